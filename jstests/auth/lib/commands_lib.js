@@ -1740,6 +1740,41 @@ var authCommandsLib = {
                 { runOnDb: secondDbName, roles: {} }
             ]
         },
+        {
+            testname: "reclaimFreeSpace",
+            command: {reclaimFreeSpace: 1},
+            skipSharded: true,
+            testcases: [
+                {
+                    runOnDb: firstDbName,
+                    roles: {
+                        dbAdmin: 1,
+                        dbAdminAnyDatabase: 1,
+                        hostManager: 1,
+                        clusterAdmin: 1,
+                        dbOwner: 1,
+                        root: 1,
+                        __system: 1
+                    },
+                    privileges: [
+                        { resource: {db: firstDbName, collection: ""}, actions: ["repairDatabase"] }
+                    ]
+                },
+                {
+                    runOnDb: secondDbName,
+                    roles: {
+                        dbAdminAnyDatabase: 1,
+                        hostManager: 1,
+                        clusterAdmin: 1,
+                        root: 1,
+                        __system: 1
+                    },
+                    privileges: [
+                        { resource: {db: secondDbName, collection: ""}, actions: ["repairDatabase"] }
+                    ]
+                }
+            ]
+        },
         {
             testname: "reIndex",
             command: {reIndex: "x"},
@@ -79,3 +79,33 @@ assert.eq( t.stats().userFlags , 0 , "userflags should be 0 now");
 assert.eq( 1, db.system.indexes.count( { key : {a:1}, expireAfterSeconds : 100 } ),
            "TTL index should be 100 now" );
 
+
+// the size class free lists are reported in collStats once records are allocated through them
+var res = db.runCommand( { "collMod" : coll , "useSizeClassFreeLists" : true } );
+debug( res );
+assert.eq( 1, res.ok, "should be able to turn on useSizeClassFreeLists" );
+assert.eq( t.stats().userFlags , 2 , "userflags should be 2 now");
+for ( var i = 0; i < 100; i++ ) {
+    t.insert( { _id : "sc" + i , s : new Array( i * 10 ).join( "x" ) } );
+}
+t.remove( { _id : /^sc[0-4]/ } );
+t.insert( { _id : "sc" , s : "" } );
+var stats = t.stats();
+assert( stats.sizeClassFreeLists , "collStats should report sizeClassFreeLists: " +
+                                  tojson( stats ) );
+assert.lt( 0, stats.sizeClassFreeLists.records );
+assert.lt( 0, stats.sizeClassFreeLists.sizeClasses.length );
+assert( t.validate( true ).valid, "collection should be valid with size class free lists" );
+
+var res = db.runCommand( { "collMod" : coll , "useSizeClassFreeLists" : false } );
+debug( res );
+assert.eq( 1, res.ok );
+assert.eq( t.stats().userFlags , 0 , "userflags should be 0 now");
+assert( !t.stats().sizeClassFreeLists );
+
+// capped collections have no free lists to index
+db.createCollection( coll + "_capped", { capped : true, size : 4096 } );
+var res = db.runCommand( { "collMod" : coll + "_capped" , "useSizeClassFreeLists" : true } );
+debug( res );
+assert.eq( 0, res.ok, "useSizeClassFreeLists shouldn't work with capped collections" );
+db[ coll + "_capped" ].drop();
@@ -0,0 +1,57 @@
+// An online compact empties the last extents of a collection into the free space of the others a
+// batch at a time, keeping the indexes up to date, and frees them.
+
+t = db.jstests_compact_online;
+t.drop();
+
+var big = new Array( 1000 ).join( "x" );
+for ( var i = 0; i < 4000; i++ ) {
+    t.insert( { _id : i , x : i % 10 , u : i , s : big } );
+}
+t.ensureIndex( { x : 1 } );
+t.ensureIndex( { u : 1 } , { unique : true } );
+assert( !db.getLastError() );
+
+// leave most of the collection as free space
+t.remove( { _id : { $mod : [ 4 , 1 ] } } );
+t.remove( { _id : { $mod : [ 4 , 2 ] } } );
+t.remove( { _id : { $mod : [ 4 , 3 ] } } );
+assert( !db.getLastError() );
+
+var before = t.stats();
+assert.eq( 1000 , before.count );
+
+var res = t.runCommand( "compact" , { online : true , batchSize : 50 } );
+assert.commandWorked( res );
+assert.lt( 0 , res.recordsMoved , tojson( res ) );
+assert.lt( 0 , res.extentsFreed , tojson( res ) );
+assert.lt( 0 , res.bytesReclaimed , tojson( res ) );
+
+var after = t.stats();
+assert.eq( 1000 , after.count );
+assert.lt( after.numExtents , before.numExtents );
+assert.lt( after.storageSize , before.storageSize );
+
+assert( t.validate().valid , "collection not valid after online compact" );
+assert.eq( 1000 , t.find().hint( { _id : 1 } ).itcount() );
+assert.eq( 1000 , t.find( { x : { $gte : 0 } } ).hint( { x : 1 } ).itcount() );
+assert.eq( 1000 , t.find( { u : { $gte : 0 } } ).hint( { u : 1 } ).itcount() );
+for ( var i = 0; i < 4000; i += 4 ) {
+    assert.eq( i , t.findOne( { u : i } ).u );
+}
+
+// the unique index still has every key
+t.insert( { _id : -1 , u : 8 } );
+assert( db.getLastError() );
+
+// nothing left to do
+res = t.runCommand( "compact" , { online : true } );
+assert.commandWorked( res );
+assert.eq( 0 , res.extentsFreed , tojson( res ) );
+
+assert.commandFailed( t.runCommand( "compact" , { online : true , batchSize : 0 } ) );
+
+t.drop();
+db.createCollection( t.getName() , { capped : true , size : 4096 } );
+assert.commandFailed( t.runCommand( "compact" , { online : true } ) );
+t.drop();
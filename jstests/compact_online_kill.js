@@ -0,0 +1,58 @@
+// An online compact killed partway through emptying an extent puts the free space of that extent
+// on the deleted lists again, so it is reused.
+
+t = db.jstests_compact_online_kill;
+t.drop();
+
+var big = new Array( 1000 ).join( "x" );
+for ( var i = 0; i < 4000; i++ ) {
+    t.insert( { _id : i , s : big } );
+}
+assert( !db.getLastError() );
+
+// leave most of the collection as free space
+t.remove( { _id : { $mod : [ 4 , 1 ] } } );
+t.remove( { _id : { $mod : [ 4 , 2 ] } } );
+t.remove( { _id : { $mod : [ 4 , 3 ] } } );
+assert( !db.getLastError() );
+
+var before = t.stats();
+var deletedBefore = t.validate().deletedSize;
+assert.lt( 0 , deletedBefore );
+
+// the compact waits after its first batch, which moves some records of the last extent, until it
+// was killed
+assert.commandWorked( db.adminCommand( { configureFailPoint : "compactOnlineHangBetweenBatches" ,
+                                         mode : "alwaysOn" } ) );
+var s = startParallelShell(
+    'var op = null; ' +
+    'assert.soon( function() { ' +
+    '    var ops = db.currentOp( { "query.compact" : "' + t.getName() + '" } ).inprog; ' +
+    '    op = ops.length ? ops[0] : null; ' +
+    '    return op && op.progressDetails && op.progressDetails.recordsMoved > 0; ' +
+    '} ); ' +
+    'db.killOp( op.opid ); ' +
+    'db.adminCommand( { configureFailPoint : "compactOnlineHangBetweenBatches" , mode : "off" } ); '
+);
+
+var res = t.runCommand( "compact" , { online : true , batchSize : 10 } );
+s();
+assert.commandFailed( res );
+
+assert( t.validate().valid , "collection not valid after killed online compact" );
+assert.eq( 1000 , t.count() );
+assert.eq( 1000 , t.find().hint( { _id : 1 } ).itcount() );
+
+// the moved records took free space elsewhere and gave back theirs, nothing was lost
+var deletedAfter = t.validate().deletedSize;
+assert.gt( deletedAfter , deletedBefore * 0.95 , "free space lost: " + deletedAfter + " of " +
+           deletedBefore + " bytes left" );
+
+// filling the holes doesn't need another extent
+for ( var i = 4000; i < 6900; i++ ) {
+    t.insert( { _id : i , s : big } );
+}
+assert( !db.getLastError() );
+assert.eq( before.numExtents , t.stats().numExtents );
+
+t.drop();
@@ -0,0 +1,57 @@
+// Check the createIndexes command, which builds its foreground indexes with one collection scan
+
+t = db.jstests_create_indexes;
+t.drop();
+
+function indexNames() {
+    return t.getIndexes().map( function( x ) { return x.name; } ).sort();
+}
+
+// creates the collection
+var res = db.runCommand( { createIndexes:t.getName(), indexes:[ { key:{ a:1 }, name:"a_1" } ] } );
+assert.commandWorked( res );
+assert( res.createdCollectionAutomatically );
+assert.eq( [ "_id_", "a_1" ], indexNames() );
+
+for( var i = 0; i < 1000; ++i ) {
+    t.insert( { _id:i, a:i, b:[ i, i + 1 ], c:"str" + i % 10, d:{ e:i % 7 } } );
+}
+assert.isnull( db.getLastError() );
+
+res = db.runCommand( { createIndexes:t.getName(),
+                       indexes:[ { key:{ a:1 }, name:"a_1" }, // already exists
+                                 { key:{ b:1 }, name:"b_1" },
+                                 { key:{ c:1, a:-1 }, name:"c_1_a_-1" },
+                                 { key:{ "d.e":"hashed" }, name:"d.e_hashed" },
+                                 { key:{ c:1 }, name:"c_1", background:true } ] } );
+assert.commandWorked( res );
+assert( !res.createdCollectionAutomatically );
+assert.eq( 2, res.numIndexesBefore );
+assert.eq( 6, res.numIndexesAfter );
+assert.eq( [ "_id_", "a_1", "b_1", "c_1", "c_1_a_-1", "d.e_hashed" ], indexNames() );
+
+var v = t.validate( true );
+assert( v.valid );
+assert.eq( 2000, v.keysPerIndex[ t.getFullName() + ".$b_1" ] );
+assert.eq( 1000, t.find().hint( { c:1, a:-1 } ).itcount() );
+assert.eq( 100, t.find( { c:"str3" } ).hint( { c:1, a:-1 } ).itcount() );
+assert.eq( 143, t.find( { "d.e":3 } ).hint( { "d.e":"hashed" } ).itcount() );
+
+// a failure removes every index of the shared scan
+t.insert( { _id:-1, a:5, c:"str5" } );
+res = db.runCommand( { createIndexes:t.getName(),
+                       indexes:[ { key:{ c:-1 }, name:"c_-1" },
+                                 { key:{ a:1, c:1 }, name:"a_1_c_1", unique:true } ] } );
+assert.commandFailed( res );
+assert.eq( 11000, res.code );
+assert.eq( [ "_id_", "a_1", "b_1", "c_1", "c_1_a_-1", "d.e_hashed" ], indexNames() );
+
+assert.commandFailed( db.runCommand( { createIndexes:t.getName(), indexes:{ key:{ x:1 } } } ) );
+assert.commandFailed( db.runCommand( { createIndexes:t.getName(), indexes:[] } ) );
+
+// reIndex rebuilds the indexes together
+assert.commandWorked( t.reIndex() );
+assert.eq( [ "_id_", "a_1", "b_1", "c_1", "c_1_a_-1", "d.e_hashed" ], indexNames() );
+assert( t.validate( true ).valid );
+
+t.drop();
@@ -0,0 +1,40 @@
+// test recovery of journal files written with and without compression (journalCompression)
+
+var path = MongoRunner.dataDir + "/nocompress";
+
+function work(conn, n) {
+    var d = conn.getDB("nocompress");
+    for (var i = 0; i < 1000; i++) {
+        d.foo.insert({ _id: n * 1000 + i, n: n, s: "some compressible text some compressible text" });
+    }
+    d.foo.update({ n: n }, { $set: { done: true } }, false, true);
+    assert.isnull(d.runCommand({ getlasterror: 1, j: true }).err);
+}
+
+function verify(conn, n) {
+    var d = conn.getDB("nocompress");
+    assert.eq(1000 * n, d.foo.count(), "nocompress.js wrong count");
+    assert.eq(1000 * n, d.foo.count({ done: true }), "nocompress.js update lost");
+}
+
+// uncompressed journal, recovered by a server which would write compressed ones
+var conn = startMongodEmpty("--port", 30001, "--dbpath", path, "--dur", "--smallfiles",
+                            "--setParameter", "journalCompression=false");
+work(conn, 1);
+print("nocompress.js kill -9 uncompressed");
+stopMongod(30001, /*signal*/9);
+
+conn = startMongodNoReset("--port", 30002, "--dbpath", path, "--dur", "--smallfiles");
+verify(conn, 1);
+
+// and the other way around
+work(conn, 2);
+print("nocompress.js kill -9 compressed");
+stopMongod(30002, /*signal*/9);
+
+conn = startMongodNoReset("--port", 30003, "--dbpath", path, "--dur", "--smallfiles",
+                          "--setParameter", "journalCompression=false");
+verify(conn, 2);
+stopMongod(30003);
+
+print("SUCCESS nocompress.js");
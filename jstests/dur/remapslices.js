@@ -0,0 +1,50 @@
+// test that remapping the private views a slice at a time, with the data files a section behind
+// the journal, neither loses writes in the running server nor on recovery
+
+var path = MongoRunner.dataDir + "/remapslices";
+var ndbs = 8;
+var N = 2000;
+
+// a 1ms slice makes nearly every remap leave a backlog for the following passes
+var conn = startMongodEmpty("--port", 30001, "--dbpath", path, "--dur", "--smallfiles",
+                            "--setParameter", "journalRemapSliceMillis=1");
+
+function work(conn) {
+    for (var i = 0; i < N; i++) {
+        var d = conn.getDB("remapslices" + (i % ndbs));
+        d.foo.insert({ _id: i, x: i });
+        if (i % 3 == 0)
+            d.foo.update({ _id: i }, { $set: { y: i } });
+    }
+    conn.getDB("remapslices0").getLastError();
+}
+
+function verify(conn, when) {
+    var total = 0;
+    for (var k = 0; k < ndbs; k++) {
+        var d = conn.getDB("remapslices" + k);
+        total += d.foo.count();
+        d.foo.find({ _id: { $mod: [3, 0] } }).forEach(function (o) {
+            assert.eq(o._id, o.y, "remapslices.js " + when + " update lost for " + tojson(o));
+        });
+    }
+    assert.eq(N, total, "remapslices.js " + when + " wrong count");
+}
+
+work(conn);
+// let the durability thread go through enough passes to remap everything a few times
+sleep(3000);
+verify(conn, "before restart");
+
+work(conn); // duplicates, so nothing changes but the journal
+assert.isnull(conn.getDB("remapslices0").runCommand({ getlasterror: 1, j: true }).err);
+
+print("remapslices.js kill -9");
+stopMongod(30001, /*signal*/9);
+
+print("remapslices.js restart and recover");
+conn = startMongodNoReset("--port", 30002, "--dbpath", path, "--dur", "--smallfiles");
+verify(conn, "after recovery");
+stopMongod(30002);
+
+print("SUCCESS remapslices.js");
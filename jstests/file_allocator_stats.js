@@ -0,0 +1,39 @@
+// serverStatus reports how long data files took to allocate and how long writes waited on them,
+// and the rate new files are zero filled at can be limited.
+
+var fa = db.serverStatus().fileAllocator;
+assert( fa , "no fileAllocator section" );
+assert.lte( 0 , fa.filesAllocated );
+assert.lte( fa.filesZeroFilled , fa.filesAllocated );
+assert.lte( fa.allocationMillis.max , fa.allocationMillis.total );
+assert.lte( fa.waits.maxMillis , fa.waits.totalMillis );
+
+var admin = db.getSisterDB( "admin" );
+var old = admin.runCommand( { getParameter : 1 , fileAllocatorMaxZeroFillMBPerSec : 1 } );
+assert.commandWorked( old );
+
+assert.commandWorked( admin.runCommand( { setParameter : 1 ,
+                                          fileAllocatorMaxZeroFillMBPerSec : 50 } ) );
+assert.eq( 50 , db.serverStatus().fileAllocator.maxZeroFillMBPerSec );
+assert.commandFailed( admin.runCommand( { setParameter : 1 ,
+                                          fileAllocatorMaxZeroFillMBPerSec : -1 } ) );
+
+// a new database needs new files, which it waits for and which don't wait on the throttle
+var testDB = db.getSisterDB( "jstests_file_allocator_stats" );
+testDB.dropDatabase();
+var before = db.serverStatus().fileAllocator;
+testDB.foo.insert( { x : 1 } );
+assert( !testDB.getLastError() );
+var after = db.serverStatus().fileAllocator;
+assert.gt( after.filesAllocated , before.filesAllocated );
+assert.gt( after.bytesAllocated , before.bytesAllocated );
+assert.gt( after.allocationMillis.total , before.allocationMillis.total );
+assert.lt( 0 , after.allocationMillis.last );
+assert.gt( after.waits.count , before.waits.count );
+testDB.dropDatabase();
+
+assert.commandWorked( admin.runCommand( { setParameter : 1 ,
+                                          fileAllocatorMaxZeroFillMBPerSec :
+                                              old.fileAllocatorMaxZeroFillMBPerSec } ) );
+
+assert.commandWorked( admin.runCommand( { getParameter : 1 , preallocateMaxFilesAhead : 1 } ) );
@@ -0,0 +1,48 @@
+// Check foreground index builds which generate and sort keys with several threads
+
+t = db.jstests_index_parallel_build;
+t.drop();
+
+var old = db.adminCommand( { getParameter:1, indexBuildThreads:1, parallelIndexBuildMinRecords:1 } );
+assert.commandWorked( db.adminCommand( { setParameter:1, indexBuildThreads:4,
+                                         parallelIndexBuildMinRecords:1 } ) );
+
+// spread the documents over many extents
+var N = 20000;
+for( var i = 0; i < N; ++i ) {
+    t.insert( { _id:i, a:i % 1000, b:[ i, -i ], s:"str" + ( N - i ) } );
+}
+assert.isnull( db.getLastError() );
+
+t.ensureIndex( { a:1, s:1 } );
+assert.isnull( db.getLastError() );
+t.ensureIndex( { b:1 } );
+assert.isnull( db.getLastError() );
+t.ensureIndex( { a:"hashed" } );
+assert.isnull( db.getLastError() );
+
+var v = t.validate( true );
+assert( v.valid );
+assert.eq( 2 * N, v.keysPerIndex[ t.getFullName() + ".$b_1" ] );
+assert( t.find( { b:1 } ).hint( { b:1 } ).explain().isMultiKey );
+assert.eq( N, t.find().hint( { a:1, s:1 } ).itcount() );
+assert.eq( 20, t.find( { a:7 } ).hint( { a:"hashed" } ).itcount() );
+
+// keys come out of the merge in order
+var last = null;
+t.find( {}, { _id:0, a:1, s:1 } ).hint( { a:1, s:1 } ).forEach( function( o ) {
+    if ( last ) {
+        assert( last.a < o.a || ( last.a == o.a && last.s < o.s ), tojson( last ) + " " + tojson( o ) );
+    }
+    last = o;
+} );
+
+// duplicates found in different threads' keys still fail a unique index
+t.ensureIndex( { a:1 }, { unique:true } );
+assert.eq( 11000, db.getLastErrorObj().code );
+assert.eq( 4, t.getIndexes().length );
+
+assert.commandWorked( db.adminCommand( { setParameter:1,
+                                         indexBuildThreads:old.indexBuildThreads,
+                                         parallelIndexBuildMinRecords:old.parallelIndexBuildMinRecords } ) );
+t.drop();
@@ -0,0 +1,68 @@
+// Check that v:2 (prefix compressed) indexes return the same results as v:1 indexes and are smaller
+
+t = db.jstests_index_v2;
+t.drop();
+
+var key = { tenant:1, user:1, ts:1 };
+var name = "tenant_1_user_1_ts_1";
+
+function doc( i ) {
+    return { _id:i, tenant:"tenant-" + ( 100000 + i % 7 ),
+             user:"user-account-" + ( 1000000 + i % 301 ), ts:new Date( 1380000000000 + i ) };
+}
+
+function check( version ) {
+    assert.eq( version, t.getIndexes().filter( function( x ) { return x.name == name; } )[ 0 ].v );
+    assert( t.validate( true ).valid, "validate v:" + version );
+    var count = t.count();
+    assert.eq( count, t.find( {}, { _id:0, tenant:1, user:1, ts:1 } ).hint( key ).itcount() );
+    for( var i = 0; i < 5000; i += 97 ) {
+        var d = doc( i );
+        assert.eq( t.count( { _id:i } ), t.find( d ).hint( key ).itcount(), "lookup " + i );
+    }
+    var expected = t.find( { tenant:"tenant-100003" } ).hint( { $natural:1 } ).sort( { _id:1 } ).toArray();
+    var actual = t.find( { tenant:"tenant-100003" } ).hint( key ).toArray();
+    actual.sort( function( a, b ) { return a._id - b._id; } );
+    assert.eq( expected, actual );
+    return t.stats().indexSizes[ name ];
+}
+
+// incremental inserts and removes, which split, balance and merge buckets
+function incremental( version ) {
+    t.drop();
+    t.ensureIndex( key, { v:version } );
+    for( var i = 0; i < 5000; ++i ) {
+        t.insert( doc( i ) );
+    }
+    assert.isnull( db.getLastError() );
+    check( version );
+    t.remove( { _id:{ $mod:[ 3, 0 ] } } );
+    t.remove( { _id:{ $gte:1000, $lt:3000 } } );
+    assert.isnull( db.getLastError() );
+    check( version );
+    for( var i = 1000; i < 3000; ++i ) {
+        t.insert( doc( i ) );
+    }
+    assert.isnull( db.getLastError() );
+    return check( version );
+}
+
+// bulk build from existing documents
+function bulk( version ) {
+    t.drop();
+    for( var i = 0; i < 5000; ++i ) {
+        t.insert( doc( i ) );
+    }
+    t.ensureIndex( key, { v:version } );
+    assert.isnull( db.getLastError() );
+    return check( version );
+}
+
+incremental( 1 );
+incremental( 2 );
+
+var v1Size = bulk( 1 );
+var v2Size = bulk( 2 );
+assert.lt( v2Size, v1Size, "v:2 index is not smaller" );
+
+t.drop();
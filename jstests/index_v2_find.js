@@ -0,0 +1,47 @@
+// Check lookups through v:2 indexes, whose searches compare codes of the first key field before the keys
+
+t = db.jstests_index_v2_find;
+
+var values = [ MinKey, null, -1e300, -2, -1.5, -0, 0, 1e-300, 1, NumberLong( 3000000000 ), 1e300,
+               "", "a", "abcdefg", "abcdefgh", "abcdefgi", "abcdefgh\u0000", "b",
+               ObjectId( "000000000000000000000000" ), ObjectId( "ffffffffffffffffffffffff" ),
+               false, true, new Date( -1000 ), new Date( 0 ), new Date( 1000 ), { a:1 },
+               MaxKey ];
+
+function check( key ) {
+    t.drop();
+    t.ensureIndex( key, { v:2 } );
+    var id = 0;
+    for( var r = 0; r < 200; ++r ) {
+        values.forEach( function( v ) { t.insert( { _id:id++, a:v, b:r % 3 } ); } );
+    }
+    assert.isnull( db.getLastError() );
+    assert( t.validate( true ).valid );
+
+    values.forEach( function( v ) {
+        var q = { a:v, b:1 };
+        assert.eq( t.find( q ).hint( { $natural:1 } ).itcount(), t.find( q ).hint( key ).itcount(),
+                   tojson( key ) + " " + tojson( q ) );
+    } );
+
+    assert.eq( t.count(), t.find( {}, { _id:0, a:1, b:1 } ).hint( key ).itcount() );
+}
+
+check( { a:1, b:1 } );
+check( { a:-1, b:1 } );
+
+// inserts and removes locate keys with BtreeBucket::find()
+t.drop();
+t.ensureIndex( { a:1 }, { v:2, unique:true } );
+var distinct = values.filter( function( v ) { return !( v === 0 && 1 / v < 0 ); } ); // -0 == 0
+distinct.forEach( function( v, i ) { t.insert( { _id:i, a:v } ); } );
+assert.isnull( db.getLastError() );
+distinct.forEach( function( v, i ) {
+    t.insert( { _id:"dup" + i, a:v } );
+    assert.eq( 11000, db.getLastErrorObj().code, tojson( v ) );
+} );
+distinct.forEach( function( v, i ) { t.remove( { _id:i } ); } );
+assert.eq( 0, t.find().hint( { a:1 } ).itcount() );
+assert( t.validate( true ).valid );
+
+t.drop();
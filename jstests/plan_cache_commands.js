@@ -4,6 +4,7 @@
  * Cache-wide Commands
  * - planCacheListKeys
  * - planCacheClear
+ * - planCacheStats
  *
  * Query-specific Commands
  * - planCacheGenerateKey
@@ -278,6 +279,50 @@ assert.eq(0, getKeys().length, 'plan cache should be empty after successful plan
 
 
 
+//
+// Tests for planCacheStats
+// Returns the size of the collection's plan cache and its hit, miss, eviction and replan counts.
+//
+
+// Utility function to get plan cache stats.
+function getStats() {
+    var res = t.runCommand('planCacheStats');
+    print('planCacheStats() = ' + tojson(res));
+    assert.commandWorked(res, 'planCacheStats failed');
+    return res;
+}
+
+var statsBefore = getStats();
+assert.eq(0, statsBefore.entries, 'plan cache should be empty after planCacheClear()');
+assert.eq(0, statsBefore.sizeBytes, 'empty plan cache should have no size');
+
+// The first run misses and caches its plan, the second one hits.
+assert.eq(1, t.find(queryA1, projectionA1).sort(sortA1).itcount(), 'unexpected document count');
+assert.eq(1, t.find(queryA1, projectionA1).sort(sortA1).itcount(), 'unexpected document count');
+var stats = getStats();
+assert.eq(1, stats.entries, 'plan cache should hold the query after running it');
+assert.gt(stats.sizeBytes, 0, 'cached query should have a size');
+assert.eq(statsBefore.misses + 1, stats.misses, 'first run of the query should miss');
+assert.eq(statsBefore.hits + 1, stats.hits, 'second run of the query should hit');
+var metrics = db.serverStatus().metrics.queryExecutor.planCache;
+assert.gte(metrics.hits, stats.hits, 'serverStatus plan cache hits should include collection');
+
+// With room for a single entry, caching a second query shape evicts the first.
+var oldMaxEntries = db.adminCommand({getParameter: 1, internalQueryPlanCacheMaxEntries: 1});
+assert.commandWorked(oldMaxEntries);
+assert.commandWorked(db.adminCommand({setParameter: 1, internalQueryPlanCacheMaxEntries: 1}));
+assert.eq(1, t.find({a: {$gt: 0}}, projectionA1).sort(sortA1).itcount(),
+          'unexpected document count');
+assert.commandWorked(db.adminCommand({setParameter: 1, internalQueryPlanCacheMaxEntries:
+                                      oldMaxEntries.internalQueryPlanCacheMaxEntries}));
+stats = getStats();
+assert.eq(1, stats.entries, 'plan cache should hold a single query');
+assert.eq(statsBefore.evictions + 1, stats.evictions, 'first query should have been evicted');
+res = t.runCommand('planCacheClear');
+assert.commandWorked(res, 'planCacheClear failed');
+
+
+
 //
 // Query Plan Revision
 // http://docs.mongodb.org/manual/core/query-plans/#query-plan-revision
@@ -0,0 +1,38 @@
+// Candidate plans which the index statistics show to be much more expensive than the best one
+// are pruned before the plans are raced, and explain shows the estimated costs.
+
+t = db.jstests_plan_cost_pruning;
+t.drop();
+
+t.ensureIndex( { a:1 } );
+t.ensureIndex( { b:1 } );
+for( i = 0; i < 20000; ++i ) {
+    t.insert( { a:i, b:i % 2 } );
+}
+assert.eq( null, db.getLastError() );
+
+function explainQuery() {
+    return t.find( { a:{ $gte:5, $lte:10 }, b:{ $gte:0 } } ).explain( true );
+}
+
+// Only the scan of the selective index on a is run.
+explain = explainQuery();
+assert.eq( 6, explain.n );
+assert.eq( "BtreeCursor a_1", explain.cursor );
+assert.eq( 1, explain.allPlans.length, tojson( explain ) );
+assert( explain.hasOwnProperty( "nscannedEstimate" ), tojson( explain ) );
+assert( explain.hasOwnProperty( "nscannedObjectsEstimate" ), tojson( explain ) );
+assert.gte( 100, explain.nscannedEstimate );
+
+// Without pruning both indexes are raced, the estimates are still reported for each.
+assert.commandWorked( db.adminCommand( { setParameter:1, internalQueryPlanCostPruneFactor:0 } ) );
+explain = explainQuery();
+assert.eq( 6, explain.n );
+assert.eq( "BtreeCursor a_1", explain.cursor );
+assert.eq( 2, explain.allPlans.length, tojson( explain ) );
+explain.allPlans.forEach( function( x ) {
+                             assert( x.hasOwnProperty( "nscannedEstimate" ), tojson( x ) );
+                         } );
+assert.commandWorked( db.adminCommand( { setParameter:1, internalQueryPlanCostPruneFactor:10 } ) );
+
+t.drop();
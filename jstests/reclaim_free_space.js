@@ -0,0 +1,53 @@
+// reclaimFreeSpace gives the disk space of free extents back to the filesystem, and dbStats reports
+// how much of it could be and has been.
+
+var testDB = db.getSiblingDB( "jstests_reclaim_free_space" );
+testDB.dropDatabase();
+
+var keep = testDB.keep;
+var dropped = testDB.dropped;
+keep.insert( { _id : 0 } );
+
+var big = new Array( 10 * 1024 ).join( "x" );
+for ( var i = 0; i < 2000; i++ ) {
+    dropped.insert( { _id : i , s : big } );
+}
+assert( !testDB.getLastError() );
+dropped.drop();
+
+var before = testDB.stats();
+assert.lt( 0 , before.reclaimableSize , tojson( before ) );
+assert.eq( 0 , before.reclaimedSize , tojson( before ) );
+
+var res = testDB.runCommand( { reclaimFreeSpace : 1 } );
+if ( !res.ok ) {
+    // holes can't be punched on this platform or filesystem
+    print( "skipping reclaimFreeSpace test: " + tojson( res ) );
+}
+else {
+    assert.lte( 0 , res.filesDeleted , tojson( res ) );
+    var after = testDB.stats();
+    assert.eq( 0 , after.reclaimableSize , tojson( after ) );
+    assert.eq( res.bytesPunched , after.reclaimedSize , tojson( after ) );
+    assert.lt( 0 , res.bytesPunched + res.bytesDeleted , tojson( res ) );
+
+    // nothing more to do
+    res = testDB.runCommand( { reclaimFreeSpace : 1 } );
+    assert.commandWorked( res );
+    assert.eq( 0 , res.bytesPunched , tojson( res ) );
+    assert.eq( 0 , res.filesDeleted , tojson( res ) );
+
+    // punched extents are reused like any other
+    for ( var i = 0; i < 2000; i++ ) {
+        testDB.reused.insert( { _id : i , s : big } );
+    }
+    assert( !testDB.getLastError() );
+    assert.eq( 2000 , testDB.reused.find().itcount() );
+    assert( testDB.reused.validate().valid );
+    if ( after.reclaimedSize > 0 ) {
+        assert.gt( after.reclaimedSize , testDB.stats().reclaimedSize );
+    }
+}
+
+assert.eq( 1 , keep.find().itcount() );
+testDB.dropDatabase();
@@ -0,0 +1,77 @@
+// Secondaries spread the ops on one collection over their writer threads by _id.  Check that
+// the ops on each document still apply in order, and that collections whose secondary unique
+// indexes could observe reordering replicate correctly too.
+
+var rt = new ReplSetTest( { name : "apply_ops_by_document" , nodes: 2, oplogSize: 100 } );
+rt.startSet();
+rt.initiate();
+rt.awaitSecondaryNodes();
+
+var primary = rt.getPrimary();
+var secondary = rt.getSecondary();
+var testDB = primary.getDB("test");
+
+testDB.docs.insert( { _id : -1 } );
+testDB.uniq.ensureIndex( { k : 1 } , { unique : true } );
+testDB.getLastError(2);
+
+var n = 2000;
+for ( var i = 0; i < n; i++ ) {
+    testDB.docs.insert( { _id : i , x : 0 } );
+    // the key moves from document to document, so their ops must not be reordered
+    testDB.uniq.remove( { k : 1 } );
+    testDB.uniq.insert( { _id : i , k : 1 } );
+}
+for ( var round = 1; round <= 3; round++ ) {
+    for ( var i = 0; i < n; i++ ) {
+        testDB.docs.update( { _id : i } , { $set : { x : round } } );
+    }
+}
+for ( var i = 0; i < n; i += 2 ) {
+    testDB.docs.remove( { _id : i } );
+}
+testDB.getLastError(2);
+
+var secondaryDB = secondary.getDB("test");
+secondary.setSlaveOk();
+
+assert.eq( n / 2 + 1 , secondaryDB.docs.count() );
+assert.eq( n / 2 , secondaryDB.docs.count( { x : 3 } ) );
+assert.eq( 0 , secondaryDB.docs.count( { _id : { $mod : [ 2 , 0 ] } } ) );
+assert.eq( 1 , secondaryDB.uniq.count() );
+assert.eq( n - 1 , secondaryDB.uniq.findOne()._id );
+
+// _ids of different types which compare equal name one document, so a delete and an insert
+// of it in the same batch must not be reordered
+testDB.mixed.insert( { _id : "create" } );
+testDB.getLastError(2);
+var secondaryAdmin = secondary.getDB("admin");
+assert.commandWorked( secondaryAdmin.runCommand( { configureFailPoint : "rsSyncApplyStop" ,
+                                                   mode : "alwaysOn" } ) );
+for ( var i = 0; i < 200; i++ ) {
+    testDB.mixed.insert( { _id : i , t : "double" } );
+    testDB.mixed.remove( { _id : i } );
+    testDB.mixed.insert( { _id : NumberInt( i ) , t : "int" } );
+    testDB.mixed.remove( { _id : i } );
+    testDB.mixed.insert( { _id : NumberLong( i ) , t : "long" } );
+}
+testDB.mixed.insert( { _id : -0.0 , t : "negative zero" } );
+testDB.mixed.remove( { _id : 0.0 } );
+testDB.mixed.insert( { _id : -0.0 , t : "negative zero again" } );
+assert.eq( null , testDB.getLastError() );
+assert.commandWorked( secondaryAdmin.runCommand( { configureFailPoint : "rsSyncApplyStop" ,
+                                                   mode : "off" } ) );
+rt.awaitReplication();
+
+assert.eq( testDB.mixed.count() , secondaryDB.mixed.count() );
+assert.eq( 199 , secondaryDB.mixed.count( { t : "long" } ) );
+assert.eq( "negative zero again" , secondaryDB.mixed.findOne( { _id : 0 } ).t );
+testDB.mixed.find().forEach( function( doc ) {
+    assert.eq( doc , secondaryDB.mixed.findOne( { _id : doc._id } ) );
+} );
+
+var metrics = secondaryDB.serverStatus().metrics.repl.apply;
+printjson( metrics );
+assert( metrics.opsSpreadById > 0 , "no ops spread by _id" );
+
+rt.stopSet();
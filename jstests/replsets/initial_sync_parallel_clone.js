@@ -0,0 +1,58 @@
+// Initial sync clones several collections at once and builds their non-unique indexes right
+// after each collection's data.  Check that every collection and index arrives, including the
+// unique indexes which are only built after the oplog is applied.
+
+var rt = new ReplSetTest( { name : "initial_sync_parallel_clone" , nodes : 1 } );
+rt.startSet();
+rt.initiate();
+var master = rt.getMaster();
+
+var dbNames = [ "a" , "b" ];
+var numColls = 6;
+var numDocs = 2000;
+dbNames.forEach( function( dbName ) {
+    var mdb = master.getDB( dbName );
+    for ( var c = 0; c < numColls; c++ ) {
+        var coll = mdb[ "c" + c ];
+        for ( var i = 0; i < numDocs; i++ ) {
+            coll.insert( { _id : i , x : i % 10 , u : i } );
+        }
+        coll.ensureIndex( { x : 1 } );
+        coll.ensureIndex( { u : 1 } , { unique : true } );
+    }
+    assert.eq( null , mdb.getLastError() );
+} );
+
+// add a secondary which clones over three connections
+var slave = rt.add();
+assert.commandWorked( slave.getDB( "admin" ).runCommand( { setParameter : 1 ,
+                                                           initialSyncCloneThreads : 3 } ) );
+rt.reInitiate();
+
+// keep writing while the secondary clones
+var mc = master.getDB( "a" ).c0;
+for ( var i = numDocs; i < numDocs + 500; i++ ) {
+    mc.insert( { _id : i , x : i % 10 , u : i } );
+}
+mc.update( {} , { $inc : { x : 1 } } , false , true );
+assert.eq( null , master.getDB( "a" ).getLastError() );
+
+rt.awaitSecondaryNodes();
+rt.awaitReplication();
+
+slave.setSlaveOk();
+dbNames.forEach( function( dbName ) {
+    for ( var c = 0; c < numColls; c++ ) {
+        var name = "c" + c;
+        assert.eq( master.getDB( dbName )[ name ].count() , slave.getDB( dbName )[ name ].count() ,
+                   dbName + "." + name + " count" );
+        var indexes = slave.getDB( dbName ).system.indexes.find( { ns : dbName + "." + name } );
+        assert.eq( 3 , indexes.count() , dbName + "." + name + " indexes" );
+        assert.eq( 1 , slave.getDB( dbName ).system.indexes.find( { ns : dbName + "." + name ,
+                                                                    key : { u : 1 } ,
+                                                                    unique : true } ).count() );
+    }
+} );
+assert.eq( numDocs + 500 , slave.getDB( "a" ).c0.find( { x : { $gte : 1 } } ).count() );
+
+rt.stopSet();
@@ -0,0 +1,59 @@
+// An initial sync whose clone fails part way through retries from the same sync source and keeps
+// the collections it cloned, even when another member could be synced from.
+
+var rt = new ReplSetTest( { name : "initial_sync_resume_clone" , nodes : 2 } );
+rt.startSet();
+rt.initiate();
+var master = rt.getMaster();
+rt.awaitSecondaryNodes();
+
+var numColls = 6;
+var numDocs = 500;
+var mdb = master.getDB( "test" );
+for ( var c = 0; c < numColls; c++ ) {
+    for ( var i = 0; i < numDocs; i++ ) {
+        mdb[ "c" + c ].insert( { _id : i , x : i } );
+    }
+}
+assert.eq( null , mdb.getLastError( 2 ) );
+
+// the new member fails its clone once three collections are in
+var slave = rt.add();
+var slaveAdmin = slave.getDB( "admin" );
+assert.commandWorked( slaveAdmin.runCommand( { setParameter : 1 , initialSyncCloneThreads : 1 } ) );
+assert.commandWorked( slaveAdmin.runCommand( { configureFailPoint : "initialSyncCloneFail" ,
+                                               mode : "alwaysOn" ,
+                                               data : { afterCollections : 3 } } ) );
+rt.reInitiate();
+
+function countLogLines( regex ) {
+    var log = slaveAdmin.runCommand( { getLog : "global" } ).log;
+    return log.filter( function( line ) { return regex.test( line ); } ).length;
+}
+
+assert.soon( function() {
+    return countLogLines( /initial sync clone failing by request/ ) > 0;
+} , "clone didn't fail" , 5 * 60 * 1000 );
+
+// writes during the failed attempt reach the resumed clone through the oplog
+mdb.c0.update( {} , { $inc : { x : 1 } } , false , true );
+mdb.c5.insert( { _id : numDocs , x : numDocs } );
+assert.eq( null , mdb.getLastError() );
+
+assert.commandWorked( slaveAdmin.runCommand( { configureFailPoint : "initialSyncCloneFail" ,
+                                               mode : "off" } ) );
+
+rt.awaitSecondaryNodes();
+rt.awaitReplication();
+
+assert.eq( 1 , countLogLines( /initial sync drop all databases/ ) , "clone started over" );
+assert.eq( 1 , countLogLines( /initial sync resuming the clone/ ) , "clone not resumed" );
+
+slave.setSlaveOk();
+var sdb = slave.getDB( "test" );
+for ( var c = 0; c < numColls; c++ ) {
+    assert.eq( mdb[ "c" + c ].count() , sdb[ "c" + c ].count() , "c" + c + " count" );
+}
+assert.eq( numDocs , sdb.c0.count( { $where : "this.x == this._id + 1" } ) );
+
+rt.stopSet();
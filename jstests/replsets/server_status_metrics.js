@@ -10,6 +10,8 @@ function testSecondaryMetrics(secondary, opCount, offset) {
     assert(ss.metrics.repl.network.getmores.totalMillis > 0, "no getmores time")
     assert.eq(ss.metrics.repl.network.ops, opCount + offset, "wrong number of ops retrieved")
     assert(ss.metrics.repl.network.bytes > 0, "zero or missing network bytes")
+    assert(ss.metrics.repl.network.bytesPerSecond >= 0, "network bytes/sec missing")
+    assert(ss.metrics.repl.network.lagSecs >= 0, "network lag missing")
 
     assert(ss.metrics.repl.buffer.count >= 0, "buffer count missing")
     assert(ss.metrics.repl.buffer.sizeBytes >= 0, "size (bytes)] missing")
@@ -19,10 +21,18 @@ function testSecondaryMetrics(secondary, opCount, offset) {
     assert(ss.metrics.repl.preload.docs.totalMillis  >= 0, "preload.docs time missing")
     assert(ss.metrics.repl.preload.docs.num >= 0, "preload.indexes num missing")
     assert(ss.metrics.repl.preload.indexes.totalMillis >= 0, "preload.indexes time missing")
+    assert(ss.metrics.repl.preload.advise.num >= 0, "preload.advise num missing")
+    assert(ss.metrics.repl.preload.pages.inMemory >= 0, "preload.pages.inMemory missing")
+    assert(ss.metrics.repl.preload.pages.advised >= 0, "preload.pages.advised missing")
+    assert(ss.metrics.repl.preload.pages.touched >= 0, "preload.pages.touched missing")
 
     assert(ss.metrics.repl.apply.batches.num > 0, "no batches")
     assert(ss.metrics.repl.apply.batches.totalMillis > 0, "no batch time")
     assert.eq(ss.metrics.repl.apply.ops, opCount + offset, "wrong number of applied ops")
+
+    assert(ss.metrics.repl.apply.opsSpreadById > 0, "no ops of test.a spread over writers by _id")
+    assert(ss.metrics.repl.apply.busiestWriterOps <= ss.metrics.repl.apply.ops,
+           "busiest writers applied more than their batches")
 }
 
 var rt = new ReplSetTest( { name : "server_status_metrics" , nodes: 2, oplogSize: 100 } );
@@ -0,0 +1,48 @@
+// With collectionLevelLocking, updates of existing collections take a collection lock like inserts
+// do.  Updates that grow and move documents on several collections of one database run together
+// and leave every collection and its indexes valid.
+
+var conn = MongoRunner.runMongod( { setParameter : "collectionLevelLocking=true" } );
+var testDB = conn.getDB( "test" );
+
+var NColls = 3;
+var N = 500;
+for ( var c = 0; c < NColls; c++ ) {
+    var t = testDB[ "collection_write_updates" + c ];
+    t.ensureIndex( { x : 1 } );
+    for ( var i = 0; i < N; i++ ) {
+        t.insert( { _id : i , x : i , s : "" } );
+    }
+    assert.eq( null , testDB.getLastError() );
+}
+
+var shells = [];
+for ( var c = 0; c < NColls; c++ ) {
+    shells.push( startParallelShell(
+        'var t = db.getSisterDB( "test" ).collection_write_updates' + c + '; ' +
+        'var big = ""; ' +
+        'for ( var round = 0; round < 5; round++ ) { ' +
+        '    big += new Array( 200 ).join( "y" ); ' +
+        '    t.update( {} , { $set : { s : big } , $inc : { x : 1 } } , false , true ); ' +
+        '    assert.eq( null , db.getLastError() ); ' +
+        '    t.update( { _id : ' + N + ' } , { $set : { x : -1 } } , true ); ' +
+        '    assert.eq( null , db.getLastError() ); ' +
+        '} ',
+        conn.port ) );
+}
+shells.forEach( function( s ) { s(); } );
+
+// an upsert into a missing collection creates it under the database lock
+testDB.collection_write_updates_new.update( { _id : 1 } , { $set : { x : 1 } } , true );
+assert.eq( null , testDB.getLastError() );
+assert.eq( 1 , testDB.collection_write_updates_new.count() );
+
+for ( var c = 0; c < NColls; c++ ) {
+    var t = testDB[ "collection_write_updates" + c ];
+    assert( t.validate( true ).valid , t.getName() + " not valid" );
+    assert.eq( N + 1 , t.count() );
+    assert.eq( N , t.find( { x : { $gte : 5 } } ).hint( { x : 1 } ).itcount() );
+    assert.eq( 1 , t.find( { x : -1 } ).hint( { x : 1 } ).itcount() );
+}
+
+MongoRunner.stopMongod( conn.port );
@@ -0,0 +1,70 @@
+// The TTL monitor deletes expired documents in batches walking the ttl index, keeps to
+// ttlMaxDocsPerSecond, and serverStatus reports how far behind each ttl index is.
+
+var conn = MongoRunner.runMongod( { setParameter : "ttlMonitorSleepSecs=1" } );
+var testDB = conn.getDB( "test" );
+var admin = conn.getDB( "admin" );
+var t = testDB.ttl_batched;
+
+assert.commandWorked( admin.runCommand( { setParameter : 1 , ttlDeleteBatchSize : 10 } ) );
+assert.commandWorked( admin.runCommand( { setParameter : 1 , ttlMaxDocsPerSecond : 100 } ) );
+assert.commandWorked( admin.runCommand( { setParameter : 1 , ttlMonitorEnabled : false } ) );
+
+var now = ( new Date() ).getTime();
+for ( var i = 0; i < 500; i++ ) {
+    t.insert( { x : new Date( now - 3600 * 1000 - i ) , i : i } );
+}
+for ( var i = 0; i < 50; i++ ) {
+    t.insert( { x : new Date( now + 3600 * 1000 ) , i : i } );
+}
+t.insert( { x : true } );
+t.insert( { x : "not a date" } );
+t.insert( { x : [ new Date( now - 7200 * 1000 ) , new Date( now - 7300 * 1000 ) ] } );
+t.ensureIndex( { x : -1 } , { expireAfterSeconds : 60 } );
+assert.eq( null , testDB.getLastError() );
+assert.eq( 553 , t.count() );
+
+function ttlIndexStats() {
+    var indexes = testDB.serverStatus().ttl.indexes;
+    for ( var i = 0; i < indexes.length; i++ ) {
+        if ( indexes[i].ns == t.getFullName() )
+            return indexes[i];
+    }
+    return null;
+}
+
+var start = new Date();
+var metricsBefore = testDB.serverStatus().metrics.ttl;
+assert.commandWorked( admin.runCommand( { setParameter : 1 , ttlMonitorEnabled : true } ) );
+
+// an hour behind until the backlog is deleted
+assert.soon( function() {
+    var stats = ttlIndexStats();
+    return stats && stats.lagSecs > 3000;
+} , "no lag reported" , 60 * 1000 );
+
+assert.soon( function() { return t.count() == 52; } , "expired documents not deleted" , 60 * 1000 );
+var elapsed = new Date() - start;
+
+// 501 documents at no more than 100 a second
+assert.lte( 4000 , elapsed , "deleted faster than ttlMaxDocsPerSecond" );
+
+var metrics = testDB.serverStatus().metrics.ttl;
+assert.lte( metricsBefore.deletedDocuments + 501 , metrics.deletedDocuments );
+assert.lte( metricsBefore.batches + 51 , metrics.batches );
+
+assert.soon( function() { return ttlIndexStats().lagSecs == 0; } , "lag not cleared" );
+var stats = ttlIndexStats();
+assert.eq( "x_-1" , stats.name );
+assert.eq( 60 , stats.expireAfterSeconds );
+assert.eq( 501 , stats.deletedDocuments );
+
+assert.eq( 50 , t.count( { x : { $gt : new Date( now ) } } ) );
+assert.eq( 1 , t.count( { x : true } ) );
+assert.eq( 1 , t.count( { x : "not a date" } ) );
+
+// a dropped collection drops out of serverStatus
+t.drop();
+assert.soon( function() { return ttlIndexStats() == null; } , "dropped index still reported" );
+
+MongoRunner.stopMongod( conn.port );
@@ -1001,6 +1001,12 @@ namespace mongo {
         }
     }
 
+    int DBClientConnection::getPollableFD() const {
+        if ( !p || _failed || p->psock->isSecure() )
+            return -1;
+        return p->psock->rawFD();
+    }
+
     const uint64_t DBClientBase::INVALID_SOCK_CREATION_TIME =
             static_cast<uint64_t>(0xFFFFFFFFFFFFFFFFULL);
 
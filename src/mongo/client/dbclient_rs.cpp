@@ -2011,6 +2011,12 @@ namespace mongo {
         }
     }
 
+    int DBClientReplicaSet::getPollableFD() const {
+        if( ! _lazyState._lastClient )
+            return -1;
+        return _lazyState._lastClient->getPollableFD();
+    }
+
     void DBClientReplicaSet::checkResponse( const char* data, int nReturned, bool* retry, string* targetHost ){
 
         // For now, do exactly as we did before, so as not to break things.  In general though, we
@@ -506,6 +506,9 @@ namespace mongo {
 
         double getSoTimeout() const { return _so_timeout; }
 
+        /** the socket of the member the last lazy request was sent to, see say() */
+        virtual int getPollableFD() const;
+
         string toString() { return getServerAddress(); }
 
         string getServerAddress() const;
@@ -124,21 +124,30 @@ namespace mongo {
         return ok;
     }
 
+    void DBClientCursor::_assembleGetMore( Message& toSend ) {
+        BufBuilder b;
+        b.appendNum(opts);
+        b.appendStr(ns);
+        b.appendNum(nextBatchSize());
+        b.appendNum(cursorId);
+        toSend.setData(dbGetMore, b.buf(), b.len());
+    }
+
     void DBClientCursor::requestMore() {
         verify( cursorId && batch.pos == batch.nReturned );
 
+        if ( _getMoresAhead > 0 && _client && !haveLimit ) {
+            _requestMorePipelined();
+            return;
+        }
+
         if (haveLimit) {
             nToReturn -= batch.nReturned;
             verify(nToReturn > 0);
         }
-        BufBuilder b;
-        b.appendNum(opts);
-        b.appendStr(ns);
-        b.appendNum(nextBatchSize());
-        b.appendNum(cursorId);
 
         Message toSend;
-        toSend.setData(dbGetMore, b.buf(), b.len());
+        _assembleGetMore( toSend );
         auto_ptr<Message> response(new Message());
 
         if ( _client ) {
@@ -158,6 +167,44 @@ namespace mongo {
         }
     }
 
+    /**
+     * Tops up the getMores in flight before waiting for the oldest one, so the server already
+     * has the next requests queued on the socket when it sends this batch.  The server handles
+     * a connection's requests one at a time, so each getMore continues where the last ended.
+     */
+    void DBClientCursor::_requestMorePipelined() {
+        while ( _getMoresInFlight.size() <= static_cast<size_t>( _getMoresAhead ) ) {
+            Message toSend;
+            _assembleGetMore( toSend );
+            _client->say( toSend );
+            _getMoresInFlight.push_back( toSend.header()->id );
+        }
+
+        auto_ptr<Message> response(new Message());
+        _recvGetMore( *response );
+        batch.m = response;
+        dataReceived();
+
+        if ( cursorId == 0 ) {
+            // the server closed the cursor, the rest can only come back as not found; read them
+            // so the connection is usable again
+            while ( !_getMoresInFlight.empty() ) {
+                Message discarded;
+                _recvGetMore( discarded );
+            }
+        }
+    }
+
+    void DBClientCursor::_recvGetMore( Message& response ) {
+        const MSGID requestId = _getMoresInFlight.front();
+        _getMoresInFlight.pop_front();
+        if ( !_client->recv( response ) ) {
+            uasserted( 17358, "recv failed reading a pipelined getMore" );
+        }
+        massert( 17359, "pipelined getMore reply doesn't match its request",
+                 response.header()->responseTo == requestId );
+    }
+
     /** with QueryOption_Exhaust, the server just blasts data at us (marked at end with cursorid==0). */
     void DBClientCursor::exhaustReceiveMore() {
         verify( cursorId && batch.pos == batch.nReturned );
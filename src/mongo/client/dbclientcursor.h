@@ -19,6 +19,7 @@
 
 #include "mongo/pch.h"
 
+#include <deque>
 #include <stack>
 
 #include "mongo/client/dbclientinterface.h"
@@ -133,6 +134,17 @@ namespace mongo {
         /// Change batchSize after construction. Can change after requesting first batch.
         void setBatchSize(int newBatchSize) { batchSize = newBatchSize; }
 
+        /**
+         * Keeps up to 'n' more getMores on the wire ahead of the one whose batch is being waited
+         * for, so the following batches travel while the current one is consumed.  Only used
+         * for cursors without a limit on a connection which reads replies with recv().  The
+         * connection can't be used for anything else while getMoresInFlight() > 0.
+         */
+        void setGetMoresAhead(int n) { _getMoresAhead = n; }
+
+        /** The number of getMores sent but not read back yet, see setGetMoresAhead() */
+        int getMoresInFlight() const { return static_cast<int>(_getMoresInFlight.size()); }
+
         DBClientCursor( DBClientBase* client, const string &_ns, BSONObj _query, int _nToReturn,
                         int _nToSkip, const BSONObj *_fieldsToReturn, int queryOptions , int bs ) :
             _client(client),
@@ -147,7 +159,8 @@ namespace mongo {
             resultFlags(0),
             cursorId(),
             _ownCursor( true ),
-            wasError( false ) {
+            wasError( false ),
+            _getMoresAhead( 0 ) {
             _finishConsInit();
         }
 
@@ -163,7 +176,8 @@ namespace mongo {
             resultFlags(0),
             cursorId(_cursorId),
             _ownCursor(true),
-            wasError(false) {
+            wasError(false),
+            _getMoresAhead(0) {
             _finishConsInit();
         }
 
@@ -237,11 +251,15 @@ namespace mongo {
         string _scopedHost;
         string _lazyHost;
         bool wasError;
+        int _getMoresAhead;
+        std::deque<MSGID> _getMoresInFlight; // request ids, oldest first
 
         void dataReceived() { bool retry; string lazyHost; dataReceived( retry, lazyHost ); }
         void dataReceived( bool& retry, string& lazyHost );
         void requestMore();
         void exhaustReceiveMore(); // for exhaust
+        void _requestMorePipelined();
+        void _recvGetMore( Message& response );
 
         // Don't call from a virtual function
         void _assertIfNull() const { uassert(13348, "connection died", this); }
@@ -252,6 +270,7 @@ namespace mongo {
 
         // init pieces
         void _assembleInit( Message& toSend );
+        void _assembleGetMore( Message& toSend );
     };
 
     /** iterate over objects in current batch only - will not cause a network call
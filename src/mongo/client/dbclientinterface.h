@@ -1146,6 +1146,13 @@ namespace mongo {
             return INVALID_SOCK_CREATION_TIME;
         }
 
+        /**
+         * @return the descriptor which becomes readable when the response to the last request
+         *         arrives, or -1 if there is no single socket to poll, or a response could be
+         *         buffered where poll() doesn't see it.
+         */
+        virtual int getPollableFD() const { return -1; }
+
     }; // DBClientBase
 
     class DBClientReplicaSet;
@@ -1301,6 +1308,8 @@ namespace mongo {
 
         uint64_t getSockCreationMicroSec() const;
 
+        virtual int getPollableFD() const;
+
     protected:
         friend class SyncClusterConnection;
         virtual void _auth(const BSONObj& params);
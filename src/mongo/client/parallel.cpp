@@ -22,6 +22,7 @@
 
 #include "mongo/client/connpool.h"
 #include "mongo/client/dbclientcursor.h"
+#include "mongo/client/response_poller.h"
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/s/chunk.h"
@@ -922,8 +923,27 @@ namespace mongo {
 
         LOG( pc ) << "finishing over " << _cursorMap.size() << " shards" << endl;
 
-        for( map< Shard, PCMData >::iterator i = _cursorMap.begin(), end = _cursorMap.end(); i != end; ++i ){
+        // Finish the shards in the order their responses arrive, rather than waiting on each shard
+        // in turn, so one slow shard doesn't hold up handling the others
+        typedef map< Shard, PCMData >::iterator ShardIterator;
+        vector<ShardIterator> shards;
+        ResponsePoller poller;
+        for( ShardIterator i = _cursorMap.begin(), end = _cursorMap.end(); i != end; ++i ){
+            PCMData& mdata = i->second;
+            if( mdata.pcState && ! mdata.finished && mdata.pcState->conn &&
+                mdata.pcState->conn->ok() ){
+                // Lazily init'ed, the query was sent and the response is on its way
+                poller.add( mdata.pcState->conn->getRawConn(), shards.size() );
+            }
+            else {
+                poller.addFD( -1, shards.size() );
+            }
+            shards.push_back( i );
+        }
+
+        while( poller.numPending() > 0 ){
 
+            ShardIterator i = shards[ poller.waitForAny() ];
             const Shard& shard = i->first;
             PCMData& mdata = i->second;
 
@@ -0,0 +1,107 @@
+/*    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/client/response_poller.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include "mongo/client/dbclientinterface.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/log.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    void ResponsePoller::add(DBClientBase* conn, size_t id) {
+        addFD(conn->getPollableFD(), id, conn->getSoTimeout());
+    }
+
+    void ResponsePoller::addFD(int fd, size_t id, double timeoutSecs) {
+        if (fd < 0 || !isPollSupported()) {
+            _ready.push_back(id);
+            return;
+        }
+
+        pollfd pollInfo;
+        pollInfo.fd = fd;
+        pollInfo.events = POLLIN;
+        pollInfo.revents = 0;
+        _fds.push_back(pollInfo);
+        _ids.push_back(id);
+        _deadlines.push_back(timeoutSecs > 0 ?
+                             curTimeMillis64() + static_cast<long long>(timeoutSecs * 1000) : 0);
+    }
+
+    size_t ResponsePoller::waitForAny() {
+        invariant(numPending() > 0);
+
+        while (_ready.empty()) {
+            // wait until the earliest deadline, or indefinitely if no request has one
+            long long now = curTimeMillis64();
+            long long earliest = 0;
+            for (size_t i = 0; i < _deadlines.size(); i++) {
+                if (_deadlines[i] && (!earliest || _deadlines[i] < earliest))
+                    earliest = _deadlines[i];
+            }
+            int waitMillis = earliest ? static_cast<int>(std::max(earliest - now, 0LL)) : -1;
+
+            int nEvents = socketPoll(&_fds[0], _fds.size(), waitMillis);
+            if (nEvents < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                // recv() reports whatever is wrong with the sockets
+                LOG(1) << "poll() failed waiting for responses, errno:" << errno << endl;
+                _ready.insert(_ready.end(), _ids.begin(), _ids.end());
+                _fds.clear();
+                _ids.clear();
+                _deadlines.clear();
+                break;
+            }
+
+            _collectReady(nEvents, curTimeMillis64());
+        }
+
+        size_t id = _ready.front();
+        _ready.pop_front();
+        return id;
+    }
+
+    void ResponsePoller::_collectReady(int nEvents, long long now) {
+        // Everything readable or timed out is moved to _ready, keeping the order the requests
+        // were added, so no connection waits behind later ones.
+        size_t kept = 0;
+        for (size_t i = 0; i < _fds.size(); i++) {
+            // POLLERR/POLLHUP are handed back too, recv() reports the failure
+            bool readable = nEvents > 0 && _fds[i].revents != 0;
+            if (readable || (_deadlines[i] && _deadlines[i] <= now)) {
+                _ready.push_back(_ids[i]);
+                continue;
+            }
+            _fds[kept] = _fds[i];
+            _ids[kept] = _ids[i];
+            _deadlines[kept] = _deadlines[i];
+            kept++;
+        }
+
+        _fds.resize(kept);
+        _ids.resize(kept);
+        _deadlines.resize(kept);
+    }
+
+}
@@ -0,0 +1,84 @@
+/*    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/util/net/socket_poll.h"
+
+namespace mongo {
+
+    class DBClientBase;
+
+    /**
+     * Completes requests which were sent to several servers in the order their responses arrive,
+     * so a caller gathering from many hosts handles each response as soon as it is readable
+     * instead of blocking on the hosts one after another.
+     *
+     * Usage:
+     *   for each host: conn->say(request); poller.add(conn, i);
+     *   while (poller.numPending()) { size_t i = poller.waitForAny(); conns[i]->recv(...); }
+     *
+     * Connections which can't be polled (SSL connections, or platforms without poll()) are
+     * handed back first, where the caller's blocking recv() behaves as before.  A replica set
+     * connection is polled on the socket of the member its request was sent to.
+     */
+    class ResponsePoller {
+        MONGO_DISALLOW_COPYING(ResponsePoller);
+    public:
+
+        ResponsePoller() {}
+
+        /**
+         * Waits for the response to a request sent on 'conn', identified by 'id' to the caller,
+         * for at most the socket timeout of 'conn'.
+         */
+        void add(DBClientBase* conn, size_t id);
+
+        /**
+         * Waits for 'fd' to become readable, for at most 'timeoutSecs' if it is > 0.  An fd < 0
+         * is handed back without waiting.
+         */
+        void addFD(int fd, size_t id, double timeoutSecs = 0);
+
+        size_t numPending() const { return _ready.size() + _ids.size(); }
+
+        /**
+         * Blocks until some pending request has a response to read, its connection failed, or
+         * its timeout passed, and returns its id.  The id is no longer pending afterwards.
+         *
+         * A request which timed out is handed back without data, so the caller's recv() fails
+         * it with the socket timeout as it would have without the poller.
+         */
+        size_t waitForAny();
+
+    private:
+        /** moves the requests which are readable or timed out to _ready */
+        void _collectReady(int nEvents, long long now);
+
+        std::deque<size_t> _ready;
+
+        // _fds[i] is polled for the request _ids[i] until _deadlines[i] (curTimeMillis64(), 0
+        // for none), in the order they were added
+        std::vector<pollfd> _fds;
+        std::vector<size_t> _ids;
+        std::vector<long long> _deadlines;
+    };
+
+}
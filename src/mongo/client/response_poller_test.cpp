@@ -0,0 +1,128 @@
+/*    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/client/response_poller.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/timer.h"
+
+// The tests use PF_LOCAL socket pairs as stand-ins for shard connections.
+#ifndef _WIN32
+
+namespace {
+
+    using namespace mongo;
+
+    /** A connected pair of sockets: the "shard" writes responses to [1], mongos polls [0]. */
+    struct MockShard {
+        MockShard() {
+            int fds[2];
+            ASSERT_EQUALS(0, ::socketpair(PF_LOCAL, SOCK_STREAM, 0, fds));
+            mongosFD = fds[0];
+            shardFD = fds[1];
+        }
+        ~MockShard() {
+            ::close(mongosFD);
+            ::close(shardFD);
+        }
+
+        void respond() {
+            char c = 'r';
+            ASSERT_EQUALS(1, ::write(shardFD, &c, 1));
+        }
+
+        int mongosFD;
+        int shardFD;
+    };
+
+    TEST(ResponsePollerTest, ReturnsResponsesInArrivalOrder) {
+        if (!isPollSupported())
+            return;
+
+        MockShard shards[3];
+        ResponsePoller poller;
+        for (size_t i = 0; i < 3; i++) {
+            poller.addFD(shards[i].mongosFD, i);
+        }
+        ASSERT_EQUALS(3U, poller.numPending());
+
+        shards[2].respond();
+        ASSERT_EQUALS(2U, poller.waitForAny());
+        shards[0].respond();
+        shards[1].respond();
+        ASSERT_EQUALS(0U, poller.waitForAny());
+        ASSERT_EQUALS(1U, poller.waitForAny());
+        ASSERT_EQUALS(0U, poller.numPending());
+    }
+
+    TEST(ResponsePollerTest, UnpollableFirst) {
+        MockShard shard;
+        ResponsePoller poller;
+        poller.addFD(shard.mongosFD, 0);
+        poller.addFD(-1, 1);
+        ASSERT_EQUALS(1U, poller.waitForAny());
+        shard.respond();
+        ASSERT_EQUALS(0U, poller.waitForAny());
+    }
+
+    TEST(ResponsePollerTest, ClosedConnectionIsReady) {
+        if (!isPollSupported())
+            return;
+
+        MockShard shards[2];
+        ResponsePoller poller;
+        poller.addFD(shards[0].mongosFD, 0);
+        poller.addFD(shards[1].mongosFD, 1);
+        ::shutdown(shards[1].shardFD, SHUT_RDWR);
+        ASSERT_EQUALS(1U, poller.waitForAny());
+    }
+
+    TEST(ResponsePollerTest, TimeoutIsPerConnection) {
+        if (!isPollSupported())
+            return;
+
+        MockShard shards[3];
+        ResponsePoller poller;
+        poller.addFD(shards[0].mongosFD, 0);        // no timeout
+        poller.addFD(shards[1].mongosFD, 1, 0.5);
+        poller.addFD(shards[2].mongosFD, 2, 0.2);
+
+        // the shortest timeout passes first, the others are still polled
+        Timer t;
+        ASSERT_EQUALS(2U, poller.waitForAny());
+        ASSERT_GREATER_THAN_OR_EQUALS(t.millis(), 200 - 50);
+        ASSERT_LESS_THAN(t.millis(), 500);
+        ASSERT_EQUALS(2U, poller.numPending());
+
+        // a response arriving meanwhile doesn't wait for the next timeout
+        shards[0].respond();
+        ASSERT_EQUALS(0U, poller.waitForAny());
+
+        ASSERT_EQUALS(1U, poller.waitForAny());
+        ASSERT_GREATER_THAN_OR_EQUALS(t.millis(), 500 - 50);
+        ASSERT_EQUALS(0U, poller.numPending());
+    }
+
+} // namespace
+
+#endif // ndef _WIN32
@@ -30,8 +30,10 @@
 
 #include "mongo/db/catalog/index_catalog.h"
 
+#include <algorithm>
 #include <vector>
 
+#include "mongo/base/owned_pointer_vector.h"
 #include "mongo/db/audit.h"
 #include "mongo/db/background.h"
 #include "mongo/db/catalog/index_create.h"
@@ -52,14 +54,25 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/keypattern.h"
 #include "mongo/db/ops/delete.h"
+#include "mongo/db/query/index_statistics.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/rs.h" // this is ugly
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/log.h"
 
 namespace mongo {
 
+    // How many keys to sample from an index for its statistics, and how many buckets may be read
+    // to get them.
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryIndexStatsSampleSize, int, 200);
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryIndexStatsMaxBuckets, int, 64);
+
+    // Index statistics are sampled again once the keys written since the last sample exceed
+    // this fraction of the keys in the index.
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryIndexStatsRefreshRatio, double, 0.1);
+
     static const int INDEX_CATALOG_INIT = 283711;
     static const int INDEX_CATALOG_UNINIT = 654321;
 
@@ -244,6 +257,13 @@ namespace mongo {
         return Status::OK();
     }
 
+    static Status statusFromBuildFailure( const AssertionException& exc ) {
+        ErrorCodes::Error codeToUse = ErrorCodes::fromInt( exc.getCode() );
+        if ( codeToUse == ErrorCodes::UnknownError )
+            return Status( ErrorCodes::InternalError, exc.what(), exc.getCode() );
+        return Status( codeToUse, exc.what() );
+    }
+
     Status IndexCatalog::createIndex( BSONObj spec,
                                       bool mayInterrupt,
                                       ShutdownBehavior shutdownBehavior ) {
@@ -253,24 +273,10 @@ namespace mongo {
         if ( !status.isOK() )
             return status;
 
-        status = okToAddIndex( spec );
-        if ( !status.isOK() )
-            return status;
-
-        spec = fixIndexSpec( spec );
-
-        // we double check with new index spec
-        status = okToAddIndex( spec );
+        status = _prepareSpecForCreate( &spec );
         if ( !status.isOK() )
             return status;
 
-        string pluginName = IndexNames::findPluginName( spec["key"].Obj() );
-        if ( pluginName.size() ) {
-            Status s = _upgradeDatabaseMinorVersionIfNeeded( pluginName );
-            if ( !s.isOK() )
-                return s;
-        }
-
         // now going to touch disk
         IndexBuildBlock indexBuildBlock( _collection, spec );
         status = indexBuildBlock.init();
@@ -318,11 +324,114 @@ namespace mongo {
                 indexBuildBlock.fail();
             }
 
-            ErrorCodes::Error codeToUse = ErrorCodes::fromInt( exc.getCode() );
-            if ( codeToUse == ErrorCodes::UnknownError )
-                return Status( ErrorCodes::InternalError, exc.what(), exc.getCode() );
-            return Status( codeToUse, exc.what() );
+            return statusFromBuildFailure( exc );
+        }
+    }
+
+    Status IndexCatalog::createIndexes( const vector<BSONObj>& specs,
+                                        bool mayInterrupt,
+                                        vector<BSONObj>* created ) {
+        Lock::assertWriteLocked( _collection->_database->name() );
+        _checkMagic();
+        Status status = _checkUnfinished();
+        if ( !status.isOK() )
+            return status;
+
+        // background builds yield and dropDups builds remove documents the other indexes
+        // would already have keys for, so neither can share the scan
+        vector<BSONObj> together;
+        vector<BSONObj> separately;
+        for ( size_t i = 0; i < specs.size(); i++ ) {
+            if ( specs[i]["background"].trueValue() || specs[i]["dropDups"].trueValue() )
+                separately.push_back( specs[i] );
+            else
+                together.push_back( specs[i] );
+        }
+        if ( together.size() == 1 ) {
+            // nothing to share the scan with
+            separately.insert( separately.begin(), together[0] );
+            together.clear();
+        }
+
+        OwnedPointerVector<IndexBuildBlock> blocks;
+        vector<IndexCatalogEntry*> entries;
+        vector<BSONObj> built;
+        for ( size_t i = 0; i < together.size(); i++ ) {
+            BSONObj spec = together[i];
+            status = _prepareSpecForCreate( &spec );
+            if ( status.code() == ErrorCodes::IndexAlreadyExists )
+                continue;
+            if ( !status.isOK() )
+                return status;
+
+            // now going to touch disk
+            IndexBuildBlock* block = new IndexBuildBlock( _collection, spec );
+            blocks.mutableVector().push_back( block );
+            status = block->init();
+            if ( !status.isOK() )
+                return status;
+
+            IndexCatalogEntry* entry = block->getEntry();
+            invariant( entry );
+            entries.push_back( entry );
+            built.push_back( together[i] );
+        }
+
+        if ( !entries.empty() ) {
+            try {
+                buildIndexes( _collection, entries, mayInterrupt );
+                for ( size_t i = 0; i < blocks.size(); i++ ) {
+                    blocks.vector()[i]->success();
+                }
+            }
+            catch ( const AssertionException& exc ) {
+                log() << "index build failed."
+                      << " specs: " << entries.size()
+                      << " error: " << exc;
+
+                for ( size_t i = blocks.size(); i > 0; i-- ) {
+                    blocks.vector()[i - 1]->fail();
+                }
+                return statusFromBuildFailure( exc );
+            }
+
+            if ( created )
+                created->insert( created->end(), built.begin(), built.end() );
+        }
+
+        for ( size_t i = 0; i < separately.size(); i++ ) {
+            status = createIndex( separately[i], mayInterrupt );
+            if ( status.code() == ErrorCodes::IndexAlreadyExists )
+                continue;
+            if ( !status.isOK() )
+                return status;
+            if ( created )
+                created->push_back( separately[i] );
+        }
+
+        return Status::OK();
+    }
+
+    Status IndexCatalog::_prepareSpecForCreate( BSONObj* spec ) {
+        Status status = okToAddIndex( *spec );
+        if ( !status.isOK() )
+            return status;
+
+        *spec = fixIndexSpec( *spec );
+
+        // we double check with new index spec
+        status = okToAddIndex( *spec );
+        if ( !status.isOK() )
+            return status;
+
+        string pluginName = IndexNames::findPluginName( (*spec)["key"].Obj() );
+        if ( pluginName.size() ) {
+            Status s = _upgradeDatabaseMinorVersionIfNeeded( pluginName );
+            if ( !s.isOK() )
+                return s;
         }
+
+        return Status::OK();
     }
 
     IndexCatalog::IndexBuildBlock::IndexBuildBlock( Collection* collection,
@@ -938,6 +1047,52 @@ namespace mongo {
         return entry->isMultikey();
     }
 
+    boost::shared_ptr<const IndexStatistics> IndexCatalog::getIndexStatistics(
+            const IndexDescriptor* desc ) {
+        IndexCatalogEntry* entry = _entries.find( desc );
+        invariant( entry );
+
+        if ( !entry->isReady() || "" != _getAccessMethodName( desc->keyPattern() ) )
+            return boost::shared_ptr<const IndexStatistics>();
+
+        boost::shared_ptr<const IndexStatistics> statistics = entry->getStatistics();
+        if ( statistics ) {
+            // small indexes are cheap to sample, don't let a few writes make them stale
+            double threshold = std::max( 1000.0,
+                                         statistics->getNumKeys() *
+                                         internalQueryIndexStatsRefreshRatio );
+            if ( entry->keysWrittenSinceStatistics() <= threshold )
+                return statistics;
+        }
+
+        vector<BSONObj> samples;
+        long long numKeys;
+        BtreeBasedAccessMethod* iam = getBtreeBasedIndex( desc );
+        Status status = iam->sampleKeys( internalQueryIndexStatsSampleSize,
+                                         internalQueryIndexStatsMaxBuckets,
+                                         &samples,
+                                         &numKeys );
+        if ( !status.isOK() ) {
+            LOG(1) << "couldn't sample index " << desc->indexNamespace()
+                   << " for statistics: " << status.toString();
+            return statistics;
+        }
+
+        // a single key index has exactly one key per document
+        if ( !entry->isMultikey() && !desc->isSparse() )
+            numKeys = _collection->numRecords();
+
+        statistics.reset( new IndexStatistics( desc->keyPattern(), numKeys, samples ) );
+        entry->setStatistics( statistics );
+        return statistics;
+    }
+
+    void IndexCatalog::noteKeysWritten( const IndexDescriptor* desc, long long n ) {
+        IndexCatalogEntry* entry = _entries.find( desc );
+        invariant( entry );
+        entry->noteKeysWritten( n );
+    }
+
 
     // ---------------------------
 
@@ -1147,8 +1302,10 @@ namespace mongo {
 
         options.dupsAllowed = ignoreUniqueIndex( index->descriptor() ) || !isUnique;
 
-        int64_t inserted;
-        return index->accessMethod()->insert(obj, loc, options, &inserted);
+        int64_t inserted = 0;
+        Status status = index->accessMethod()->insert(obj, loc, options, &inserted);
+        index->noteKeysWritten( inserted );
+        return status;
     }
 
     Status IndexCatalog::_unindexRecord( IndexCatalogEntry* index,
@@ -1158,8 +1315,9 @@ namespace mongo {
         InsertDeleteOptions options;
         options.logIfError = logIfError;
 
-        int64_t removed;
+        int64_t removed = 0;
         Status status = index->accessMethod()->remove(obj, loc, options, &removed);
+        index->noteKeysWritten( removed );
 
         if ( !status.isOK() ) {
             problem() << "Couldn't unindex record " << obj.toString()
@@ -1282,7 +1440,7 @@ namespace mongo {
             // note (one day) we may be able to fresh build less versions than we can use
             // isASupportedIndexVersionNumber() is what we can use
             uassert(14803, str::stream() << "this version of mongod cannot build new indexes of version number " << vv, 
-                    vv == 0 || vv == 1);
+                    vv == 0 || vv == 1 || vv == 2);
             v = (int) vv;
         }
         // idea is to put things we use a lot earlier
@@ -30,6 +30,7 @@
 
 #pragma once
 
+#include <boost/shared_ptr.hpp>
 #include <vector>
 
 #include "mongo/db/catalog/index_catalog_entry.h"
@@ -47,6 +48,7 @@ namespace mongo {
     class IndexAccessMethod;
     class BtreeAccessMethod;
     class BtreeBasedAccessMethod;
+    class IndexStatistics;
 
     /**
      * how many: 1 per Collection
@@ -146,6 +148,17 @@ namespace mongo {
                             bool mayInterrupt,
                             ShutdownBehavior shutdownBehavior = SHUTDOWN_CLEANUP );
 
+        /**
+         * Creates every index in 'specs' that doesn't exist yet.  Foreground indexes without
+         * dropDups are built together with a single scan of the collection, and if one of them
+         * fails none of them is kept.  Background and dropDups indexes are built one at a time
+         * afterwards.
+         * @param created if not NULL, the specs of the indexes created are appended to it
+         */
+        Status createIndexes( const std::vector<BSONObj>& specs,
+                              bool mayInterrupt,
+                              std::vector<BSONObj>* created );
+
         Status okToAddIndex( const BSONObj& spec ) const;
 
         Status dropAllIndexes( bool includingIdIndex );
@@ -168,6 +181,18 @@ namespace mongo {
 
         bool isMultikey( const IndexDescriptor* idex );
 
+        // ---- index statistics
+
+        /**
+         * Statistics about the keys of a plain btree index, sampled again when more keys were
+         * written since the last sample than internalQueryIndexStatsRefreshRatio allows.
+         * @return NULL for other kinds of indexes, and for indexes still being built
+         */
+        boost::shared_ptr<const IndexStatistics> getIndexStatistics( const IndexDescriptor* desc );
+
+        // counts writes to 'desc' made outside of indexRecord/unindexRecord, e.g. by updates
+        void noteKeysWritten( const IndexDescriptor* desc, long long n );
+
         // --- these probably become private?
 
 
@@ -253,6 +278,9 @@ namespace mongo {
 
         Status _upgradeDatabaseMinorVersionIfNeeded( const string& newPluginName );
 
+        // checks that 'spec' may be added and replaces it with its fixed form
+        Status _prepareSpecForCreate( BSONObj* spec );
+
         int _removeFromSystemIndexes( const StringData& indexName );
 
         bool _shouldOverridePlugin( const BSONObj& keyPattern );
@@ -32,6 +32,7 @@
 
 #include "mongo/db/index/index_access_method.h"
 #include "mongo/db/index/index_descriptor.h"
+#include "mongo/db/query/index_statistics.h"
 
 namespace mongo {
 
@@ -44,7 +45,8 @@ namespace mongo {
           _accessMethod( NULL ),
           _forcedBtreeIndex( NULL ),
           _ordering( Ordering::make( descriptor->keyPattern() ) ),
-          _isReady( false ) {
+          _isReady( false ),
+          _statisticsMutex( "IndexCatalogEntry::_statistics" ) {
         _descriptor->_cachedEntry = this;
     }
 
@@ -73,6 +75,18 @@ namespace mongo {
         return _head;
     }
 
+    boost::shared_ptr<const IndexStatistics> IndexCatalogEntry::getStatistics() const {
+        SimpleMutex::scoped_lock lk( _statisticsMutex );
+        return _statistics;
+    }
+
+    void IndexCatalogEntry::setStatistics(
+            const boost::shared_ptr<const IndexStatistics>& statistics ) {
+        SimpleMutex::scoped_lock lk( _statisticsMutex );
+        _statistics = statistics;
+        _keysWritten.store( 0 );
+    }
+
     bool IndexCatalogEntry::isReady() const {
         DEV verify( _isReady == _catalogIsReady() );
         return _isReady;
@@ -30,11 +30,14 @@
 
 #pragma once
 
+#include <boost/shared_ptr.hpp>
 #include <string>
 
 #include "mongo/base/owned_pointer_vector.h"
 #include "mongo/bson/ordering.h"
 #include "mongo/db/diskloc.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
 
@@ -42,6 +45,7 @@ namespace mongo {
     class IndexDescriptor;
     class RecordStore;
     class IndexAccessMethod;
+    class IndexStatistics;
 
     class IndexCatalogEntry {
         MONGO_DISALLOW_COPYING( IndexCatalogEntry );
@@ -88,6 +92,18 @@ namespace mongo {
         // if this ready is ready for queries
         bool isReady() const;
 
+        // --
+
+        // the last statistics sampled from this index, NULL if there are none yet
+        boost::shared_ptr<const IndexStatistics> getStatistics() const;
+
+        // also resets the count of keys written since the statistics were sampled
+        void setStatistics( const boost::shared_ptr<const IndexStatistics>& statistics );
+
+        void noteKeysWritten( long long n ) { _keysWritten.addAndFetch( n ); }
+
+        long long keysWrittenSinceStatistics() const { return _keysWritten.load(); }
+
     private:
 
         int _indexNo() const;
@@ -113,6 +129,11 @@ namespace mongo {
         bool _isReady; // cache of NamespaceDetails info
         DiskLoc _head; // cache of IndexDetails
         bool _isMultikey; // cache of NamespaceDetails info
+
+        // readers refresh these under a shared lock, so they need their own mutex
+        mutable SimpleMutex _statisticsMutex;
+        boost::shared_ptr<const IndexStatistics> _statistics;
+        AtomicInt64 _keysWritten;
     };
 
     class IndexCatalogEntryContainer {
@@ -30,12 +30,17 @@
 
 #include "mongo/db/catalog/index_create.h"
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/base/owned_pointer_vector.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/audit.h"
 #include "mongo/db/background.h"
 #include "mongo/db/structure/btree/btreebuilder.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/extsort.h"
+#include "mongo/db/storage/extent.h"
 #include "mongo/db/storage/index_details.h"
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/namespace_details.h"
@@ -45,11 +50,17 @@
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/util/processinfo.h"
 
 namespace mongo {
 
+    // Threads generating and sorting the keys of a foreground index build, 0 for one per core
+    // up to 8.  Only used for collections of at least parallelIndexBuildMinRecords documents.
+    MONGO_EXPORT_SERVER_PARAMETER(indexBuildThreads, int, 0);
+    MONGO_EXPORT_SERVER_PARAMETER(parallelIndexBuildMinRecords, int, 100000);
+
     /**
      * Add the provided (obj, dl) pair to the provided index.
      */
@@ -183,6 +194,133 @@ namespace mongo {
         return n;
     }
 
+    /**
+     * Inserts every document of a collection into the partitions of bulk IndexAccessMethods,
+     * with one thread per entry of 'partitions'; each thread feeds every index it is given a
+     * partition of.  The threads take the collection's extents one at a time and walk their
+     * records directly, so the caller must hold the collection's write lock and must not write
+     * to it until run() returns.
+     */
+    class ParallelBulkScan : boost::noncopyable {
+    public:
+        typedef vector<IndexAccessMethod*> Partition;
+
+        ParallelBulkScan( Collection* collection, const vector<Partition>& partitions )
+            : _partitions( partitions ), _nextExtent( 0 ), _running( 0 ),
+              _status( Status::OK() ), _scanned( 0 ), _stop( false ) {
+            for ( DiskLoc L = collection->details()->firstExtent(); !L.isNull(); ) {
+                Extent* e = L.ext();
+                _extents.push_back( e );
+                L = e->xnext;
+            }
+        }
+
+        /** @return the number of documents scanned */
+        unsigned long long run( ProgressMeter& progress, bool mayInterrupt ) {
+            boost::thread_group threads;
+            _running = _partitions.size();
+            for ( size_t i = 0; i < _partitions.size(); i++ ) {
+                threads.create_thread( boost::bind( &ParallelBulkScan::work, this, i ) );
+            }
+
+            unsigned long long reported = 0;
+            try {
+                boost::mutex::scoped_lock lk( _m );
+                while ( _running ) {
+                    _finished.timed_wait( lk, boost::posix_time::milliseconds( 100 ) );
+                    unsigned long long scanned = _scanned.load();
+                    progress.hit( scanned - reported );
+                    reported = scanned;
+                    if ( mayInterrupt ) {
+                        lk.unlock();
+                        killCurrentOp.checkForInterrupt();
+                        lk.lock();
+                    }
+                }
+            }
+            catch ( ... ) {
+                _stop = true;
+                threads.join_all();
+                throw;
+            }
+            threads.join_all();
+
+            uassertStatusOK( _status );
+            unsigned long long scanned = _scanned.load();
+            progress.hit( scanned - reported );
+            return scanned;
+        }
+
+    private:
+        void work( size_t id ) {
+            const Partition& partition = _partitions[id];
+            string name = str::stream() << "index build worker " << id;
+            Client::initThread( name.c_str() );
+            InsertDeleteOptions options;
+            options.dupsAllowed = true; // bulk methods check for dups when committed
+            Status status = Status::OK();
+            try {
+                Extent* e;
+                while ( status.isOK() && ( e = nextExtent() ) ) {
+                    for ( DiskLoc dl = e->firstRecord; !dl.isNull() && !_stop; ) {
+                        Record* r = e->getRecord( dl );
+                        BSONObj obj( r->data() );
+                        for ( size_t i = 0; i < partition.size() && status.isOK(); i++ ) {
+                            status = partition[i]->insert( obj, dl, options, NULL );
+                        }
+                        if ( !status.isOK() )
+                            break;
+                        _scanned.fetchAndAdd( 1 );
+                        int next = r->nextOfs();
+                        dl = next == DiskLoc::NullOfs ? DiskLoc() : DiskLoc( dl.a(), next );
+                    }
+                }
+            }
+            catch ( const DBException& e ) {
+                status = e.toStatus();
+            }
+            catch ( const std::exception& e ) {
+                status = Status( ErrorCodes::InternalError, e.what() );
+            }
+            cc().shutdown();
+
+            boost::mutex::scoped_lock lk( _m );
+            if ( !status.isOK() && _status.isOK() ) {
+                _status = status;
+                _stop = true;
+            }
+            if ( --_running == 0 )
+                _finished.notify_one();
+        }
+
+        /** @return NULL once every extent has been taken or the scan is stopped */
+        Extent* nextExtent() {
+            boost::mutex::scoped_lock lk( _m );
+            if ( _stop || _nextExtent == _extents.size() )
+                return NULL;
+            return _extents[ _nextExtent++ ];
+        }
+
+        const vector<Partition> _partitions;
+        vector<Extent*> _extents;
+
+        boost::mutex _m;
+        boost::condition_variable _finished;
+        // guarded by _m
+        size_t _nextExtent;
+        size_t _running;
+        Status _status;
+
+        AtomicUInt64 _scanned;
+        volatile bool _stop;
+    };
+
+    static int parallelIndexBuildThreads() {
+        if ( indexBuildThreads > 0 )
+            return indexBuildThreads;
+        return std::min( 8u, std::max( 1u, ProcessInfo().getNumCores() ) );
+    }
+
     // ---------------------------
 
     // throws DBException
@@ -233,22 +371,46 @@ namespace mongo {
                  << status.toString(),
                  status.isOK() );
 
-        IndexAccessMethod* bulk = doInBackground ? NULL : btreeState->accessMethod()->initiateBulk();
-        IndexAccessMethod* iam = bulk ? bulk : btreeState->accessMethod();
+        // the bulk IndexAccessMethod, and with it its partitions, are ours
+        scoped_ptr<IndexAccessMethod> bulk( doInBackground ?
+                                            NULL : btreeState->accessMethod()->initiateBulk() );
+        IndexAccessMethod* iam = bulk ? bulk.get() : btreeState->accessMethod();
 
         if ( bulk )
             log() << "\t building index using bulk method";
 
-        unsigned long long n = addExistingToIndex( collection,
-                                                   btreeState->descriptor(),
-                                                   iam,
-                                                   doInBackground );
+        vector<IndexAccessMethod*> partitions;
+        int nThreads = parallelIndexBuildThreads();
+        if ( bulk && nThreads > 1 && !idx->dropDups() &&
+             collection->numRecords() >= parallelIndexBuildMinRecords ) {
+            if ( bulk->partitionBulk( nThreads, &partitions ) )
+                log() << "\t generating keys with " << nThreads << " threads";
+        }
+
+        unsigned long long n;
+        if ( !partitions.empty() ) {
+            ProgressMeter& progress =
+                cc().curop()->setMessage( "Index Build", "Index Build", collection->numRecords() );
+            vector<ParallelBulkScan::Partition> threadPartitions;
+            for ( size_t i = 0; i < partitions.size(); i++ ) {
+                threadPartitions.push_back( ParallelBulkScan::Partition( 1, partitions[i] ) );
+            }
+            ParallelBulkScan scan( collection, threadPartitions );
+            n = scan.run( progress, mayInterrupt );
+            progress.finished();
+        }
+        else {
+            n = addExistingToIndex( collection,
+                                    btreeState->descriptor(),
+                                    iam,
+                                    doInBackground );
+        }
 
         if ( bulk ) {
             LOG(1) << "\t bulk commit starting";
             std::set<DiskLoc> dupsToDrop;
 
-            btreeState->accessMethod()->commitBulk( bulk, mayInterrupt, &dupsToDrop );
+            btreeState->accessMethod()->commitBulk( bulk.get(), mayInterrupt, &dupsToDrop );
 
             if ( dupsToDrop.size() )
                 log() << "\t bulk dropping " << dupsToDrop.size() << " dups";
@@ -275,5 +437,139 @@ namespace mongo {
         collection->infoCache()->addedIndex();
     }
 
+    // throws DBException
+    void buildIndexes( Collection* collection,
+                       const vector<IndexCatalogEntry*>& entries,
+                       bool mayInterrupt ) {
+
+        string ns = collection->ns().ns(); // our copy
+
+        for ( size_t i = 0; i < entries.size(); i++ ) {
+            const IndexDescriptor* idx = entries[i]->descriptor();
+            const BSONObj& idxInfo = idx->infoObj();
+            invariant( !idx->dropDups() );
+            MONGO_TLOG(0) << "build index on: " << ns
+                          << " properties: " << idx->toString() << endl;
+            audit::logCreateIndex( currentClient.get(), &idxInfo, idx->indexName(), ns );
+        }
+
+        Timer t;
+
+        verify( Lock::isWriteLocked( ns ) );
+        collection->infoCache()->addedIndex();
+
+        for ( size_t i = 0; i < entries.size(); i++ ) {
+            Status status = entries[i]->accessMethod()->initializeAsEmpty();
+            massert( 17356,
+                     str::stream()
+                     << "IndexAccessMethod::initializeAsEmpty failed" << status.toString(),
+                     status.isOK() );
+        }
+
+        if ( collection->numRecords() == 0 ) {
+            MONGO_TLOG(0) << "\t added " << entries.size() << " indexes to empty collection";
+            collection->infoCache()->addedIndex();
+            return;
+        }
+
+        // A bulk method only keeps the keys given to its partitions once it has been
+        // partitioned, so if some index can't be partitioned the single threaded scan below
+        // feeds the first partition of those that were.
+        int nThreads = parallelIndexBuildThreads();
+        bool parallel = nThreads > 1 &&
+            collection->numRecords() >= parallelIndexBuildMinRecords;
+
+        // the bulk IndexAccessMethods own their partitions
+        OwnedPointerVector<IndexAccessMethod> bulksOwned;
+        vector<IndexAccessMethod*>& bulks = bulksOwned.mutableVector();
+        vector<vector<IndexAccessMethod*> > partitions( entries.size() );
+        for ( size_t i = 0; i < entries.size(); i++ ) {
+            IndexAccessMethod* bulk = entries[i]->accessMethod()->initiateBulk();
+            bulks.push_back( bulk );
+            if ( parallel && bulk )
+                bulk->partitionBulk( nThreads, &partitions[i] );
+            parallel = parallel && !partitions[i].empty();
+        }
+
+        string curopMessage;
+        {
+            stringstream ss;
+            ss << "Index Build: scanning for " << entries.size() << " indexes:";
+            for ( size_t i = 0; i < entries.size(); i++ ) {
+                ss << ( i ? ", " : " " ) << entries[i]->descriptor()->indexName();
+            }
+            curopMessage = ss.str();
+        }
+        ProgressMeter& progress = cc().curop()->setMessage( curopMessage.c_str(),
+                                                            "Index Build",
+                                                            collection->numRecords() );
+        unsigned long long n = 0;
+        if ( parallel ) {
+            log() << "\t generating keys of " << entries.size() << " indexes with "
+                  << nThreads << " threads";
+            vector<ParallelBulkScan::Partition> threadPartitions( nThreads );
+            for ( int t = 0; t < nThreads; t++ ) {
+                for ( size_t i = 0; i < entries.size(); i++ ) {
+                    threadPartitions[t].push_back( partitions[i][t] );
+                }
+            }
+            ParallelBulkScan scan( collection, threadPartitions );
+            n = scan.run( progress, mayInterrupt );
+        }
+        else {
+            vector<IndexAccessMethod*> targets;
+            for ( size_t i = 0; i < entries.size(); i++ ) {
+                if ( !partitions[i].empty() )
+                    targets.push_back( partitions[i][0] );
+                else
+                    targets.push_back( bulks[i] ? bulks[i] : entries[i]->accessMethod() );
+            }
+
+            auto_ptr<Runner> runner( InternalPlanner::collectionScan( ns ) );
+            BSONObj js;
+            DiskLoc loc;
+            while ( Runner::RUNNER_ADVANCED == runner->getNext( &js, &loc ) ) {
+                RARELY killCurrentOp.checkForInterrupt( !mayInterrupt );
+                for ( size_t i = 0; i < entries.size(); i++ ) {
+                    if ( bulks[i] ) {
+                        InsertDeleteOptions options;
+                        options.dupsAllowed = true; // checked when the bulk is committed
+                        uassertStatusOK( targets[i]->insert( js, loc, options, NULL ) );
+                    }
+                    else {
+                        addKeysToIndex( collection, entries[i]->descriptor(), targets[i],
+                                        js, loc );
+                    }
+                }
+                n++;
+                progress.hit();
+                getDur().commitIfNeeded();
+            }
+        }
+        progress.finished();
+
+        for ( size_t i = 0; i < entries.size(); i++ ) {
+            if ( !bulks[i] )
+                continue;
+
+            LOG(1) << "\t bulk commit starting for " << entries[i]->descriptor()->indexName();
+            std::set<DiskLoc> dupsToDrop;
+            Status status = entries[i]->accessMethod()->commitBulk( bulks[i],
+                                                                     mayInterrupt,
+                                                                     &dupsToDrop );
+            uassertStatusOK( status );
+            invariant( dupsToDrop.empty() );
+            verify( !entries[i]->head().isNull() );
+            MONGO_TLOG(0) << "\t index " << i + 1 << " of " << entries.size() << " "
+                          << entries[i]->descriptor()->indexName() << " committed";
+        }
+
+        MONGO_TLOG(0) << "build indexes done.  scanned " << n << " total records for "
+                      << entries.size() << " indexes. " << t.millis() / 1000.0 << " secs" << endl;
+
+        // this one is so people know that the indexes are finished
+        collection->infoCache()->addedIndex();
+    }
+
 }  // namespace mongo
 
@@ -31,6 +31,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace mongo {
 
@@ -44,4 +45,10 @@ namespace mongo {
                        IndexCatalogEntry* btreeState,
                        bool mayInterrupt );
 
+    // Build several indexes in the foreground with a single scan of the collection, which
+    // feeds each document to every index's bulk builder.  None of the indexes may use dropDups.
+    void buildIndexes( Collection* collection,
+                       const std::vector<IndexCatalogEntry*>& btreeStates,
+                       bool mayInterrupt );
+
 } // namespace mongo
@@ -106,6 +106,8 @@ namespace mongo {
         static void check(StringData tname) {
             static int max;
             StackChecker *sc = checker.get();
+            if ( !sc ) // a reactor worker may shut down a client it didn't init
+                return;
             const char *p = sc->buf;
 
             int lastStackByteModifed = 0;
@@ -373,8 +373,6 @@ namespace mongo {
             }
         }
 
-        string systemNamespacesNS = opts.fromDB + ".system.namespaces";
-
         list<BSONObj> toClone;
         if ( clonedColls ) clonedColls->clear();
         if ( opts.syncData ) {
@@ -384,59 +382,13 @@ namespace mongo {
             mayInterrupt( opts.mayBeInterrupted );
             dbtempreleaseif r( opts.mayYield );
 
-            // just using exhaust for collection copying right now
-
-            // todo: if snapshot (bool param to this func) is true, we need to snapshot this query?
-            //       only would be relevant if a thousands of collections -- maybe even then it is hard
-            //       to exceed a single cursor batch.
-            //       for repl it is probably ok as we apply oplog section after the clone (i.e. repl
-            //       doesnt not use snapshot=true).
-            auto_ptr<DBClientCursor> cursor = _conn->query(systemNamespacesNS, BSONObj(), 0, 0, 0,
-                                                      opts.slaveOk ? QueryOption_SlaveOk : 0);
-
-            if (!validateQueryResults(cursor, errCode, errmsg)) {
-                errmsg = str::stream() << "index query on ns " << systemNamespacesNS
-                                       << " failed: " << errmsg;
+            if ( !listCollections( opts, &toClone, errmsg, errCode ) )
                 return false;
-            }
-
-            while ( cursor->more() ) {
-                BSONObj collection = cursor->next();
-
-                LOG(2) << "\t cloner got " << collection << endl;
-
-                BSONElement e = collection.getField("name");
-                if ( e.eoo() ) {
-                    string s = "bad system.namespaces object " + collection.toString();
-                    massert( 10290 , s.c_str(), false);
-                }
-                verify( !e.eoo() );
-                verify( e.type() == String );
-                const char *from_name = e.valuestr();
-
-                if( strstr(from_name, ".system.") ) {
-                    /* system.users and s.js is cloned -- but nothing else from system.
-                     * system.indexes is handled specially at the end*/
-                    if( legalClientSystemNS( from_name , true ) == 0 ) {
-                        LOG(2) << "\t\t not cloning because system collection" << endl;
-                        continue;
-                    }
-                }
-                if( ! NamespaceString::normal( from_name ) ) {
-                    LOG(2) << "\t\t not cloning because has $ " << endl;
-                    continue;
-                }
 
-                if( opts.collsToIgnore.find( string( from_name ) ) != opts.collsToIgnore.end() ){
-                    LOG(2) << "\t\t ignoring collection " << from_name << endl;
-                    continue;
+            if ( clonedColls ) {
+                for ( list<BSONObj>::iterator i=toClone.begin(); i != toClone.end(); i++ ) {
+                    clonedColls->insert( (*i)["name"].String() );
                 }
-                else {
-                    LOG(2) << "\t\t not ignoring collection " << from_name << endl;
-                }
-
-                if ( clonedColls ) clonedColls->insert( from_name );
-                toClone.push_back( collection.getOwned() );
             }
         }
 
@@ -445,47 +397,7 @@ namespace mongo {
                 mayInterrupt( opts.mayBeInterrupted );
                 dbtempreleaseif r( opts.mayYield );
             }
-            BSONObj collection = *i;
-            LOG(2) << "  really will clone: " << collection << endl;
-            const char * from_name = collection["name"].valuestr();
-            BSONObj options = collection.getObjectField("options");
-
-            /* change name "<fromdb>.collection" -> <todb>.collection */
-            const char *p = strchr(from_name, '.');
-            verify(p);
-            string to_name = todb + p;
-
-            bool wantIdIndex = false;
-            {
-                string err;
-                const char *toname = to_name.c_str();
-                /* we defer building id index for performance - building it in batch is much faster */
-                userCreateNS(toname, options, err, opts.logForRepl, &wantIdIndex);
-            }
-            LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
-            Query q;
-            if( opts.snapshot )
-                q.snapshot();
-            copy(context,from_name, to_name.c_str(), false, opts.logForRepl, masterSameProcess,
-                 opts.slaveOk, opts.mayYield, opts.mayBeInterrupted, q);
-
-            if( wantIdIndex ) {
-                /* we need dropDups to be true as we didn't do a true snapshot and this is before applying oplog operations
-                   that occur during the initial sync.  inDBRepair makes dropDups be true.
-                   */
-                bool old = inDBRepair;
-                try {
-                    inDBRepair = true;
-                    Collection* c = cc().database()->getCollection( to_name );
-                    if ( c )
-                        c->getIndexCatalog()->ensureHaveIdIndex();
-                    inDBRepair = old;
-                }
-                catch(...) {
-                    inDBRepair = old;
-                    throw;
-                }
-            }
+            cloneCollection( context, *i, opts, masterSameProcess );
         }
 
         // now build the indexes
@@ -514,6 +426,128 @@ namespace mongo {
         return true;
     }
 
+    bool Cloner::listCollections(const CloneOptions& opts, list<BSONObj>* toClone,
+                                 string& errmsg, int* errCode) {
+        string systemNamespacesNS = opts.fromDB + ".system.namespaces";
+
+        // just using exhaust for collection copying right now
+
+        // todo: if snapshot (bool param to this func) is true, we need to snapshot this query?
+        //       only would be relevant if a thousands of collections -- maybe even then it is hard
+        //       to exceed a single cursor batch.
+        //       for repl it is probably ok as we apply oplog section after the clone (i.e. repl
+        //       doesnt not use snapshot=true).
+        auto_ptr<DBClientCursor> cursor = _conn->query(systemNamespacesNS, BSONObj(), 0, 0, 0,
+                                                       opts.slaveOk ? QueryOption_SlaveOk : 0);
+
+        if (!validateQueryResults(cursor, errCode, errmsg)) {
+            errmsg = str::stream() << "index query on ns " << systemNamespacesNS
+                                   << " failed: " << errmsg;
+            return false;
+        }
+
+        while ( cursor->more() ) {
+            BSONObj collection = cursor->next();
+
+            LOG(2) << "\t cloner got " << collection << endl;
+
+            BSONElement e = collection.getField("name");
+            if ( e.eoo() ) {
+                string s = "bad system.namespaces object " + collection.toString();
+                massert( 10290 , s.c_str(), false);
+            }
+            verify( !e.eoo() );
+            verify( e.type() == String );
+            const char *from_name = e.valuestr();
+
+            if( strstr(from_name, ".system.") ) {
+                /* system.users and s.js is cloned -- but nothing else from system.
+                 * system.indexes is handled specially at the end*/
+                if( legalClientSystemNS( from_name , true ) == 0 ) {
+                    LOG(2) << "\t\t not cloning because system collection" << endl;
+                    continue;
+                }
+            }
+            if( ! NamespaceString::normal( from_name ) ) {
+                LOG(2) << "\t\t not cloning because has $ " << endl;
+                continue;
+            }
+
+            if( opts.collsToIgnore.find( string( from_name ) ) != opts.collsToIgnore.end() ){
+                LOG(2) << "\t\t ignoring collection " << from_name << endl;
+                continue;
+            }
+            else {
+                LOG(2) << "\t\t not ignoring collection " << from_name << endl;
+            }
+
+            toClone->push_back( collection.getOwned() );
+        }
+        return true;
+    }
+
+    // inDBRepair is process wide, cloners of different databases building their _id indexes at
+    // once must not reset it under each other
+    static SimpleMutex idIndexBuildMutex("clonerIdIndex");
+
+    void Cloner::cloneCollection(Client::Context& context, const BSONObj& collection,
+                                 const CloneOptions& opts, bool masterSameProcess) {
+        string todb = context.db()->name();
+        LOG(2) << "  really will clone: " << collection << endl;
+        const char * from_name = collection["name"].valuestr();
+        BSONObj options = collection.getObjectField("options");
+
+        /* change name "<fromdb>.collection" -> <todb>.collection */
+        const char *p = strchr(from_name, '.');
+        verify(p);
+        string to_name = todb + p;
+
+        bool wantIdIndex = false;
+        {
+            string err;
+            const char *toname = to_name.c_str();
+            /* we defer building id index for performance - building it in batch is much faster */
+            userCreateNS(toname, options, err, opts.logForRepl, &wantIdIndex);
+        }
+        LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
+        Query q;
+        if( opts.snapshot )
+            q.snapshot();
+        copy(context,from_name, to_name.c_str(), false, opts.logForRepl, masterSameProcess,
+             opts.slaveOk, opts.mayYield, opts.mayBeInterrupted, q);
+
+        if( wantIdIndex ) {
+            /* we need dropDups to be true as we didn't do a true snapshot and this is before applying oplog operations
+               that occur during the initial sync.  inDBRepair makes dropDups be true.
+               */
+            SimpleMutex::scoped_lock lk(idIndexBuildMutex);
+            bool old = inDBRepair;
+            try {
+                inDBRepair = true;
+                Collection* c = cc().database()->getCollection( to_name );
+                if ( c )
+                    c->getIndexCatalog()->ensureHaveIdIndex();
+                inDBRepair = old;
+            }
+            catch(...) {
+                inDBRepair = old;
+                throw;
+            }
+        }
+
+        if ( opts.syncNonUniqueIndexes ) {
+            // duplicates are only resolved by applying the oplog, so unique indexes have to wait
+            // for the syncIndexes pass
+            string system_indexes_from = opts.fromDB + ".system.indexes";
+            string system_indexes_to = todb + ".system.indexes";
+            BSONObj query = BSON( "ns" << from_name << "name" << NE << "_id_" <<
+                                  "unique" << NIN << BSON_ARRAY( true << 1 ) );
+            copy(context, system_indexes_from.c_str(), system_indexes_to.c_str(), true,
+                 opts.logForRepl, masterSameProcess, opts.slaveOk, opts.mayYield,
+                 opts.mayBeInterrupted, query);
+        }
+    }
+
     bool Cloner::cloneFrom(Client::Context& context, const string& masterHost, const CloneOptions& options,
                            string& errmsg, int* errCode, set<string>* clonedCollections) {
         Cloner cloner;
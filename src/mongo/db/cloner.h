@@ -58,6 +58,21 @@ namespace mongo {
                 set<string>* clonedColls,
                 string& errmsg, int *errCode = 0);
 
+        /**
+         * Lists the collections of opts.fromDB which go() clones, as their system.namespaces
+         * entries.
+         */
+        bool listCollections(const CloneOptions& opts, list<BSONObj>* toClone,
+                             string& errmsg, int* errCode = 0);
+
+        /**
+         * Clones one collection listed by listCollections() into the database of 'context' and
+         * builds its _id index, plus its other non-unique indexes if opts.syncNonUniqueIndexes.
+         * Throws if the copy fails.
+         */
+        void cloneCollection(Client::Context& context, const BSONObj& collection,
+                             const CloneOptions& opts, bool masterSameProcess);
+
         bool copyCollection(const string& ns, const BSONObj& query, string& errmsg,
                             bool mayYield, bool mayBeInterrupted, bool copyIndexes = true,
                             bool logForRepl = true );
@@ -108,6 +123,7 @@ namespace mongo {
 
             syncData = true;
             syncIndexes = true;
+            syncNonUniqueIndexes = false;
         }
 
         string fromDB;
@@ -122,6 +138,8 @@ namespace mongo {
 
         bool syncData;
         bool syncIndexes;
+        // build each collection's non-unique indexes right after its data
+        bool syncNonUniqueIndexes;
     };
 
 } // namespace mongo
@@ -39,16 +39,36 @@
 #include "mongo/db/database.h"
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/curop-inl.h"
+#include "mongo/db/database_holder.h"
 #include "mongo/db/index_builder.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/kill_current_op.h"
+#include "mongo/db/storage_options.h"
 #include "mongo/db/structure/collection.h"
+#include "mongo/util/fail_point_service.h"
 
 namespace mongo {
 
     // from repl/rs.cpp
     bool isCurrentlyAReplSetPrimary();
 
+    // holds an online compact between two batches, with the lock released
+    MONGO_FP_DECLARE(compactOnlineHangBetweenBatches);
+
+    /**
+     * @return a Lock::CollectionWrite for a batch of an online compact of ns if collection level
+     * locking is enabled and the collection exists in an open database, otherwise a Lock::DBWrite.
+     */
+    static Lock::ScopedLock* lockForCompactBatch( const string& ns ) {
+        if ( Lock::CollectionWrite::supported( ns ) ) {
+            auto_ptr<Lock::ScopedLock> lk( new Lock::CollectionWrite( ns ) );
+            Database* db = dbHolder().get( ns, storageGlobalParams.dbpath );
+            if ( db && db->getCollection( ns ) )
+                return lk.release();
+        }
+        return new Lock::DBWrite( ns );
+    }
+
     class CompactCmd : public Command {
     public:
         virtual LockType locktype() const { return NONE; }
@@ -67,9 +87,13 @@ namespace mongo {
             help << "compact collection\n"
                 "warning: this operation blocks the server and is slow. you can cancel with cancelOp()\n"
                 "{ compact : <collection_name>, [force:<bool>], [validate:<bool>],\n"
-                "  [paddingFactor:<num>], [paddingBytes:<num>] }\n"
+                "  [paddingFactor:<num>], [paddingBytes:<num>],\n"
+                "  [online:<bool>], [batchSize:<num>] }\n"
                 "  force - allows to run on a replica set primary\n"
-                "  validate - check records are noncorrupt before adding to newly compacting extents. slower but safer (defaults to true in this version)\n";
+                "  validate - check records are noncorrupt before adding to newly compacting extents. slower but safer (defaults to true in this version)\n"
+                "  online - move the records of the last extents into free space elsewhere, a batch\n"
+                "           at a time releasing the lock in between, and free the emptied extents\n"
+                "  batchSize - records moved per batch of an online compact (default 100)\n";
         }
         CompactCmd() : Command("compact") { }
 
@@ -90,7 +114,9 @@ namespace mongo {
                 return false;
             }
 
-            if( isCurrentlyAReplSetPrimary() && !cmdObj["force"].trueValue() ) {
+            bool online = cmdObj["online"].trueValue();
+
+            if( !online && isCurrentlyAReplSetPrimary() && !cmdObj["force"].trueValue() ) {
                 errmsg = "will not run compact on an active replica set primary as this is a slow blocking operation. use force:true to force";
                 return false;
             }
@@ -141,6 +167,16 @@ namespace mongo {
             if ( cmdObj.hasElement("validate") )
                 compactOptions.validateDocuments = cmdObj["validate"].trueValue();
 
+            if ( cmdObj.hasElement("batchSize") ) {
+                compactOptions.batchSize = cmdObj["batchSize"].numberInt();
+                if ( compactOptions.batchSize < 1 ) {
+                    errmsg = "invalid batch size";
+                    return false;
+                }
+            }
+
+            if ( online )
+                return runOnline(ns, compactOptions, errmsg, result);
 
             Lock::DBWrite lk(ns.ns());
             BackgroundOperation::assertNoBgOpInProgForNs(ns.ns());
@@ -174,6 +210,82 @@ namespace mongo {
 
             return true;
         }
+
+    private:
+        /**
+         * Compacts a batch at a time, taking the write lock for each batch only.  Only the
+         * collection is locked if collection level locking is enabled.
+         */
+        bool runOnline(const NamespaceString& ns, const CompactOptions& compactOptions,
+                       string& errmsg, BSONObjBuilder& result) {
+            int numExtents = 0;
+            {
+                Client::ReadContext ctx(ns.ns());
+                Collection* collection = ctx.ctx().db()->getCollection(ns.ns());
+                if( ! collection ) {
+                    errmsg = "namespace does not exist";
+                    return false;
+                }
+
+                if ( collection->isCapped() ) {
+                    errmsg = "cannot compact a capped collection";
+                    return false;
+                }
+
+                collection->storageSize(&numExtents);
+            }
+
+            log() << "compact " << ns << " online begin, options: " << compactOptions.toString();
+
+            OnlineCompactState state;
+            ProgressMeterHolder pm(cc().curop()->setMessage("compact online",
+                                                            "Online Compact Progress",
+                                                            numExtents));
+            while ( true ) {
+                {
+                    scoped_ptr<Lock::ScopedLock> lk(lockForCompactBatch(ns.ns()));
+                    BackgroundOperation::assertNoBgOpInProgForNs(ns.ns());
+                    Client::Context ctx(ns);
+
+                    Collection* collection = ctx.db()->getCollection(ns.ns());
+                    if( ! collection ) {
+                        errmsg = "namespace was dropped during compact";
+                        return false;
+                    }
+
+                    long long extentsFreed = state.stats.extentsFreed;
+                    StatusWith<bool> more = collection->compactBatch(&compactOptions, &state);
+                    if ( !more.isOK() )
+                        return appendCommandStatus(result, more.getStatus());
+
+                    pm.hit(static_cast<int>(state.stats.extentsFreed - extentsFreed));
+                    cc().curop()->setProgressDetails(
+                        BSON("recordsMoved" << state.stats.recordsMoved
+                             << "extentsFreed" << state.stats.extentsFreed
+                             << "bytesReclaimed" << state.stats.bytesReclaimed));
+
+                    if ( !more.getValue() )
+                        break;
+                }
+
+                // the lock was released, others got their turn, the next batch checks for
+                // interrupts
+                cc().curop()->yielded();
+
+                while ( MONGO_FAIL_POINT(compactOnlineHangBetweenBatches) ) {
+                    sleepmillis( 100 );
+                }
+            }
+            pm.finished();
+
+            log() << "compact " << ns << " online end, moved " << state.stats.recordsMoved
+                  << " records, freed " << state.stats.extentsFreed << " extents";
+
+            result.appendNumber("recordsMoved", state.stats.recordsMoved);
+            result.appendNumber("extentsFreed", state.stats.extentsFreed);
+            result.appendNumber("bytesReclaimed", state.stats.bytesReclaimed);
+            return true;
+        }
     };
     static CompactCmd compactCmd;
 
@@ -0,0 +1,145 @@
+// create_indexes.cpp
+
+/**
+*    Copyright (C) 2013 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/auth/action_set.h"
+#include "mongo/db/auth/action_type.h"
+#include "mongo/db/auth/privilege.h"
+#include "mongo/db/catalog/index_catalog.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/database.h"
+#include "mongo/db/ops/insert.h"
+#include "mongo/db/repl/oplog.h"
+#include "mongo/db/structure/collection.h"
+
+namespace mongo {
+
+    /**
+     * { createIndexes : <collection>, indexes : [ <index spec>, ... ] }
+     *
+     * Foreground indexes are built together with one scan of the collection, rather than one
+     * scan per index as when the specs are inserted into system.indexes.
+     */
+    class CmdCreateIndexes : public Command {
+    public:
+        CmdCreateIndexes() : Command( "createIndexes" ) { }
+
+        // each new index is logged as an insert into system.indexes instead
+        virtual bool logTheOp() { return false; }
+        virtual bool slaveOk() const { return false; }
+        virtual LockType locktype() const { return WRITE; }
+        virtual void help( stringstream& help ) const {
+            help << "create several indexes on a collection, scanning it once\n"
+                 << "{ createIndexes : <collection>, indexes : [ { key : ..., name : ... }, ... ] }";
+        }
+        virtual void addRequiredPrivileges( const std::string& dbname,
+                                            const BSONObj& cmdObj,
+                                            std::vector<Privilege>* out ) {
+            ActionSet actions;
+            actions.addAction( ActionType::createIndex );
+            out->push_back( Privilege( parseResourcePattern( dbname, cmdObj ), actions ) );
+        }
+
+        bool run( const string& dbname, BSONObj& cmdObj, int, string& errmsg,
+                  BSONObjBuilder& result, bool /*fromRepl*/ ) {
+            string ns = dbname + '.' + cmdObj.firstElement().valuestrsafe();
+            if ( !NamespaceString::validCollectionComponent( ns ) ) {
+                errmsg = "invalid collection name";
+                return false;
+            }
+
+            BSONElement indexes = cmdObj["indexes"];
+            if ( indexes.type() != Array ) {
+                errmsg = "indexes has to be an array";
+                return false;
+            }
+
+            vector<BSONObj> specs;
+            BSONObjIterator i( indexes.Obj() );
+            while ( i.more() ) {
+                BSONElement e = i.next();
+                if ( e.type() != Object ) {
+                    errmsg = "every index spec has to be an object";
+                    return false;
+                }
+
+                BSONObj spec = e.Obj();
+                if ( spec["ns"].eoo() ) {
+                    BSONObjBuilder b;
+                    b.append( "ns", ns );
+                    b.appendElements( spec );
+                    spec = b.obj();
+                }
+
+                StatusWith<BSONObj> fixed = fixDocumentForInsert( spec );
+                if ( !fixed.isOK() )
+                    return appendCommandStatus( result, fixed.getStatus() );
+                specs.push_back( fixed.getValue().isEmpty() ? spec : fixed.getValue() );
+            }
+
+            if ( specs.empty() ) {
+                errmsg = "no indexes to add";
+                return false;
+            }
+
+            Database* db = cc().database();
+            Collection* collection = db->getCollection( ns );
+            result.appendBool( "createdCollectionAutomatically", collection == NULL );
+            if ( !collection ) {
+                collection = db->createCollection( ns );
+                if ( !collection ) {
+                    errmsg = "could not create collection";
+                    return false;
+                }
+            }
+
+            IndexCatalog* indexCatalog = collection->getIndexCatalog();
+            result.append( "numIndexesBefore", indexCatalog->numIndexesTotal() );
+
+            vector<BSONObj> created;
+            Status status = indexCatalog->createIndexes( specs, true, &created );
+
+            string systemIndexes = dbname + ".system.indexes";
+            for ( size_t j = 0; j < created.size(); j++ ) {
+                logOp( "i", systemIndexes.c_str(), created[j] );
+            }
+
+            if ( !status.isOK() )
+                return appendCommandStatus( result, status );
+
+            result.append( "numIndexesAfter", indexCatalog->numIndexesTotal() );
+            return true;
+        }
+    } cmdCreateIndexes;
+
+}
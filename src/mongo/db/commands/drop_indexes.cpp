@@ -238,13 +238,14 @@ namespace mongo {
                 return appendCommandStatus( result, s );
             }
 
-            for ( list<BSONObj>::iterator i=all.begin(); i!=all.end(); i++ ) {
-                BSONObj o = *i;
-                LOG(1) << "reIndex ns: " << toDeleteNs << " index: " << o << endl;
-                Status s = collection->getIndexCatalog()->createIndex( o, false );
-                if ( !s.isOK() )
-                    return appendCommandStatus( result, s );
+            // rebuild them together, with a single scan of the collection
+            vector<BSONObj> specs( all.begin(), all.end() );
+            for ( size_t i = 0; i < specs.size(); i++ ) {
+                LOG(1) << "reIndex ns: " << toDeleteNs << " index: " << specs[i] << endl;
             }
+            s = collection->getIndexCatalog()->createIndexes( specs, false, NULL );
+            if ( !s.isOK() )
+                return appendCommandStatus( result, s );
 
             result.append( "nIndexes" , (int)all.size() );
             result.appendArray( "indexes" , b.obj() );
@@ -59,6 +59,7 @@ namespace {
         PipelineRunner(intrusive_ptr<Pipeline> pipeline)
             : _pipeline(pipeline)
             , _includeMetaData(_pipeline->getContext()->inShard) // send metadata to merger
+            , _batchPosition(0)
         {}
 
         virtual RunnerState getNext(BSONObj* objOut, DiskLoc* dlOut) {
@@ -115,22 +116,31 @@ namespace {
 
     private:
         boost::optional<BSONObj> getNextBson() {
-            if (boost::optional<Document> next = _pipeline->output()->getNext()) {
-                if (_includeMetaData) {
-                    return next->toBsonWithMetaData();
-                }
-                else {
-                    return next->toBson();
-                }
+            if (_batchPosition == _batch.size()) {
+                // pull whole batches so the stages before the output can run batch at a time
+                _pipeline->output()->getNextBatch(&_batch);
+                _batchPosition = 0;
+                if (_batch.empty())
+                    return boost::none;
             }
 
-            return boost::none;
+            const Document& next = _batch[_batchPosition++];
+            if (_includeMetaData) {
+                return next.toBsonWithMetaData();
+            }
+            else {
+                return next.toBson();
+            }
         }
 
         // Things in the _stash sould be returned before pulling items from _pipeline.
         const intrusive_ptr<Pipeline> _pipeline;
         vector<BSONObj> _stash;
         const bool _includeMetaData;
+
+        // Documents pulled from _pipeline but not yet returned, starting at _batchPosition.
+        vector<Document> _batch;
+        size_t _batchPosition;
     };
 }
 
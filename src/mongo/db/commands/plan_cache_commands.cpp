@@ -92,6 +92,7 @@ namespace {
         // the ActionType construction will be completed first.
         new PlanCacheListKeys();
         new PlanCacheClear();
+        new PlanCacheStats();
         new PlanCacheGenerateKey();
         new PlanCacheGet();
         new PlanCacheDrop();
@@ -217,6 +218,43 @@ namespace mongo {
         return Status::OK();
     }
 
+    PlanCacheStats::PlanCacheStats() : PlanCacheCommand("planCacheStats",
+        "Displays the size and hit, miss, eviction and replan counts of a collection's "
+        "plan cache.",
+        ActionType::planCacheRead) { }
+
+    Status PlanCacheStats::runPlanCacheCommand(const string& ns, BSONObj& cmdObj,
+                                               BSONObjBuilder* bob) {
+        // This is a read lock. The query cache is owned by the collection.
+        Client::ReadContext readCtx(ns);
+        Client::Context& ctx = readCtx.ctx();
+        PlanCache* planCache;
+        Status status = getPlanCache(ctx.db(), ns, &planCache);
+        if (!status.isOK()) {
+            return status;
+        }
+        return stats(*planCache, bob);
+    }
+
+    // static
+    Status PlanCacheStats::stats(const PlanCache& planCache, BSONObjBuilder* bob) {
+        verify(bob);
+
+        PlanCache::Stats stats;
+        planCache.getStats(&stats);
+
+        bob->appendNumber("entries", stats.entries);
+        bob->appendNumber("sizeBytes", stats.sizeBytes);
+        bob->append("maxEntries", internalQueryPlanCacheMaxEntries);
+        bob->append("maxSizeBytes", internalQueryPlanCacheMaxSizeBytes);
+        bob->appendNumber("hits", stats.hits);
+        bob->appendNumber("misses", stats.misses);
+        bob->appendNumber("evictions", stats.evictions);
+        bob->appendNumber("replans", stats.replans);
+
+        return Status::OK();
+    }
+
     PlanCacheGenerateKey::PlanCacheGenerateKey() : PlanCacheCommand("planCacheGenerateKey",
         "Returns a key into the cache for a query. "
         "Similar queries with the same query shape "
@@ -128,6 +128,25 @@ namespace mongo {
         static Status clear(PlanCache* planCache);
     };
 
+    /**
+     * planCacheStats
+     *
+     * { planCacheStats: <collection> }
+     *
+     */
+    class PlanCacheStats : public PlanCacheCommand {
+    public:
+        PlanCacheStats();
+        virtual Status runPlanCacheCommand(const std::string& ns, BSONObj& cmdObj,
+                                           BSONObjBuilder* bob);
+
+        /**
+         * Inserts the size, bounds and hit/miss/eviction/replan counters of the collection's
+         * plan cache into BSON builder.
+         */
+        static Status stats(const PlanCache& planCache, BSONObjBuilder* bob);
+    };
+
     /**
      * planCacheGenerateKey
      *
@@ -142,6 +142,39 @@ namespace {
         ASSERT_EQUALS(getKeys(planCache).size(), 0U);
     }
 
+    /**
+     * Tests for planCacheStats
+     */
+
+    TEST(PlanCacheCommandsTest, planCacheStatsCounters) {
+        CanonicalQuery* cqRaw;
+        ASSERT_OK(CanonicalQuery::canonicalize(ns, fromjson("{a: 1}"), &cqRaw));
+        auto_ptr<CanonicalQuery> cq(cqRaw);
+
+        PlanCache planCache;
+        CachedSolution* rawCS;
+        ASSERT_NOT_OK(planCache.get(*cq, &rawCS));
+
+        QuerySolution qs;
+        qs.cacheData.reset(createSolutionCacheData());
+        std::vector<QuerySolution*> solns;
+        solns.push_back(&qs);
+        planCache.add(*cq, solns, new PlanRankingDecision());
+        ASSERT_OK(planCache.get(*cq, &rawCS));
+        delete rawCS;
+
+        BSONObjBuilder bob;
+        ASSERT_OK(PlanCacheStats::stats(planCache, &bob));
+        BSONObj resultObj = bob.obj();
+        ASSERT_EQUALS(resultObj["entries"].numberLong(), 1);
+        ASSERT_GREATER_THAN(resultObj["sizeBytes"].numberLong(), 0);
+        ASSERT_EQUALS(resultObj["maxEntries"].numberInt(), internalQueryPlanCacheMaxEntries);
+        ASSERT_EQUALS(resultObj["hits"].numberLong(), 1);
+        ASSERT_EQUALS(resultObj["misses"].numberLong(), 1);
+        ASSERT_EQUALS(resultObj["evictions"].numberLong(), 0);
+        ASSERT_EQUALS(resultObj["replans"].numberLong(), 0);
+    }
+
     /**
      * Tests for runGetPlanCacheKey
      * Mostly validation on the input parameters
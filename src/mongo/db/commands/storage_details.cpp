@@ -523,9 +523,9 @@ namespace {
      *
      * @return true on success, false on failure (partial output may still be present)
      */
-    bool analyzeDiskStorage(const NamespaceDetails* nsd, const Extent* ex,
-                                               const AnalyzeParams& params, string& errmsg,
-                                               BSONObjBuilder& result) {
+    bool analyzeDiskStorage(const NamespaceDetails* nsd, const DeletedRecordIndex* deletedRecords,
+                            const Extent* ex, const AnalyzeParams& params, string& errmsg,
+                            BSONObjBuilder& result) {
         bool isCapped = nsd->isCapped();
 
         result.append("extentHeaderBytes", Extent::HeaderSize());
@@ -566,7 +566,19 @@ namespace {
                     new BSONArrayBuilder(result.subarrayStart("deletedRecords")));
         }
 
-        if (processingDeletedRecords) {
+        if (processingDeletedRecords && deletedRecords != NULL) {
+            // only look at the deleted records in this extent
+            vector<DiskLoc> inExtent;
+            deletedRecords->findInRange(ex->myLoc, ex->length, &inExtent);
+            for (vector<DiskLoc>::const_iterator it = inExtent.begin(); it != inExtent.end();
+                 ++it) {
+                DeletedRecord* dr = it->drec();
+                processDeletedRecord(*it, dr, ex, params,
+                                     NamespaceDetails::bucket(dr->lengthWithHeaders()),
+                                     sliceData, deletedRecordsArrayBuilder.get());
+            }
+        }
+        else if (processingDeletedRecords) {
             for (int bucketNum = 0; bucketNum < mongo::Buckets; bucketNum++) {
                 DiskLoc dl = nsd->deletedListEntry(bucketNum);
                 while (!dl.isNull()) {
@@ -677,8 +689,9 @@ namespace {
      * @param params analysis parameters, will be updated with computed number of slices or
      *               granularity
      */
-    bool analyzeExtent(const NamespaceDetails* nsd, const Extent* ex, SubCommand subCommand,
-                       AnalyzeParams& params, string& errmsg, BSONObjBuilder& outputBuilder) {
+    bool analyzeExtent(const NamespaceDetails* nsd, const DeletedRecordIndex* deletedRecords,
+                       const Extent* ex, SubCommand subCommand, AnalyzeParams& params,
+                       string& errmsg, BSONObjBuilder& outputBuilder) {
 
         params.startOfs = max(0, params.startOfs);
         params.endOfs = min(params.endOfs, ex->length);
@@ -698,7 +711,8 @@ namespace {
                 (params.granularity * (params.numberOfSlices - 1));
         switch (subCommand) {
             case SUBCMD_DISK_STORAGE:
-                return analyzeDiskStorage(nsd, ex, params, errmsg, outputBuilder);
+                return analyzeDiskStorage(nsd, deletedRecords, ex, params, errmsg,
+                                          outputBuilder);
             case SUBCMD_PAGES_IN_RAM:
                 return analyzePagesInRAM(ex, params, errmsg, outputBuilder);
         }
@@ -712,12 +726,15 @@ namespace {
                      SubCommand subCommand, AnalyzeParams& globalParams,
                      string& errmsg, BSONObjBuilder& result) {
         const NamespaceDetails* nsd = collection->details();
+        const DeletedRecordIndex* deletedRecords =
+            collection->getRecordStore()->getDeletedRecordIndex();
         const ExtentManager& em = db->getExtentManager();
         BSONObjBuilder outputBuilder; // temporary builder to avoid output corruption in case of
                                       // failure
         bool success = false;
         if (ex != NULL) {
-            success = analyzeExtent(nsd, ex, subCommand, globalParams, errmsg, outputBuilder);
+            success = analyzeExtent(nsd, deletedRecords, ex, subCommand, globalParams, errmsg,
+                                    outputBuilder);
         }
         else {
             const DiskLoc dl = nsd->firstExtent();
@@ -743,8 +760,8 @@ namespace {
                                                  // total number of slices across all the
                                                  // extents
                 BSONObjBuilder extentBuilder(extentsArrayBuilder.subobjStart());
-                success = analyzeExtent(nsd, curExtent, subCommand, extentParams, errmsg,
-                                        extentBuilder);
+                success = analyzeExtent(nsd, deletedRecords, curExtent, subCommand, extentParams,
+                                        errmsg, extentBuilder);
                 extentBuilder.doneFast();
             }
             extentsArrayBuilder.doneFast();
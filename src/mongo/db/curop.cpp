@@ -79,6 +79,7 @@ namespace mongo {
         _maxTimeTracker.reset();
         _message = "";
         _progressMeter.finished();
+        _progressDetails.reset();
         _killPending.store(0);
         killCurrentOp.notifyAllWaiters();
         _numYields = 0;
@@ -259,6 +260,10 @@ namespace mongo {
             }
         }
 
+        if ( _progressDetails.have() ) {
+            _progressDetails.append( b , "progressDetails" );
+        }
+
         if( killPending() )
             b.append("killPending", true);
 
@@ -287,6 +287,9 @@ namespace mongo {
                                   int secondsBetween = 3);
         string getMessage() const { return _message.toString(); }
         ProgressMeter& getProgressMeter() { return _progressMeter; }
+
+        /** details of the progress beyond the meter, reported in currentOp as progressDetails */
+        void setProgressDetails( const BSONObj& details ) { _progressDetails.set( details ); }
         CurOp *parent() const { return _wrapped; }
         void kill(bool* pNotifyFlag = NULL); 
         bool killPendingStrict() const { return _killPending.load(); }
@@ -341,6 +344,7 @@ namespace mongo {
         OpDebug _debug;
         ThreadSafeString _message;
         ProgressMeter _progressMeter;
+        CachedBSONObj _progressDetails;  // CachedBSONObj is thread safe
         AtomicInt32 _killPending;
         int _numYields;
         LockStat _lockStat;
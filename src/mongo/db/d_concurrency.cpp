@@ -39,6 +39,7 @@
 #include "mongo/db/dur.h"
 #include "mongo/db/lockstat.h"
 #include "mongo/db/namespace_string.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/server.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/concurrency/mapsf.h"
@@ -65,6 +66,10 @@ namespace mongo {
 
     static const bool DB_LEVEL_LOCKING_ENABLED = ( ( MONGOD_CONCURRENCY_LEVEL ) >= MONGOD_CONCURRENCY_LEVEL_DB );
 
+    // when true, inserts into and updates of existing collections take a Lock::CollectionWrite rather than
+    // a Lock::DBWrite.  startup only as ExtentManager sizes itself for it when a db is opened.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(collectionLevelLocking, bool, false);
+
     inline LockState& lockState() { 
         return cc().lockState();
     }
@@ -100,6 +105,17 @@ namespace mongo {
     typedef mapsf< StringMap<WrapperForRWLock*> > DBLocksMap;
     static DBLocksMap dblocks;
 
+    /* full ns->lock for Lock::CollectionWrite.  like dblocks these are never deleted. */
+    static DBLocksMap collectionLocks;
+
+    static WrapperForRWLock* getLock( DBLocksMap& locks, const StringData& name ) {
+        DBLocksMap::ref r(locks);
+        WrapperForRWLock*& lock = r[name];
+        if( lock == 0 )
+            lock = new WrapperForRWLock(name, Lock::collectionLevelLockingEnabled());
+        return lock;
+    }
+
     /* we don't want to touch dblocks too much as a mutex is involved.  thus party for that, 
        this is here...
     */
@@ -272,9 +288,19 @@ namespace mongo {
             msgasserted(16105, str::stream() << "expected to be write locked for " << ns);
         }
     }
+    bool Lock::isIntentWriteLocked(const StringData& db) {
+        if( isWriteLocked(db) )
+            return true;
+        LockState &ls = lockState();
+        return ls.threadState() == 'w' && ls.hasCollectionLock() &&
+            nsToDatabaseSubstring( ls.collectionName() ) == nsToDatabaseSubstring( db );
+    }
     bool Lock::dbLevelLockingEnabled() {
         return DB_LEVEL_LOCKING_ENABLED;
     }
+    bool Lock::collectionLevelLockingEnabled() {
+        return DB_LEVEL_LOCKING_ENABLED && collectionLevelLocking;
+    }
 
     RWLockRecursive &Lock::ParallelBatchWriterMode::_batchLock = *(new RWLockRecursive("special"));
     void Lock::ParallelBatchWriterMode::iAmABatchParticipant() {
@@ -416,6 +442,12 @@ namespace mongo {
     void Lock::DBRead::_relock() { 
         lockDB(_what);
     }
+    void Lock::CollectionWrite::_tempRelease() {
+        unlockCollection();
+    }
+    void Lock::CollectionWrite::_relock() {
+        lockCollection();
+    }
 
     Lock::GlobalWrite::GlobalWrite(bool sg, int timeoutms)
         : ScopedLock('W') {
@@ -526,6 +558,8 @@ namespace mongo {
         fassert( 16252, !db.empty() );
         LockState& ls = lockState();
 
+        massert(17351, str::stream() << "can't dblock:" << db << " while holding a collection lock on " << ls.collectionName(), !ls.hasCollectionLock());
+
         // we do checks first, as on assert destructor won't be called so don't want to be half finished with our work.
         if( ls.otherCount() ) { 
             // nested. if/when we do temprelease with DBWrite we will need to increment here
@@ -542,7 +576,7 @@ namespace mongo {
             DBLocksMap::ref r(dblocks);
             WrapperForRWLock*& lock = r[db];
             if( lock == 0 )
-                lock = new WrapperForRWLock(db);
+                lock = new WrapperForRWLock(db, collectionLevelLockingEnabled());
             ls.lockedOther( db , 1 , lock );
         }
         else { 
@@ -716,6 +750,8 @@ namespace mongo {
         fassert( 16255, !db.empty() );
         LockState& ls = lockState();
 
+        massert(17352, str::stream() << "can't dblock:" << db << " while holding a collection lock on " << ls.collectionName(), !ls.hasCollectionLock());
+
         // we do checks first, as on assert destructor won't be called so don't want to be half finished with our work.
         if( ls.otherCount() ) { 
             // nested. prev could be read or write. if/when we do temprelease with DBRead/DBWrite we will need to increment/decrement here
@@ -732,7 +768,7 @@ namespace mongo {
             DBLocksMap::ref r(dblocks);
             WrapperForRWLock*& lock = r[db];
             if( lock == 0 )
-                lock = new WrapperForRWLock(db);
+                lock = new WrapperForRWLock(db, collectionLevelLockingEnabled());
             ls.lockedOther( db , -1 , lock );
         }
         else { 
@@ -744,6 +780,63 @@ namespace mongo {
         _weLocked = ls.otherLock();
     }
 
+    bool Lock::CollectionWrite::supported(const StringData& ns) {
+        if( !collectionLevelLockingEnabled() )
+            return false;
+        NamespaceString nss(ns);
+        if( !nss.isValid() || nss.isSystem() )
+            return false;
+        return n(nss.db()) == notnestable;
+    }
+
+    Lock::CollectionWrite::CollectionWrite( const StringData& ns )
+        : ScopedLock( 'w' ), _locked_w(false), _dbLock(0), _collectionLock(0), _ns(ns.toString()) {
+        // without collection level locking the db lock has no intent mode, see getLock()
+        fassert( 17363, supported( _ns ) );
+        lockCollection();
+    }
+
+    Lock::CollectionWrite::~CollectionWrite() {
+        unlockCollection();
+    }
+
+    void Lock::CollectionWrite::lockCollection() {
+        LockState& ls = lockState();
+        StringData db = nsToDatabaseSubstring( _ns );
+
+        // checks first, as on assert the destructor won't be called
+        fassert( 17353, n(db) == notnestable );
+        massert( 17354, str::stream() << "can't lock collection " << _ns << " while holding another lock",
+                 ls.threadState() == 0 && ls.otherCount() == 0 && ls.nestableCount() == 0 &&
+                 !ls.hasCollectionLock() );
+
+        // same order as DBWrite: database, then global, then the collection
+        Acquiring a(this,ls);
+        _dbLock = getLock( dblocks, db );
+        _collectionLock = getLock( collectionLocks, _ns );
+        ls.lockedCollection( _ns, _dbLock, _collectionLock );
+
+        _dbLock->lock_intent();
+        qlk.lock_w();
+        _locked_w = true;
+        _collectionLock->lock();
+    }
+
+    void Lock::CollectionWrite::unlockCollection() {
+        if( _collectionLock ) {
+            recordTime();  // for lock stats
+            lockState().unlockedCollection();
+            _collectionLock->unlock();
+            _dbLock->unlock_intent();
+        }
+        if( _locked_w ) {
+            qlk.unlock_w();
+        }
+        _collectionLock = 0;
+        _dbLock = 0;
+        _locked_w = false;
+    }
+
     Lock::DBWrite::UpgradeToExclusive::UpgradeToExclusive() {
         fassert( 16187, lockState().threadState() == 'w' );
 
@@ -871,6 +964,13 @@ namespace mongo {
                     b.append(i->first, i->second->stats.report());
                 }
             }
+            {
+                // keyed by full ns, which can't clash with a database name
+                DBLocksMap::ref r(collectionLocks);
+                for( DBLocksMap::const_iterator i = r.r.begin(); i != r.r.end(); ++i ) {
+                    b.append(i->first, i->second->stats.report());
+                }
+            }
             return b.obj();
         }
 
@@ -59,8 +59,10 @@ namespace mongo {
         static bool atLeastReadLocked(const StringData& ns); // true if this db is locked
         static void assertAtLeastReadLocked(const StringData& ns);
         static void assertWriteLocked(const StringData& ns);
+        static bool isIntentWriteLocked(const StringData& db); // db is write locked, or one of its collections is
 
         static bool dbLevelLockingEnabled(); 
+        static bool collectionLevelLockingEnabled();
         
         static LockStat* globalLockStat();
         static LockStat* nestableLockStat( Nestable db );
@@ -229,6 +231,40 @@ namespace mongo {
             
         };
 
+        /**
+         * lock a single collection for writing.  the database is locked in intent exclusive
+         * ('w') mode and the collection exclusively, so writers to different collections of
+         * the same database run in parallel while DBRead and DBWrite on that database wait
+         * for them.
+         *
+         * only for collections that already exist in an open database: anything that changes
+         * the database catalog (creating collections or indexes, opening the database) still
+         * needs a DBWrite.  may not be nested inside or around other database locks, except
+         * for the local db (oplog) which can be locked inside.  callers must check supported()
+         * first and use a DBWrite otherwise.
+         */
+        class CollectionWrite : public ScopedLock {
+            void lockCollection();
+            void unlockCollection();
+
+        protected:
+            void _tempRelease();
+            void _relock();
+
+        public:
+            CollectionWrite(const StringData& ns);
+            virtual ~CollectionWrite();
+
+            /** @return true if a CollectionWrite may be used for ns, see above */
+            static bool supported(const StringData& ns);
+
+        private:
+            bool _locked_w;
+            WrapperForRWLock *_dbLock;
+            WrapperForRWLock *_collectionLock;
+            const string _ns;
+        };
+
     };
 
     class readlocktry : boost::noncopyable {
@@ -71,6 +71,7 @@
 #include "mongo/db/storage_options.h"
 #include "mongo/db/ttl.h"
 #include "mongo/platform/process_id.h"
+#include "mongo/s/d_logic.h"
 #include "mongo/s/d_writeback.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/background.h"
@@ -181,8 +182,42 @@ namespace mongo {
         sleepmicros( Client::recommendedYieldMicros() );
     }
 
+    /**
+     * What a client connection keeps in thread local storage: its Client and its sharding
+     * info.  Moved between threads by a reactor message server.
+     */
+    class MongodConnectionState : public MessageHandler::ConnectionState {
+    public:
+        MongodConnectionState() : _client( NULL ), _sharding( NULL ) {}
+
+        virtual ~MongodConnectionState() {
+            delete _sharding;
+            delete _client;
+        }
+
+        virtual void attach() {
+            if ( _client )
+                currentClient.reset( _client );
+            if ( _sharding )
+                ShardedConnectionInfo::attach( _sharding );
+        }
+
+        virtual void detach() {
+            _client = currentClient.release();
+            _sharding = ShardedConnectionInfo::release();
+        }
+
+    private:
+        Client* _client;
+        ShardedConnectionInfo* _sharding;
+    };
+
     class MyMessageHandler : public MessageHandler {
     public:
+        virtual bool isThreadAgnostic() const { return true; }
+
+        virtual ConnectionState* newConnectionState() { return new MongodConnectionState(); }
+
         virtual void connected( AbstractMessagingPort* p ) {
             Client::initThread("conn", p);
         }
@@ -275,6 +310,8 @@ namespace mongo {
         MessageServer::Options options;
         options.port = port;
         options.ipList = serverGlobalParams.bind_ip;
+        options.reactorThreads = netReactorThreads;
+        options.workerThreads = netReactorWorkerThreads;
 
         MessageServer * server = createServer( options , new MyMessageHandler() );
         server->setAsTimeTracker();
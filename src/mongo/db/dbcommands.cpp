@@ -67,6 +67,7 @@
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/storage/extent_manager.h"
 #include "mongo/db/write_concern.h"
 #include "mongo/s/d_logic.h"
 #include "mongo/s/d_writeback.h"
@@ -255,6 +256,63 @@ namespace mongo {
         }
     } cmdRepairDatabase;
 
+    class CmdReclaimFreeSpace : public Command {
+    public:
+        virtual bool logTheOp() {
+            return false;
+        }
+        virtual bool slaveOk() const {
+            return true;
+        }
+        virtual void help( stringstream& help ) const {
+            help << "give the disk space of free extents back to the filesystem, without a repair\n"
+                 << "{ reclaimFreeSpace : 1, [truncateFiles : <bool>] }\n"
+                 << "  truncateFiles - delete the data files at the end which only hold free\n"
+                 << "                  extents (default true)";
+        }
+        virtual LockType locktype() const { return WRITE; }
+        // syncDataAndTruncateJournal requires a global lock
+        virtual bool lockGlobally() const { return true; }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::repairDatabase);
+            out->push_back(Privilege(ResourcePattern::forDatabaseName(dbname), actions));
+        }
+        CmdReclaimFreeSpace() : Command("reclaimFreeSpace") {}
+
+        bool run(const string& dbname , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+            bool truncateFiles = true;
+            if ( cmdObj.hasElement( "truncateFiles" ) )
+                truncateFiles = cmdObj["truncateFiles"].trueValue();
+
+            ExtentManager& em = cc().database()->getExtentManager();
+
+            // the extents freed so far must never be written to by recovery again
+            getDur().syncDataAndTruncateJournal();
+
+            int filesDeleted = truncateFiles ? em.detachTrailingFreeFiles() : 0;
+            long long bytesDeleted = 0;
+            if ( filesDeleted > 0 ) {
+                // neither the free list nor the journal may refer to the files once they're gone
+                getDur().syncDataAndTruncateJournal();
+                bytesDeleted = em.deleteTrailingFiles( filesDeleted );
+            }
+            result.append( "filesDeleted", filesDeleted );
+            result.appendNumber( "bytesDeleted", bytesDeleted );
+
+            StatusWith<long long> punched = em.punchFreeExtents();
+            if ( !punched.isOK() )
+                return appendCommandStatus( result, punched.getStatus() );
+            result.appendNumber( "bytesPunched", punched.getValue() );
+
+            log() << "reclaimFreeSpace " << dbname << " deleted " << filesDeleted << " files ("
+                  << bytesDeleted << " bytes), punched " << punched.getValue() << " bytes";
+            return true;
+        }
+    } cmdReclaimFreeSpace;
+
     /* set db profiling level
        todo: how do we handle profiling information put in the db with replication?
              sensibly or not?
@@ -1055,6 +1113,14 @@ namespace mongo {
             result.append( "systemFlags" , nsd->systemFlags() );
             result.append( "userFlags" , nsd->userFlags() );
 
+            const DeletedRecordIndex* deletedRecords =
+                collection->getRecordStore()->getDeletedRecordIndex();
+            if ( deletedRecords ) {
+                BSONObjBuilder freeLists( result.subobjStart( "sizeClassFreeLists" ) );
+                deletedRecords->appendStats( &freeLists );
+                freeLists.doneFast();
+            }
+
             BSONObjBuilder indexSizes;
             result.appendNumber( "totalIndexSize" , getIndexSizeForCollection(dbname, ns, &indexSizes, scale) / scale );
             result.append("indexSizes", indexSizes.obj());
@@ -1081,6 +1147,7 @@ namespace mongo {
             help << 
                 "Sets collection options.\n"
                 "Example: { collMod: 'foo', usePowerOf2Sizes:true }\n"
+                "Example: { collMod: 'foo', useSizeClassFreeLists:true }\n"
                 "Example: { collMod: 'foo', index: {keyPattern: {a: 1}, expireAfterSeconds: 600} }";
         }
         virtual void addRequiredPrivileges(const std::string& dbname,
@@ -1124,6 +1191,28 @@ namespace mongo {
                         result.appendBool( "usePowerOf2Sizes_new", newPowerOf2 );
                     }
                 }
+                else if ( str::equals( "useSizeClassFreeLists", e.fieldName() ) ) {
+                    bool oldSizeClasses =
+                        nsd->isUserFlagSet( NamespaceDetails::Flag_UseSizeClassFreeLists );
+                    bool newSizeClasses = e.trueValue();
+
+                    if ( newSizeClasses && nsd->isCapped() ) {
+                        errmsg = "capped collections don't use free lists";
+                        ok = false;
+                        continue;
+                    }
+
+                    if ( oldSizeClasses != newSizeClasses ) {
+                        result.appendBool( "useSizeClassFreeLists_old", oldSizeClasses );
+
+                        newSizeClasses ?
+                            nsd->setUserFlag( NamespaceDetails::Flag_UseSizeClassFreeLists ) :
+                            nsd->clearUserFlag( NamespaceDetails::Flag_UseSizeClassFreeLists );
+                        nsd->syncUserFlags( ns ); // must keep system.namespaces up-to-date
+
+                        result.appendBool( "useSizeClassFreeLists_new", newSizeClasses );
+                    }
+                }
                 else if ( str::equals( "index", e.fieldName() ) ) {
                     BSONObj indexObj = e.Obj();
                     BSONObj keyPattern = indexObj.getObjectField( "keyPattern" );
@@ -1258,6 +1347,13 @@ namespace mongo {
             result.appendNumber( "indexes" , indexes );
             result.appendNumber( "indexSize" , indexSize / scale );
             result.appendNumber( "fileSize" , d->fileSize() / scale );
+            if ( d ) {
+                long long reclaimable;
+                long long reclaimed;
+                d->getExtentManager().freeSpaceStats( &reclaimable, &reclaimed );
+                result.appendNumber( "reclaimableSize" , reclaimable / scale );
+                result.appendNumber( "reclaimedSize" , reclaimed / scale );
+            }
             if( d )
                 result.appendNumber( "nsSizeMB", (int) d->namespaceIndex().fileLength() / 1024 / 1024 );
 
@@ -58,13 +58,19 @@
      READLOCK mmmutex
        commitJob.reset()
      UNLOCK dbMutex                      // now other threads can write
-       WRITETOJOURNAL()
-       WRITETODATAFILES()
+       WRITETOJOURNAL()                  // on the journal writer thread, while this thread does
+       WRITETODATAFILES(previous)        // the previous section's WRITETODATAFILES
      UNLOCK mmmutex
      UNLOCK groupCommitMutex
 
+   so a section is applied to the data files one commit after it is journaled.  anything which
+   needs the data files current (a commit in R or W, and thus REMAPPRIVATEVIEW, file closes,
+   fsync) applies the pending section first; see applyPendingSection().
+
    every Nth groupCommit, at the end, we REMAPPRIVATEVIEW() at the end of the work. because of
-   that we are in W lock for that groupCommit, which is nonideal of course.
+   that we are in W lock for that groupCommit, which is nonideal of course.  the remap is
+   bounded by journalRemapSliceMillis; files it doesn't get to are remapped on the following
+   passes of the durability thread, each in a W lock of its own.
 
    @see https://docs.google.com/drawings/edit?id=1TklsmZzm7ohIZkwgeK6rMvsdaR13KjtJYMsfLr175Zc
 */
@@ -81,9 +87,12 @@
 #include "mongo/db/dur_journal.h"
 #include "mongo/db/dur_recover.h"
 #include "mongo/db/dur_stats.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/server.h"
+#include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/concurrency/race.h"
+#include "mongo/util/concurrency/thread_name.h"
 #include "mongo/util/mongoutils/hash.h"
 #include "mongo/util/mongoutils/str.h"
 #include "mongo/util/stacktrace.h"
@@ -153,6 +162,7 @@ namespace mongo {
             b << 
                        "commits" << _commits <<
                        "journaledMB" << _journaledBytes / 1000000.0 <<
+                       "journaledUncompressedMB" << _uncompressedBytes / 1000000.0 <<
                        "writeToDataFilesMB" << _writeToDataFilesBytes / 1000000.0 <<
                        "compression" << _journaledBytes / (_uncompressedBytes+1.0) <<
                        "commitsInWriteLock" << _commitsInWriteLock <<
@@ -468,6 +478,15 @@ namespace mongo {
 
         extern size_t privateMapBytes;
 
+        /** upper bound on the time a single REMAPPRIVATEVIEW() spends remapping, and thus on how
+            long it holds the W lock.  the files it doesn't get to are remapped by the following
+            passes of the durability thread.  0 for no bound.
+        */
+        MONGO_EXPORT_SERVER_PARAMETER(journalRemapSliceMillis, int, 20);
+
+        /** number of files an earlier REMAPPRIVATEVIEW() ran out of time for */
+        static unsigned remapBacklog = 0;
+
         static void _REMAPPRIVATEVIEW() {
             // todo: Consider using ProcessInfo herein and watching for getResidentSize to drop.  that could be a way 
             //       to assure very good behavior here.
@@ -517,10 +536,14 @@ namespace mongo {
                 privateMapBytes = 0;
             }
 
-            unsigned ntodo = (unsigned) (sz * fraction);
+            unsigned ntodo = (unsigned) (sz * fraction) + remapBacklog;
             if( ntodo < 1 ) ntodo = 1;
             if( ntodo > sz ) ntodo = sz;
 
+            int sliceMillis = journalRemapSliceMillis;
+            if (storageGlobalParams.durOptions & StorageGlobalParams::DurAlwaysRemap)
+                sliceMillis = 0;
+
             const set<MongoFile*>::iterator b = files.begin();
             const set<MongoFile*>::iterator e = files.end();
             set<MongoFile*>::iterator i = b;
@@ -530,10 +553,15 @@ namespace mongo {
                 if( i == e ) i = b;
             }
             unsigned startedAt = startAt;
-            startAt = (startAt + ntodo) % sz; // mark where to start next time
 
             Timer t;
-            for( unsigned x = 0; x < ntodo; x++ ) {
+            unsigned x = 0;
+            for( ; x < ntodo; x++ ) {
+                if( sliceMillis > 0 && t.millis() >= sliceMillis ) {
+                    // out of time; the rest is left for the next pass so that writers aren't
+                    // held up by a single long remap
+                    break;
+                }
                 dassert( i != e );
                 if( (*i)->isDurableMappedFile() ) {
                     DurableMappedFile *mmf = (DurableMappedFile*) *i;
@@ -546,7 +574,9 @@ namespace mongo {
                     if( i == e ) i = b;
                 }
             }
-            LOG(2) << "journal REMAPPRIVATEVIEW done startedAt: " << startedAt << " n:" << ntodo << ' ' << t.millis() << "ms" << endl;
+            startAt = (startedAt + x) % sz; // mark where to start next time
+            remapBacklog = ntodo - x;
+            LOG(2) << "journal REMAPPRIVATEVIEW done startedAt: " << startedAt << " n:" << x << " backlog:" << remapBacklog << ' ' << t.millis() << "ms" << endl;
         }
 
         /** We need to remap the private views periodically. otherwise they would become very large.
@@ -558,14 +588,114 @@ namespace mongo {
             stats.curr->_remapPrivateViewMicros += t.micros();
         }
 
-        // this is a pseudo-local variable in the groupcommit functions 
+        // these are pseudo-local variables in the groupcommit functions 
         // below.  however we don't truly do that so that we don't have to 
-        // reallocate, and more importantly regrow it, on every single commit.
+        // reallocate, and more importantly regrow them, on every single commit.
+        // there are two as the next section is built while the previous one
+        // may still be waiting to be applied to the data files.
         static AlignedBuilder __theBuilder(4 * 1024 * 1024);
+        static AlignedBuilder __theOtherBuilder(4 * 1024 * 1024);
+
+        /** a section that is in the journal but has not been applied to the data files yet.
+            groupCommitWithLimitedLocks() leaves its section here and applies it while the next
+            section is written to the journal.  protected by groupCommitMutex.
+
+            so the data files may trail the journal by one group commit.  that is only safe while
+            the section is still replayed by recovery: recovery skips sections whose seqNumber
+            (the last data file flush before them) is more than ExtraKeepTimeMs older than the lsn
+            (the last flush), and old journal files are kept for the same slack.  so a pending
+            section must reach the data files well within ExtraKeepTimeMs, which it does as the
+            dur thread applies it on its next pass, every journalCommitInterval, even with nothing
+            new to journal.  and whatever makes the journal unnecessary must apply it first:
+            syncDataAndTruncateJournal() and the final commit at shutdown both go through
+            commitNow(), whose _groupCommit() applies it, and a commit that starts once shutdown
+            has begun applies its own section right away.
+        */
+        static JSectHeader pendingHeader;
+        static AlignedBuilder *pendingSection = 0;
+
+        /** WRITETODATAFILES for the pending section, if there is one.  call in groupCommitMutex,
+            and in either the global lock or mmmutex so that the files can't be closed under us.
+        */
+        static void applyPendingSection() {
+            if( pendingSection == 0 )
+                return;
+            WRITETODATAFILES(pendingHeader, *pendingSection);
+            pendingSection->reset();
+            pendingSection = 0;
+        }
+
+        /** writes a section to the journal on a thread of its own, so that the caller can apply
+            the previous section to the data files in the meantime.  only used in groupCommitMutex,
+            and each write must be waited for before the next is started.
+        */
+        class JournalWriter : boost::noncopyable {
+        public:
+            JournalWriter() : _m("JournalWriter"), _ab(0), _started(false) { }
+
+            /** begins WRITETOJOURNAL(h, ab). ab must not be touched until wait() returns. */
+            void start(const JSectHeader& h, AlignedBuilder& ab) {
+                scoped_lock lk(_m);
+                verify( _ab == 0 );
+                if( !_started ) {
+                    boost::thread t( boost::bind(&JournalWriter::run, this) );
+                    _started = true;
+                }
+                _h = h;
+                _ab = &ab;
+                _c.notify_all();
+            }
+
+            /** waits for the section given to start() to be on disk */
+            void wait() {
+                scoped_lock lk(_m);
+                while( _ab != 0 )
+                    _c.wait(lk.boost());
+            }
+
+        private:
+            void run() {
+                setThreadName("journalWriter");
+                while( 1 ) {
+                    JSectHeader h;
+                    AlignedBuilder *ab;
+                    {
+                        scoped_lock lk(_m);
+                        while( _ab == 0 )
+                            _c.wait(lk.boost());
+                        h = _h;
+                        ab = _ab;
+                    }
+
+                    try {
+                        WRITETOJOURNAL(h, *ab);
+                    }
+                    catch(DBException& e) {
+                        log() << "dbexception in journalWriter causing immediate shutdown: " << e.toString() << endl;
+                        mongoAbort("jw1");
+                    }
+                    catch(std::exception& e) {
+                        log() << "exception in journalWriter causing immediate shutdown: " << e.what() << endl;
+                        mongoAbort("jw2");
+                    }
+
+                    scoped_lock lk(_m);
+                    _ab = 0;
+                    _c.notify_all();
+                }
+            }
+
+            mongo::mutex _m;
+            boost::condition _c;
+            JSectHeader _h;
+            AlignedBuilder *_ab; // section being written, 0 if none
+            bool _started;
+        };
+
+        static JournalWriter& journalWriter = *(new JournalWriter()); // don't destroy
 
         static bool _groupCommitWithLimitedLocks() {
             unspoolWriteIntents(); // in case we were doing some writing ourself (likely impossible with limitedlocks version)
-            AlignedBuilder &ab = __theBuilder;
 
             verify( ! Lock::isLocked() );
 
@@ -582,9 +712,16 @@ namespace mongo {
             if( !commitJob.hasWritten() ) {
                 // getlasterror request could have came after the data was already committed
                 commitJob.committingNotifyCommitted();
+
+                // nothing new to journal, but the data files may still be a section behind
+                LockMongoFilesShared lk3;
+                lk1.reset();
+                applyPendingSection();
                 return true;
             }
 
+            AlignedBuilder &ab = pendingSection == &__theBuilder ? __theOtherBuilder : __theBuilder;
+
             JSectHeader h;
             // need to be in readlock (writes excluded) for this as write intent stuctures point into 
             // the private mmap for their actual data.  i suppose we could lock individual databases 
@@ -603,20 +740,28 @@ namespace mongo {
 
             // ****** now other threads can do writes ******
 
-            WRITETOJOURNAL(h, ab);
+            // the previous section is already in the journal, so it can be applied to the
+            // data files while this one is being written to the journal.
+            //
+            // note the higher-up-the-chain locking of filesLockedFsync is important here, 
+            // as we are not in Lock::GlobalRead anymore. private view readers won't see 
+            // anything as we do this, but external viewers of the datafiles will see them 
+            // mutating.
+            journalWriter.start(h, ab);
+            applyPendingSection();
+            journalWriter.wait();
             verify( abLen == ab.len() ); // a check that no one touched the builder while we were doing work. if so, our locking is wrong.
 
             // data is now in the journal, which is sufficient for acknowledging getLastError.
             // (ok to crash after that)
             commitJob.committingNotifyCommitted();
 
-            // note the higher-up-the-chain locking of filesLockedFsync is important here, 
-            // as we are not in Lock::GlobalRead anymore. private view readers won't see 
-            // anything as we do this, but external viewers of the datafiles will see them 
-            // mutating.
-            WRITETODATAFILES(h, ab);
-            verify( abLen == ab.len() ); // check again wasn't modded
-            ab.reset();
+            // applied by the next commit, or by whatever needs the data files current first.
+            // once shutdown has begun there may be no next commit before the journal is removed.
+            pendingHeader = h;
+            pendingSection = &ab;
+            if( inShutdown() )
+                applyPendingSection();
 
             // can't : d.dbMutex._remapPrivateViewRequested = true;
             // (writes have happened we released)
@@ -666,6 +811,10 @@ namespace mongo {
 
                 commitJob.commitingBegin();
 
+                // sections must reach the data files in order, and REMAPPRIVATEVIEW below
+                // needs them all there
+                applyPendingSection();
+
                 if( !commitJob.hasWritten() ) {
                     // getlasterror request could have came after the data was already committed
                     commitJob.committingNotifyCommitted();
@@ -763,10 +912,12 @@ namespace mongo {
             static int n;
             if (privateMapBytes < UncommittedBytesLimit && ++n % N &&
                 (storageGlobalParams.durOptions &
-                 StorageGlobalParams::DurAlwaysRemap) == 0) {
+                 StorageGlobalParams::DurAlwaysRemap) == 0 &&
+                remapBacklog == 0) {
                 // limited locks version doesn't do any remapprivateview at all, so only try this if privateMapBytes
                 // is in an acceptable range.  also every Nth commit, we do everything so we can do some remapping;
                 // remapping a lot all at once could cause jitter from a large amount of copy-on-writes all at once.
+                // if the last remap ran out of time we keep going, a slice per pass, until it has caught up.
                 if( groupCommitWithLimitedLocks() )
                     return;
             }
@@ -910,6 +1061,12 @@ namespace mongo {
             }
 
             commitNow();
+            {
+                // commitNow() applied any section the last commit left pending, and none can have
+                // started since, in the write lock.  the data files are as current as the journal.
+                SimpleMutex::scoped_lock lk(commitJob.groupCommitMutex);
+                verify( pendingSection == 0 );
+            }
             MongoFile::flushAll(true);
             journalCleanup();
 
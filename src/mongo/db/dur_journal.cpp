@@ -41,6 +41,7 @@
 #include "mongo/db/dur_journalformat.h"
 #include "mongo/db/dur_journalimpl.h"
 #include "mongo/db/dur_stats.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/platform/random.h"
 #include "mongo/server.h"
@@ -87,6 +88,11 @@ namespace mongo {
             return Status::OK();
         }
 
+        /** compress the sections of the journal files we write.  turning it off trades journal
+            bandwidth for the cpu time of compressing; recovery handles files in either format.
+        */
+        MONGO_EXPORT_STARTUP_SERVER_PARAMETER(journalCompression, bool, true);
+
         BOOST_STATIC_ASSERT( sizeof(Checksum) == 16 );
         BOOST_STATIC_ASSERT( sizeof(JHeader) == 8192 );
         BOOST_STATIC_ASSERT( sizeof(JSectHeader) == 20 );
@@ -160,9 +166,9 @@ namespace mongo {
             }
         }
 
-        JHeader::JHeader(string fname) {
+        JHeader::JHeader(string fname, bool compressed) {
             magic[0] = 'j'; magic[1] = '\n';
-            _version = CurrentVersion;
+            _version = compressed ? CompressedVersion : UncompressedVersion;
             memset(ts, 0, sizeof(ts));
             time_t t = time(0);
             strncpy(ts, time_t_to_String_short(t).c_str(), sizeof(ts)-1);
@@ -517,7 +523,7 @@ namespace mongo {
                         {
                             // JHeader::fileId must be updated before renaming to be race-safe
                             LogFile f(p.string());
-                            JHeader h(p.string());
+                            JHeader h(p.string(), journalCompression);
                             AlignedBuilder b(8192);
                             b.appendStruct(h);
                             f.synchronousAppend(b.buf(), b.len());
@@ -534,7 +540,7 @@ namespace mongo {
             _curLogFile = new LogFile(fname.string());
             _nextFileNumber++;
             {
-                JHeader h(fname.string());
+                JHeader h(fname.string(), journalCompression);
                 _curFileId = h.fileId;
                 verify(_curFileId);
                 AlignedBuilder b(8192);
@@ -732,11 +738,11 @@ namespace mongo {
             static AlignedBuilder b(32*1024*1024);
             /* buffer to journal will be
                JSectHeader
-               compressed operations
+               operations, compressed unless journalCompression is off
                JSectFooter
             */
             const unsigned headTailSize = sizeof(JSectHeader) + sizeof(JSectFooter);
-            const unsigned max = maxCompressedLength(uncompressed.len()) + headTailSize;
+            const unsigned max = (journalCompression ? maxCompressedLength(uncompressed.len()) : uncompressed.len()) + headTailSize;
             b.reset(max);
 
             {
@@ -744,11 +750,16 @@ namespace mongo {
                 b.appendStruct(h);
             }
 
-            size_t compressedLength = 0;
-            rawCompress(uncompressed.buf(), uncompressed.len(), b.cur(), &compressedLength);
-            verify( compressedLength < 0xffffffff );
-            verify( compressedLength < max );
-            b.skip(compressedLength);
+            if( journalCompression ) {
+                size_t compressedLength = 0;
+                rawCompress(uncompressed.buf(), uncompressed.len(), b.cur(), &compressedLength);
+                verify( compressedLength < 0xffffffff );
+                verify( compressedLength < max );
+                b.skip(compressedLength);
+            }
+            else {
+                b.appendBuf(uncompressed.buf(), uncompressed.len());
+            }
 
             // footer
             unsigned L = 0xffffffff;
@@ -42,17 +42,19 @@ namespace mongo {
         */
         struct JHeader {
             JHeader() { }
-            JHeader(string fname);
+            JHeader(string fname, bool compressed);
 
             char magic[2]; // "j\n". j means journal, then a linefeed, fwiw if you were to run "less" on the file or something...
 
             // x4142 is asci--readable if you look at the file with head/less -- thus the starting values were near
             // that.  simply incrementing the version # is safe on a fwd basis.
-#if defined(_NOCOMPRESS)
-            enum { CurrentVersion = 0x4148 };
-#else
-            enum { CurrentVersion = 0x4149 };
-#endif
+            // the sections of an UncompressedVersion file hold their entries as is, those of a
+            // CompressedVersion file hold them compressed.  both are written and recovered.
+            // _NOCOMPRESS builds used to write NoCompressBuildVersion files, whose sections
+            // are compressed all the same; they are only recovered.
+            enum { NoCompressBuildVersion = 0x4148,
+                   CompressedVersion = 0x4149,
+                   UncompressedVersion = 0x414A };
             unsigned short _version;
 
             // these are just for diagnostic ease (make header more useful as plain text)
@@ -67,7 +69,11 @@ namespace mongo {
             char reserved3[8026]; // 8KB total for the file header
             char txt2[2];         // "\n\n" at the end
 
-            bool versionOk() const { return _version == CurrentVersion; }
+            bool versionOk() const {
+                return _version == UncompressedVersion || _version == CompressedVersion ||
+                       _version == NoCompressBuildVersion;
+            }
+            bool compressed() const { return _version != UncompressedVersion; }
             bool valid() const { return magic[0] == 'j' && txt2[1] == '\n' && fileId; }
         };
 
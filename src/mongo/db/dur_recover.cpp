@@ -115,32 +115,31 @@ namespace mongo {
             const bool _doDurOps;
             string _uncompressed;
         public:
-            JournalSectionIterator(const JSectHeader& h, const void *compressed, unsigned compressedLen, bool doDurOpsRecovering) :
+            /** @param data the section's entries, compressed if 'compressed'.  we work with the
+                            uncompressed buffer when doing a WRITETODATAFILES (for speed).
+            */
+            JournalSectionIterator(const JSectHeader& h, const void *data, unsigned len, bool compressed, bool doDurOpsRecovering) :
                 _h(h),
                 _lastDbName(0)
                 , _doDurOps(doDurOpsRecovering)
             {
+                if( !compressed ) {
+                    _entries = auto_ptr<BufReader>( new BufReader((const char *) data, len) );
+                    return;
+                }
+
                 verify( doDurOpsRecovering );
-                bool ok = uncompress((const char *)compressed, compressedLen, &_uncompressed);
+                bool ok = uncompress((const char *)data, len, &_uncompressed);
                 if( !ok ) { 
                     // it should always be ok (i think?) as there is a previous check to see that the JSectFooter is ok
                     log() << "couldn't uncompress journal section" << endl;
                     msgasserted(15874, "couldn't uncompress journal section");
                 }
                 const char *p = _uncompressed.c_str();
-                verify( compressedLen == _h.sectionLen() - sizeof(JSectFooter) - sizeof(JSectHeader) );
+                verify( len == _h.sectionLen() - sizeof(JSectFooter) - sizeof(JSectHeader) );
                 _entries = auto_ptr<BufReader>( new BufReader(p, _uncompressed.size()) );
             }
 
-            // we work with the uncompressed buffer when doing a WRITETODATAFILES (for speed)
-            JournalSectionIterator(const JSectHeader &h, const void *p, unsigned len) :
-                _entries( new BufReader((const char *) p, len) ),
-                _h(h),
-                _lastDbName(0)
-                , _doDurOps(false)
-
-                { }
-
             bool atEof() const { return _entries->atEof(); }
 
             unsigned long long seqNumber() const { return _h.seqNumber; }
@@ -388,13 +387,9 @@ namespace mongo {
                 return;
             }
 
-            auto_ptr<JournalSectionIterator> i;
-            if( _recovering ) {
-                i = auto_ptr<JournalSectionIterator>(new JournalSectionIterator(*h, p, len, _recovering));
-            }
-            else { 
-                i = auto_ptr<JournalSectionIterator>(new JournalSectionIterator(*h, /*after header*/p, /*w/out header*/len));
-            }
+            auto_ptr<JournalSectionIterator> i(
+                new JournalSectionIterator(*h, /*after header*/p, /*w/out header*/len,
+                                           _recovering && _compressedSections, _recovering));
 
             // we use a static so that we don't have to reallocate every time through.  occasionally we 
             // go back to a small allocation so that if there were a spiky growth it won't stick forever.
@@ -453,11 +448,14 @@ namespace mongo {
 
                     if( !h.versionOk() ) {
                         log() << "journal file version number mismatch got:" << hex << h._version                             
-                            << " expected:" << hex << (unsigned) JHeader::CurrentVersion 
+                            << " expected:" << hex << (unsigned) JHeader::UncompressedVersion
+                            << ", " << hex << (unsigned) JHeader::CompressedVersion
+                            << " or " << hex << (unsigned) JHeader::NoCompressBuildVersion
                             << ". if you have just upgraded, recover with old version of mongod, terminate cleanly, then upgrade." 
                             << endl;
                         uasserted(13536, str::stream() << "journal version number mismatch " << h._version);
                     }
+                    _compressedSections = h.compressed();
                     fileId = h.fileId;
                     if (storageGlobalParams.durOptions &
                         StorageGlobalParams::DurDumpJournal) {
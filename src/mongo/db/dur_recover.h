@@ -57,11 +57,13 @@ namespace mongo {
             } last;        
         public:
             RecoveryJob() : _lastDataSyncedFromLastRun(0), 
-                _mx("recovery"), _recovering(false) { _lastSeqMentionedInConsoleLog = 1; }
+                _mx("recovery"), _recovering(false), _compressedSections(true) { _lastSeqMentionedInConsoleLog = 1; }
             void go(vector<boost::filesystem::path>& files);
             ~RecoveryJob();
 
-            /** @param data data between header and footer. compressed if recovering. */
+            /** @param data data between header and footer. compressed if recovering a file
+                            written with compression (see JHeader::compressed()).
+            */
             void processSection(const JSectHeader *h, const void *data, unsigned len, const JSectFooter *f);
 
             void close(); // locks and calls _close()
@@ -84,6 +86,7 @@ namespace mongo {
             mongo::mutex _mx; // protects _mmfs
         private:
             bool _recovering; // are we in recovery or WRITETODATAFILES
+            bool _compressedSections; // format of the journal file being recovered
 
             static RecoveryJob &_instance;
         };
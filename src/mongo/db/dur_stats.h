@@ -47,8 +47,8 @@ namespace mongo {
 
                 unsigned _commits;
                 unsigned _earlyCommits; // count of early commits from commitIfNeeded() or from getDur().commitNow()
-                unsigned long long _journaledBytes;
-                unsigned long long _uncompressedBytes;
+                unsigned long long _journaledBytes;    // written to the journal, with padding
+                unsigned long long _uncompressedBytes; // what the sections would have taken uncompressed
                 unsigned long long _writeToDataFilesBytes;
 
                 unsigned long long _prepLogBufferMicros;
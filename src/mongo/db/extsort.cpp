@@ -85,6 +85,21 @@ namespace mongo {
                                  .MaxMemoryUsageBytes(maxFileSize),
                     OldExtSortComparator(comp, _mayInterrupt)))
     {}
+
+    auto_ptr<BSONObjExternalSorter::Iterator> BSONObjExternalSorter::merge(
+            const vector<BSONObjExternalSorter*>& sorters,
+            const ExternalSortComparison* comp,
+            bool mayInterrupt) {
+        vector<boost::shared_ptr<Iterator> > iters;
+        for (size_t i = 0; i < sorters.size(); i++) {
+            iters.push_back(boost::shared_ptr<Iterator>(sorters[i]->_sorter->done()));
+        }
+        return auto_ptr<Iterator>(Iterator::merge(
+                    iters,
+                    SortOptions().TempDir(storageGlobalParams.dbpath + "/_tmp")
+                                 .ExtSortAllowed(),
+                    OldExtSortComparator(comp, boost::make_shared<bool>(mayInterrupt))));
+    }
 }
 
 #include "mongo/db/sorter/sorter.cpp"
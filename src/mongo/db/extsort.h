@@ -73,6 +73,14 @@ namespace mongo {
 
         auto_ptr<Iterator> iterator() { return auto_ptr<Iterator>(_sorter->done()); }
 
+        /**
+         * @return an iterator over the data of all of 'sorters', which must have been
+         *         constructed with 'comp', in order.  Nothing can be added to them afterwards.
+         */
+        static auto_ptr<Iterator> merge( const vector<BSONObjExternalSorter*>& sorters,
+                                         const ExternalSortComparison* comp,
+                                         bool mayInterrupt );
+
         void sort( bool mayInterrupt ) { *_mayInterrupt = mayInterrupt; }
         int numFiles() { return _sorter->numFiles(); }
         long getCurSizeSoFar() { return _sorter->memUsed(); }
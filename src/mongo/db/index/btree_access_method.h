@@ -61,6 +61,7 @@ namespace mongo {
 
     private:
         virtual void getKeys(const BSONObj& obj, BSONObjSet* keys);
+        virtual bool getKeysIsThreadSafe() const { return true; }
 
         // Our keys differ for V0 and V1.
         scoped_ptr<BtreeKeyGenerator> _keyGenerator;
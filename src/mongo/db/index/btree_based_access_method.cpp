@@ -28,6 +28,7 @@
 
 #include "mongo/db/index/btree_access_method.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "mongo/base/status.h"
@@ -48,7 +49,7 @@ namespace mongo {
     BtreeBasedAccessMethod::BtreeBasedAccessMethod(IndexCatalogEntry* btreeState)
         : _btreeState(btreeState), _descriptor(btreeState->descriptor()) {
 
-        verify(0 == _descriptor->version() || 1 == _descriptor->version());
+        verify(IndexDetails::isASupportedIndexVersionNumber(_descriptor->version()));
         _interface = BtreeInterface::interfaces[_descriptor->version()];
     }
 
@@ -175,6 +176,9 @@ namespace mongo {
         else if ( 1 == _descriptor->version() ) {
             newHead = BtreeBucket<V1>::addBucket( _btreeState );
         }
+        else if ( 2 == _descriptor->version() ) {
+            newHead = BtreeBucket<V2>::addBucket( _btreeState );
+        }
         else {
             return Status( ErrorCodes::InternalError, "invalid index number" );
         }
@@ -217,6 +221,11 @@ namespace mongo {
                                                                      _btreeState->head(),
                                                                      key );
         }
+        if ( 2 == _descriptor->version() ) {
+            return BtreeBucket<V2>::asVersion( record )->findSingle( _btreeState,
+                                                                     _btreeState->head(),
+                                                                     key );
+        }
         verify( 0 );
     }
 
@@ -228,6 +237,92 @@ namespace mongo {
         return Status::OK();
     }
 
+    Status BtreeBasedAccessMethod::sampleKeys(size_t targetSamples,
+                                              size_t maxBuckets,
+                                              vector<BSONObj>* samplesOut,
+                                              long long* numKeysOut) {
+        *numKeysOut = 0;
+        DiskLoc head = _btreeState->head();
+        if (head.isNull()) {
+            return Status::OK();
+        }
+
+        // How many levels the tree has, all leaves are at the same depth.
+        int height = 1;
+        for (DiskLoc b = _interface->childAt(_btreeState, head, 0); !b.isNull();
+             b = _interface->childAt(_btreeState, b, 0)) {
+            ++height;
+        }
+
+        // Find the deepest level to sample, counting keys on the way down.
+        vector<DiskLoc> level(1, head);
+        vector<DiskLoc> nextLevel;
+        size_t bucketsRead = 0;
+        long long keysRead = 0;
+        long long levelKeys = 0;
+        int depth = 0;
+        while (true) {
+            levelKeys = 0;
+            nextLevel.clear();
+            for (size_t i = 0; i < level.size(); ++i) {
+                int n = _interface->nKeys(_btreeState, level[i]);
+                levelKeys += n;
+                for (int j = 0; j <= n; ++j) {
+                    DiskLoc child = _interface->childAt(_btreeState, level[i], j);
+                    if (!child.isNull()) {
+                        nextLevel.push_back(child);
+                    }
+                }
+            }
+            bucketsRead += level.size();
+            keysRead += levelKeys;
+
+            if (nextLevel.empty()
+                || keysRead >= static_cast<long long>(targetSamples)
+                || bucketsRead + nextLevel.size() > maxBuckets) {
+                break;
+            }
+            level.swap(nextLevel);
+            ++depth;
+        }
+
+        size_t firstSample = samplesOut->size();
+        _appendKeys(head, depth + 1, samplesOut);
+
+        if (nextLevel.empty()) {
+            // Every key was read.
+            *numKeysOut = samplesOut->size() - firstSample;
+            return Status::OK();
+        }
+
+        // The levels below the sample are assumed to branch out like the last one read did.
+        double fanout = std::max(2.0, static_cast<double>(nextLevel.size()) / level.size());
+        double keysPerBucket = std::max(1.0, static_cast<double>(levelKeys) / level.size());
+        double buckets = nextLevel.size();
+        double keys = keysRead;
+        for (int d = depth + 1; d < height; ++d) {
+            keys += buckets * keysPerBucket;
+            buckets *= fanout;
+        }
+        *numKeysOut = static_cast<long long>(keys);
+        return Status::OK();
+    }
+
+    void BtreeBasedAccessMethod::_appendKeys(const DiskLoc& bucket, int levels,
+                                             vector<BSONObj>* keysOut) {
+        if (bucket.isNull() || levels <= 0) {
+            return;
+        }
+        int n = _interface->nKeys(_btreeState, bucket);
+        for (int i = 0; i < n; ++i) {
+            _appendKeys(_interface->childAt(_btreeState, bucket, i), levels - 1, keysOut);
+            if (_interface->keyIsUsed(_btreeState, bucket, i)) {
+                keysOut->push_back(_interface->keyAt(_btreeState, bucket, i).getOwned());
+            }
+        }
+        _appendKeys(_interface->childAt(_btreeState, bucket, n), levels - 1, keysOut);
+    }
+
     Status BtreeBasedAccessMethod::validateUpdate(
         const BSONObj &from, const BSONObj &to, const DiskLoc &record,
         const InsertDeleteOptions &options, UpdateTicket* status) {
@@ -303,6 +398,9 @@ namespace mongo {
 
     class BtreeBulk : public IndexAccessMethod {
     public:
+        // the BSONObjExternalSorter default, shared by the partitions of a bulk build
+        static const long SortMemory = 100 * 1024 * 1024;
+
         BtreeBulk( BtreeBasedAccessMethod* real ) {
             _real = real;
         }
@@ -358,6 +456,21 @@ namespace mongo {
             return Status::OK();
         }
 
+        virtual bool partitionBulk( int n, std::vector<IndexAccessMethod*>* partitions ) {
+            verify( _partitions.empty() && _phase1.nkeys == 0 );
+            if ( !_real->getKeysIsThreadSafe() )
+                return false;
+            for ( int i = 0; i < n; i++ ) {
+                shared_ptr<BtreeBulk> p( new BtreeBulk( _real ) );
+                p->_phase1.sortCmp = _phase1.sortCmp;
+                p->_phase1.sorter.reset( new BSONObjExternalSorter( _phase1.sortCmp.get(),
+                                                                    SortMemory / n ) );
+                _partitions.push_back( p );
+                partitions->push_back( p.get() );
+            }
+            return true;
+        }
+
         virtual Status touch(const BSONObj& obj) {
             return _notAllowed();
         }
@@ -384,10 +497,14 @@ namespace mongo {
             BtreeBuilder<V> btBuilder(dupsAllowed, entry);
 
             BSONObj keyLast;
-            scoped_ptr<BSONObjExternalSorter::Iterator> i( _phase1.sorter->iterator() );
+            scoped_ptr<BSONObjExternalSorter::Iterator> i( sortedKeys( mayInterrupt ) );
+
+            // the index is named, a multi index build commits several one after another
+            const string indexName = entry->descriptor()->indexName();
+            string message = "Index Bulk Build: (2/3) btree bottom up: " + indexName;
 
             // verifies that pm and op refer to the same ProgressMeter
-            ProgressMeter& pm = op->setMessage("Index Bulk Build: (2/3) btree bottom up",
+            ProgressMeter& pm = op->setMessage(message.c_str(),
                                                "Index: (2/3) BTree Bottom Up Progress",
                                                _phase1.nkeys,
                                                10);
@@ -431,7 +548,8 @@ namespace mongo {
                 pm.hit();
             }
             pm.finished();
-            op->setMessage("Index Bulk Build: (3/3) btree-middle",
+            message = "Index Bulk Build: (3/3) btree-middle: " + indexName;
+            op->setMessage(message.c_str(),
                            "Index: (3/3) BTree Middle Progress");
             LOG(timer.seconds() > 10 ? 0 : 1 ) << "\t done building bottom layer, going to commit";
             btBuilder.commit( mayInterrupt );
@@ -441,6 +559,26 @@ namespace mongo {
             }
         }
 
+        /** folds the counts of the partitions, if any, into _phase1 */
+        void gatherPartitions() {
+            for ( size_t i = 0; i < _partitions.size(); i++ ) {
+                const SortPhaseOne& p = _partitions[i]->_phase1;
+                _phase1.n += p.n;
+                _phase1.nkeys += p.nkeys;
+                _phase1.multi = _phase1.multi || p.multi;
+            }
+        }
+
+        auto_ptr<BSONObjExternalSorter::Iterator> sortedKeys( bool mayInterrupt ) {
+            if ( _partitions.empty() )
+                return _phase1.sorter->iterator();
+            vector<BSONObjExternalSorter*> sorters;
+            for ( size_t i = 0; i < _partitions.size(); i++ ) {
+                sorters.push_back( _partitions[i]->_phase1.sorter.get() );
+            }
+            return BSONObjExternalSorter::merge( sorters, _phase1.sortCmp.get(), mayInterrupt );
+        }
+
         // -------
 
         Status _notAllowed() const {
@@ -449,6 +587,7 @@ namespace mongo {
 
         BtreeBasedAccessMethod* _real; // now owned here
         SortPhaseOne _phase1;
+        vector<shared_ptr<BtreeBulk> > _partitions;
     };
 
     int oldCompare(const BSONObj& l,const BSONObj& r, const Ordering &o); // key.cpp
@@ -493,7 +632,8 @@ namespace mongo {
         if ( 0 == version ) {
             return new BtreeExternalSortComparisonV0( keyPattern );
         }
-        else if ( 1 == version ) {
+        else if ( 1 == version || 2 == version ) {
+            // v2 only changes how keys are laid out in a bucket, not the keys themselves
             return new BtreeExternalSortComparisonV1( keyPattern );
         }
         verify( 0 );
@@ -534,6 +674,7 @@ namespace mongo {
         string ns = _btreeState->collection()->ns().ns();
 
         BtreeBulk* bulk = static_cast<BtreeBulk*>( bulkRaw );
+        bulk->gatherPartitions();
         if ( bulk->_phase1.multi )
             _btreeState->setMultikey();
 
@@ -543,6 +684,8 @@ namespace mongo {
             bulk->commit<V0>( dupsToDrop, cc().curop(), mayInterrupt );
         else if ( _descriptor->version() == 1 )
             bulk->commit<V1>( dupsToDrop, cc().curop(), mayInterrupt );
+        else if ( _descriptor->version() == 2 )
+            bulk->commit<V2>( dupsToDrop, cc().curop(), mayInterrupt );
         else
             return Status( ErrorCodes::InternalError, "bad btree version" );
 
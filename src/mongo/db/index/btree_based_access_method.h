@@ -86,10 +86,27 @@ namespace mongo {
                                    bool mayInterrupt,
                                    std::set<DiskLoc>* dups );
 
+        virtual bool partitionBulk( int n, std::vector<IndexAccessMethod*>* partitions ) {
+            return false; // only a bulk IndexAccessMethod can be partitioned
+        }
+
         virtual Status touch(const BSONObj& obj);
 
         virtual Status validate(int64_t* numKeys);
 
+        /**
+         * Samples keys from the upper levels of the tree, reading whole levels from the root
+         * down until at least 'targetSamples' keys are gathered or the next level would take the
+         * buckets read past 'maxBuckets'.  The samples are appended in index order.
+         *
+         * '*numKeysOut' is the number of keys in the index, estimated from the shape of the tree
+         * unless the sample reached the leaves, in which case it is exact.
+         */
+        Status sampleKeys(size_t targetSamples,
+                          size_t maxBuckets,
+                          std::vector<BSONObj>* samplesOut,
+                          long long* numKeysOut);
+
         // XXX: consider migrating callers to use IndexCursor instead
         virtual DiskLoc findSingle( const BSONObj& key );
 
@@ -106,6 +123,12 @@ namespace mongo {
 
         virtual void getKeys(const BSONObj &obj, BSONObjSet *keys) = 0;
 
+        /**
+         * @return true if getKeys() may be called from several threads at the same time,
+         *         which lets bulk builds generate and sort keys in parallel.
+         */
+        virtual bool getKeysIsThreadSafe() const { return false; }
+
         IndexCatalogEntry* _btreeState; // owned by IndexCatalogEntry
         const IndexDescriptor* _descriptor;
 
@@ -114,6 +137,9 @@ namespace mongo {
 
     private:
         bool removeOneKey(const BSONObj& key, const DiskLoc& loc);
+
+        // Appends the used keys of the subtree at 'bucket', down to 'levels' levels, in order.
+        void _appendKeys(const DiskLoc& bucket, int levels, std::vector<BSONObj>* keysOut);
     };
 
     /**
@@ -196,6 +196,16 @@ namespace mongo {
             }
         }
 
+        virtual DiskLoc childAt(const IndexCatalogEntry* btreeState,
+                                DiskLoc bucket, int keyOffset) const {
+            verify(!bucket.isNull());
+            const BtreeBucket<Version> *b = getBucket(btreeState,bucket);
+            if (keyOffset == b->getN()) {
+                return b->getNextChild();
+            }
+            return b->k(keyOffset).prevChildBucket;
+        }
+
         virtual string dupKeyError(const IndexCatalogEntry* btreeState,
                                    DiskLoc bucket,
                                    const BSONObj& keyObj) const {
@@ -221,7 +231,8 @@ namespace mongo {
 
     BtreeInterfaceImpl<V0> interface_v0;
     BtreeInterfaceImpl<V1> interface_v1;
-    BtreeInterface* BtreeInterface::interfaces[] = { &interface_v0, &interface_v1 };
+    BtreeInterfaceImpl<V2> interface_v2;
+    BtreeInterface* BtreeInterface::interfaces[] = { &interface_v0, &interface_v1, &interface_v2 };
 
 }  // namespace mongo
 
@@ -147,6 +147,13 @@ namespace mongo {
         virtual void keyAndRecordAt(const IndexCatalogEntry* btreeState,
                                     DiskLoc bucket, int keyOffset, BSONObj* keyOut,
                                     DiskLoc* recordOut) const = 0;
+
+        /**
+         * Get the child bucket before the key at (bucket, keyOffset), or the bucket's right
+         * child if keyOffset is the bucket's number of keys.  Null in leaf buckets.
+         */
+        virtual DiskLoc childAt(const IndexCatalogEntry* btreeState,
+                                DiskLoc bucket, int keyOffset) const = 0;
     };
 
 }  // namespace mongo
@@ -69,6 +69,7 @@ namespace mongo {
 
     private:
         virtual void getKeys(const BSONObj& obj, BSONObjSet* keys);
+        virtual bool getKeysIsThreadSafe() const { return true; }
 
         // Only one of our fields is hashed.  This is the field name for it.
         string _hashedField;
@@ -169,6 +169,17 @@ namespace mongo {
         virtual Status commitBulk( IndexAccessMethod* bulk,
                                    bool mayInterrupt,
                                    std::set<DiskLoc>* dups ) = 0;
+
+        /**
+         * Splits a bulk IndexAccessMethod (one gotten from initiateBulk) into 'n' partitions,
+         * each of which sorts the keys of the documents inserted into it on its own.  Different
+         * partitions may be inserted into from different threads at the same time, and
+         * commitBulk() merges the keys of all of them.  The partitions are owned by the bulk
+         * IndexAccessMethod, which must not be inserted into itself once partitioned.
+         * @return false if not supported, for instance because the keys of the index cannot
+         *         be generated concurrently
+         */
+        virtual bool partitionBulk( int n, std::vector<IndexAccessMethod*>* partitions ) = 0;
     };
 
     /**
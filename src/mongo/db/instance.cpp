@@ -568,6 +568,22 @@ namespace mongo {
         delete database; // closes files
     }
 
+    /**
+     * @return a Lock::CollectionWrite for inserting into or updating ns if collection level
+     * locking is enabled and the collection already exists in an open database, otherwise a
+     * Lock::DBWrite.  an upsert into a missing collection thus gets the DBWrite it needs to
+     * create it.
+     */
+    static Lock::ScopedLock* lockForWrite( const char* ns ) {
+        if ( Lock::CollectionWrite::supported( ns ) ) {
+            auto_ptr<Lock::ScopedLock> lk( new Lock::CollectionWrite( ns ) );
+            Database* db = dbHolder().get( ns, storageGlobalParams.dbpath );
+            if ( db && db->getCollection( ns ) )
+                return lk.release();
+        }
+        return new Lock::DBWrite( ns );
+    }
+
     void receivedUpdate(Message& m, CurOp& op) {
         DbMessage d(m);
         NamespaceString ns(d.getns());
@@ -625,7 +641,7 @@ namespace mongo {
             uasserted( 17009, status.reason() );
         }
 
-        Lock::DBWrite lk(ns.ns());
+        scoped_ptr<Lock::ScopedLock> lk( lockForWrite( ns.ns().c_str() ) );
 
         // void ReplSetImpl::relinquish() uses big write lock so this is thus
         // synchronized given our lock above.
@@ -916,7 +932,7 @@ namespace mongo {
         PageFaultRetryableSection s;
         while ( true ) {
             try {
-                Lock::DBWrite lk(ns);
+                scoped_ptr<Lock::ScopedLock> lk( lockForWrite( ns ) );
                 
                 // CONCURRENCY TODO: is being read locked in big log sufficient here?
                 // writelock is used to synchronize stepdowns w/ writes
@@ -48,6 +48,8 @@ namespace mongo {
           _nestableCount(0), 
           _otherCount(0), 
           _otherLock(NULL),
+          _collectionDbLock(NULL),
+          _collectionLock(NULL),
           _scopedLk(NULL),
           _lockPending(false),
           _lockPendingParallelWriter(false)
@@ -71,6 +73,9 @@ namespace mongo {
     }
 
     bool LockState::isLocked( const StringData& ns ) {
+        if ( _collectionLock && ns == _collectionName )
+            return true;
+
         char db[MaxDatabaseNameLen];
         nsToDatabase(ns, db);
         
@@ -142,6 +147,12 @@ namespace mongo {
                 b.append(s, kind(_otherCount));
             }
         }
+        if( _collectionLock ) {
+            WrapperForRWLock *d = _collectionDbLock;
+            WrapperForRWLock *c = _collectionLock;
+            b.append("^" + d->name(), "w");
+            b.append("^" + c->name(), "W");
+        }
         BSONObj o = b.obj();
         if( !o.isEmpty() ) 
             res.append("locks", o);
@@ -167,6 +178,9 @@ namespace mongo {
             if( _otherCount ) {
                 ss << " otherdb:" << _otherName;
             }
+            if( _collectionLock ) {
+                ss << " collection:" << _collectionName;
+            }
             if( _nestableCount ) {
                 ss << " nestableCount:" << _nestableCount << " which:";
                 if( _whichNestable == Lock::local ) 
@@ -230,10 +244,27 @@ namespace mongo {
         _otherCount = 0;
     }
 
+    void LockState::lockedCollection( const StringData& ns,
+                                      WrapperForRWLock* dbLock,
+                                      WrapperForRWLock* collectionLock ) {
+        fassert( 17355 , _collectionLock == NULL );
+        _collectionName = ns.toString();
+        _collectionDbLock = dbLock;
+        _collectionLock = collectionLock;
+    }
+
+    void LockState::unlockedCollection() {
+        _collectionDbLock = NULL;
+        _collectionLock = NULL;
+    }
+
     LockStat* LockState::getRelevantLockStat() {
         if ( _whichNestable )
             return Lock::nestableLockStat( _whichNestable );
 
+        if ( _collectionLock )
+            return &_collectionLock->stats;
+
         if ( _otherCount && _otherLock )
             return &_otherLock->stats;
         
@@ -32,6 +32,7 @@
 #pragma once
 
 #include "mongo/db/d_concurrency.h"
+#include "mongo/util/concurrency/qlock.h"
 
 namespace mongo {
 
@@ -91,6 +92,15 @@ namespace mongo {
         void lockedOther( const StringData& db , int type , WrapperForRWLock* lock );
         void lockedOther( int type );  // "same lock as last time" case 
         void unlockedOther();
+
+        /** a Lock::CollectionWrite holds dbLock in intent mode and collectionLock exclusively */
+        void lockedCollection( const StringData& ns,
+                               WrapperForRWLock* dbLock,
+                               WrapperForRWLock* collectionLock );
+        void unlockedCollection();
+        bool hasCollectionLock() const { return _collectionLock != NULL; }
+        const string& collectionName() const { return _collectionName; }
+
         bool _batchWriter;
 
         LockStat* getRelevantLockStat();
@@ -111,6 +121,11 @@ namespace mongo {
         string _otherName;             // which database are we locking and working with (besides local/admin) 
         WrapperForRWLock* _otherLock;  // so we don't have to check the map too often (the map has a mutex)
 
+        // collection level locking related
+        string _collectionName;              // full ns we hold a Lock::CollectionWrite on
+        WrapperForRWLock* _collectionDbLock; // its database, held in intent ('w') mode
+        WrapperForRWLock* _collectionLock;
+
         // for temprelease
         // for the nonrecursive case. otherwise there would be many
         // the first lock goes here, which is ok since we can't yield recursive locks
@@ -123,16 +138,28 @@ namespace mongo {
         friend class AcquiringParallelWriter;
     };
 
+    /**
+     * database and collection lock.  with collection level locking a database lock is a QLock
+     * rather than a plain rwlock, so that it can also be held in intent exclusive mode by
+     * collection level writers: lock_intent() is compatible with other intent holders but not
+     * with lock() or lock_shared().  otherwise the cheaper SimpleRWLock is used.
+     */
     class WrapperForRWLock : boost::noncopyable { 
         SimpleRWLock r;
+        scoped_ptr<QLock> q;
     public:
         string name() const { return r.name; }
         LockStat stats;
-        WrapperForRWLock(const StringData& name) : r(name) { }
-        void lock()          { r.lock(); }
-        void lock_shared()   { r.lock_shared(); }
-        void unlock()        { r.unlock(); }
-        void unlock_shared() { r.unlock_shared(); }
+        WrapperForRWLock(const StringData& name, bool withIntent = false) : r(name) {
+            if ( withIntent )
+                q.reset( new QLock() );
+        }
+        void lock()          { if ( q ) q->lock_W(); else r.lock(); }
+        void lock_shared()   { if ( q ) q->lock_R(); else r.lock_shared(); }
+        void lock_intent()   { verify( q ); q->lock_w(); }
+        void unlock()        { if ( q ) q->unlock_W(); else r.unlock(); }
+        void unlock_shared() { if ( q ) q->unlock_R(); else r.unlock_shared(); }
+        void unlock_intent() { q->unlock_w(); }
     };
 
     class ScopedLock;
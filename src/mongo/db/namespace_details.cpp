@@ -189,15 +189,19 @@ namespace mongo {
         @return null diskloc if no room - allocate a new extent then
     */
     DiskLoc NamespaceDetails::alloc(const StringData& ns, int lenToAlloc) {
-        {
-            // align very slightly.
-            lenToAlloc = (lenToAlloc + 3) & 0xfffffffc;
-        }
+        // align very slightly.
+        lenToAlloc = alignAllocationLength(lenToAlloc);
 
         DiskLoc loc = _alloc(ns, lenToAlloc);
         if ( loc.isNull() )
             return loc;
 
+        claimDeletedRec(ns, loc, lenToAlloc);
+        return loc;
+    }
+
+    void NamespaceDetails::claimDeletedRec(const StringData& ns, const DiskLoc& loc,
+                                           int lenToAlloc) {
         DeletedRecord *r = loc.drec();
         //r = getDur().writing(r);
 
@@ -212,7 +216,7 @@ namespace mongo {
         if ( ! isCapped() ) {
             if ( left < 24 || left < (lenToAlloc >> 3) ) {
                 // you get the whole thing.
-                return loc;
+                return;
             }
         }
 
@@ -228,7 +232,7 @@ namespace mongo {
 
             if ( left < 24 ) {
                 // you get the whole thing.
-                return loc;
+                return;
             }
         }
 
@@ -243,8 +247,6 @@ namespace mongo {
         newDelW->nextDeleted().Null();
 
         addDeletedRec(newDel, newDelLoc);
-
-        return loc;
     }
 
     /* for non-capped collections.
@@ -728,6 +730,34 @@ namespace mongo {
         }
     }
 
+    void NamespaceDetails::orphanDeletedRecordsInExtent( const DiskLoc& extentLoc ) {
+        for ( int b = 0; b < Buckets; b++ ) {
+            DiskLoc* prev = &_deletedList[b];
+            while ( !prev->isNull() ) {
+                DeletedRecord* r = prev->drec();
+                if ( DiskLoc( prev->a(), r->extentOfs() ) == extentLoc ) {
+                    // unlink, prev now points at the record after it
+                    *getDur().writing( prev ) = r->nextDeleted();
+                }
+                else {
+                    prev = &r->nextDeleted();
+                }
+            }
+        }
+    }
+
+    long long NamespaceDetails::deletedRecordsLength( const DiskLoc& excludedExtent ) const {
+        long long total = 0;
+        for ( int b = 0; b < Buckets; b++ ) {
+            for ( DiskLoc dl = _deletedList[b]; !dl.isNull(); dl = dl.drec()->nextDeleted() ) {
+                DeletedRecord* r = dl.drec();
+                if ( DiskLoc( dl.a(), r->extentOfs() ) != excludedExtent )
+                    total += r->lengthWithHeaders();
+            }
+        }
+        return total;
+    }
+
     int NamespaceDetails::_catalogFindIndexByName(const StringData& name,
                                                   bool includeBackgroundInProgress) {
         IndexIterator i = ii(includeBackgroundInProgress);
@@ -215,6 +215,12 @@ namespace mongo {
 
         void orphanDeletedList();
 
+        /** takes the deleted records which lie in the extent at 'extentLoc' off the lists */
+        void orphanDeletedRecordsInExtent( const DiskLoc& extentLoc );
+
+        /** @return the length of all the deleted records, except those in 'excludedExtent' */
+        long long deletedRecordsLength( const DiskLoc& excludedExtent ) const;
+
         /**
          * @param max in and out, will be adjusted
          * @return if the value is valid at all
@@ -254,7 +260,8 @@ namespace mongo {
         };
 
         enum UserFlags {
-            Flag_UsePowerOf2Sizes = 1 << 0
+            Flag_UsePowerOf2Sizes = 1 << 0,
+            Flag_UseSizeClassFreeLists = 1 << 1 // see DeletedRecordIndex
         };
 
         IndexDetails& idx(int idxNo, bool missingExpected = false );
@@ -385,6 +392,15 @@ namespace mongo {
         */
         DiskLoc alloc(const StringData& ns, int lenToAlloc);
 
+        /** the length alloc() really allocates for a record of 'lenToAlloc' bytes */
+        static int alignAllocationLength(int lenToAlloc) { return (lenToAlloc + 3) & 0xfffffffc; }
+
+        /** takes the first 'lenToAlloc' bytes of the deleted record at 'loc', which must be
+            unlinked from the deleted lists already, and returns the rest of it to them.
+            @param lenToAlloc is WITH header and aligned
+        */
+        void claimDeletedRec(const StringData& ns, const DiskLoc& loc, int lenToAlloc);
+
         /* add a given record to the deleted chains for this NS */
         void addDeletedRec(DeletedRecord *d, DiskLoc dloc);
         void dumpDeleted(set<DiskLoc> *extents = 0);
@@ -57,6 +57,16 @@ namespace mongo {
     void DocumentSource::optimize() {
     }
 
+    void DocumentSource::getNextBatch(vector<Document>* batch) {
+        batch->clear();
+        while (batch->size() < BatchSize) {
+            boost::optional<Document> next = getNext();
+            if (!next)
+                return;
+            batch->push_back(*next);
+        }
+    }
+
     void DocumentSource::dispose() {
         if ( pSource ) {
             // This is required for the DocumentSourceCursor to release its read lock, see
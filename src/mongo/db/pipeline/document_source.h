@@ -65,6 +65,17 @@ namespace mongo {
          */
         virtual boost::optional<Document> getNext() = 0;
 
+        /**
+         * Replaces the contents of batch with the next Documents, or empties it at EOF, so
+         * that stages which implement this natively pass many Documents per virtual call.
+         * The default implementation fills the batch from getNext().  Calls may be mixed
+         * with calls to getNext().
+         */
+        virtual void getNextBatch(vector<Document>* batch);
+
+        /// The number of Documents a batch is filled up to, when the stage doesn't have its own.
+        static const size_t BatchSize = 128;
+
         /**
          * Inform the source that it is no longer needed and may release its resources.  After
          * dispose() is called the source must still be able to handle iteration requests, but may
@@ -351,6 +362,7 @@ namespace mongo {
         // virtuals from DocumentSource
         virtual ~DocumentSourceCursor();
         virtual boost::optional<Document> getNext();
+        virtual void getNextBatch(vector<Document>* batch);
         virtual const char *getSourceName() const;
         virtual Value serialize(bool explain = false) const;
         virtual void setSource(DocumentSource *pSource);
@@ -448,6 +460,7 @@ namespace mongo {
     public:
         // virtuals from DocumentSource
         virtual boost::optional<Document> getNext();
+        virtual void getNextBatch(vector<Document>* batch);
         virtual const char *getSourceName() const;
         virtual void optimize();
         virtual GetDepsReturn getDependencies(set<string>& deps) const;
@@ -493,6 +506,9 @@ namespace mongo {
         /// Tell this source if it is doing a merge from shards. Defaults to false.
         void setDoingMerge(bool doingMerge) { _doingMerge = doingMerge; }
 
+        /// Groups are spilled to disk once they use more than this. Defaults to 100MB.
+        void setMaxMemoryUsageBytes(size_t bytes) { _maxMemoryUsageBytes = bytes; }
+
         /**
           Create a grouping DocumentSource from BSON.
 
@@ -517,11 +533,46 @@ namespace mongo {
     private:
         DocumentSourceGroup(const intrusive_ptr<ExpressionContext> &pExpCtx);
 
-        /// Spill groups map to disk and returns an iterator to the file.
-        shared_ptr<Sorter<Value, Value>::Iterator> spill();
+        typedef vector<intrusive_ptr<Accumulator> > Accumulators;
+        typedef boost::unordered_map<Value, Accumulators, Value::Hash> GroupsMap;
+        typedef SortIteratorInterface<Value, Value> SpillIterator;
 
-        // Only used by spill. Would be function-local if that were legal in C++03.
-        class SpillSTLComparator;
+        /*
+          Groups that don't fit in memory are spilled grace hash style: the
+          hash of their _id picks one of NumPartitions files, so that all the
+          partial results of a group end up in the same file.  Once the input
+          is exhausted the partitions are aggregated one at a time.  A
+          partition that still doesn't fit is partitioned again using other
+          bits of the hash, up to MaxPartitionLevel times.
+         */
+        static const size_t NumPartitions = 16;
+        static const int MaxPartitionLevel = 8;
+
+        /// The spill files of one level of partitioning.
+        class PartitionWriters {
+        public:
+            PartitionWriters(const SortOptions& opts, int level);
+            void add(const Value& id, const Value& accumulatorStates);
+            int level() const { return _level; }
+            /// Can't add more groups after calling done().
+            void done(std::deque<pair<shared_ptr<SpillIterator>, int> >* partitions);
+        private:
+            const SortOptions _opts;
+            const int _level;
+            vector<shared_ptr<SortedFileWriter<Value, Value> > > _writers; // NULL until used
+        };
+
+        /// Returns the group for id, adding it if it is new.  Keeps _memoryUsageBytes up to date.
+        Accumulators& getGroup(const Value& id, bool* inserted);
+
+        /// Writes every group to its partition and clears the groups map.
+        void spill(PartitionWriters* writers);
+
+        /**
+          Aggregates the next spilled partition into the groups map.
+          @returns false if there are no more partitions
+         */
+        bool loadNextPartition();
 
         /*
           Before returning anything, this source must fetch everything from
@@ -534,8 +585,6 @@ namespace mongo {
 
         intrusive_ptr<Expression> pIdExpression;
 
-        typedef vector<intrusive_ptr<Accumulator> > Accumulators;
-        typedef boost::unordered_map<Value, Accumulators, Value::Hash> GroupsMap;
         GroupsMap groups;
 
         /*
@@ -558,19 +607,15 @@ namespace mongo {
         Document makeDocument(const Value& id, const Accumulators& accums, bool mergeableOutput);
 
         bool _doingMerge;
-        bool _spilled;
         const bool _extSortAllowed;
-        const int _maxMemoryUsageBytes;
+        size_t _maxMemoryUsageBytes;
+        size_t _memoryUsageBytes; // of the groups map, including the accumulators
         boost::scoped_ptr<Variables> _variables;
 
-        // only used when !_spilled
         GroupsMap::iterator groupsIterator;
 
-        // only used when _spilled
-        scoped_ptr<Sorter<Value, Value>::Iterator> _sorterIterator;
-        pair<Value, Value> _firstPartOfNextGroup;
-        Value _currentId;
-        Accumulators _currentAccumulators;
+        // spilled partitions still to be aggregated, with their level of partitioning
+        std::deque<pair<shared_ptr<SpillIterator>, int> > _partitions;
     };
 
 
@@ -578,6 +623,7 @@ namespace mongo {
     public:
         // virtuals from DocumentSource
         virtual boost::optional<Document> getNext();
+        virtual void getNextBatch(vector<Document>* batch);
         virtual const char *getSourceName() const;
         virtual bool coalesce(const intrusive_ptr<DocumentSource>& nextSource);
         virtual Value serialize(bool explain = false) const;
@@ -731,6 +777,7 @@ namespace mongo {
     public:
         // virtuals from DocumentSource
         virtual boost::optional<Document> getNext();
+        virtual void getNextBatch(vector<Document>* batch);
         virtual const char *getSourceName() const;
         virtual void optimize();
         virtual Value serialize(bool explain = false) const;
@@ -760,6 +807,9 @@ namespace mongo {
         DocumentSourceProject(const intrusive_ptr<ExpressionContext>& pExpCtx,
                               const intrusive_ptr<ExpressionObject>& exprObj);
 
+        /// Returns the projection of input.
+        Document project(const Document& input);
+
         // configuration state
         boost::scoped_ptr<Variables> _variables;
         intrusive_ptr<ExpressionObject> pEO;
@@ -64,6 +64,23 @@ namespace mongo {
         return out;
     }
 
+    void DocumentSourceCursor::getNextBatch(vector<Document>* batch) {
+        batch->clear();
+
+        if (_currentBatch.empty()) {
+            pExpCtx->checkForInterrupt();
+            loadBatch();
+        }
+
+        // hand over the whole batch read from the cursor
+        batch->reserve(_currentBatch.size());
+        for (size_t i = 0; i < _currentBatch.size(); i++) {
+            pExpCtx->checkForInterrupt();
+            batch->push_back(_currentBatch[i]);
+        }
+        _currentBatch.clear();
+    }
+
     void DocumentSourceCursor::dispose() {
         if (_cursorId) {
             ClientCursor::erase(_cursorId);
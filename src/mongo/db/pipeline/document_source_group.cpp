@@ -50,69 +50,50 @@ namespace mongo {
         if (!populated)
             populate();
 
-        if (_spilled) {
-            if (!_sorterIterator)
+        while (groupsIterator == groups.end()) {
+            if (!loadNextPartition())
                 return boost::none;
+        }
 
-            const size_t numAccumulators = vpAccumulatorFactory.size();
-            for (size_t i=0; i < numAccumulators; i++) {
-                _currentAccumulators[i]->reset(); // prep accumulators for a new group
-            }
+        Document out = makeDocument(groupsIterator->first,
+                                    groupsIterator->second,
+                                    pExpCtx->inShard);
 
-            _currentId = _firstPartOfNextGroup.first;
-            while (_currentId == _firstPartOfNextGroup.first) {
-                // Inside of this loop, _firstPartOfNextGroup is the current data being processed.
-                // At loop exit, it is the first value to be processed in the next group.
-
-                switch (numAccumulators) { // mirrors switch in spill()
-                case 0: // no Accumulators so no Values
-                    break;
-
-                case 1: // single accumulators serialize as a single Value
-                    _currentAccumulators[0]->process(_firstPartOfNextGroup.second,
-                                                     /*merging=*/true);
-                    break;
-
-                default: { // multiple accumulators serialize as an array
-                    const vector<Value>& accumulatorStates =
-                        _firstPartOfNextGroup.second.getArray();
-                    for (size_t i=0; i < numAccumulators; i++) {
-                        _currentAccumulators[i]->process(accumulatorStates[i],
-                                                         /*merging=*/true);
-                    }
-                    break;
-                }
-                }
+        if (++groupsIterator == groups.end() && _partitions.empty())
+            dispose();
 
-                if (!_sorterIterator->more()) {
-                    dispose();
-                    break;
-                }
+        return out;
+    }
 
-                _firstPartOfNextGroup = _sorterIterator->next();
-            }
+    void DocumentSourceGroup::getNextBatch(vector<Document>* batch) {
+        pExpCtx->checkForInterrupt();
+        batch->clear();
 
-            return makeDocument(_currentId, _currentAccumulators, pExpCtx->inShard);
+        if (!populated)
+            populate();
 
-        } else {
-            if (groups.empty())
-                return boost::none;
+        while (batch->size() < BatchSize) {
+            while (groupsIterator == groups.end()) {
+                if (!loadNextPartition())
+                    return;
+            }
 
-            Document out = makeDocument(groupsIterator->first,
-                                        groupsIterator->second,
-                                        pExpCtx->inShard);
+            batch->push_back(makeDocument(groupsIterator->first,
+                                          groupsIterator->second,
+                                          pExpCtx->inShard));
 
-            if (++groupsIterator == groups.end())
+            if (++groupsIterator == groups.end() && _partitions.empty()) {
                 dispose();
-
-            return out;
+                return;
+            }
         }
     }
 
     void DocumentSourceGroup::dispose() {
         // free our resources
         GroupsMap().swap(groups);
-        _sorterIterator.reset();
+        _partitions.clear();
+        _memoryUsageBytes = 0;
 
         // make us look done
         groupsIterator = groups.end();
@@ -177,9 +158,9 @@ namespace mongo {
         : DocumentSource(pExpCtx)
         , populated(false)
         , _doingMerge(false)
-        , _spilled(false)
         , _extSortAllowed(pExpCtx->extSortAllowed && !pExpCtx->inRouter)
         , _maxMemoryUsageBytes(100*1024*1024)
+        , _memoryUsageBytes(0)
     {}
 
     void DocumentSourceGroup::addAccumulator(
@@ -342,161 +323,226 @@ namespace mongo {
     }
 
     namespace {
-        class SorterComparator {
-        public:
-            typedef pair<Value, Value> Data;
-            int operator() (const Data& lhs, const Data& rhs) const {
-                return Value::compare(lhs.first, rhs.first);
+        /**
+         * The partial result of a group's accumulators as a single Value: nothing without
+         * accumulators (essentially a distinct), the accumulator's own Value for one of them
+         * and an array for several.
+         */
+        Value getAccumulatorStates(const vector<intrusive_ptr<Accumulator> >& accumulators) {
+            switch (accumulators.size()) {
+            case 0:
+                return Value();
+
+            case 1:
+                return accumulators[0]->getValue(/*toBeMerged=*/true);
+
+            default: {
+                vector<Value> states;
+                states.reserve(accumulators.size());
+                for (size_t i = 0; i < accumulators.size(); i++) {
+                    states.push_back(accumulators[i]->getValue(/*toBeMerged=*/true));
+                }
+                return Value::consume(states);
             }
-        };
+            }
+        }
+    }
+
+    DocumentSourceGroup::PartitionWriters::PartitionWriters(const SortOptions& opts, int level)
+        : _opts(opts)
+        , _level(level)
+        , _writers(NumPartitions)
+    {}
+
+    void DocumentSourceGroup::PartitionWriters::add(const Value& id,
+                                                    const Value& accumulatorStates) {
+        // Mix the hash (with the MurmurHash3 finalizer) so that every level of partitioning
+        // can use its own bits of it.
+        unsigned long long h = Value::Hash()(id);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        const size_t partition = (h >> (_level * 4)) % NumPartitions;
+
+        shared_ptr<SortedFileWriter<Value, Value> >& writer = _writers[partition];
+        if (!writer)
+            writer.reset(new SortedFileWriter<Value, Value>(_opts));
+        writer->addAlreadySorted(id, accumulatorStates);
+    }
+
+    void DocumentSourceGroup::PartitionWriters::done(
+            std::deque<pair<shared_ptr<SpillIterator>, int> >* partitions) {
+        for (size_t i = 0; i < NumPartitions; i++) {
+            if (!_writers[i])
+                continue; // nothing was spilled to it
+
+            partitions->push_front(make_pair(shared_ptr<SpillIterator>(_writers[i]->done()),
+                                             _level));
+            _writers[i].reset();
+        }
+    }
+
+    DocumentSourceGroup::Accumulators& DocumentSourceGroup::getGroup(const Value& id,
+                                                                     bool* inserted) {
+        const size_t oldSize = groups.size();
+        Accumulators& group = groups[id];
+        *inserted = groups.size() != oldSize;
+
+        if (*inserted) {
+            const size_t numAccumulators = vpAccumulatorFactory.size();
+
+            // the map's node and bucket and the accumulator pointers count as well as the
+            // values themselves
+            _memoryUsageBytes += id.getApproximateSize()
+                               + sizeof(GroupsMap::value_type) + 2 * sizeof(void*)
+                               + numAccumulators * sizeof(intrusive_ptr<Accumulator>);
+
+            // Add the accumulators
+            group.reserve(numAccumulators);
+            for (size_t i = 0; i < numAccumulators; i++) {
+                group.push_back(vpAccumulatorFactory[i]());
+                _memoryUsageBytes += group[i]->memUsageForSorter();
+            }
+        }
+
+        return group;
     }
 
     void DocumentSourceGroup::populate() {
         const size_t numAccumulators = vpAccumulatorFactory.size();
         dassert(numAccumulators == vpExpression.size());
 
-        // pushed to on spill()
-        vector<shared_ptr<Sorter<Value, Value>::Iterator> > sortedFiles;
-        int memoryUsageBytes = 0;
+        // created on the first spill()
+        scoped_ptr<PartitionWriters> writers;
+        const SortOptions spillOptions = SortOptions().TempDir(pExpCtx->tempDir);
+        int numDebugSpills = 0;
 
         // This loop consumes all input from pSource and buckets it based on pIdExpression.
-        while (boost::optional<Document> input = pSource->getNext()) {
-            if (memoryUsageBytes > _maxMemoryUsageBytes) {
-                uassert(16945, "Exceeded memory limit for $group, but didn't allow external sort",
-                        _extSortAllowed);
-                sortedFiles.push_back(spill());
-                memoryUsageBytes = 0;
-            }
-
-            _variables->setRoot(*input);
+        vector<Document> batch;
+        for (pSource->getNextBatch(&batch); !batch.empty(); pSource->getNextBatch(&batch)) {
+            for (size_t n = 0; n < batch.size(); n++) {
+                const Document& input = batch[n];
+
+                if (_memoryUsageBytes > _maxMemoryUsageBytes) {
+                    uassert(16945,
+                            "Exceeded memory limit for $group, but didn't allow external sort",
+                            _extSortAllowed);
+                    if (!writers)
+                        writers.reset(new PartitionWriters(spillOptions, 0));
+                    spill(writers.get());
+                }
 
-            /* get the _id value */
-            Value id = pIdExpression->evaluate(_variables.get());
+                _variables->setRoot(input);
 
-            /* treat missing values the same as NULL SERVER-4674 */
-            if (id.missing())
-                id = Value(BSONNULL);
+                /* get the _id value */
+                Value id = pIdExpression->evaluate(_variables.get());
 
-            /*
-              Look for the _id value in the map; if it's not there, add a
-              new entry with a blank accumulator.
-            */
-            const size_t oldSize = groups.size();
-            vector<intrusive_ptr<Accumulator> >& group = groups[id];
-            const bool inserted = groups.size() != oldSize;
+                /* treat missing values the same as NULL SERVER-4674 */
+                if (id.missing())
+                    id = Value(BSONNULL);
 
-            if (inserted) {
-                memoryUsageBytes += id.getApproximateSize();
+                bool inserted;
+                Accumulators& group = getGroup(id, &inserted);
 
-                // Add the accumulators
-                group.reserve(numAccumulators);
+                /* tickle all the accumulators for the group we found */
+                dassert(numAccumulators == group.size());
                 for (size_t i = 0; i < numAccumulators; i++) {
-                    group.push_back(vpAccumulatorFactory[i]());
+                    _memoryUsageBytes -= group[i]->memUsageForSorter();
+                    group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
+                    _memoryUsageBytes += group[i]->memUsageForSorter();
                 }
-            } else {
-                for (size_t i = 0; i < numAccumulators; i++) {
-                    // subtract old mem usage. New usage added back after processing.
-                    memoryUsageBytes -= group[i]->memUsageForSorter();
-                }
-            }
 
-            /* tickle all the accumulators for the group we found */
-            dassert(numAccumulators == group.size());
-            for (size_t i = 0; i < numAccumulators; i++) {
-                group[i]->process(vpExpression[i]->evaluate(_variables.get()), _doingMerge);
-                memoryUsageBytes += group[i]->memUsageForSorter();
-            }
-
-            // We are done with the ROOT document so release it.
-            _variables->clearRoot();
-
-            DEV {
-                // In debug mode, spill every time we have a duplicate id to stress merge logic.
-                if (!inserted // is a dup
-                        && !pExpCtx->inRouter // can't spill to disk in router
-                        && !_extSortAllowed // don't change behavior when testing external sort
-                        && sortedFiles.size() < 20 // don't open too many FDs
-                        ) {
-                    sortedFiles.push_back(spill());
+                // We are done with the ROOT document so release it.
+                _variables->clearRoot();
+
+                DEV {
+                    // In debug mode, spill every time we have a duplicate id to stress merging.
+                    if (!inserted // is a dup
+                            && !pExpCtx->inRouter // can't spill to disk in router
+                            && !_extSortAllowed // don't change behavior when testing external sort
+                            && numDebugSpills++ < 20 // don't spend too long spilling
+                            ) {
+                        if (!writers)
+                            writers.reset(new PartitionWriters(spillOptions, 0));
+                        spill(writers.get());
+                    }
                 }
             }
         }
 
-        // These blocks do any final steps necessary to prepare to output results.
-        if (!sortedFiles.empty()) {
-            _spilled = true;
-            if (!groups.empty()) {
-                sortedFiles.push_back(spill());
-            }
-
-            // We won't be using groups again so free its memory.
-            GroupsMap().swap(groups);
+        if (writers) {
+            // Every group has to be aggregated from its partition, so spill the rest as well.
+            spill(writers.get());
+            writers->done(&_partitions);
+        }
 
-            _sorterIterator.reset(
-                    Sorter<Value,Value>::Iterator::merge(
-                        sortedFiles, SortOptions(), SorterComparator()));
+        // start the group iterator, getNext() loads the partitions as needed
+        groupsIterator = groups.begin();
 
-            // prepare current to accumulate data
-            _currentAccumulators.reserve(numAccumulators);
-            for (size_t i = 0; i < numAccumulators; i++) {
-                _currentAccumulators.push_back(vpAccumulatorFactory[i]());
-            }
+        populated = true;
+    }
 
-            verify(_sorterIterator->more()); // we put data in, we should get something out.
-            _firstPartOfNextGroup = _sorterIterator->next();
-        } else {
-            // start the group iterator
-            groupsIterator = groups.begin();
+    void DocumentSourceGroup::spill(PartitionWriters* writers) {
+        for (GroupsMap::const_iterator it=groups.begin(), end=groups.end(); it != end; ++it) {
+            writers->add(it->first, getAccumulatorStates(it->second));
         }
 
-        populated = true;
+        groups.clear();
+        _memoryUsageBytes = 0;
     }
 
-    class DocumentSourceGroup::SpillSTLComparator {
-    public:
-        bool operator() (const GroupsMap::value_type* lhs, const GroupsMap::value_type* rhs) const {
-            return Value::compare(lhs->first, rhs->first) < 0;
-        }
-    };
+    bool DocumentSourceGroup::loadNextPartition() {
+        GroupsMap().swap(groups);
+        _memoryUsageBytes = 0;
+        groupsIterator = groups.end();
 
-    shared_ptr<Sorter<Value, Value>::Iterator> DocumentSourceGroup::spill() {
-        vector<const GroupsMap::value_type*> ptrs; // using pointers to speed sorting
-        ptrs.reserve(groups.size());
-        for (GroupsMap::const_iterator it=groups.begin(), end=groups.end(); it != end; ++it) {
-            ptrs.push_back(&*it);
-        }
+        if (_partitions.empty())
+            return false;
 
-        stable_sort(ptrs.begin(), ptrs.end(), SpillSTLComparator());
+        const shared_ptr<SpillIterator> partition = _partitions.front().first;
+        const int level = _partitions.front().second;
+        _partitions.pop_front();
 
-        SortedFileWriter<Value, Value> writer(SortOptions().TempDir(pExpCtx->tempDir));
-        switch (vpAccumulatorFactory.size()) { // same as ptrs[i]->second.size() for all i.
-        case 0: // no values, essentially a distinct
-            for (size_t i=0; i < ptrs.size(); i++) {
-                writer.addAlreadySorted(ptrs[i]->first, Value());
-            }
-            break;
+        const size_t numAccumulators = vpAccumulatorFactory.size();
+
+        // created if this partition doesn't fit in memory either
+        scoped_ptr<PartitionWriters> writers;
 
-        case 1: // just one value, use optimized serialization as single Value
-            for (size_t i=0; i < ptrs.size(); i++) {
-                writer.addAlreadySorted(ptrs[i]->first,
-                                        ptrs[i]->second[0]->getValue(/*toBeMerged=*/true));
+        while (partition->more()) {
+            pExpCtx->checkForInterrupt();
+
+            // Past the last level the groups must share hashes (or be huge), so partitioning
+            // again wouldn't separate them.
+            if (_memoryUsageBytes > _maxMemoryUsageBytes && level < MaxPartitionLevel) {
+                if (!writers)
+                    writers.reset(new PartitionWriters(SortOptions().TempDir(pExpCtx->tempDir),
+                                                       level + 1));
+                spill(writers.get());
             }
-            break;
 
-        default: // multiple values, serialize as array-typed Value
-            for (size_t i=0; i < ptrs.size(); i++) {
-                vector<Value> accums;
-                for (size_t j=0; j < ptrs[i]->second.size(); j++) {
-                    accums.push_back(ptrs[i]->second[j]->getValue(/*toBeMerged=*/true));
-                }
-                writer.addAlreadySorted(ptrs[i]->first, Value::consume(accums));
+            const SpillIterator::Data spilled = partition->next();
+
+            bool inserted;
+            Accumulators& group = getGroup(spilled.first, &inserted);
+
+            for (size_t i = 0; i < numAccumulators; i++) { // mirrors getAccumulatorStates()
+                const Value& state = (numAccumulators == 1 ? spilled.second
+                                                           : spilled.second.getArray()[i]);
+                _memoryUsageBytes -= group[i]->memUsageForSorter();
+                group[i]->process(state, /*merging=*/true);
+                _memoryUsageBytes += group[i]->memUsageForSorter();
             }
-            break;
         }
 
-        groups.clear();
+        if (writers) {
+            spill(writers.get());
+            writers->done(&_partitions);
+        }
 
-        return shared_ptr<Sorter<Value, Value>::Iterator>(writer.done());
+        groupsIterator = groups.begin();
+        return true;
     }
 
     Document DocumentSourceGroup::makeDocument(const Value& id,
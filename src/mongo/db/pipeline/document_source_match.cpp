@@ -66,6 +66,35 @@ namespace mongo {
         return boost::none;
     }
 
+    void DocumentSourceMatch::getNextBatch(vector<Document>* batch) {
+        massert(17357, "Should never call getNextBatch on a $match stage with $text clause",
+                !_isTextQuery);
+
+        // keep going until something matches, since an empty batch means EOF
+        while (true) {
+            pSource->getNextBatch(batch);
+            if (batch->empty())
+                return;
+
+            // filter the batch in place
+            size_t matched = 0;
+            for (size_t i = 0; i < batch->size(); i++) {
+                pExpCtx->checkForInterrupt();
+
+                // The matcher only takes BSON documents, so we have to make one.
+                if (matcher->matches((*batch)[i].toBson())) {
+                    if (matched != i)
+                        (*batch)[i].swap((*batch)[matched]);
+                    matched++;
+                }
+            }
+            batch->resize(matched);
+
+            if (!batch->empty())
+                return;
+        }
+    }
+
     bool DocumentSourceMatch::coalesce(const intrusive_ptr<DocumentSource>& nextSource) {
         DocumentSourceMatch* otherMatch = dynamic_cast<DocumentSourceMatch*>(nextSource.get());
         if (!otherMatch)
@@ -119,15 +119,18 @@ namespace mongo {
 
         vector<BSONObj> bufferedObjects;
         int bufferedBytes = 0;
-        while (boost::optional<Document> next = pSource->getNext()) {
-            BSONObj toInsert = next->toBson();
-            bufferedBytes += toInsert.objsize();
-            if (!bufferedObjects.empty() && bufferedBytes > BSONObjMaxUserSize) {
-                spill(conn, bufferedObjects);
-                bufferedObjects.clear();
-                bufferedBytes = toInsert.objsize();
+        vector<Document> batch;
+        for (pSource->getNextBatch(&batch); !batch.empty(); pSource->getNextBatch(&batch)) {
+            for (size_t i = 0; i < batch.size(); i++) {
+                BSONObj toInsert = batch[i].toBson();
+                bufferedBytes += toInsert.objsize();
+                if (!bufferedObjects.empty() && bufferedBytes > BSONObjMaxUserSize) {
+                    spill(conn, bufferedObjects);
+                    bufferedObjects.clear();
+                    bufferedBytes = toInsert.objsize();
+                }
+                bufferedObjects.push_back(toInsert);
             }
-            bufferedObjects.push_back(toInsert);
         }
 
         if (!bufferedObjects.empty())
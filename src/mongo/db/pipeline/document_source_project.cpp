@@ -55,10 +55,23 @@ namespace mongo {
         if (!input)
             return boost::none;
 
+        return project(*input);
+    }
+
+    void DocumentSourceProject::getNextBatch(vector<Document>* batch) {
+        pSource->getNextBatch(batch);
+
+        for (size_t i = 0; i < batch->size(); i++) {
+            pExpCtx->checkForInterrupt();
+            (*batch)[i] = project((*batch)[i]);
+        }
+    }
+
+    Document DocumentSourceProject::project(const Document& input) {
         /* create the result document */
         const size_t sizeHint = pEO->getSizeHint();
         MutableDocument out (sizeHint);
-        out.copyMetaDataFrom(*input);
+        out.copyMetaDataFrom(input);
 
         /*
           Use the ExpressionObject to create the base result.
@@ -66,15 +79,15 @@ namespace mongo {
           If we're excluding fields at the top level, leave out the _id if
           it is found, because we took care of it above.
         */
-        _variables->setRoot(*input);
-        pEO->addToDocument(out, *input, _variables.get());
+        _variables->setRoot(input);
+        pEO->addToDocument(out, input, _variables.get());
         _variables->clearRoot();
 
 #if defined(_DEBUG)
         if (!_simpleProjection.getSpec().isEmpty()) {
             // Make sure we return the same results as Projection class
 
-            BSONObj inputBson = input->toBson();
+            BSONObj inputBson = input.toBson();
             BSONObj outputBson = out.peek().toBson();
 
             BSONObj projected = _simpleProjection.transform(inputBson);
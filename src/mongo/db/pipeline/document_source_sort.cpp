@@ -229,8 +229,11 @@ namespace mongo {
             }
         } else {
             scoped_ptr<MySorter> sorter (MySorter::make(makeSortOptions(), Comparator(*this)));
-            while (boost::optional<Document> next = pSource->getNext()) {
-                sorter->add(extractKey(*next), *next);
+            vector<Document> batch;
+            for (pSource->getNextBatch(&batch); !batch.empty(); pSource->getNextBatch(&batch)) {
+                for (size_t i = 0; i < batch.size(); i++) {
+                    sorter->add(extractKey(batch[i]), batch[i]);
+                }
             }
             _output.reset(sorter->done());
         }
@@ -30,16 +30,24 @@
 
 #include "mongo/db/prefetch.h"
 
+#include <algorithm>
+
+#include "mongo/base/counter.h"
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/index/index_access_method.h"
+#include "mongo/db/storage/data_file.h"
+#include "mongo/db/storage/extent_manager.h"
 #include "mongo/db/storage/index_details.h"
+#include "mongo/db/storage/record.h"
 #include "mongo/db/structure/collection.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/stats/timer_stats.h"
 #include "mongo/db/commands/server_status.h"
+#include "mongo/util/mmap.h"
+#include "mongo/util/processinfo.h"
 
 namespace mongo {
 
@@ -57,8 +65,138 @@ namespace mongo {
                                                     "repl.preload.docs",
                                                     &prefetchDocStats );
 
+    //The count (of batches) and time spent reading in the records of a batch by address
+    static TimerStats prefetchAdviseStats;
+    static ServerStatusMetricField<TimerStats> displayPrefetchAdvise(
+                                                    "repl.preload.advise",
+                                                    &prefetchAdviseStats );
+    //The record pages of batches which were in memory already, which were advised to be read in,
+    //and which were faulted in by touching them where there is no such advice
+    static Counter64 prefetchPagesInMemory;
+    static ServerStatusMetricField<Counter64> displayPrefetchPagesInMemory(
+                                                    "repl.preload.pages.inMemory",
+                                                    &prefetchPagesInMemory );
+    static Counter64 prefetchPagesAdvised;
+    static ServerStatusMetricField<Counter64> displayPrefetchPagesAdvised(
+                                                    "repl.preload.pages.advised",
+                                                    &prefetchPagesAdvised );
+    static Counter64 prefetchPagesTouched;
+    static ServerStatusMetricField<Counter64> displayPrefetchPagesTouched(
+                                                    "repl.preload.pages.touched",
+                                                    &prefetchPagesTouched );
+
+    void RecordPrefetchBatch::add(const DiskLoc& loc) {
+        // the record is only looked at while the caller's read lock keeps its file mapped
+        ExtentManager& extentManager = cc().database()->getExtentManager();
+        const unsigned long long fileLength = extentManager.getFile(loc.a())->length();
+        if (loc.getOfs() < 0 || static_cast<unsigned long long>(loc.getOfs()) >= fileLength)
+            return;
+        Range range;
+        range.start = reinterpret_cast<const char*>(extentManager.recordFor(loc));
+        range.era = LockMongoFilesShared::getEra();
+
+        // the length is only read where the header is in memory, so as not to fault here; otherwise
+        // the header is read in and the rest is left to the writer
+        unsigned long long length = Record::HeaderSize;
+        if (ProcessInfo::blockCheckSupported() && ProcessInfo::blockInMemory(range.start)) {
+            const Record* r = reinterpret_cast<const Record*>(range.start);
+            length = std::max(r->lengthWithHeaders(), static_cast<int>(Record::HeaderSize));
+        }
+        range.length = static_cast<size_t>(std::min(length, fileLength - loc.getOfs()));
+
+        SimpleMutex::scoped_lock lk(_mutex);
+        _records.push_back(range);
+    }
+
+    static void readInPages(const char* start, size_t numPages) {
+        if (numPages == 0)
+            return;
+
+        if (MAdvise::willNeed(start, numPages * g_minOSPageSizeBytes)) {
+            prefetchPagesAdvised.increment(numPages);
+            return;
+        }
+
+        volatile char _dummy_char = '\0';
+        for (size_t i = 0; i < numPages; i++) {
+            _dummy_char += *(start + i * g_minOSPageSizeBytes);
+        }
+        prefetchPagesTouched.increment(numPages);
+    }
+
+    void RecordPrefetchBatch::adviseAll() {
+        if (_records.empty())
+            return;
+
+        TimerHolder timer(&prefetchAdviseStats);
+
+        // no data file may be unmapped while its records are read in
+        LockMongoFilesShared lk;
+
+        std::sort(_records.begin(), _records.end());
+        const bool canCheck = ProcessInfo::blockCheckSupported();
+        const char* lastPage = NULL;
+        // adjacent pages to read in are advised together, so readahead sees one range
+        const char* runStart = NULL;
+        size_t runPages = 0;
+
+        for (size_t i = 0; i < _records.size(); i++) {
+            const Range& range = _records[i];
+            if (range.era != LockMongoFilesShared::getEra()) {
+                // files were opened or closed since the record was added, so its range may no
+                // longer be mapped; as in PageFaultException::touch() it is left to the writer
+                continue;
+            }
+            const char* firstPage = reinterpret_cast<const char*>(
+                reinterpret_cast<unsigned long long>(range.start) & ~(g_minOSPageSizeBytes - 1));
+            const char* end = range.start + range.length;
+            const size_t numPages = (end - 1 - firstPage) / g_minOSPageSizeBytes + 1;
+
+            for (size_t j = 0; j < numPages; j++) {
+                const char* page = firstPage + j * g_minOSPageSizeBytes;
+                if (lastPage && page <= lastPage)
+                    continue; // shared with an earlier record
+                lastPage = page;
+
+                if (canCheck && ProcessInfo::blockInMemory(page)) {
+                    prefetchPagesInMemory.increment();
+                    continue;
+                }
+                if (runStart && page == runStart + runPages * g_minOSPageSizeBytes) {
+                    runPages++;
+                    continue;
+                }
+                readInPages(runStart, runPages);
+                runStart = page;
+                runPages = 1;
+            }
+        }
+        readInPages(runStart, runPages);
+
+        _records.clear();
+    }
+
+    // finds the record an op on 'obj' will change by its _id, for the batch to read in
+    static void locateRecord(Collection* collection, const BSONObj& obj,
+                             RecordPrefetchBatch* records) {
+        BSONElement _id;
+        if( !obj.getObjectID(_id) )
+            return;
+
+        TimerHolder timer(&prefetchDocStats);
+        try {
+            // this touches the _id index, but not the record
+            DiskLoc loc = Helpers::findById(collection, _id.wrap());
+            if ( !loc.isNull() )
+                records->add(loc);
+        }
+        catch(const DBException& e) {
+            LOG(2) << "ignoring exception in locateRecord(): " << e.what() << endl;
+        }
+    }
+
     // prefetch for an oplog operation
-    void prefetchPagesForReplicatedOp(const BSONObj& op) {
+    void prefetchPagesForReplicatedOp(const BSONObj& op, RecordPrefetchBatch* records) {
         const char *opField;
         const char *opType = op.getStringField("op");
         switch (*opType) {
@@ -109,13 +247,19 @@ namespace mongo {
         // do not prefetch the data for inserts; it doesn't exist yet
         // 
         // we should consider doing the record prefetch for the delete op case as we hit the record
-        // when we delete.  note if done we only want to touch the first page.
+        // when we delete.  note if done we only want to touch the first page.  with a batch to
+        // read the records in, that costs no more than the _id lookup, so deletes are included.
         // 
         // update: do record prefetch. 
-        if ((*opType == 'u') &&
+        if (collection->details()->isCapped()) {
             // do not prefetch the data for capped collections because
             // they typically do not have an _id index for findById() to use.
-            !collection->details()->isCapped()) {
+        }
+        else if (records) {
+            if (*opType == 'u' || *opType == 'd')
+                locateRecord(collection, obj, records);
+        }
+        else if (*opType == 'u') {
             prefetchRecordPages(ns, obj);
         }
     }
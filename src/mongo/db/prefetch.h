@@ -27,13 +27,50 @@
 */
 #pragma once
 
+#include <vector>
+
 #include "mongo/db/jsobj.h"
 #include "mongo/db/diskloc.h"
+#include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
     class Collection;
-    // page in both index and data pages for an op from the oplog
-    void prefetchPagesForReplicatedOp(const BSONObj& op);
+
+    /**
+     * The records the ops of a replication batch update or delete, gathered while each op is
+     * prefetched and read in together afterwards: sorted by address, which within a data file is
+     * the file offset, and advised with MADV_WILLNEED where not in memory, so the reads reach the
+     * disk as one sorted batch instead of one blocking fault per op.
+     */
+    class RecordPrefetchBatch : boost::noncopyable {
+    public:
+        RecordPrefetchBatch() : _mutex("RecordPrefetchBatch") {}
+
+        /**
+         * Called by the prefetch threads, locked for the record's database.  Takes the record's
+         * address and length, as the lock is released before adviseAll().
+         */
+        void add(const DiskLoc& loc);
+
+        /** Starts reading in the pages of all records added, and forgets them */
+        void adviseAll();
+
+    private:
+        /** A record's bytes, within its data file's mapping as of 'era' */
+        struct Range {
+            const char* start;
+            size_t length;
+            unsigned era;
+            bool operator<(const Range& other) const { return start < other.start; }
+        };
+
+        SimpleMutex _mutex;
+        std::vector<Range> _records;
+    };
+
+    // page in both index and data pages for an op from the oplog.  with 'records' the data pages
+    // are left for records->adviseAll()
+    void prefetchPagesForReplicatedOp(const BSONObj& op, RecordPrefetchBatch* records = NULL);
 
     // page in pages needed for all index lookups on a given object
     void prefetchIndexPages(Collection *nsd, const BSONObj& obj);
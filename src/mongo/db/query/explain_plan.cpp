@@ -28,6 +28,7 @@
 
 #include "mongo/db/query/explain_plan.h"
 
+#include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/stage_types.h"
 #include "mongo/db/query/type_explain.h"
 #include "mongo/util/mongoutils/str.h"
@@ -280,6 +281,14 @@ namespace mongo {
         return Status::OK();
     }
 
+    void explainEstimate(const QuerySolutionEstimate& estimate, TypeExplain* explain) {
+        if (!estimate.isSet()) {
+            return;
+        }
+        explain->setNScannedEstimate(static_cast<long long>(estimate.nScanned));
+        explain->setNScannedObjectsEstimate(static_cast<long long>(estimate.nScannedObjects));
+    }
+
     // XXX: where does this really live?  stage_types.h?
     string stageTypeString(StageType type) {
         if (STAGE_AND_HASH == type) {
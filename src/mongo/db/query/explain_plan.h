@@ -34,6 +34,7 @@
 namespace mongo {
 
     class TypeExplain;
+    struct QuerySolutionEstimate;
 
     /**
      * Returns OK, allocating and filling in '*explain' describing the access paths used in
@@ -52,6 +53,12 @@ namespace mongo {
      */
     Status explainPlan(const PlanStageStats& stats, TypeExplain** explain, bool fullDetails);
 
+    /**
+     * Adds what the plan cost model expected the plan to examine, 'nscannedEstimate' and
+     * 'nscannedObjectsEstimate', to 'explain'.  No-op if no estimate was made.
+     */
+    void explainEstimate(const QuerySolutionEstimate& estimate, TypeExplain* explain);
+
     BSONObj statsToBSON(const PlanStageStats& stats);
 
 } // namespace mongo
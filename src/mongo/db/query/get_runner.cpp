@@ -36,6 +36,7 @@
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/query/multi_plan_runner.h"
 #include "mongo/db/query/plan_cache.h"
+#include "mongo/db/query/plan_cost.h"
 #include "mongo/db/query/qlog.h"
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/query/query_planner_common.h"
@@ -247,6 +248,34 @@ namespace mongo {
                           " No query solutions");
         }
 
+        if (solutions.size() > 1 && internalQueryPlanCostPruneFactor > 0) {
+            // Drop the candidates the index statistics say are clearly worse than the best one
+            // before racing the rest.
+            PlanCostModel costModel(collection->numRecords());
+            BSONObjSet keyPatterns;
+            for (size_t i = 0; i < solutions.size(); ++i) {
+                PlanCostModel::getIndexesScanned(*solutions[i], &keyPatterns);
+            }
+            IndexCatalog* catalog = collection->getIndexCatalog();
+            for (BSONObjSet::const_iterator it = keyPatterns.begin(); it != keyPatterns.end();
+                 ++it) {
+                const IndexDescriptor* desc = catalog->findIndexByKeyPattern(*it);
+                if (NULL == desc) {
+                    continue;
+                }
+                boost::shared_ptr<const IndexStatistics> stats = catalog->getIndexStatistics(desc);
+                if (stats) {
+                    costModel.addIndexStatistics(stats);
+                }
+            }
+
+            size_t pruned = costModel.prune(*canonicalQuery, &solutions);
+            if (pruned > 0) {
+                QLOG() << "cost model pruned " << pruned << " of "
+                       << pruned + solutions.size() << " candidate plans" << endl;
+            }
+        }
+
         if (1 == solutions.size()) {
             // Only one possible plan.  Run it.  Build the stages from the solution.
             WorkingSet* ws;
@@ -0,0 +1,81 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/db/query/index_statistics.h"
+
+#include <algorithm>
+
+#include "mongo/bson/ordering.h"
+
+namespace mongo {
+
+    IndexStatistics::IndexStatistics(const BSONObj& keyPattern,
+                                     long long numKeys,
+                                     const std::vector<BSONObj>& samples)
+        : _keyPattern(keyPattern.getOwned()),
+          _numKeys(std::max(numKeys, static_cast<long long>(samples.size()))),
+          _samples(samples.size()) {
+        for (size_t i = 0; i < samples.size(); ++i) {
+            _samples[i] = samples[i].getOwned();
+        }
+    }
+
+    double IndexStatistics::estimateKeys(const IndexBounds& bounds, int direction) const {
+        size_t matched = 0;
+        if (bounds.isSimpleRange) {
+            Ordering ordering = Ordering::make(_keyPattern);
+            const BSONObj& low = direction > 0 ? bounds.startKey : bounds.endKey;
+            const BSONObj& high = direction > 0 ? bounds.endKey : bounds.startKey;
+            for (size_t i = 0; i < _samples.size(); ++i) {
+                if (_samples[i].woCompare(low, ordering, false) >= 0
+                    && _samples[i].woCompare(high, ordering, false) <= 0) {
+                    ++matched;
+                }
+            }
+        }
+        else {
+            IndexBoundsChecker checker(&bounds, _keyPattern, direction);
+            for (size_t i = 0; i < _samples.size(); ++i) {
+                if (checker.isValidKey(_samples[i])) {
+                    ++matched;
+                }
+            }
+        }
+
+        if (static_cast<long long>(_samples.size()) == _numKeys) {
+            return matched;
+        }
+
+        // Each sample stands for the run of keys up to the next one.  Bounds which contain no
+        // sample fall inside a single run, guess they cover half of it.
+        double keysPerSample = static_cast<double>(_numKeys) / (_samples.size() + 1);
+        double estimate = matched > 0 ? matched * keysPerSample : keysPerSample / 2;
+        return std::min(estimate, static_cast<double>(_numKeys));
+    }
+
+}  // namespace mongo
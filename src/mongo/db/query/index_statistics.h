@@ -0,0 +1,71 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/query/index_bounds.h"
+
+namespace mongo {
+
+    /**
+     * Lightweight statistics about the keys of one index: about how many there are, and a sample
+     * of them in index order taken from the upper levels of the index's B-tree.  The keys of an
+     * upper level split the index into runs holding roughly the same number of keys, so the
+     * sample is an equi-depth histogram of the index.
+     */
+    class IndexStatistics {
+    public:
+        /**
+         * 'samples' must be in index order.  If they are all the keys of the index, 'numKeys' is
+         * samples.size() and estimates are exact.
+         */
+        IndexStatistics(const BSONObj& keyPattern,
+                        long long numKeys,
+                        const std::vector<BSONObj>& samples);
+
+        const BSONObj& getKeyPattern() const { return _keyPattern; }
+
+        long long getNumKeys() const { return _numKeys; }
+
+        const std::vector<BSONObj>& getSamples() const { return _samples; }
+
+        /**
+         * Estimates how many keys a scan of the index over 'bounds', in 'direction', examines.
+         */
+        double estimateKeys(const IndexBounds& bounds, int direction) const;
+
+    private:
+        BSONObj _keyPattern;
+        long long _numKeys;
+        std::vector<BSONObj> _samples;
+    };
+
+}  // namespace mongo
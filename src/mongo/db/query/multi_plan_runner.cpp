@@ -377,15 +377,16 @@ namespace mongo {
             if (i == bestChild) { continue; }
             if (i == backupChild) { continue; }
 
-            delete _candidates[i].solution;
-
             // Remember the stats for the candidate plan because we always show it on an
             // explain. (The {verbose:false} in explain() is client-side trick; we always
             // generate a "verbose" explain.)
             PlanStageStats* stats = _candidates[i].root->getStats();
             if (stats) {
                 _candidateStats.push_back(stats);
+                _candidateEstimates.push_back(_candidates[i].solution->estimate);
             }
+
+            delete _candidates[i].solution;
             delete _candidates[i].root;
 
             // ws must die after the root.
@@ -508,6 +509,7 @@ namespace mongo {
         if (!status.isOK()) {
             return status;
         }
+        explainEstimate(_bestSolution->estimate, *explain);
 
         // TODO Hook the cached plan if there was one.
         // (*explain)->setOldPlan(???);
@@ -526,19 +528,19 @@ namespace mongo {
             return status;
         }
 
+        explainEstimate(_bestSolution->estimate, chosenPlan);
         (*explain)->addToAllPlans(chosenPlan); // ownership xfer
 
         size_t nScannedObjectsAllPlans = chosenPlan->getNScannedObjects();
         size_t nScannedAllPlans = chosenPlan->getNScanned();
-        for (std::vector<PlanStageStats*>::const_iterator it = _candidateStats.begin();
-             it != _candidateStats.end();
-             ++it) {
-
+        for (size_t i = 0; i < _candidateStats.size(); ++i) {
             TypeExplain* candidateExplain = NULL;
-            status = explainPlan(**it, &candidateExplain, false /* no full details */);
+            status = explainPlan(*_candidateStats[i], &candidateExplain,
+                                 false /* no full details */);
             if (status != Status::OK()) {
                 continue;
             }
+            explainEstimate(_candidateEstimates[i], candidateExplain);
 
             (*explain)->addToAllPlans(candidateExplain); // ownership xfer
 
@@ -144,6 +144,9 @@ namespace mongo {
         // Candidate plans' stats. Owned here.
         std::vector<PlanStageStats*> _candidateStats;
 
+        // What the plan cost model expected of each of the candidates in _candidateStats.
+        std::vector<QuerySolutionEstimate> _candidateEstimates;
+
         // Yielding policy we use when we're running candidates.
         boost::scoped_ptr<RunnerYieldPolicy> _yieldPolicy;
 
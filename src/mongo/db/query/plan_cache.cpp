@@ -35,6 +35,7 @@
 #include "mongo/db/query/plan_ranker.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/qlog.h"
+#include "mongo/db/server_parameters.h"
 
 namespace {
 
@@ -183,12 +184,44 @@ namespace {
         }
     }
 
+    size_t indexTreeSize(const PlanCacheIndexTree* tree) {
+        size_t size = sizeof(PlanCacheIndexTree);
+        if (NULL != tree->entry.get()) {
+            const IndexEntry& ie = *tree->entry;
+            size += sizeof(IndexEntry) + ie.keyPattern.objsize() + ie.name.size()
+                    + ie.infoObj.objsize();
+        }
+        for (size_t i = 0; i < tree->children.size(); ++i) {
+            size += sizeof(PlanCacheIndexTree*) + indexTreeSize(tree->children[i]);
+        }
+        return size;
+    }
+
+    size_t statsTreeSize(const PlanStageStats* stats) {
+        size_t size = sizeof(PlanStageStats);
+        for (size_t i = 0; i < stats->children.size(); ++i) {
+            size += sizeof(PlanStageStats*) + statsTreeSize(stats->children[i]);
+        }
+        return size;
+    }
+
 } // namespace
 
 namespace mongo {
 
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlanCacheMaxEntries, int, 5000);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlanCacheMaxSizeBytes, int, 16 * 1024 * 1024);
+
     const int PlanCache::kPlanCacheMaxWriteOperations = 1000;
 
+    Counter64 PlanCache::totalEntries;
+    Counter64 PlanCache::totalSizeBytes;
+    Counter64 PlanCache::totalHits;
+    Counter64 PlanCache::totalMisses;
+    Counter64 PlanCache::totalEvictions;
+    Counter64 PlanCache::totalReplans;
+
     //
     // Cache-related functions for CanonicalQuery
     //
@@ -315,6 +348,7 @@ namespace mongo {
         decision.reset(d);
         pinned = false;
         pinnedIndex = 0;
+        sizeBytes = 0;
     }
 
     PlanCacheEntry::~PlanCacheEntry() {
@@ -332,6 +366,22 @@ namespace mongo {
         return ss.str();
     }
 
+    size_t PlanCacheEntry::estimateSize(const PlanCacheKey& key) const {
+        // The key is held by both the map and the LRU list.
+        size_t size = sizeof(PlanCacheEntry) + 2 * key.size()
+                      + query.objsize() + sort.objsize() + projection.objsize();
+        for (size_t i = 0; i < plannerData.size(); ++i) {
+            size += sizeof(SolutionCacheData*) + sizeof(SolutionCacheData);
+            if (NULL != plannerData[i]->tree.get()) {
+                size += indexTreeSize(plannerData[i]->tree.get());
+            }
+        }
+        if (NULL != decision.get() && NULL != decision->statsOfWinner) {
+            size += sizeof(PlanRankingDecision) + statsTreeSize(decision->statsOfWinner);
+        }
+        return size;
+    }
+
     string CachedSolution::toString() const {
         stringstream ss;
         ss << "key: " << key << endl;
@@ -457,13 +507,18 @@ namespace mongo {
         boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
         // XXX: Replacing existing entry - revisit when we have real cached solutions.
         // Delete previous entry
-        typedef unordered_map<PlanCacheKey, PlanCacheEntry*>::const_iterator ConstIterator;
-        ConstIterator i = _cache.find(key);
+        EntryMap::iterator i = _cache.find(key);
         if (i != _cache.end()) {
-            PlanCacheEntry* previousEntry = i->second;
-            delete previousEntry;
+            _stats.replans++;
+            totalReplans.increment();
+            _erase(i);
         }
+        _lru.push_front(key);
+        entry->lruPosition = _lru.begin();
         _cache[key] = entry;
+        totalEntries.increment();
+        _resize(key, entry);
+        _evict();
 
         return Status::OK();
     }
@@ -480,11 +535,17 @@ namespace mongo {
         typedef unordered_map<PlanCacheKey, PlanCacheEntry*>::const_iterator ConstIterator;
         ConstIterator i = _cache.find(key);
         if (i == _cache.end()) {
+            _stats.misses++;
+            totalMisses.increment();
             return Status(ErrorCodes::BadValue, "no such key in cache");
         }
         PlanCacheEntry* entry = i->second;
         verify(entry);
 
+        _stats.hits++;
+        totalHits.increment();
+        _lru.splice(_lru.begin(), _lru, entry->lruPosition);
+
         *crOut = new CachedSolution(key, *entry);
 
         return Status::OK();
@@ -497,15 +558,12 @@ namespace mongo {
 
     Status PlanCache::remove(const PlanCacheKey& ck) {
         boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        typedef unordered_map<PlanCacheKey, PlanCacheEntry*>::const_iterator ConstIterator;
-        ConstIterator i = _cache.find(ck);
+        EntryMap::iterator i = _cache.find(ck);
         if (i == _cache.end()) {
             return Status(ErrorCodes::BadValue, "no such key in cache");
         }
-        PlanCacheEntry* entry = i->second;
-        verify(entry);
-        _cache.erase(i);
-        delete entry;
+        verify(i->second);
+        _erase(i);
         return Status::OK();
     }
 
@@ -530,6 +588,15 @@ namespace mongo {
         keys.swap(*keysOut);
     }
 
+    void PlanCache::getStats(Stats* statsOut) const {
+        verify(statsOut);
+
+        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+        *statsOut = _stats;
+        statsOut->entries = _cache.size();
+        statsOut->sizeBytes = _sizeBytes;
+    }
+
     Status PlanCache::pin(const PlanCacheKey& key, const PlanID& plan) {
         boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
         typedef unordered_map<PlanCacheKey, PlanCacheEntry*>::const_iterator ConstIterator;
@@ -589,6 +656,7 @@ namespace mongo {
         SolutionCacheData* scd = new SolutionCacheData();
         scd->tree.reset(new PlanCacheIndexTree());
         entry->plannerData.push_back(scd);
+        _resize(key, entry);
 
         *planOut = plan;
         return Status::OK();
@@ -658,7 +726,51 @@ namespace mongo {
             PlanCacheEntry* entry = i->second;
             delete entry;
         }
+        totalEntries.decrement(_cache.size());
+        totalSizeBytes.decrement(_sizeBytes);
         _cache.clear();
+        _lru.clear();
+        _sizeBytes = 0;
+    }
+
+    void PlanCache::_erase(EntryMap::iterator i) {
+        PlanCacheEntry* entry = i->second;
+        _lru.erase(entry->lruPosition);
+        _sizeBytes -= static_cast<long long>(entry->sizeBytes);
+        totalSizeBytes.decrement(entry->sizeBytes);
+        totalEntries.decrement();
+        _cache.erase(i);
+        delete entry;
+    }
+
+    void PlanCache::_resize(const PlanCacheKey& key, PlanCacheEntry* entry) {
+        size_t sizeBytes = entry->estimateSize(key);
+        _sizeBytes += static_cast<long long>(sizeBytes);
+        _sizeBytes -= static_cast<long long>(entry->sizeBytes);
+        totalSizeBytes.increment(sizeBytes);
+        totalSizeBytes.decrement(entry->sizeBytes);
+        entry->sizeBytes = sizeBytes;
+    }
+
+    void PlanCache::_evict() {
+        const size_t maxEntries = std::max(internalQueryPlanCacheMaxEntries, 1);
+        const long long maxSizeBytes = internalQueryPlanCacheMaxSizeBytes;
+
+        // Walk from the least recently used end, stopping before the front entry.
+        std::list<PlanCacheKey>::iterator it = _lru.end();
+        while ((_cache.size() > maxEntries || _sizeBytes > maxSizeBytes)
+               && --it != _lru.begin()) {
+            EntryMap::iterator i = _cache.find(*it);
+            verify(i != _cache.end());
+            if (i->second->pinned) {
+                continue;
+            }
+            // _erase() removes *it from the list, step past it first.
+            ++it;
+            _stats.evictions++;
+            totalEvictions.increment();
+            _erase(i);
+        }
     }
 
 }  // namespace mongo
@@ -28,10 +28,12 @@
 
 #pragma once
 
+#include <list>
 #include <set>
 #include <boost/optional/optional.hpp>
 #include <boost/thread/mutex.hpp>
 
+#include "mongo/base/counter.h"
 #include "mongo/db/exec/plan_stats.h"
 #include "mongo/db/query/canonical_query.h"
 #include "mongo/db/query/index_tag.h"
@@ -45,9 +47,19 @@ namespace mongo {
     struct QuerySolutionNode;
 
     /**
-     * TODO HK notes
+     * The most entries a collection's plan cache holds.  Adding to a full cache evicts the least
+     * recently used entries.
+     */
+    extern int internalQueryPlanCacheMaxEntries;
 
-     * cache should be LRU with some cap on size
+    /**
+     * The most bytes, as estimated by PlanCacheEntry::estimateSize(), a collection's plan cache
+     * holds before evicting the least recently used entries.
+     */
+    extern int internalQueryPlanCacheMaxSizeBytes;
+
+    /**
+     * TODO HK notes
 
      * write ops should invalidate but tell plan_cache there was a write op, don't enforce policy elsewhere,
        enforce here.
@@ -279,6 +291,17 @@ namespace mongo {
         BSONObj query;
         BSONObj sort;
         BSONObj projection;
+
+        /**
+         * Rough count of the bytes held by this entry when cached under 'key', used to bound the
+         * size of the cache.
+         */
+        size_t estimateSize(const PlanCacheKey& key) const;
+
+        // Maintained by the PlanCache: the last estimateSize() and the entry's position in the
+        // cache's LRU list.
+        size_t sizeBytes;
+        std::list<PlanCacheKey>::iterator lruPosition;
     };
 
     /**
@@ -297,6 +320,34 @@ namespace mongo {
          */
         static const int kPlanCacheMaxWriteOperations;
 
+        /**
+         * A snapshot of a cache's size and counters, reported by the planCacheStats command.
+         */
+        struct Stats {
+            Stats() : entries(0), sizeBytes(0), hits(0), misses(0), evictions(0), replans(0) { }
+
+            long long entries;
+            long long sizeBytes;
+
+            // Lookups by get() which did and did not find an entry.
+            long long hits;
+            long long misses;
+
+            // Least recently used entries dropped to stay within the size bounds.
+            long long evictions;
+
+            // Calls to add() replacing the entry of a query shape which was already cached.
+            long long replans;
+        };
+
+        // Totals over the plan caches of all collections, exported through serverStatus.
+        static Counter64 totalEntries;
+        static Counter64 totalSizeBytes;
+        static Counter64 totalHits;
+        static Counter64 totalMisses;
+        static Counter64 totalEvictions;
+        static Counter64 totalReplans;
+
         /**
          * We don't want to cache every possible query. This function
          * encapsulates the criteria for what makes a canonical query
@@ -317,7 +368,7 @@ namespace mongo {
          */
         static PlanCacheKey getPlanCacheKey(const CanonicalQuery& query);
 
-        PlanCache() { }
+        PlanCache() : _sizeBytes(0) { }
 
         ~PlanCache();
 
@@ -329,6 +380,10 @@ namespace mongo {
          *
          * Takes ownership of 'why'.
          *
+         * The new entry becomes the most recently used, and the least recently used unpinned
+         * entries are evicted while the cache is over internalQueryPlanCacheMaxEntries or
+         * internalQueryPlanCacheMaxSizeBytes.
+         *
          * If the mapping was added successfully, returns Status::OK().
          * If the mapping already existed or some other error occurred, returns another Status.
          */
@@ -353,7 +408,7 @@ namespace mongo {
          * If there is no entry in the cache for the 'query', returns an error Status.
          *
          * If there is an entry in the cache, populates 'crOut' and returns Status::OK().  Caller
-         * owns '*crOut'.
+         * owns '*crOut'.  The entry becomes the most recently used.
          */
         Status get(const PlanCacheKey& key, CachedSolution** crOut) const;
 
@@ -394,6 +449,11 @@ namespace mongo {
          */
         void getKeys(std::vector<PlanCacheKey>* keysOut) const;
 
+        /**
+         * Fills in 'statsOut' with the current size and counters of the cache.
+         */
+        void getStats(Stats* statsOut) const;
+
         /**
          * Pins plan on a query in the cache. Subsequent cached solutions
          * will be generated based on the pinned plan.
@@ -422,6 +482,7 @@ namespace mongo {
         void notifyOfWriteOp();
 
     private:
+        typedef unordered_map<PlanCacheKey, PlanCacheEntry*> EntryMap;
 
         /**
          * Releases resources associated with each cache entry
@@ -430,10 +491,36 @@ namespace mongo {
          */
         void _clear();
 
-        unordered_map<PlanCacheKey, PlanCacheEntry*> _cache;
+        /**
+         * Removes the entry at 'i' from the map and the LRU list and deletes it.
+         */
+        void _erase(EntryMap::iterator i);
+
+        /**
+         * Re-estimates the size of 'entry' after it changed.
+         */
+        void _resize(const PlanCacheKey& key, PlanCacheEntry* entry);
+
+        /**
+         * Evicts unpinned entries from the back of the LRU list, never the most recently used
+         * one, until the cache is within its bounds.
+         */
+        void _evict();
+
+        EntryMap _cache;
+
+        // Keys of all entries in _cache, most recently used first.  get() reorders it, hence
+        // mutable.
+        mutable std::list<PlanCacheKey> _lru;
+
+        // Sum of the sizeBytes of all entries.
+        long long _sizeBytes;
+
+        // Counters reported by getStats().  Mutable as get() counts hits and misses.
+        mutable Stats _stats;
 
         /**
-         * Protects _cache.
+         * Protects _cache, _lru, _sizeBytes and _stats.
          */
         mutable boost::mutex _cacheMutex;
 
@@ -401,6 +401,136 @@ namespace {
         planCache.getKeys(&keys);
         ASSERT_EQUALS(keys.size(), 1U);
     }
+
+    /**
+     * Sets the plan cache bounds for the lifetime of a test.
+     */
+    class PlanCacheBounds {
+    public:
+        PlanCacheBounds(int maxEntries, int maxSizeBytes)
+            : _oldMaxEntries(internalQueryPlanCacheMaxEntries),
+              _oldMaxSizeBytes(internalQueryPlanCacheMaxSizeBytes) {
+            internalQueryPlanCacheMaxEntries = maxEntries;
+            internalQueryPlanCacheMaxSizeBytes = maxSizeBytes;
+        }
+        ~PlanCacheBounds() {
+            internalQueryPlanCacheMaxEntries = _oldMaxEntries;
+            internalQueryPlanCacheMaxSizeBytes = _oldMaxSizeBytes;
+        }
+    private:
+        int _oldMaxEntries;
+        int _oldMaxSizeBytes;
+    };
+
+    void addQuery(PlanCache* planCache, const char* queryStr) {
+        auto_ptr<CanonicalQuery> cq(canonicalize(queryStr));
+        QuerySolution qs;
+        qs.cacheData.reset(new SolutionCacheData());
+        qs.cacheData->tree.reset(new PlanCacheIndexTree());
+        std::vector<QuerySolution*> solns;
+        solns.push_back(&qs);
+        ASSERT_OK(planCache->add(*cq, solns, new PlanRankingDecision()));
+    }
+
+    bool isCached(const PlanCache& planCache, const char* queryStr) {
+        auto_ptr<CanonicalQuery> cq(canonicalize(queryStr));
+        std::vector<PlanCacheKey> keys;
+        planCache.getKeys(&keys);
+        PlanCacheKey key = PlanCache::getPlanCacheKey(*cq);
+        return std::find(keys.begin(), keys.end(), key) != keys.end();
+    }
+
+    void lookUp(const PlanCache& planCache, const char* queryStr) {
+        auto_ptr<CanonicalQuery> cq(canonicalize(queryStr));
+        CachedSolution* rawCS;
+        if (planCache.get(*cq, &rawCS).isOK()) {
+            delete rawCS;
+        }
+    }
+
+    TEST(PlanCacheTest, EvictLeastRecentlyUsedEntry) {
+        PlanCacheBounds bounds(3, 1024 * 1024);
+        PlanCache planCache;
+        addQuery(&planCache, "{a: 1}");
+        addQuery(&planCache, "{b: 1}");
+        addQuery(&planCache, "{c: 1}");
+
+        // Looking up {a: 1} leaves {b: 1} the least recently used.
+        lookUp(planCache, "{a: 1}");
+        addQuery(&planCache, "{d: 1}");
+
+        ASSERT_TRUE(isCached(planCache, "{a: 1}"));
+        ASSERT_FALSE(isCached(planCache, "{b: 1}"));
+        ASSERT_TRUE(isCached(planCache, "{c: 1}"));
+        ASSERT_TRUE(isCached(planCache, "{d: 1}"));
+
+        PlanCache::Stats stats;
+        planCache.getStats(&stats);
+        ASSERT_EQUALS(3, stats.entries);
+        ASSERT_EQUALS(1, stats.evictions);
+        ASSERT_EQUALS(1, stats.hits);
+    }
+
+    TEST(PlanCacheTest, PinnedEntryIsNotEvicted) {
+        PlanCacheBounds bounds(2, 1024 * 1024);
+        PlanCache planCache;
+        addQuery(&planCache, "{a: 1}");
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        ASSERT_OK(planCache.pin(PlanCache::getPlanCacheKey(*cq), "plan0"));
+        addQuery(&planCache, "{b: 1}");
+        addQuery(&planCache, "{c: 1}");
+
+        ASSERT_TRUE(isCached(planCache, "{a: 1}"));
+        ASSERT_FALSE(isCached(planCache, "{b: 1}"));
+        ASSERT_TRUE(isCached(planCache, "{c: 1}"));
+    }
+
+    TEST(PlanCacheTest, EvictBySize) {
+        PlanCache planCache;
+        addQuery(&planCache, "{a: 1}");
+        PlanCache::Stats stats;
+        planCache.getStats(&stats);
+        ASSERT_EQUALS(1, stats.entries);
+        ASSERT_GREATER_THAN(stats.sizeBytes, 0);
+
+        // Room for about two entries: the third add evicts the first.
+        PlanCacheBounds bounds(1000, static_cast<int>(stats.sizeBytes * 5 / 2));
+        addQuery(&planCache, "{b: 1}");
+        addQuery(&planCache, "{c: 1}");
+        ASSERT_FALSE(isCached(planCache, "{a: 1}"));
+        ASSERT_TRUE(isCached(planCache, "{b: 1}"));
+        ASSERT_TRUE(isCached(planCache, "{c: 1}"));
+
+        // The most recently added entry is kept even if it alone is over the bound.
+        PlanCacheBounds tinyBounds(1000, 1);
+        addQuery(&planCache, "{d: 1}");
+        planCache.getStats(&stats);
+        ASSERT_EQUALS(1, stats.entries);
+        ASSERT_TRUE(isCached(planCache, "{d: 1}"));
+
+        planCache.clear();
+        planCache.getStats(&stats);
+        ASSERT_EQUALS(0, stats.entries);
+        ASSERT_EQUALS(0, stats.sizeBytes);
+        ASSERT_EQUALS(3, stats.evictions);
+    }
+
+    TEST(PlanCacheTest, StatsCounters) {
+        PlanCache planCache;
+        lookUp(planCache, "{a: 1}");
+        addQuery(&planCache, "{a: 1}");
+        lookUp(planCache, "{a: 1}");
+        lookUp(planCache, "{a: 1}");
+        addQuery(&planCache, "{a: 1}");
+
+        PlanCache::Stats stats;
+        planCache.getStats(&stats);
+        ASSERT_EQUALS(1, stats.entries);
+        ASSERT_EQUALS(2, stats.hits);
+        ASSERT_EQUALS(1, stats.misses);
+        ASSERT_EQUALS(1, stats.replans);
+        ASSERT_EQUALS(0, stats.evictions);
+    }
     /**
      * Test functions for getPlanCacheKey.
      * Cache keys are intentionally obfuscated and are meaningful only
@@ -0,0 +1,219 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/db/query/plan_cost.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "mongo/db/query/qlog.h"
+#include "mongo/db/server_parameters.h"
+
+namespace mongo {
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlanCostPruneFactor, int, 10);
+
+    const double PlanCostModel::kMinPrunedCost = 1000;
+
+    /**
+     * What a subtree of a solution examines, and how many results it passes up.
+     */
+    struct PlanCostModel::NodeEstimate {
+        NodeEstimate() : nScanned(0), nScannedObjects(0), sortWork(0), results(0) { }
+
+        double nScanned;
+        double nScannedObjects;
+        double sortWork;
+        double results;
+    };
+
+    PlanCostModel::PlanCostModel(long long numRecords) : _numRecords(numRecords) { }
+
+    void PlanCostModel::addIndexStatistics(const boost::shared_ptr<const IndexStatistics>& stats) {
+        _indexStats.push_back(stats);
+    }
+
+    // static
+    void PlanCostModel::getIndexesScanned(const QuerySolution& soln, BSONObjSet* keyPatternsOut) {
+        std::vector<const QuerySolutionNode*> toVisit;
+        if (NULL != soln.root.get()) {
+            toVisit.push_back(soln.root.get());
+        }
+        while (!toVisit.empty()) {
+            const QuerySolutionNode* node = toVisit.back();
+            toVisit.pop_back();
+            if (STAGE_IXSCAN == node->getType()) {
+                keyPatternsOut->insert(static_cast<const IndexScanNode*>(node)->indexKeyPattern);
+            }
+            toVisit.insert(toVisit.end(), node->children.begin(), node->children.end());
+        }
+    }
+
+    bool PlanCostModel::estimate(QuerySolution* soln) const {
+        soln->estimate = QuerySolutionEstimate();
+
+        NodeEstimate est;
+        if (NULL == soln->root.get() || !_estimateNode(soln->root.get(), &est)) {
+            return false;
+        }
+
+        soln->estimate.nScanned = est.nScanned;
+        soln->estimate.nScannedObjects = est.nScannedObjects;
+        soln->estimate.cost = est.nScanned + est.nScannedObjects + est.sortWork;
+        return true;
+    }
+
+    size_t PlanCostModel::prune(const CanonicalQuery& query,
+                                std::vector<QuerySolution*>* solutions) const {
+        bool allEstimated = true;
+        double cheapest = -1;
+        for (size_t i = 0; i < solutions->size(); ++i) {
+            QuerySolution* soln = (*solutions)[i];
+            if (!estimate(soln)) {
+                allEstimated = false;
+                continue;
+            }
+            QLOG() << "estimated cost " << soln->estimate.cost << " of solution:\n"
+                   << soln->toString() << endl;
+            if (cheapest < 0 || soln->estimate.cost < cheapest) {
+                cheapest = soln->estimate.cost;
+            }
+        }
+
+        if (!allEstimated || internalQueryPlanCostPruneFactor <= 0) {
+            return 0;
+        }
+
+        const double maxCost = std::max(cheapest * internalQueryPlanCostPruneFactor,
+                                        kMinPrunedCost);
+        const bool sorted = !query.getParsed().getSort().isEmpty();
+
+        std::vector<QuerySolution*> kept;
+        for (size_t i = 0; i < solutions->size(); ++i) {
+            QuerySolution* soln = (*solutions)[i];
+            if (soln->estimate.cost <= maxCost || (sorted && !soln->hasSortStage)) {
+                kept.push_back(soln);
+                continue;
+            }
+            QLOG() << "pruning solution estimated to cost " << soln->estimate.cost
+                   << ", the cheapest costs " << cheapest << ":\n" << soln->toString() << endl;
+            delete soln;
+        }
+
+        size_t pruned = solutions->size() - kept.size();
+        solutions->swap(kept);
+        return pruned;
+    }
+
+    bool PlanCostModel::_estimateNode(const QuerySolutionNode* node, NodeEstimate* out) const {
+        std::vector<NodeEstimate> children(node->children.size());
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            if (!_estimateNode(node->children[i], &children[i])) {
+                return false;
+            }
+            out->nScanned += children[i].nScanned;
+            out->nScannedObjects += children[i].nScannedObjects;
+            out->sortWork += children[i].sortWork;
+        }
+
+        switch (node->getType()) {
+        case STAGE_COLLSCAN:
+            out->nScanned += _numRecords;
+            out->nScannedObjects += _numRecords;
+            out->results = _numRecords;
+            return true;
+
+        case STAGE_IXSCAN: {
+            const IndexScanNode* ixn = static_cast<const IndexScanNode*>(node);
+            const IndexStatistics* stats = _findStatistics(ixn->indexKeyPattern);
+            if (NULL == stats) {
+                return false;
+            }
+            double keys = stats->estimateKeys(ixn->bounds, ixn->direction);
+            out->nScanned += keys;
+            out->results = keys;
+            return true;
+        }
+
+        case STAGE_FETCH:
+            out->nScannedObjects += children[0].results;
+            out->results = children[0].results;
+            return true;
+
+        case STAGE_AND_HASH:
+        case STAGE_AND_SORTED:
+            out->results = children[0].results;
+            for (size_t i = 1; i < children.size(); ++i) {
+                out->results = std::min(out->results, children[i].results);
+            }
+            return true;
+
+        case STAGE_OR:
+        case STAGE_SORT_MERGE:
+            for (size_t i = 0; i < children.size(); ++i) {
+                out->results += children[i].results;
+            }
+            return true;
+
+        case STAGE_SORT: {
+            const SortNode* sn = static_cast<const SortNode*>(node);
+            double input = children[0].results;
+            double kept = sn->limit > 0 ? std::min(input, static_cast<double>(sn->limit)) : input;
+            out->sortWork += input * std::log(std::max(kept, 2.0)) / std::log(2.0);
+            out->results = kept;
+            return true;
+        }
+
+        case STAGE_LIMIT: {
+            const LimitNode* ln = static_cast<const LimitNode*>(node);
+            out->results = std::min(children[0].results, static_cast<double>(ln->limit));
+            return true;
+        }
+
+        case STAGE_PROJECTION:
+        case STAGE_SHARDING_FILTER:
+        case STAGE_SKIP:
+            out->results = children[0].results;
+            return true;
+
+        default:
+            // Text and geo stages find their own way through their indexes.
+            return false;
+        }
+    }
+
+    const IndexStatistics* PlanCostModel::_findStatistics(const BSONObj& keyPattern) const {
+        for (size_t i = 0; i < _indexStats.size(); ++i) {
+            if (_indexStats[i]->getKeyPattern().binaryEqual(keyPattern)) {
+                return _indexStats[i].get();
+            }
+        }
+        return NULL;
+    }
+
+}  // namespace mongo
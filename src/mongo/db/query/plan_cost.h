@@ -0,0 +1,100 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/index_statistics.h"
+#include "mongo/db/query/query_solution.h"
+
+namespace mongo {
+
+    /**
+     * Candidates estimated to cost more than this many times the cheapest one are pruned before
+     * the candidates are raced.  0 disables pruning.
+     */
+    extern int internalQueryPlanCostPruneFactor;
+
+    /**
+     * Estimates what running a QuerySolution costs from statistics about the indexes it scans:
+     * how many index keys and documents it examines, plus the work of any blocking sort.
+     *
+     * The estimates ignore filters and limits, so they are only good enough to drop candidates
+     * which are clearly worse than the best one and spare running them in the plan race.
+     */
+    class PlanCostModel {
+    public:
+        /**
+         * Candidates estimated to cost less than this are never pruned, as racing them is cheap.
+         */
+        static const double kMinPrunedCost;
+
+        explicit PlanCostModel(long long numRecords);
+
+        /**
+         * Statistics for the index with 'stats->getKeyPattern()', for estimating scans of it.
+         */
+        void addIndexStatistics(const boost::shared_ptr<const IndexStatistics>& stats);
+
+        /**
+         * Adds to 'keyPatternsOut' the key patterns of the indexes that 'soln' scans.
+         */
+        static void getIndexesScanned(const QuerySolution& soln, BSONObjSet* keyPatternsOut);
+
+        /**
+         * Fills in the estimate of 'soln'.  Returns false, leaving no estimate, if the solution
+         * has a stage the model can't estimate or scans an index without statistics.
+         */
+        bool estimate(QuerySolution* soln) const;
+
+        /**
+         * Estimates every candidate in 'solutions' and deletes those that cost more than
+         * internalQueryPlanCostPruneFactor times the cheapest.  Nothing is pruned unless every
+         * candidate could be estimated, the cheapest candidate is always kept, and when 'query'
+         * is sorted so is every candidate that gets the sort from an index, as a limit may stop
+         * it early.
+         *
+         * Returns the number of candidates pruned.
+         */
+        size_t prune(const CanonicalQuery& query, std::vector<QuerySolution*>* solutions) const;
+
+    private:
+        struct NodeEstimate;
+
+        bool _estimateNode(const QuerySolutionNode* node, NodeEstimate* out) const;
+
+        const IndexStatistics* _findStatistics(const BSONObj& keyPattern) const;
+
+        long long _numRecords;
+        std::vector<boost::shared_ptr<const IndexStatistics> > _indexStats;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,190 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+/**
+ * This file contains tests for mongo/db/query/plan_cost.h and index_statistics.h
+ */
+
+#include "mongo/db/query/plan_cost.h"
+
+#include <memory>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/json.h"
+#include "mongo/db/query/canonical_query.h"
+#include "mongo/db/query/index_statistics.h"
+#include "mongo/db/query/query_planner.h"
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    using std::auto_ptr;
+    using std::vector;
+
+    static const char* ns = "somebogusns";
+
+    /**
+     * Statistics for an index over the keys 0..numKeys-1, sampling every 'step'th one.
+     */
+    boost::shared_ptr<const IndexStatistics> makeStatistics(const BSONObj& keyPattern,
+                                                            long long numKeys,
+                                                            int step) {
+        vector<BSONObj> samples;
+        for (long long i = 0; i < numKeys; i += step) {
+            samples.push_back(BSON("" << i));
+        }
+        return boost::shared_ptr<const IndexStatistics>(
+            new IndexStatistics(keyPattern, numKeys, samples));
+    }
+
+    IndexBounds makeBounds(long long low, long long high) {
+        OrderedIntervalList oil("a");
+        oil.intervals.push_back(Interval(BSON("" << low << "" << high), true, true));
+        IndexBounds bounds;
+        bounds.fields.push_back(oil);
+        return bounds;
+    }
+
+    TEST(IndexStatisticsTest, ExactWhenEveryKeyIsSampled) {
+        boost::shared_ptr<const IndexStatistics> stats = makeStatistics(BSON("a" << 1), 100, 1);
+        ASSERT_EQUALS(11.0, stats->estimateKeys(makeBounds(10, 20), 1));
+        ASSERT_EQUALS(0.0, stats->estimateKeys(makeBounds(200, 300), 1));
+        ASSERT_EQUALS(100.0, stats->estimateKeys(makeBounds(0, 1000), 1));
+    }
+
+    TEST(IndexStatisticsTest, ExtrapolatesFromSamples) {
+        // 100 samples standing for 10000 keys
+        boost::shared_ptr<const IndexStatistics> stats =
+            makeStatistics(BSON("a" << 1), 10000, 100);
+
+        double estimate = stats->estimateKeys(makeBounds(0, 999), 1);
+        ASSERT_GREATER_THAN(estimate, 500);
+        ASSERT_LESS_THAN(estimate, 2000);
+
+        // bounds between two samples still cost something
+        estimate = stats->estimateKeys(makeBounds(10, 20), 1);
+        ASSERT_GREATER_THAN(estimate, 0);
+        ASSERT_LESS_THAN(estimate, 100);
+
+        estimate = stats->estimateKeys(makeBounds(0, 100000), 1);
+        ASSERT_GREATER_THAN(estimate, 9000);
+        ASSERT_LESS_THAN_OR_EQUALS(estimate, 10000);
+    }
+
+    /**
+     * Plans the query against the indexes { a: 1 } and { b: 1 }.
+     */
+    class PlanCostModelTest : public mongo::unittest::Test {
+    protected:
+        void tearDown() {
+            for (size_t i = 0; i < solns.size(); ++i) {
+                delete solns[i];
+            }
+        }
+
+        void plan(const char* queryStr, const char* sortStr = "{}") {
+            CanonicalQuery* rawCq;
+            ASSERT_OK(CanonicalQuery::canonicalize(ns, fromjson(queryStr), fromjson(sortStr),
+                                                   BSONObj(), &rawCq));
+            cq.reset(rawCq);
+
+            QueryPlannerParams params;
+            params.options = QueryPlannerParams::INCLUDE_COLLSCAN;
+            params.indices.push_back(IndexEntry(BSON("a" << 1), false, false, "a_1"));
+            params.indices.push_back(IndexEntry(BSON("b" << 1), false, false, "b_1"));
+            ASSERT_OK(QueryPlanner::plan(*cq, params, &solns));
+        }
+
+        auto_ptr<CanonicalQuery> cq;
+        vector<QuerySolution*> solns;
+    };
+
+    TEST_F(PlanCostModelTest, PrunesExpensiveCandidates) {
+        PlanCostModel model(100000);
+        model.addIndexStatistics(makeStatistics(BSON("a" << 1), 100000, 1000));
+        model.addIndexStatistics(makeStatistics(BSON("b" << 1), 100000, 1000));
+
+        // a is selective, b matches nearly every key
+        plan("{a: {$gte: 5, $lte: 10}, b: {$gte: 0}}");
+        ASSERT_EQUALS(2U, solns.size());
+
+        ASSERT_EQUALS(1U, model.prune(*cq, &solns));
+        ASSERT_EQUALS(1U, solns.size());
+        ASSERT(solns[0]->estimate.isSet());
+
+        BSONObjSet keyPatterns;
+        PlanCostModel::getIndexesScanned(*solns[0], &keyPatterns);
+        ASSERT_EQUALS(1U, keyPatterns.size());
+        ASSERT_EQUALS(BSON("a" << 1), *keyPatterns.begin());
+    }
+
+    TEST_F(PlanCostModelTest, KeepsEverythingWithoutStatistics) {
+        PlanCostModel model(100000);
+        model.addIndexStatistics(makeStatistics(BSON("a" << 1), 100000, 1000));
+
+        plan("{a: {$gte: 5, $lte: 10}, b: {$gte: 0}}");
+        ASSERT_EQUALS(2U, solns.size());
+        ASSERT_EQUALS(0U, model.prune(*cq, &solns));
+        ASSERT_EQUALS(2U, solns.size());
+    }
+
+    TEST_F(PlanCostModelTest, KeepsCheapCandidates) {
+        // nothing costs enough to be worth pruning
+        PlanCostModel model(100);
+        model.addIndexStatistics(makeStatistics(BSON("a" << 1), 100, 1));
+        model.addIndexStatistics(makeStatistics(BSON("b" << 1), 100, 1));
+
+        plan("{a: {$gte: 5, $lte: 10}, b: {$gte: 0}}");
+        ASSERT_EQUALS(2U, solns.size());
+        ASSERT_EQUALS(0U, model.prune(*cq, &solns));
+    }
+
+    TEST_F(PlanCostModelTest, KeepsCandidatesProvidingTheSort) {
+        PlanCostModel model(100000);
+        model.addIndexStatistics(makeStatistics(BSON("a" << 1), 100000, 1000));
+        model.addIndexStatistics(makeStatistics(BSON("b" << 1), 100000, 1000));
+
+        // the scan of b provides the sort, and a limit could stop it early
+        plan("{a: {$gte: 5, $lte: 10}, b: {$gte: 0}}", "{b: 1}");
+        size_t numSolns = solns.size();
+        ASSERT_GREATER_THAN(numSolns, 1U);
+        model.prune(*cq, &solns);
+
+        bool keptUnsorted = false;
+        for (size_t i = 0; i < solns.size(); ++i) {
+            if (!solns[i]->hasSortStage) {
+                keptUnsorted = true;
+            }
+        }
+        ASSERT(keptUnsorted);
+    }
+
+}  // namespace
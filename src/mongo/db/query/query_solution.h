@@ -148,6 +148,25 @@ namespace mongo {
         MONGO_DISALLOW_COPYING(QuerySolutionNode);
     };
 
+    /**
+     * What the PlanCostModel expects running a solution to examine, for comparison with what
+     * it actually examined.  Negative values mean no estimate was made.
+     */
+    struct QuerySolutionEstimate {
+        QuerySolutionEstimate() : nScanned(-1), nScannedObjects(-1), cost(-1) { }
+
+        bool isSet() const { return cost >= 0; }
+
+        // Index keys plus documents scanned, as explain's nscanned.
+        double nScanned;
+
+        // Documents examined, as explain's nscannedObjects.
+        double nScannedObjects;
+
+        // What the candidates are ranked by: everything examined plus any sorting work.
+        double cost;
+    };
+
     /**
      * A QuerySolution must be entirely self-contained and own everything inside of it.
      *
@@ -172,6 +191,9 @@ namespace mongo {
         // Owned here. Used by the plan cache.
         boost::scoped_ptr<SolutionCacheData> cacheData;
 
+        // Filled in by the PlanCostModel before the candidate solutions are raced.
+        QuerySolutionEstimate estimate;
+
         /**
          * Output a human-readable string representing the plan.
          */
@@ -98,11 +98,13 @@ namespace mongo {
         if (!status.isOK()) {
             return status;
         }
+        explainEstimate(_solution->estimate, *explain);
 
         // Fill in explain fields that are accounted by on the runner level.
         TypeExplain* chosenPlan = NULL;
         explainPlan(*stats, &chosenPlan, false /* no full details */);
         if (chosenPlan) {
+            explainEstimate(_solution->estimate, chosenPlan);
             (*explain)->addToAllPlans(chosenPlan);
         }
         (*explain)->setNScannedObjectsAllPlans((*explain)->getNScannedObjects());
@@ -45,6 +45,8 @@ namespace mongo {
     const BSONField<long long> TypeExplain::nScanned("nscanned", 0);
     const BSONField<long long> TypeExplain::nScannedObjectsAllPlans("nscannedObjectsAllPlans");
     const BSONField<long long> TypeExplain::nScannedAllPlans("nscannedAllPlans");
+    const BSONField<long long> TypeExplain::nScannedEstimate("nscannedEstimate");
+    const BSONField<long long> TypeExplain::nScannedObjectsEstimate("nscannedObjectsEstimate");
     const BSONField<bool> TypeExplain::scanAndOrder("scanAndOrder");
     const BSONField<bool> TypeExplain::indexOnly("indexOnly");
     const BSONField<long long> TypeExplain::nYields("nYields");
@@ -133,6 +135,11 @@ namespace mongo {
 
         if (_isNScannedAllPlansSet) builder.appendNumber(nScannedAllPlans(), _nScannedAllPlans);
 
+        if (_isNScannedEstimateSet) builder.appendNumber(nScannedEstimate(), _nScannedEstimate);
+
+        if (_isNScannedObjectsEstimateSet)
+            builder.appendNumber(nScannedObjectsEstimate(), _nScannedObjectsEstimate);
+
         if (_isScanAndOrderSet) builder.append(scanAndOrder(), _scanAndOrder);
 
         if (_isIndexOnlySet) builder.append(indexOnly(), _indexOnly);
@@ -212,6 +219,17 @@ namespace mongo {
         if (fieldState == FieldParser::FIELD_INVALID) return false;
         _isNScannedAllPlansSet = fieldState == FieldParser::FIELD_SET;
 
+        fieldState = FieldParser::extract(source, nScannedEstimate, &_nScannedEstimate, errMsg);
+        if (fieldState == FieldParser::FIELD_INVALID) return false;
+        _isNScannedEstimateSet = fieldState == FieldParser::FIELD_SET;
+
+        fieldState = FieldParser::extract(source,
+                                          nScannedObjectsEstimate,
+                                          &_nScannedObjectsEstimate,
+                                          errMsg);
+        if (fieldState == FieldParser::FIELD_INVALID) return false;
+        _isNScannedObjectsEstimateSet = fieldState == FieldParser::FIELD_SET;
+
         fieldState = FieldParser::extract(source, scanAndOrder, &_scanAndOrder, errMsg);
         if (fieldState == FieldParser::FIELD_INVALID) return false;
         _isScanAndOrderSet = fieldState == FieldParser::FIELD_SET;
@@ -277,6 +295,12 @@ namespace mongo {
         _nScannedAllPlans = 0;
         _isNScannedAllPlansSet = false;
 
+        _nScannedEstimate = 0;
+        _isNScannedEstimateSet = false;
+
+        _nScannedObjectsEstimate = 0;
+        _isNScannedObjectsEstimateSet = false;
+
         _scanAndOrder = false;
         _isScanAndOrderSet = false;
 
@@ -342,6 +366,12 @@ namespace mongo {
         other->_nScannedAllPlans = _nScannedAllPlans;
         other->_isNScannedAllPlansSet = _isNScannedAllPlansSet;
 
+        other->_nScannedEstimate = _nScannedEstimate;
+        other->_isNScannedEstimateSet = _isNScannedEstimateSet;
+
+        other->_nScannedObjectsEstimate = _nScannedObjectsEstimate;
+        other->_isNScannedObjectsEstimateSet = _isNScannedObjectsEstimateSet;
+
         other->_scanAndOrder = _scanAndOrder;
         other->_isScanAndOrderSet = _isScanAndOrderSet;
 
@@ -564,6 +594,42 @@ namespace mongo {
         return _nScannedAllPlans;
     }
 
+    void TypeExplain::setNScannedEstimate(long long nScannedEstimate) {
+        _nScannedEstimate = nScannedEstimate;
+        _isNScannedEstimateSet = true;
+    }
+
+    void TypeExplain::unsetNScannedEstimate() {
+        _isNScannedEstimateSet = false;
+    }
+
+    bool TypeExplain::isNScannedEstimateSet() const {
+        return _isNScannedEstimateSet;
+    }
+
+    long long TypeExplain::getNScannedEstimate() const {
+        verify(_isNScannedEstimateSet);
+        return _nScannedEstimate;
+    }
+
+    void TypeExplain::setNScannedObjectsEstimate(long long nScannedObjectsEstimate) {
+        _nScannedObjectsEstimate = nScannedObjectsEstimate;
+        _isNScannedObjectsEstimateSet = true;
+    }
+
+    void TypeExplain::unsetNScannedObjectsEstimate() {
+        _isNScannedObjectsEstimateSet = false;
+    }
+
+    bool TypeExplain::isNScannedObjectsEstimateSet() const {
+        return _isNScannedObjectsEstimateSet;
+    }
+
+    long long TypeExplain::getNScannedObjectsEstimate() const {
+        verify(_isNScannedObjectsEstimateSet);
+        return _nScannedObjectsEstimate;
+    }
+
     void TypeExplain::setScanAndOrder(bool scanAndOrder) {
         _scanAndOrder = scanAndOrder;
         _isScanAndOrderSet = true;
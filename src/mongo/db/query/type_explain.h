@@ -55,6 +55,8 @@ namespace mongo {
         static const BSONField<long long> nScanned;
         static const BSONField<long long> nScannedObjectsAllPlans;
         static const BSONField<long long> nScannedAllPlans;
+        static const BSONField<long long> nScannedEstimate;
+        static const BSONField<long long> nScannedObjectsEstimate;
         static const BSONField<bool> scanAndOrder;
         static const BSONField<bool> indexOnly;
         static const BSONField<long long> nYields;
@@ -132,6 +134,16 @@ namespace mongo {
         bool isNScannedAllPlansSet() const;
         long long getNScannedAllPlans() const;
 
+        void setNScannedEstimate(long long nScannedEstimate);
+        void unsetNScannedEstimate();
+        bool isNScannedEstimateSet() const;
+        long long getNScannedEstimate() const;
+
+        void setNScannedObjectsEstimate(long long nScannedObjectsEstimate);
+        void unsetNScannedObjectsEstimate();
+        bool isNScannedObjectsEstimateSet() const;
+        long long getNScannedObjectsEstimate() const;
+
         void setScanAndOrder(bool scanAndOrder);
         void unsetScanAndOrder();
         bool isScanAndOrderSet() const;
@@ -222,6 +234,14 @@ namespace mongo {
         long long _nScannedAllPlans;
         bool _isNScannedAllPlansSet;
 
+        // (O)  number of entries the plan cost model expected to retrieve
+        long long _nScannedEstimate;
+        bool _isNScannedEstimateSet;
+
+        // (O)  number of documents the plan cost model expected to fetch
+        long long _nScannedObjectsEstimate;
+        bool _isNScannedObjectsEstimateSet;
+
         // (O)  whether this plan involved sorting
         bool _scanAndOrder;
         bool _isScanAndOrderSet;
@@ -35,7 +35,9 @@
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/rs_sync.h"
 #include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/fail_point_service.h"
+#include "mongo/util/timer.h"
 #include "mongo/base/counter.h"
 #include "mongo/db/stats/timer_stats.h"
 
@@ -47,6 +49,10 @@ namespace replset {
 
     MONGO_FP_DECLARE(rsBgSyncProduce);
 
+    // getMores kept in flight to the sync source ahead of the one being waited for, so the next
+    // batches are on the network while the current one is queued; 0 waits for each in turn
+    MONGO_EXPORT_SERVER_PARAMETER(replGetMoresAhead, int, 2);
+
     BackgroundSync* BackgroundSync::s_instance = 0;
     boost::mutex BackgroundSync::s_mutex;
 
@@ -63,6 +69,14 @@ namespace replset {
     static Counter64 networkByteStats;
     static ServerStatusMetricField<Counter64> displayBytesRead( "repl.network.bytes",
                                                                 &networkByteStats );
+    //The rate of bytes read via the oplog reader, measured over a second or more
+    static long long networkBytesPerSecGauge = 0;
+    static ServerStatusMetricField<long long> displayBytesPerSec( "repl.network.bytesPerSecond",
+                                                                  &networkBytesPerSecGauge );
+    //How far the last op fetched is behind the sync source's last op, as of its heartbeat
+    static int networkLagSecsGauge = 0;
+    static ServerStatusMetricField<int> displayLagSecs( "repl.network.lagSecs",
+                                                        &networkLagSecsGauge );
 
     //The count of items in the buffer
     static Counter64 bufferCountGauge;
@@ -85,6 +99,11 @@ namespace replset {
         return static_cast<size_t>(o.objsize());
     }
 
+    static int lagSecs(const OpTime& sourceLastOp, const OpTime& lastFetched) {
+        return std::max(0, static_cast<int>(sourceLastOp.getSecs()) -
+                           static_cast<int>(lastFetched.getSecs()));
+    }
+
     BackgroundSync::BackgroundSync() : _buffer(bufferMaxSizeGauge, &getSize),
                                        _lastOpTimeFetched(0, 0),
                                        _lastH(0),
@@ -361,6 +380,14 @@ namespace replset {
             return;
         }
 
+        if (replGetMoresAhead > 0) {
+            r.setGetMoresAhead(replGetMoresAhead);
+        }
+
+        Timer rateTimer;
+        long long rateBytes = 0;
+        std::vector<BSONObj> ops;
+
         while (!inShutdown()) {
             if (!r.moreInCurrentBatch()) {
                 // Check some things periodically
@@ -406,6 +433,13 @@ namespace replset {
                 }
                 networkByteStats.increment(r.currentBatchMessageSize());
 
+                rateBytes += r.currentBatchMessageSize();
+                if (rateTimer.millis() >= 1000) {
+                    networkBytesPerSecGauge = rateBytes * 1000 / rateTimer.millis();
+                    rateBytes = 0;
+                    rateTimer.reset();
+                }
+
                 if (!r.moreInCurrentBatch()) {
                     // If there is still no data from upstream, check a few more things
                     // and then loop back for another pass at getting more data
@@ -416,6 +450,8 @@ namespace replset {
                             !_currentSyncTarget->hbinfo().hbstate.readable()) {
                             return;
                         }
+                        networkLagSecsGauge = lagSecs(_currentSyncTarget->hbinfo().opTime,
+                                                      _lastOpTimeFetched);
                     }
 
                     r.tailCheck();
@@ -429,9 +465,14 @@ namespace replset {
             }
 
             // At this point, we are guaranteed to have at least one thing to read out
-            // of the oplogreader cursor.
-            BSONObj o = r.nextSafe().getOwned();
-            opsReadStats.increment();
+            // of the oplogreader cursor.  The rest of the batch is queued along with it.
+            ops.clear();
+            size_t opsBytes = 0;
+            while (r.moreInCurrentBatch()) {
+                ops.push_back(r.nextSafe().getOwned());
+                opsBytes += getSize(ops.back());
+            }
+            opsReadStats.increment(ops.size());
 
             {
                 boost::unique_lock<boost::mutex> lock(_mutex);
@@ -441,15 +482,20 @@ namespace replset {
             OCCASIONALLY {
                 LOG(2) << "bgsync buffer has " << _buffer.size() << " bytes" << rsLog;
             }
-            // the blocking queue will wait (forever) until there's room for us to push
-            _buffer.push(o);
-            bufferCountGauge.increment();
-            bufferSizeGauge.increment(getSize(o));
+            // the blocking queue will wait (forever) until there's room for the whole batch
+            _buffer.pushAll(ops);
+            bufferCountGauge.increment(ops.size());
+            bufferSizeGauge.increment(opsBytes);
 
             {
                 boost::unique_lock<boost::mutex> lock(_mutex);
-                _lastH = o["h"].numberLong();
-                _lastOpTimeFetched = o["ts"]._opTime();
+                const BSONObj& last = ops.back();
+                _lastH = last["h"].numberLong();
+                _lastOpTimeFetched = last["ts"]._opTime();
+                if (_currentSyncTarget) {
+                    networkLagSecsGauge = lagSecs(_currentSyncTarget->hbinfo().opTime,
+                                                  _lastOpTimeFetched);
+                }
             }
         }
     }
@@ -55,7 +55,14 @@ namespace mongo {
     public:
         OplogReader();
         ~OplogReader() { }
-        void resetCursor() { cursor.reset(); }
+        void resetCursor() {
+            // replies to pipelined getMores would be read by the connection's next request
+            if( cursor.get() && cursor->getMoresInFlight() > 0 ) {
+                resetConnection();
+                return;
+            }
+            cursor.reset();
+        }
         void resetConnection() {
             cursor.reset();
             _conn.reset();
@@ -87,6 +94,12 @@ namespace mongo {
 
         bool haveCursor() { return cursor.get() != 0; }
 
+        /** @see DBClientCursor::setGetMoresAhead() */
+        void setGetMoresAhead(int n) {
+            verify( cursor.get() );
+            cursor->setGetMoresAhead(n);
+        }
+
         /** this is ok but commented out as when used one should consider if QueryOption_OplogReplay
            is needed; if not fine, but if so, need to change.
         *//*
@@ -551,6 +551,9 @@ namespace mongo {
         friend class Consensus;
 
     private:
+        bool _syncDoInitialSync_cloneData(const string& master, const list<string>& dbs);
+        bool _canResumeClone(OplogReader& r, const string& sourceHostname);
+        const Member* _getResumableCloneSource();
         bool _syncDoInitialSync_clone(Cloner &cloner, const char *master,
                                       const list<string>& dbs, bool dataPass);
         bool _syncDoInitialSync_applyToHead( replset::SyncTail& syncer, OplogReader* r ,
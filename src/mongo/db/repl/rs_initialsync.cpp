@@ -30,10 +30,14 @@
 
 #include "mongo/db/repl/rs.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/authorization_manager_global.h"
 #include "mongo/db/client.h"
 #include "mongo/db/cloner.h"
+#include "mongo/db/database.h"
 #include "mongo/db/dbhelpers.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/oplog.h"
@@ -41,6 +45,8 @@
 #include "mongo/bson/optime.h"
 #include "mongo/db/repl/replication_server_status.h"  // replSettings
 #include "mongo/db/repl/rs_sync.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/fail_point_service.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
@@ -81,6 +87,216 @@ namespace mongo {
         fassert( 16233, failedAttempts < maxFailedAttempts);
     }
 
+    // collections cloned at once during initial sync, each over its own connection
+    MONGO_EXPORT_SERVER_PARAMETER(initialSyncCloneThreads, int, 4);
+
+    static CloneOptions initialSyncCloneOptions(const string& db, bool dataPass) {
+        CloneOptions options;
+        options.fromDB = db;
+        options.logForRepl = false;
+        options.slaveOk = true;
+        options.useReplAuth = true;
+        options.snapshot = false;
+        options.mayYield = true;
+        options.mayBeInterrupted = false;
+        options.syncData = dataPass;
+        options.syncIndexes = ! dataPass;
+        // the unique ones are built once the data is consistent, after the oplog is applied
+        options.syncNonUniqueIndexes = dataPass;
+        return options;
+    }
+
+    /**
+     * The clone of an initial sync attempt which failed part way through, for the next attempt
+     * from the same sync source to pick up: the op the clone started after, and the collections
+     * cloned completely since.  Applying the oplog from that op brings those up to date just like
+     * the collections the next attempt clones.
+     */
+    struct InitialSyncCloneProgress {
+        string source;
+        BSONObj startOp;
+        set<string> cloned;
+
+        void clear() {
+            source.clear();
+            startOp = BSONObj();
+            cloned.clear();
+        }
+    };
+
+    static InitialSyncCloneProgress cloneProgress;
+
+    // Fails the clone of an initial sync once { afterCollections : n } collections are cloned
+    MONGO_FP_DECLARE(initialSyncCloneFail);
+
+    /**
+     * Clones collections over several connections at once, each worker taking the next collection
+     * off a shared list, so other collections keep cloning while one is inserted or indexed.  A
+     * collection whose clone fails, e.g. on a network error, is dropped and cloned again over a
+     * new connection.
+     */
+    class ParallelCollectionCloner : boost::noncopyable {
+    public:
+        static const int maxAttemptsPerCollection = 3;
+
+        ParallelCollectionCloner(const string& source, set<string>* cloned)
+            : _source(source), _cloned(cloned), _mutex("ParallelCollectionCloner"),
+              _next(0), _failed(false) {}
+
+        /** Queues the collections of 'db' which aren't in the cloned set yet */
+        bool addDatabase(Cloner& lister, const string& db, string& errmsg) {
+            list<BSONObj> collections;
+            if (!lister.listCollections(initialSyncCloneOptions(db, true), &collections, errmsg))
+                return false;
+
+            for (list<BSONObj>::const_iterator i = collections.begin(); i != collections.end();
+                 ++i) {
+                if (_cloned->count((*i)["name"].String())) {
+                    LOG(1) << "replSet initial sync already cloned " << (*i)["name"].String()
+                           << rsLog;
+                    continue;
+                }
+                Task task;
+                task.db = db;
+                task.collection = *i;
+                _tasks.push_back(task);
+            }
+            return true;
+        }
+
+        /** @return true if every queued collection was cloned */
+        bool run(int numThreads) {
+            log() << "replSet initial sync cloning " << _tasks.size() << " collections over "
+                  << numThreads << " connections" << rsLog;
+
+            boost::thread_group workers;
+            for (int i = 0; i < numThreads; i++) {
+                workers.create_thread(boost::bind(&ParallelCollectionCloner::_work, this, i));
+            }
+            workers.join_all();
+            return !_failed;
+        }
+
+    private:
+        struct Task {
+            string db;
+            BSONObj collection;
+        };
+
+        void _work(int id) {
+            string name = str::stream() << "initialSyncClone" << id;
+            Client::initThread(name.c_str());
+            replLocalAuth();
+
+            scoped_ptr<Cloner> cloner;
+            while (true) {
+                Task task;
+                {
+                    SimpleMutex::scoped_lock lk(_mutex);
+                    if (_failed || _next == _tasks.size())
+                        break;
+                    MONGO_FAIL_POINT_BLOCK(initialSyncCloneFail, failAfter) {
+                        const BSONObj& data = failAfter.getData();
+                        if (_cloned->size() >= static_cast<size_t>(
+                                                    data["afterCollections"].numberLong())) {
+                            log() << "replSet initial sync clone failing by request" << rsLog;
+                            _failed = true;
+                        }
+                    }
+                    if (_failed)
+                        break;
+                    task = _tasks[_next++];
+                }
+
+                if (!_cloneWithRetries(cloner, task)) {
+                    SimpleMutex::scoped_lock lk(_mutex);
+                    _failed = true;
+                    break;
+                }
+
+                SimpleMutex::scoped_lock lk(_mutex);
+                _cloned->insert(task.collection["name"].String());
+            }
+
+            cc().shutdown();
+        }
+
+        bool _cloneWithRetries(scoped_ptr<Cloner>& cloner, const Task& task) {
+            const string ns = task.collection["name"].String();
+            for (int attempt = 1; attempt <= maxAttemptsPerCollection; attempt++) {
+                try {
+                    if (!cloner) {
+                        cloner.reset(new Cloner());
+                        DBClientConnection* conn = new DBClientConnection();
+                        // cloner owns the connection
+                        cloner->setConnection(conn);
+                        string errmsg;
+                        uassert(17360, errmsg, conn->connect(_source, errmsg) &&
+                                               replAuthenticate(conn));
+                    }
+
+                    Client::WriteContext ctx(ns);
+                    if (ctx.ctx().db()->getCollection(ns)) {
+                        // left from an attempt which failed part way through
+                        uassertStatusOK(ctx.ctx().db()->dropCollection(ns));
+                    }
+                    cloner->cloneCollection(ctx.ctx(), task.collection,
+                                            initialSyncCloneOptions(task.db, true), false);
+                    return true;
+                }
+                catch (const DBException& e) {
+                    log() << "replSet initial sync failed to clone " << ns << ", attempt "
+                          << attempt << " of " << maxAttemptsPerCollection << causedBy(e)
+                          << rsLog;
+                    cloner.reset();
+                }
+            }
+            return false;
+        }
+
+        const string _source;
+        set<string>* const _cloned; // guarded by _mutex
+        SimpleMutex _mutex;
+        vector<Task> _tasks;
+        size_t _next; // guarded by _mutex
+        bool _failed; // guarded by _mutex
+    };
+
+    bool ReplSetImpl::_syncDoInitialSync_cloneData(const string& master,
+                                                   const list<string>& dbs) {
+        Cloner lister;
+        DBClientConnection* conn = new DBClientConnection();
+        // lister owns the connection
+        lister.setConnection(conn);
+        string errmsg;
+        if (!conn->connect(master, errmsg) || !replAuthenticate(conn)) {
+            sethbmsg(str::stream() << "initial sync couldn't connect to " << master << "  "
+                                   << errmsg, 0);
+            return false;
+        }
+
+        ParallelCollectionCloner cloner(master, &cloneProgress.cloned);
+        for (list<string>::const_iterator i = dbs.begin(); i != dbs.end(); i++) {
+            if (*i == "local")
+                continue;
+
+            if (!cloner.addDatabase(lister, *i, errmsg)) {
+                sethbmsg(str::stream() << "initial sync: error while listing collections of "
+                                       << *i << ".  " << errmsg, 0);
+                return false;
+            }
+        }
+
+        sethbmsg(str::stream() << "initial sync cloning databases, "
+                               << cloneProgress.cloned.size() << " collections cloned before", 0);
+        if (!cloner.run(std::max(1, static_cast<int>(initialSyncCloneThreads)))) {
+            sethbmsg(str::stream() << "initial sync: error while cloning, "
+                                   << cloneProgress.cloned.size() << " collections cloned", 0);
+            return false;
+        }
+        return true;
+    }
+
     bool ReplSetImpl::_syncDoInitialSync_clone(Cloner& cloner, const char *master,
                                                const list<string>& dbs, bool dataPass) {
 
@@ -98,16 +314,7 @@ namespace mongo {
 
             string err;
             int errCode;
-            CloneOptions options;
-            options.fromDB = db;
-            options.logForRepl = false;
-            options.slaveOk = true;
-            options.useReplAuth = true;
-            options.snapshot = false;
-            options.mayYield = true;
-            options.mayBeInterrupted = false;
-            options.syncData = dataPass;
-            options.syncIndexes = ! dataPass;
+            CloneOptions options = initialSyncCloneOptions(db, dataPass);
 
             if (!cloner.go(ctx.ctx(), master, options, NULL, err, &errCode)) {
                 sethbmsg(str::stream() << "initial sync: error while "
@@ -334,13 +541,46 @@ namespace mongo {
         return true;
     }
 
+    bool ReplSetImpl::_canResumeClone(OplogReader& r, const string& sourceHostname) {
+        if (cloneProgress.startOp.isEmpty() || cloneProgress.source != sourceHostname)
+            return false;
+
+        // the source's oplog must still reach back to where the clone started
+        BSONObj startOp = r.findOne(rsoplog, BSON("ts" << cloneProgress.startOp["ts"] <<
+                                                  "h" << cloneProgress.startOp["h"]));
+        if (startOp.isEmpty()) {
+            log() << "replSet initial sync can't resume the clone, " << sourceHostname
+                  << " no longer has op " << cloneProgress.startOp << rsLog;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @return the member a failed clone made progress from, if it can still be synced from, so
+     * the next attempt resumes that clone rather than starting over from the closest member
+     */
+    const Member* ReplSetImpl::_getResumableCloneSource() {
+        if (cloneProgress.cloned.empty())
+            return NULL;
+
+        lock lk(this);
+        Member* m = findByName(cloneProgress.source);
+        if (!m || m == _self || !m->syncable())
+            return NULL;
+
+        sethbmsg(str::stream() << "syncing to: " << m->fullName() << " to resume the clone", 0);
+        return m;
+    }
+
     /**
      * Do the initial sync for this member.  There are several steps to this process:
      *
      *     0. Add _initialSyncFlag to minValid to tell us to restart initial sync if we
      *        crash in the middle of this procedure
      *     1. Record start time.
-     *     2. Clone.
+     *     2. Clone, several collections at once.  If this fails part way through, the next
+     *        attempt from the same source keeps the collections cloned completely.
      *     3. Set minValid1 to sync target's latest op time.
      *     4. Apply ops from start to minValid1, fetching missing docs as needed.
      *     5. Set minValid2 to sync target's latest op time.
@@ -366,7 +606,9 @@ namespace mongo {
             return;
         }
 
-        const Member *source = getMemberToSyncTo();
+        const Member *source = _getResumableCloneSource();
+        if (!source)
+            source = getMemberToSyncTo();
         if (!source) {
             sethbmsg("initial sync need a member to be primary or secondary to do our initial sync", 0);
             sleepsecs(15);
@@ -403,19 +645,42 @@ namespace mongo {
             // Add field to minvalid document to tell us to restart initial sync if we crash
             theReplSet->setInitialSyncFlag();
 
-            sethbmsg("initial sync drop all databases", 0);
-            dropAllDatabasesExceptLocal();
+            if (_canResumeClone(r, sourceHostname)) {
+                log() << "replSet initial sync resuming the clone from " << sourceHostname
+                      << ", " << cloneProgress.cloned.size() << " collections cloned already"
+                      << rsLog;
+                lastOp = cloneProgress.startOp;
+            }
+            else {
+                cloneProgress.clear();
+                cloneProgress.source = sourceHostname;
+                cloneProgress.startOp = lastOp.getOwned();
+
+                sethbmsg("initial sync drop all databases", 0);
+                dropAllDatabasesExceptLocal();
+            }
 
             sethbmsg("initial sync clone all databases", 0);
 
             list<string> dbs = r.conn()->getDatabaseNames();
 
-            Cloner cloner;
-            if (!_syncDoInitialSync_clone(cloner, sourceHostname.c_str(), dbs, true)) {
+            if (!_syncDoInitialSync_cloneData(sourceHostname, dbs)) {
+                if (!cloneProgress.cloned.empty()) {
+                    // vetoing the source would send the next attempt elsewhere to start over
+                    sethbmsg(str::stream() << "initial sync will resume the clone from "
+                                           << sourceHostname << " in 15 seconds", 0);
+                    sleepsecs(15);
+                    return;
+                }
+                sethbmsg("initial sync: clone failed, sleeping 5 minutes", 0);
                 veto(source->fullName(), 600);
                 sleepsecs(300);
                 return;
             }
+            // later failures start over, as before the clone could be resumed
+            cloneProgress.clear();
+
+            Cloner cloner;
 
             sethbmsg("initial sync data copy, starting syncup",0);
 
@@ -34,17 +34,24 @@
 
 #include "third_party/murmurhash3/MurmurHash3.h"
 
+#include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/client.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/d_concurrency.h"
+#include "mongo/db/database.h"
+#include "mongo/db/database_holder.h"
+#include "mongo/db/hasher.h"
+#include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/prefetch.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rs_sync.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
+#include "mongo/db/structure/collection.h"
 #include "mongo/util/fail_point_service.h"
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/stats/timer_stats.h"
@@ -68,6 +75,10 @@ namespace replset {
 
     MONGO_FP_DECLARE(rsSyncApplyStop);
 
+    // Read in the records a batch changes together, sorted by address, once the prefetch threads
+    // have found them all, rather than faulting them in one op at a time
+    MONGO_EXPORT_SERVER_PARAMETER(replPrefetchRecordsByBatch, bool, true);
+
     // Number and time of each ApplyOps worker pool round
     static TimerStats applyBatchStats;
     static ServerStatusMetricField<TimerStats> displayOpBatchesApplied(
@@ -77,6 +88,15 @@ namespace replset {
     static Counter64 opsAppliedStats;
     static ServerStatusMetricField<Counter64> displayOpsApplied( "repl.apply.ops",
                                                                 &opsAppliedStats );
+    //The oplog entries distributed over the writer threads by _id rather than by namespace
+    static Counter64 opsSpreadByIdStats;
+    static ServerStatusMetricField<Counter64> displayOpsSpreadById( "repl.apply.opsSpreadById",
+                                                                   &opsSpreadByIdStats );
+    //The oplog entries applied by the busiest writer thread of each batch, summed over batches
+    static Counter64 busiestWriterOpsStats;
+    static ServerStatusMetricField<Counter64> displayBusiestWriterOps(
+                                                    "repl.apply.busiestWriterOps",
+                                                    &busiestWriterOpsStats );
 
 
     SyncTail::SyncTail(BackgroundSyncInterface *q) :
@@ -204,7 +224,7 @@ namespace replset {
 
 
     // The pool threads call this to prefetch each op
-    void SyncTail::prefetchOp(const BSONObj& op) {
+    void SyncTail::prefetchOp(const BSONObj& op, RecordPrefetchBatch* records) {
         initializePrefetchThread();
 
         const char *ns = op.getStringField("ns");
@@ -213,7 +233,7 @@ namespace replset {
                 // one possible tweak here would be to stay in the read lock for this database 
                 // for multiple prefetches if they are for the same database.
                 Client::ReadContext ctx(ns);
-                prefetchPagesForReplicatedOp(op);
+                prefetchPagesForReplicatedOp(op, records);
             }
             catch (const DBException& e) {
                 LOG(2) << "ignoring exception in prefetchOp(): " << e.what() << endl;
@@ -228,12 +248,17 @@ namespace replset {
     // Doles out all the work to the reader pool threads and waits for them to complete
     void SyncTail::prefetchOps(const std::deque<BSONObj>& ops) {
         threadpool::ThreadPool& prefetcherPool = theReplSet->getPrefetchPool();
+        RecordPrefetchBatch records;
+        RecordPrefetchBatch* recordsOrNull = replPrefetchRecordsByBatch ? &records : NULL;
         for (std::deque<BSONObj>::const_iterator it = ops.begin();
              it != ops.end();
              ++it) {
-            prefetcherPool.schedule(&prefetchOp, *it);
+            prefetcherPool.schedule(&prefetchOp, *it, recordsOrNull);
         }
         prefetcherPool.join();
+
+        // the records are read in once their addresses are all known, in address order
+        records.adviseAll();
     }
     
     // Doles out all the work to the writer pool threads and waits for them to complete
@@ -258,8 +283,15 @@ namespace replset {
         prefetchOps(ops);
         
         std::vector< std::vector<BSONObj> > writerVectors(theReplSet->replWriterThreadCount);
-        fillWriterVectors(ops, &writerVectors);
+        opsSpreadByIdStats.increment(fillWriterVectors(ops, &writerVectors));
         LOG(2) << "replication batch size is " << ops.size() << endl;
+
+        size_t busiestWriter = 0;
+        for (size_t i = 0; i < writerVectors.size(); i++) {
+            busiestWriter = std::max(busiestWriter, writerVectors[i].size());
+        }
+        busiestWriterOpsStats.increment(busiestWriter);
+
         // We must grab this because we're going to grab write locks later.
         // We hold this mutex the entire time we're writing; it doesn't matter
         // because all readers are blocked anyway.
@@ -272,8 +304,58 @@ namespace replset {
     }
 
 
-    void SyncTail::fillWriterVectors(const std::deque<BSONObj>& ops, 
-                                              std::vector< std::vector<BSONObj> >* writerVectors) {
+    /**
+     * @return true if the ops of ns may be applied by several writer threads, each taking the
+     * ops of the documents whose _id hashes to it.  That reorders ops on different documents,
+     * which capped collections (insertion order) and unique secondary indexes (an insert may
+     * depend on another document giving up its key first) would notice.  Collections which
+     * don't exist yet are created by their first op, so they stay on one thread as well.
+     */
+    static bool canApplyByDocument(const string& ns) {
+        Lock::DBRead lk(ns);
+        Database* db = dbHolder().get(ns, storageGlobalParams.dbpath);
+        Collection* collection = db ? db->getCollection(ns) : NULL;
+        if (!collection || collection->isCapped())
+            return false;
+
+        IndexCatalog::IndexIterator ii = collection->getIndexCatalog()->getIndexIterator(true);
+        while (ii.more()) {
+            IndexDescriptor* desc = ii.next();
+            if (desc->unique() && !desc->isIdIndex())
+                return false;
+        }
+        return true;
+    }
+
+    /** @return the _id of the document an insert, update or delete op is on, or EOO */
+    static BSONElement opDocumentId(const BSONObj& op) {
+        const char* opType = op["op"].valuestrsafe();
+        if ((opType[0] == 'i' || opType[0] == 'd') && opType[1] == '\0')
+            return op["o"]["_id"];
+        if (opType[0] == 'u')
+            return op["o2"]["_id"];
+        return BSONElement();
+    }
+
+    size_t SyncTail::fillWriterVectors(const std::deque<BSONObj>& ops,
+                                       std::vector< std::vector<BSONObj> >* writerVectors) {
+        // Each namespace's ops are spread by _id if all of them carry one and its collection
+        // allows it, otherwise they all go to the thread of the namespace.  Either way every op
+        // on a document is applied by the same thread, in oplog order; commands and index
+        // builds never get here with other ops, as they are batched alone.
+        map<string, bool> byDocument;
+        for (std::deque<BSONObj>::const_iterator it = ops.begin(); it != ops.end(); ++it) {
+            const string ns = it->getStringField("ns");
+            map<string, bool>::iterator i = byDocument.find(ns);
+            if (i == byDocument.end()) {
+                bool canSpread = !ns.empty() && canApplyByDocument(ns);
+                i = byDocument.insert(make_pair(ns, canSpread)).first;
+            }
+            if (i->second && opDocumentId(*it).eoo())
+                i->second = false;
+        }
+
+        size_t spread = 0;
         for (std::deque<BSONObj>::const_iterator it = ops.begin();
              it != ops.end();
              ++it) {
@@ -284,8 +366,18 @@ namespace replset {
             uint32_t hash = 0;
             MurmurHash3_x86_32( ns, len, 0, &hash);
 
+            if (byDocument[ns]) {
+                // _ids which compare equal, like 1 and 1.0, must hash alike whatever their type
+                const long long idHash =
+                    BSONElementHasher::hash64(opDocumentId(*it),
+                                              BSONElementHasher::DEFAULT_HASH_SEED);
+                MurmurHash3_x86_32(&idHash, sizeof(idHash), hash, &hash);
+                spread++;
+            }
+
             (*writerVectors)[hash % writerVectors->size()].push_back(*it);
         }
+        return spread;
     }
 
 
@@ -38,6 +38,9 @@
 #include "mongo/util/concurrency/thread_pool.h"
 
 namespace mongo {
+
+    class RecordPrefetchBatch;
+
 namespace replset {
 
     class BackgroundSyncInterface;
@@ -125,15 +128,21 @@ namespace replset {
 
         // Doles out all the work to the reader pool threads and waits for them to complete
         void prefetchOps(const std::deque<BSONObj>& ops);
-        // Used by the thread pool readers to prefetch an op
-        static void prefetchOp(const BSONObj& op);
+        // Used by the thread pool readers to prefetch an op, leaving its record to 'records'
+        // if not NULL
+        static void prefetchOp(const BSONObj& op, RecordPrefetchBatch* records);
 
         // Doles out all the work to the writer pool threads and waits for them to complete
         void applyOps(const std::vector< std::vector<BSONObj> >& writerVectors, 
                       MultiSyncApplyFunc applyFunc);
 
-        void fillWriterVectors(const std::deque<BSONObj>& ops, 
-                               std::vector< std::vector<BSONObj> >* writerVectors);
+        /**
+         * Distributes ops over the writer threads.  Ops on different documents of a collection
+         * may go to different threads, the ops on each document go to one thread in order.
+         * @return the number of ops distributed by document
+         */
+        size_t fillWriterVectors(const std::deque<BSONObj>& ops,
+                                 std::vector< std::vector<BSONObj> >* writerVectors);
         void handleSlaveDelay(const BSONObj& op);
         void setOplogVersion(const BSONObj& op);
     };
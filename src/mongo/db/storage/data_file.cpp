@@ -34,6 +34,10 @@
 
 #include <boost/filesystem/operations.hpp>
 
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/dur.h"
 #include "mongo/db/lockstate.h"
@@ -155,6 +159,33 @@ namespace mongo {
         mmf.flush( sync );
     }
 
+    Status DataFile::punchHole( int offset, int length ) {
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+        if ( fallocate( getFd(), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length ) == 0 )
+            return Status::OK();
+        return Status( ErrorCodes::InternalError,
+                       str::stream() << "punching a hole in " << mmf.filename() << " failed: "
+                                     << errnoWithDescription() );
+#else
+        return Status( ErrorCodes::IllegalOperation,
+                       "punching holes in data files is not supported on this platform" );
+#endif
+    }
+
+    Status DataFile::allocateRange( int offset, int length ) {
+#if defined(__linux__)
+        int ret = posix_fallocate( getFd(), offset, length );
+        if ( ret == 0 )
+            return Status::OK();
+        return Status( ErrorCodes::InternalError,
+                       str::stream() << "allocating space in " << mmf.filename() << " failed: "
+                                     << errnoWithDescription( ret ) );
+#else
+        // holes are only punched on linux
+        return Status::OK();
+#endif
+    }
+
     DiskLoc DataFile::allocExtentArea( int size ) {
 
         massert( 10357, "shutdown in progress", !inShutdown() );
@@ -30,6 +30,7 @@
 
 #pragma once
 
+#include "mongo/base/status.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/pdfile_version.h"
 #include "mongo/db/storage/durable_mapped_file.h"
@@ -106,6 +107,15 @@ namespace mongo {
         /** fsync */
         void flush( bool sync );
 
+        /**
+         * gives the disk space of a range of the file back to the filesystem, it reads as zeroes
+         * afterwards.  the file keeps its length.
+         */
+        Status punchHole( int offset, int length );
+
+        /** allocates disk space for a range again, so writing to it can't run out of space */
+        Status allocateRange( int offset, int length );
+
     private:
         void badOfs(int) const;
         void badOfs2(int) const;
@@ -130,6 +130,21 @@ namespace mongo {
         lastRecord.Null();
     }
 
+    // not a valid namespace, so never the name of a collection's extent
+    static const char punchedMarker[] = "$punched";
+
+    bool Extent::isPunched() const {
+        return nsDiagnostic == punchedMarker;
+    }
+
+    void Extent::markPunched() {
+        nsDiagnostic = punchedMarker;
+    }
+
+    void Extent::markUnpunched() {
+        nsDiagnostic = "";
+    }
+
     DiskLoc Extent::reuse(const StringData& nsname, bool capped) {
         return getDur().writing(this)->_reuse(nsname, capped);
     }
@@ -115,6 +115,16 @@ namespace mongo {
 
         /** caller must declare write intent first */
         void markEmpty();
+
+        /**
+         * a free extent whose pages were given back to the filesystem has its nsDiagnostic
+         * replaced by a marker, until it's reused.  see ExtentManager::punchFreeExtents()
+         */
+        bool isPunched() const;
+
+        /** caller must declare write intent first */
+        void markPunched();
+        void markUnpunched();
     private:
         DiskLoc _reuse(const StringData& nsname, bool newUseIsAsCapped); // recycle an extent and reuse it for a different ns
     };
@@ -36,14 +36,19 @@
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/memconcept.h"
 #include "mongo/db/namespace_details.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage/data_file.h"
 #include "mongo/db/storage/extent.h"
 #include "mongo/db/storage/extent_manager.h"
+#include "mongo/util/file_allocator.h"
 
 #include "mongo/db/pdfile.h"
 
 namespace mongo {
 
+    // upper bound on how many files to preallocate ahead of a database growing quickly
+    MONGO_EXPORT_SERVER_PARAMETER( preallocateMaxFilesAhead, int, 2 );
+
     ExtentManager::ExtentManager( const StringData& dbname,
                                   const StringData& path,
                                   NamespaceDetails* freeListDetails,
@@ -51,7 +56,11 @@ namespace mongo {
         : _dbname( dbname.toString() ),
           _path( path.toString() ),
           _freeListDetails( freeListDetails ),
-          _directoryPerDB( directoryPerDB ) {
+          _directoryPerDB( directoryPerDB ),
+          _allocationMutex( "ExtentManager::_allocationMutex" ),
+          _lastFileAddedMillis( 0 ) {
+        if ( Lock::collectionLevelLockingEnabled() )
+            _files.reserve( DiskLoc::MaxFiles );
     }
 
     ExtentManager::~ExtentManager() {
@@ -133,7 +142,7 @@ namespace mongo {
         if ( !preallocateOnly ) {
             while ( n >= (int) _files.size() ) {
                 verify(this);
-                if( !Lock::isWriteLocked(_dbname) ) {
+                if( !Lock::isIntentWriteLocked(_dbname) ) {
                     log() << "error: getFile() called in a read lock, yet file to return is not yet open" << endl;
                     log() << "       getFile(" << n << ") _files.size:" <<_files.size() << ' ' << fileName(n).string() << endl;
                     log() << "       context ns: " << cc().ns() << endl;
@@ -144,12 +153,13 @@ namespace mongo {
             p = _files[n];
         }
         if ( p == 0 ) {
-            DEV Lock::assertWriteLocked( _dbname );
+            DEV verify( Lock::isIntentWriteLocked( _dbname ) );
+            RecursiveMutex::scoped_lock lk( _allocationMutex );
             boost::filesystem::path fullName = fileName( n );
             string fullNameString = fullName.string();
             p = new DataFile(n);
             int minSize = 0;
-            if ( n != 0 && _files[ n - 1 ] )
+            if ( n != 0 && n - 1 < (int) _files.size() && _files[ n - 1 ] )
                 minSize = _files[ n - 1 ]->getHeader()->fileLength;
             if ( sizeNeeded + DataFileHeader::HeaderSize > minSize )
                 minSize = sizeNeeded + DataFileHeader::HeaderSize;
@@ -169,14 +179,37 @@ namespace mongo {
     }
 
     DataFile* ExtentManager::addAFile( int sizeNeeded, bool preallocateNextFile ) {
-        DEV Lock::assertWriteLocked( _dbname );
+        DEV verify( Lock::isIntentWriteLocked( _dbname ) );
+        RecursiveMutex::scoped_lock lk( _allocationMutex );
         int n = (int) _files.size();
         DataFile *ret = getFile( n, sizeNeeded );
-        if ( preallocateNextFile )
-            preallocateAFile();
+        if ( preallocateNextFile ) {
+            int ahead = _filesToPreallocate();
+            for ( int i = 1; i <= ahead && n + i < DiskLoc::MaxFiles; i++ )
+                getFile( n + i, 0, true );
+        }
         return ret;
     }
 
+    int ExtentManager::_filesToPreallocate() {
+        unsigned long long now = curTimeMillis64();
+        unsigned long long sinceLast = now - _lastFileAddedMillis;
+        bool first = _lastFileAddedMillis == 0;
+        _lastFileAddedMillis = now;
+
+        int maxAhead = std::max( 1, preallocateMaxFilesAhead );
+        if ( first )
+            return 1;
+
+        // keep enough files in hand to cover twice the time it takes to allocate one, at the rate
+        // files are being used up, so a write rarely has to wait for an allocation to finish
+        unsigned long long allocMillis = FileAllocator::get()->lastAllocationMillis();
+        if ( sinceLast == 0 )
+            return maxAhead;
+        unsigned long long ahead = 1 + 2 * allocMillis / sinceLast;
+        return static_cast<int>( std::min( ahead, static_cast<unsigned long long>( maxAhead ) ) );
+    }
+
     size_t ExtentManager::numFiles() const {
         DEV Lock::assertAtLeastReadLocked( _dbname );
         return _files.size();
@@ -322,6 +355,17 @@ namespace mongo {
         return newSize;
     }
 
+    /**
+     * the pages of an extent after the one its header is on, which can be given back to the
+     * filesystem while it is free.  extents are page aligned, see quantizeExtentSize().
+     */
+    static void punchableRange( const DiskLoc& loc, int length, int* start, int* end ) {
+        *start = ( loc.getOfs() + Extent::HeaderSize() + 0xfff ) & 0xfffff000;
+        *end = ( loc.getOfs() + length ) & 0xfffff000;
+        if ( *end < *start )
+            *end = *start;
+    }
+
     void _quotaExceeded() {
         uasserted(12501, "quota exceeded");
     }
@@ -355,6 +399,7 @@ namespace mongo {
 
 
     DiskLoc ExtentManager::createExtent( int size, int maxFileNoForQuota ) {
+        RecursiveMutex::scoped_lock lk( _allocationMutex );
         size = quantizeExtentSize( size );
 
         if ( size > Extent::maxSize() )
@@ -379,7 +424,7 @@ namespace mongo {
         // no space in an existing file
         // allocate files until we either get one big enough or hit maxSize
         for ( int i = 0; i < 8; i++ ) {
-            DataFile* f = addAFile( size, false );
+            DataFile* f = addAFile( size, true );
 
             if ( f->getHeader()->unusedLength >= size ) {
                 return _createExtentInFile( numFiles() - 1, f, size, maxFileNoForQuota );
@@ -428,6 +473,7 @@ namespace mongo {
         }
 
         // scan free list looking for something suitable
+        RecursiveMutex::scoped_lock lk( _allocationMutex );
 
         int n = 0;
         Extent *best = 0;
@@ -474,25 +520,30 @@ namespace mongo {
         if ( !best )
             return DiskLoc();
 
-        // remove from the free list
-        if ( !best->xprev.isNull() )
-            getExtent( best->xprev )->xnext.writing() = best->xnext;
-        if ( !best->xnext.isNull() )
-            getExtent( best->xnext )->xprev.writing() = best->xprev;
-        if ( _freeListDetails->firstExtent() == best->myLoc )
-            _freeListDetails->setFirstExtent( best->xnext );
-        if ( _freeListDetails->lastExtent() == best->myLoc )
-            _freeListDetails->setLastExtent( best->xprev );
+        _removeFromFreeList( best );
 
         return best->myLoc;
     }
 
+    void ExtentManager::_removeFromFreeList( Extent* e ) {
+        if ( !e->xprev.isNull() )
+            getExtent( e->xprev )->xnext.writing() = e->xnext;
+        if ( !e->xnext.isNull() )
+            getExtent( e->xnext )->xprev.writing() = e->xprev;
+        if ( _freeListDetails->firstExtent() == e->myLoc )
+            _freeListDetails->setFirstExtent( e->xnext );
+        if ( _freeListDetails->lastExtent() == e->myLoc )
+            _freeListDetails->setLastExtent( e->xprev );
+    }
+
 
     Extent* ExtentManager::increaseStorageSize( const string& ns,
                                                 NamespaceDetails* details,
                                                 int size,
                                                 int quotaMax ) {
 
+        RecursiveMutex::scoped_lock lk( _allocationMutex );
+
         bool fromFreeList = true;
         DiskLoc eloc = allocFromFreeList( size, details->isCapped() );
         if ( eloc.isNull() ) {
@@ -512,6 +563,19 @@ namespace mongo {
         Extent *e = getExtent( eloc, false );
         verify( e );
 
+        if ( fromFreeList && e->isPunched() ) {
+            // get the disk space back now, rather than failing a write to the mapped file later
+            DataFile* f = getFile( eloc.a() );
+            int start, end;
+            punchableRange( eloc, e->length, &start, &end );
+            Status s = f->allocateRange( start, end - start );
+            if ( !s.isOK() ) {
+                getDur().writing( e )->markEmpty();
+                freeExtents( eloc, eloc );
+                uassertStatusOK( s );
+            }
+        }
+
         DiskLoc emptyLoc = getDur().writing(e)->reuse( ns,
                                                        details->isCapped() );
 
@@ -553,6 +617,7 @@ namespace mongo {
         }
 
         verify( _freeListDetails );
+        RecursiveMutex::scoped_lock lk( _allocationMutex );
 
         if( _freeListDetails->firstExtent().isNull() ) {
             _freeListDetails->setFirstExtent( firstExt );
@@ -569,6 +634,128 @@ namespace mongo {
     }
 
 
+    void ExtentManager::freeSpaceStats( long long* reclaimable, long long* reclaimed ) const {
+        *reclaimable = 0;
+        *reclaimed = 0;
+        if ( !_freeListDetails )
+            return;
+
+        for ( DiskLoc L = _freeListDetails->firstExtent(); !L.isNull(); ) {
+            Extent* e = getExtent( L );
+            int start, end;
+            punchableRange( L, e->length, &start, &end );
+            if ( e->isPunched() )
+                *reclaimed += end - start;
+            else
+                *reclaimable += end - start;
+            L = e->xnext;
+        }
+    }
+
+    StatusWith<long long> ExtentManager::punchFreeExtents() {
+        DEV verify( Lock::isW() );
+        RecursiveMutex::scoped_lock lk( _allocationMutex );
+
+        long long punched = 0;
+        if ( !_freeListDetails )
+            return StatusWith<long long>( punched );
+
+        // mark the extents first and make the marks durable, so that after a crash an extent
+        // with a hole is always allocated again before reuse.  one marked without its hole just
+        // gets a needless allocateRange
+        vector<DiskLoc> toPunch;
+        for ( DiskLoc L = _freeListDetails->firstExtent(); !L.isNull(); ) {
+            Extent* e = getExtent( L );
+            int start, end;
+            punchableRange( L, e->length, &start, &end );
+            if ( !e->isPunched() && end > start ) {
+                getDur().writing( e )->markPunched();
+                toPunch.push_back( L );
+            }
+            L = e->xnext;
+        }
+        if ( toPunch.empty() )
+            return StatusWith<long long>( punched );
+
+        getDur().syncDataAndTruncateJournal();
+
+        for ( size_t i = 0; i < toPunch.size(); i++ ) {
+            Extent* e = getExtent( toPunch[i] );
+            int start, end;
+            punchableRange( toPunch[i], e->length, &start, &end );
+            Status s = getFile( toPunch[i].a() )->punchHole( start, end - start );
+            if ( !s.isOK() ) {
+                // the rest keep their pages, so don't report them as given back.  this one may
+                // have lost some unless punching isn't supported at all
+                size_t keptPages = s.code() == ErrorCodes::IllegalOperation ? i : i + 1;
+                for ( size_t j = keptPages; j < toPunch.size(); j++ )
+                    getDur().writing( getExtent( toPunch[j] ) )->markUnpunched();
+                return StatusWith<long long>( s );
+            }
+            punched += end - start;
+        }
+
+        return StatusWith<long long>( punched );
+    }
+
+    int ExtentManager::detachTrailingFreeFiles() {
+        DEV verify( Lock::isW() );
+        RecursiveMutex::scoped_lock lk( _allocationMutex );
+
+        if ( !_freeListDetails || _files.size() < 2 )
+            return 0;
+
+        vector<long long> freeBytes( _files.size(), 0 );
+        for ( DiskLoc L = _freeListDetails->firstExtent(); !L.isNull(); ) {
+            Extent* e = getExtent( L );
+            freeBytes[L.a()] += e->length;
+            L = e->xnext;
+        }
+
+        // file 0 is never deleted, it holds the system collections
+        int n = 0;
+        for ( int i = _files.size() - 1; i > 0 && _files[i]; i-- ) {
+            DataFileHeader* h = _files[i]->getHeader();
+            if ( freeBytes[i] != h->unused.getOfs() - DataFileHeader::HeaderSize )
+                break;
+            n++;
+        }
+
+        int firstDeleted = _files.size() - n;
+        for ( DiskLoc L = _freeListDetails->firstExtent(); n && !L.isNull(); ) {
+            Extent* e = getExtent( L );
+            L = e->xnext;
+            if ( e->myLoc.a() >= firstDeleted )
+                _removeFromFreeList( e );
+        }
+
+        return n;
+    }
+
+    long long ExtentManager::deleteTrailingFiles( int n ) {
+        DEV verify( Lock::isW() );
+        RecursiveMutex::scoped_lock lk( _allocationMutex );
+        verify( n >= 0 && n < static_cast<int>( _files.size() ) );
+
+        // the file allocator may still be preallocating the next file
+        FileAllocator::get()->waitUntilFinished();
+
+        long long deleted = 0;
+        for ( int i = 0; i < n; i++ ) {
+            delete _files.back();
+            _files.pop_back();
+        }
+
+        for ( int i = _files.size(); boost::filesystem::exists( fileName( i ) ); i++ ) {
+            boost::filesystem::path p = fileName( i );
+            deleted += boost::filesystem::file_size( p );
+            log() << "removing data file " << p.string();
+            boost::filesystem::remove( p );
+        }
+
+        return deleted;
+    }
+
     void ExtentManager::printFreeList() const {
         log() << "dump freelist " << _dbname << endl;
 
@@ -36,8 +36,10 @@
 #include <boost/filesystem/path.hpp>
 
 #include "mongo/base/status.h"
+#include "mongo/base/status_with.h"
 #include "mongo/base/string_data.h"
 #include "mongo/db/diskloc.h"
+#include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
 
@@ -53,7 +55,9 @@ namespace mongo {
      *  - responsible for figuring out how to get a new extent
      *  - can use any method it wants to do so
      *  - this structure is NOT stored on disk
-     *  - this class is NOT thread safe, locking should be above (for now)
+     *  - this class is NOT thread safe, locking should be above (for now), except that
+     *    collection level writers (Lock::CollectionWrite) may allocate extents and files
+     *    concurrently, which is serialized by _allocationMutex
      *
      * implementation:
      *  - ExtentManager holds a list of DataFile
@@ -93,6 +97,10 @@ namespace mongo {
 
         DataFile* getFile( int n, int sizeNeeded = 0, bool preallocateOnly = false );
 
+        /**
+         * @param preallocateNextFile also request the files after the new one in the background,
+         *        more of them the faster files are being added (see preallocateMaxFilesAhead)
+         */
         DataFile* addAFile( int sizeNeeded, bool preallocateNextFile );
 
         void preallocateAFile() { getFile( numFiles() , 0, true ); }// XXX-ERH
@@ -126,6 +134,34 @@ namespace mongo {
 
         void printFreeList() const;
 
+        /**
+         * @param reclaimable set to the bytes of the free extents which holes could be punched in
+         * @param reclaimed set to the bytes already given back to the filesystem that way
+         */
+        void freeSpaceStats( long long* reclaimable, long long* reclaimed ) const;
+
+        /**
+         * Gives the pages of the free extents, but for their headers, back to the filesystem and
+         * marks the extents.  The caller must have synced the data files and truncated the
+         * journal first, so recovery won't redo writes from when the extents were in use.
+         * The marks are made durable before any hole is punched.  Requires the global W lock.
+         * @return the bytes given back
+         */
+        StatusWith<long long> punchFreeExtents();
+
+        /**
+         * Takes the extents of the data files at the end which only hold free extents off the
+         * free list.  The files are deleted by deleteTrailingFiles() once that is durable.
+         * @return the number of such files
+         */
+        int detachTrailingFreeFiles();
+
+        /**
+         * Closes and deletes the last n data files, and any preallocated file after them.
+         * @return the bytes deleted
+         */
+        long long deleteTrailingFiles( int n );
+
         bool hasFreeList() const { return _freeListDetails != NULL; }
 
         /**
@@ -174,11 +210,17 @@ namespace mongo {
 
         const DataFile* _getOpenFile( int n ) const;
 
+        // unlinks an extent from the free list, caller holds _allocationMutex
+        void _removeFromFreeList( Extent* e );
+
         DiskLoc _createExtentInFile( int fileNo, DataFile* f,
                                      int size, int maxFileNoForQuota );
 
         boost::filesystem::path fileName( int n ) const;
 
+        // how many files to keep preallocated after a new one, caller holds _allocationMutex
+        int _filesToPreallocate();
+
 // -----
 
         std::string _dbname; // i.e. "test"
@@ -189,8 +231,16 @@ namespace mongo {
         // must be in the dbLock when touching this (and write locked when writing to of course)
         // however during Database object construction we aren't, which is ok as it isn't yet visible
         //   to others and we are in the dbholder lock then.
+        // with collection level locking, capacity is reserved for DiskLoc::MaxFiles up front so
+        //   that adding a file never moves the array under readers holding only an intent lock.
         std::vector<DataFile*> _files;
 
+        // held while changing _files, data file headers or the extent free list
+        RecursiveMutex _allocationMutex;
+
+        // when addAFile last added a file, 0 if it hasn't yet
+        unsigned long long _lastFileAddedMillis;
+
     };
 
 }
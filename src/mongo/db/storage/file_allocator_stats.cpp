@@ -0,0 +1,88 @@
+// file_allocator_stats.cpp
+
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/file_allocator.h"
+
+namespace mongo {
+namespace {
+
+    /** how fast new data files may be zero filled when the filesystem can't allocate them */
+    class FileAllocatorMaxZeroFillMBPerSec : public ServerParameter {
+    public:
+        FileAllocatorMaxZeroFillMBPerSec()
+            : ServerParameter( ServerParameterSet::getGlobal(),
+                               "fileAllocatorMaxZeroFillMBPerSec" ) {
+        }
+
+        virtual void append( BSONObjBuilder& b, const string& name ) {
+            b.append( name, FileAllocator::get()->getMaxZeroFillMBPerSec() );
+        }
+
+        virtual Status set( const BSONElement& newValueElement ) {
+            if ( !newValueElement.isNumber() ) {
+                return Status( ErrorCodes::BadValue,
+                               "fileAllocatorMaxZeroFillMBPerSec has to be a number" );
+            }
+            return _set( newValueElement.numberInt() );
+        }
+
+        virtual Status setFromString( const string& str ) {
+            return _set( atoi( str.c_str() ) );
+        }
+
+    private:
+        Status _set( int mbPerSec ) {
+            if ( mbPerSec < 0 ) {
+                return Status( ErrorCodes::BadValue,
+                               "fileAllocatorMaxZeroFillMBPerSec has to be >= 0" );
+            }
+            FileAllocator::get()->setMaxZeroFillMBPerSec( mbPerSec );
+            return Status::OK();
+        }
+    } fileAllocatorMaxZeroFillMBPerSec;
+
+    class FileAllocatorServerStatusSection : public ServerStatusSection {
+    public:
+        FileAllocatorServerStatusSection() : ServerStatusSection( "fileAllocator" ) {}
+        virtual bool includeByDefault() const { return true; }
+
+        virtual BSONObj generateSection( const BSONElement& configElement ) const {
+            BSONObjBuilder b;
+            FileAllocator::get()->appendStats( &b );
+            return b.obj();
+        }
+    } fileAllocatorServerStatusSection;
+
+} // namespace
+} // namespace mongo
@@ -53,6 +53,7 @@ namespace mongo {
 
     BOOST_STATIC_ASSERT( Record::HeaderSize == 16 );
     BOOST_STATIC_ASSERT( Record::HeaderSize + BtreeData_V1::BucketSize == 8192 );
+    BOOST_STATIC_ASSERT( Record::HeaderSize + BtreeData_V2::BucketSize == 8192 );
 
     NOINLINE_DECL void checkFailed(unsigned line) {
         static time_t last;
@@ -325,6 +326,7 @@ namespace mongo {
         this->n--;
         for ( int j = keypos; j < this->n; j++ )
             k(j) = k(j+1);
+        _removeKeyCode(keypos);
         setNotPacked();
     }
 
@@ -339,7 +341,7 @@ namespace mongo {
         KeyNode kn = keyNode(this->n-1);
         recLoc = kn.recordLoc;
         key.assign(kn.key);
-        int keysize = kn.key.dataSize();
+        int keysize = this->keyDataSize(k(this->n-1).keyDataOfs());
 
         massert( 10283 , "rchild not null in btree popBack()", this->nextChild.isNull());
 
@@ -347,6 +349,7 @@ namespace mongo {
         this->nextChild = kn.prevChildBucket;
 
         this->n--;
+        _removeKeyCode(this->n);
         // This is risky because the key we are returning points to this unalloc'ed memory,
         // and we are assuming that the last key points to the last allocated
         // bson region.
@@ -357,7 +360,7 @@ namespace mongo {
     /** add a key.  must be > all existing.  be careful to set next ptr right. */
     template< class V >
     bool BucketBasics<V>::_pushBack(const DiskLoc recordLoc, const Key& key, const Ordering &order, const DiskLoc prevChild) {
-        int bytesNeeded = key.dataSize() + sizeof(_KeyNode);
+        int bytesNeeded = this->keyStorageSize(key) + sizeof(_KeyNode);
         if ( bytesNeeded > this->emptySize )
             return false;
         verify( bytesNeeded <= this->emptySize );
@@ -375,10 +378,12 @@ namespace mongo {
         _KeyNode& kn = k(this->n++);
         kn.prevChildBucket = prevChild;
         kn.recordLoc = recordLoc;
-        kn.setKeyDataOfs( (short) _alloc(key.dataSize()) );
+        kn.setKeyDataOfs( (short) _alloc(bytesNeeded - sizeof(_KeyNode)) );
         short ofs = kn.keyDataOfs();
         char *p = dataAt(ofs);
-        memcpy(p, key.data(), key.dataSize());
+        if ( !this->storeKey(p, key) )
+            setNotPacked();
+        _insertKeyCode(this->n - 1, key);
 
         return true;
     }
@@ -395,9 +400,11 @@ namespace mongo {
     bool BucketBasics<V>::basicInsert(const DiskLoc thisLoc, int &keypos, const DiskLoc recordLoc, const Key& key, const Ordering &order) const {
         check( this->n < 1024 );
         check( keypos >= 0 && keypos <= this->n );
-        int bytesNeeded = key.dataSize() + sizeof(_KeyNode);
+        int bytesNeeded = this->keyStorageSize(key) + sizeof(_KeyNode);
         if ( bytesNeeded > this->emptySize ) {
             _pack(thisLoc, order, keypos);
+            // packing may also change how much space the key needs, see BtreeData_V2
+            bytesNeeded = this->keyStorageSize(key) + sizeof(_KeyNode);
             if ( bytesNeeded > this->emptySize )
                 return false;
         }
@@ -427,10 +434,15 @@ namespace mongo {
         _KeyNode& kn = b->k(keypos);
         kn.prevChildBucket.Null();
         kn.recordLoc = recordLoc;
-        kn.setKeyDataOfs((short) b->_alloc(key.dataSize()) );
+        int keySize = bytesNeeded - sizeof(_KeyNode);
+        kn.setKeyDataOfs((short) b->_alloc(keySize) );
         char *p = b->dataAt(kn.keyDataOfs());
-        getDur().declareWriteIntent(p, key.dataSize());
-        memcpy(p, key.data(), key.dataSize());
+        getDur().declareWriteIntent(p, keySize);
+        if ( !b->storeKey(p, key) ) {
+            getDur().declareWriteIntent(&b->flags, sizeof(this->flags));
+            b->setNotPacked();
+        }
+        b->_insertKeyCode(keypos, key);
         return true;
     }
 
@@ -529,6 +541,143 @@ namespace mongo {
         assertValid( order );
     }
 
+    template<>
+    int BucketBasics<V2>::packedDataSize( int refPos ) const {
+        // Sized as if stored without a prefix, as the keys may move to a bucket with another
+        // one.  Even when packed that is not what the bucket uses now.
+        int size = 0;
+        for( int j = 0; j < this->n; ++j ) {
+            if ( mayDropKey( j, refPos ) ) {
+                continue;
+            }
+            short ofs = k( j ).keyDataOfs();
+            size += this->keyDataSize( ofs ) + ( this->keyHasPrefix( ofs ) ? this->prefixLen : 0 ) + sizeof( _KeyNode );
+        }
+        return size;
+    }
+
+    /** @return length of the common prefix of b and the first len bytes of a */
+    static int commonPrefixLength( const KeyV2& a, int len, const KeyV2& b ) {
+        int max = std::min( len, b.dataSize() );
+        const char *p = a.data();
+        const char *q = b.data();
+        int i = 0;
+        while ( i < max && p[i] == q[i] ) {
+            ++i;
+        }
+        return i;
+    }
+
+    /**
+     * As the generic version, but rewrites each key against a newly chosen prefix.  There
+     * are two candidates: the prefix of all of the keys, which is what a bucket filled from
+     * scratch gets, and the longest prefix of the keys stored with the current prefix.
+     * Keys stored whole (see BtreeData_V2) can make the first larger than what the bucket
+     * uses now, the second never is, so whichever stores the keys in less space is used.
+     */
+    template<>
+    void BucketBasics<V2>::_packReadyForMod( const Ordering &order, int &refPos ) {
+        assertWritable();
+
+        if ( this->flags & Packed )
+            return;
+
+        int i = 0;
+        for ( int j = 0; j < this->n; j++ ) {
+            if( mayDropKey( j, refPos ) ) {
+                continue; // key is unused and has no children - drop it
+            }
+            if( i != j ) {
+                if ( refPos == j ) {
+                    refPos = i; // i < j so j will never be refPos again
+                }
+                k( i ) = k( j );
+            }
+            ++i;
+        }
+        if ( refPos == this->n ) {
+            refPos = i;
+        }
+        this->n = i;
+
+        Key all;
+        Key stripped;
+        int allLen = 0;
+        int strippedLen = 0;
+        int nStripped = 0;
+        int unprefixedSize = 0;
+        for ( int j = 0; j < this->n; j++ ) {
+            KeyNode kn = keyNode( j );
+            unprefixedSize += keyStorageBound( kn.key.dataSize() );
+            if ( j == 0 ) {
+                all.assign( kn.key );
+                allLen = kn.key.dataSize();
+            }
+            else {
+                allLen = commonPrefixLength( all, allLen, kn.key );
+            }
+            if ( this->keyHasPrefix( k( j ).keyDataOfs() ) ) {
+                if ( nStripped++ == 0 ) {
+                    stripped.assign( kn.key );
+                    strippedLen = kn.key.dataSize();
+                }
+                else {
+                    strippedLen = commonPrefixLength( stripped, strippedLen, kn.key );
+                }
+            }
+        }
+        int allSize = allLen + unprefixedSize - this->n * allLen;
+        int strippedSize = strippedLen + unprefixedSize - nStripped * strippedLen;
+        bool useAll = nStripped == 0 || allSize <= strippedSize;
+        const char *prefix = useAll ? all.data() : stripped.data();
+        int newPrefixLen = useAll ? allLen : strippedLen;
+
+        int tdz = totalDataSize();
+        int keysSize = 0;
+        for ( int j = 0; j < this->n; j++ ) {
+            keysSize += storedSize( keyNode( j ).key, prefix, newPrefixLen );
+        }
+        const int codeSize = sizeof( StoredCode );
+        int used = keysSize + this->n * sizeof( _KeyNode );
+        int cap = keyCodesCapacity( this->n, used, tdz - newPrefixLen - used );
+
+        // the prefix at the top, below it the codes, then the keys, so the last key is still
+        // the last allocation for popBack()
+        char temp[V2::BucketSize];
+        int ofs = tdz - newPrefixLen;
+        if ( newPrefixLen ) {
+            memcpy( temp + ofs, prefix, newPrefixLen );
+        }
+        ofs -= cap * codeSize;
+        const int newCodesOfs = ofs;
+        for ( int j = 0; j < this->n; j++ ) {
+            // decoded against the old prefix, which is only replaced below
+            KeyNode kn = keyNode( j );
+            if ( cap ) {
+                StoredCode c = storedCode( kn.key.prefixCode() );
+                memcpy( temp + newCodesOfs + j * codeSize, &c, codeSize );
+            }
+            ofs -= storedSize( kn.key, prefix, newPrefixLen );
+            store( temp + ofs, kn.key, prefix, newPrefixLen );
+            k( j ).setKeyDataOfsSavingUse( ofs );
+        }
+        int dataUsed = tdz - ofs;
+        memcpy( this->data + ofs, temp + ofs, dataUsed );
+        this->prefixOfs = tdz - newPrefixLen;
+        this->prefixLen = newPrefixLen;
+        this->codesOfs = newCodesOfs;
+        this->codesCap = cap;
+        this->topSize = dataUsed;
+
+        int empty = tdz - dataUsed - this->n * sizeof( _KeyNode );
+        verify( empty >= 0 );
+        this->emptySize = empty;
+
+        setPacked();
+
+        assertValid( order );
+    }
+
     template< class V >
     inline void BucketBasics<V>::truncateTo(int N, const Ordering &order, int &refPos) {
         verify( Lock::somethingWriteLocked() );
@@ -565,7 +714,7 @@ namespace mongo {
         // TODO I think we only want to do the 90% split on the rhs node of the tree.
         int rightSizeLimit = ( this->topSize + sizeof( _KeyNode ) * this->n ) / ( keypos == this->n ? 10 : 2 );
         for( int i = this->n - 1; i > -1; --i ) {
-            rightSize += keyNode( i ).key.dataSize() + sizeof( _KeyNode );
+            rightSize += this->keyDataSize( k( i ).keyDataOfs() ) + sizeof( _KeyNode );
             if ( rightSize > rightSizeLimit ) {
                 split = i;
                 break;
@@ -585,6 +734,7 @@ namespace mongo {
     template< class V >
     void BucketBasics<V>::reserveKeysFront( int nAdd ) {
         verify( this->emptySize >= int( sizeof( _KeyNode ) * nAdd ) );
+        _dropKeyCodes();
         this->emptySize -= sizeof( _KeyNode ) * nAdd;
         for( int i = this->n - 1; i > -1; --i ) {
             k( i + nAdd ) = k( i );
@@ -594,13 +744,129 @@ namespace mongo {
 
     template< class V >
     void BucketBasics<V>::setKey( int i, const DiskLoc recordLoc, const Key &key, const DiskLoc prevChildBucket ) {
+        _dropKeyCodes();
         _KeyNode &kn = k( i );
         kn.recordLoc = recordLoc;
         kn.prevChildBucket = prevChildBucket;
-        short ofs = (short) _alloc( key.dataSize() );
+        short ofs = (short) _alloc( this->keyStorageSize( key ) );
         kn.setKeyDataOfs( ofs );
         char *p = dataAt( ofs );
-        memcpy( p, key.data(), key.dataSize() );
+        if ( !this->storeKey( p, key ) ) {
+            setNotPacked();
+        }
+    }
+
+    template< class V >
+    void BucketBasics<V>::adoptPrefix( const BucketBasics& from ) {
+        // a key takes the same space in every bucket
+        verify( this->n == 0 );
+    }
+
+    template<>
+    void BucketBasics<V2>::adoptPrefix( const BucketBasics<V2>& from ) {
+        verify( this->n == 0 );
+        if ( from.prefixLen == 0 ) {
+            return;
+        }
+        this->prefixOfs = _alloc( from.prefixLen );
+        this->prefixLen = from.prefixLen;
+        memcpy( dataAt( this->prefixOfs ), from.data + from.prefixOfs, from.prefixLen );
+    }
+
+    template< class V >
+    void BucketBasics<V>::_insertKeyCode( int pos, const Key& key ) {
+    }
+
+    template< class V >
+    void BucketBasics<V>::_removeKeyCode( int pos ) {
+    }
+
+    template< class V >
+    void BucketBasics<V>::_dropKeyCodes() {
+    }
+
+    template< class V >
+    void BucketBasics<V>::_buildKeyCodes() {
+    }
+
+    template<>
+    void BucketBasics<V2>::_insertKeyCode( int pos, const KeyV2& key ) {
+        if ( !this->hasKeyCodes() ) {
+            return;
+        }
+        if ( this->n > this->codesCap ) {
+            _dropKeyCodes();
+            return;
+        }
+        const int size = sizeof( StoredCode );
+        char *codes = dataAt( this->codesOfs );
+        getDur().declareWriteIntent( codes + pos * size, ( this->n - pos ) * size );
+        memmove( codes + ( pos + 1 ) * size, codes + pos * size, ( this->n - 1 - pos ) * size );
+        StoredCode c = storedCode( key.prefixCode() );
+        memcpy( codes + pos * size, &c, size );
+    }
+
+    template<>
+    void BucketBasics<V2>::_removeKeyCode( int pos ) {
+        if ( !this->hasKeyCodes() || pos == this->n ) {
+            return;
+        }
+        const int size = sizeof( StoredCode );
+        char *codes = dataAt( this->codesOfs );
+        getDur().declareWriteIntent( codes + pos * size, ( this->n - pos ) * size );
+        memmove( codes + pos * size, codes + ( pos + 1 ) * size, ( this->n - pos ) * size );
+    }
+
+    template<>
+    void BucketBasics<V2>::_dropKeyCodes() {
+        if ( !this->hasKeyCodes() ) {
+            return;
+        }
+        getDur().declareWriteIntent( &this->codesCap, sizeof( this->codesCap ) );
+        this->codesCap = 0;
+        // the array's space is reclaimed, and the array rebuilt, by the next pack
+        getDur().declareWriteIntent( &this->flags, sizeof( this->flags ) );
+        setNotPacked();
+    }
+
+    /**
+     * Only for buckets nothing is popped from, see popBack(), as the array is allocated
+     * below the keys.  Write intent must have been declared for the whole bucket.
+     */
+    template<>
+    void BucketBasics<V2>::_buildKeyCodes() {
+        if ( this->hasKeyCodes() ) {
+            return;
+        }
+        int used = this->topSize - this->prefixLen + this->n * sizeof( _KeyNode );
+        int cap = keyCodesCapacity( this->n, used, this->emptySize );
+        if ( cap == 0 ) {
+            return;
+        }
+        const int size = sizeof( StoredCode );
+        this->codesOfs = _alloc( cap * size );
+        this->codesCap = cap;
+        char *codes = dataAt( this->codesOfs );
+        for ( int j = 0; j < this->n; j++ ) {
+            StoredCode c = storedCode( keyNode( j ).key.prefixCode() );
+            memcpy( codes + j * size, &c, size );
+        }
+    }
+
+    template<>
+    bool BucketBasics<V2>::keyCodesMatchKeys() const {
+        if ( !this->hasKeyCodes() ) {
+            return true;
+        }
+        if ( this->n > this->codesCap ) {
+            return false;
+        }
+        for ( int j = 0; j < this->n; j++ ) {
+            if ( storedCodeAt( j ) != storedCode( keyNode( j ).key.prefixCode() ) ) {
+                return false;
+            }
+        }
+        return true;
     }
 
     template< class V >
@@ -776,9 +1042,20 @@ namespace mongo {
         if( guessIncreasing ) {
             m = h;
         }
+        const unsigned long long code = this->keyCode(key);
         while ( l <= h ) {
+            int x = this->compareKeyCode(code, m, k(m), btreeState->ordering());
+            if ( x != 0 ) {
+                // decided without looking at the key
+                if ( x < 0 )
+                    h = m-1;
+                else
+                    l = m+1;
+                m = (l+h)/2;
+                continue;
+            }
             KeyNode M = this->keyNode(m);
-            int x = key.woCompare(M.key, btreeState->ordering());
+            x = key.woCompare(M.key, btreeState->ordering());
             if ( x == 0 ) {
                 if( assertIfDup ) {
                     if( k(m).isUnused() ) {
@@ -998,13 +1275,29 @@ namespace mongo {
         {
             const BtreeBucket *l = leftNodeLoc.btree<V>();
             const BtreeBucket *r = rightNodeLoc.btree<V>();
-            if ( ( this->headerSize() + l->packedDataSize( pos ) + r->packedDataSize( pos ) + keyNode( leftIndex ).key.dataSize() + sizeof(_KeyNode) > unsigned( V::BucketSize ) ) ) {
+            if ( ( this->headerSize() + l->packedDataSize( pos ) + r->packedDataSize( pos ) + V::keyStorageBound( keyNode( leftIndex ).key.dataSize() ) + sizeof(_KeyNode) > unsigned( V::BucketSize ) ) ) {
                 return false;
             }
         }
         return true;
     }
 
+    template< class V >
+    int BtreeBucket<V>::childrenDataSize( const DiskLoc &thisLoc, int leftIndex ) const {
+        const BtreeBucket *l = BTREE(this->childForPos( leftIndex ));
+        const BtreeBucket *r = BTREE(this->childForPos( leftIndex + 1 ));
+        return l->packedDataSize( 0 ) +
+               V::keyStorageBound( keyNode( leftIndex ).key.dataSize() ) + sizeof( _KeyNode ) +
+               r->packedDataSize( 0 );
+    }
+
+    template< class V >
+    bool BtreeBucket<V>::canBalanceChildren( const DiskLoc &thisLoc, int leftIndex ) const {
+        // The side receiving keys ends up with at most half of the total, rounded up.
+        int total = childrenDataSize( thisLoc, leftIndex );
+        return total - total / 2 < BtreeBucket<V>::bodySize();
+    }
+
     /**
      * This implementation must respect the meaning and value of lowWaterMark.
      * Also see comments in splitPos().
@@ -1017,26 +1310,26 @@ namespace mongo {
         const BtreeBucket *r = BTREE(this->childForPos( leftIndex + 1 ));
 
         int KNS = sizeof( _KeyNode );
-        int rightSizeLimit = ( l->topSize + l->n * KNS + keyNode( leftIndex ).key.dataSize() + KNS + r->topSize + r->n * KNS ) / 2;
+        int rightSizeLimit = childrenDataSize( thisLoc, leftIndex ) / 2;
         // This constraint should be ensured by only calling this function
-        // if we go below the low water mark.
+        // if we go below the low water mark (and canBalanceChildren()).
         verify( rightSizeLimit < BtreeBucket<V>::bodySize() );
         for( int i = r->n - 1; i > -1; --i ) {
-            rightSize += r->keyNode( i ).key.dataSize() + KNS;
+            rightSize += V::keyStorageBound( r->keyNode( i ).key.dataSize() ) + KNS;
             if ( rightSize > rightSizeLimit ) {
                 split = l->n + 1 + i;
                 break;
             }
         }
         if ( split == -1 ) {
-            rightSize += keyNode( leftIndex ).key.dataSize() + KNS;
+            rightSize += V::keyStorageBound( keyNode( leftIndex ).key.dataSize() ) + KNS;
             if ( rightSize > rightSizeLimit ) {
                 split = l->n;
             }
         }
         if ( split == -1 ) {
             for( int i = l->n - 1; i > -1; --i ) {
-                rightSize += l->keyNode( i ).key.dataSize() + KNS;
+                rightSize += V::keyStorageBound( l->keyNode( i ).key.dataSize() ) + KNS;
                 if ( rightSize > rightSizeLimit ) {
                     split = i;
                     break;
@@ -1128,6 +1421,9 @@ namespace mongo {
         if ( canMergeChildren( thisLoc, leftIndex ) ) {
             return false;
         }
+        if ( !canBalanceChildren( thisLoc, leftIndex ) ) {
+            return false;
+        }
         thisLoc.btreemod<V>()->doBalanceChildren( btreeState, thisLoc, leftIndex );
         return true;
     }
@@ -1256,13 +1552,14 @@ namespace mongo {
             return true;
         }
 
-        BtreeBucket *pm = BTREEMOD(this->parent);
-        if ( mayBalanceRight ) {
-            pm->doMergeChildren( btreeState, this->parent, parentIdx );
+        // Prefix compressed children may be neither balanced nor merged, in
+        // which case this bucket stays below the low water mark.
+        if ( mayBalanceRight && p->canMergeChildren( this->parent, parentIdx ) ) {
+            BTREEMOD(this->parent)->doMergeChildren( btreeState, this->parent, parentIdx );
             return true;
         }
-        else if ( mayBalanceLeft ) {
-            pm->doMergeChildren( btreeState, this->parent, parentIdx - 1 );
+        else if ( mayBalanceLeft && p->canMergeChildren( this->parent, parentIdx - 1 ) ) {
+            BTREEMOD(this->parent)->doMergeChildren( btreeState, this->parent, parentIdx - 1 );
             return true;
         }
 
@@ -1412,12 +1709,14 @@ namespace mongo {
         int split = this->splitPos( keypos );
         DiskLoc rLoc = addBucket(btreeState);
         BtreeBucket *r = rLoc.btreemod<V>();
+        r->adoptPrefix( *this );
         if ( split_debug )
             out() << "     split:" << split << ' ' << keyNode(split).key.toString() << " n:" << this->n << endl;
         for ( int i = split+1; i < this->n; i++ ) {
             KeyNode kn = keyNode(i);
             r->pushBack(kn.recordLoc, kn.key, btreeState->ordering(), kn.prevChildBucket);
         }
+        r->_buildKeyCodes();
         r->nextChild = this->nextChild;
         r->assertValid( btreeState->ordering() );
 
@@ -1947,8 +2246,10 @@ namespace mongo {
 
     template class BucketBasics<V0>;
     template class BucketBasics<V1>;
+    template class BucketBasics<V2>;
     template class BtreeBucket<V0>;
     template class BtreeBucket<V1>;
+    template class BtreeBucket<V2>;
     template struct __KeyNode<DiskLoc>;
     template struct __KeyNode<DiskLoc56Bit>;
 
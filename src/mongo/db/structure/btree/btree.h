@@ -178,6 +178,21 @@ namespace mongo {
             reserved = 0;
         }
 
+        /** @return the key stored at body offset ofs */
+        KeyBson keyAt(short ofs) const { return KeyBson(data + ofs); }
+        /** @return the number of body bytes used by the key stored at ofs */
+        int keyDataSize(short ofs) const { return keyAt(ofs).dataSize(); }
+        /** @return the number of body bytes storeKey() would use for key */
+        int keyStorageSize(const KeyBson& key) const { return key.dataSize(); }
+        /**
+         * Writes keyStorageSize(key) bytes at dest.
+         * @return false if packing the bucket could store the key in less space
+         */
+        bool storeKey(char *dest, const KeyBson& key) const {
+            memcpy(dest, key.data(), key.dataSize());
+            return true;
+        }
+
         /** basicInsert() assumes the next three members are consecutive and in this order: */
 
         /** Size of the empty region. */
@@ -202,6 +217,22 @@ namespace mongo {
         static const int KeyMax = OldBucketSize / 10;
         // A sentinel value sometimes used to identify a deallocated bucket.
         static const int INVALID_N_SENTINEL = -1;
+        /** @return the most body bytes a key of keySize bytes can use in any bucket */
+        static int keyStorageBound(int keySize) { return keySize; }
+
+    protected:
+        /**
+         * BtreeBucket::find() first compares the key searched for with a bucket's keys by
+         * a code of their first field, if the version has one (see BtreeData_V2), and
+         * only looks at the keys themselves when the codes do not tell them apart.
+         * @return the code of key, 0 if there is none
+         */
+        static unsigned long long keyCode(const KeyBson& key) { return 0; }
+        /**
+         * @return < 0 or > 0 if the key with code 'code' orders before or after the key at
+         *         pos, whose _KeyNode is kn, 0 if that cannot be told from their codes
+         */
+        static int compareKeyCode(unsigned long long code, int pos, const _KeyNode& kn, const Ordering &o) { return 0; }
     };
 
     // a a a ofs ofs ofs ofs
@@ -293,6 +324,7 @@ namespace mongo {
         static const int KeyMax = 1024;
         // A sentinel value sometimes used to identify a deallocated bucket.
         static const unsigned short INVALID_N_SENTINEL = 0xffff;
+        static int keyStorageBound(int keySize) { return keySize; }
     protected:
         /** Parent bucket of this bucket, which isNull() for the root bucket. */
         Loc parent;
@@ -314,10 +346,195 @@ namespace mongo {
         char data[4];
 
         void _init() { }
+
+        // see BtreeData_V0
+        Key keyAt(short ofs) const { return Key(data + ofs); }
+        int keyDataSize(short ofs) const { return keyAt(ofs).dataSize(); }
+        int keyStorageSize(const Key& key) const { return key.dataSize(); }
+        bool storeKey(char *dest, const Key& key) const {
+            memcpy(dest, key.data(), key.dataSize());
+            return true;
+        }
+        static unsigned long long keyCode(const Key& key) { return 0; }
+        static int compareKeyCode(unsigned long long code, int pos, const _KeyNode& kn, const Ordering &o) { return 0; }
+    };
+
+    /**
+     * Bucket format of v:2 indexes.  Keys are in KeyV1 format as in BtreeData_V1,
+     * but a byte prefix shared by the keys of a bucket is stored only once, at
+     * prefixOfs in the body, and is stripped from every key that starts with it.
+     * Each key's data begins with a two byte header holding the number of bytes
+     * that follow and whether the prefix was stripped.
+     *
+     * The prefix is chosen when the bucket is packed.  A key that does not start
+     * with it when it is added is stored whole and the bucket is marked as not
+     * packed, as packing could choose a prefix which stores it in less space.
+     * A key therefore never takes more than keyStorageBound() bytes, and that is
+     * the size used to decide whether keys will fit when they move between
+     * buckets, whose prefixes may differ.
+     *
+     * Packing also lays out, below the prefix, a contiguous array with the top
+     * 32 bits of KeyV1::prefixCode() of each key in key order, so a binary search
+     * only touches the keys themselves where the codes are equal.  The array has
+     * room for codesCap codes, and holds exactly n of them whenever codesCap != 0.
+     * It is only reserved where a key of KeyMax bytes still fits next to it, so it
+     * never makes a bucket split earlier.  Inserts and deletes keep it up to date
+     * while it has room; otherwise it is dropped (codesCap = 0), and its space is
+     * reclaimed and the array rebuilt by the next pack.  Without the array the codes
+     * are computed from the keys' leading bytes, see keyCodeAt().
+     *
+     * |hhhh|kkkkkkk--------ssssssssssssuuussscccpppp|
+     * s = key suffix data (or whole keys)
+     * c = key codes
+     * p = prefix
+     */
+    class BtreeData_V2 {
+    public:
+        typedef DiskLoc56Bit Loc;
+        typedef __KeyNode<DiskLoc56Bit> _KeyNode;
+        typedef KeyV2 Key;
+        typedef KeyV2 KeyOwned;
+        enum { BucketSize = 8192-16 }; // leave room for Record header
+        static const int KeyMax = 1024;
+        // A sentinel value sometimes used to identify a deallocated bucket.
+        static const unsigned short INVALID_N_SENTINEL = 0xffff;
+        static int keyStorageBound(int keySize) { return sizeof(unsigned short) + keySize; }
+    protected:
+        /** Parent bucket of this bucket, which isNull() for the root bucket. */
+        Loc parent;
+        /** Given that there are n keys, this is the n index child. */
+        Loc nextChild;
+
+        unsigned short flags;
+
+        /** basicInsert() assumes the next three members are consecutive and in this order: */
+
+        /** Size of the empty region. */
+        unsigned short emptySize;
+        /** Size used for key storage, including the prefix and storage of old keys. */
+        unsigned short topSize;
+        /* Number of keys in the bucket. */
+        unsigned short n;
+
+        /** Offset within the body of the prefix shared by the keys. */
+        unsigned short prefixOfs;
+        /** Length of the prefix, 0 if there is none. */
+        unsigned short prefixLen;
+        /** Offset within the body of the key codes array. */
+        unsigned short codesOfs;
+        /** Number of codes the key codes array has room for, 0 if there is no array. */
+        unsigned short codesCap;
+
+        /* Beginning of the bucket's body */
+        char data[4];
+
+        void _init() {
+            prefixOfs = 0;
+            prefixLen = 0;
+            codesOfs = 0;
+            codesCap = 0;
+        }
+
+        enum { HasPrefix = 0x8000, LengthMask = 0x7fff };
+
+        unsigned short keyHeader(short ofs) const {
+            unsigned short h;
+            memcpy(&h, data + ofs, sizeof(h));
+            return h;
+        }
+        bool keyHasPrefix(short ofs) const { return prefixLen && ( keyHeader(ofs) & HasPrefix ); }
+
+        // see BtreeData_V0
+        Key keyAt(short ofs) const {
+            unsigned short h = keyHeader(ofs);
+            const char *rest = data + ofs + sizeof(h);
+            if ( h & HasPrefix )
+                return Key(data + prefixOfs, prefixLen, rest, h & LengthMask);
+            return Key(rest, h & LengthMask, 0, 0);
+        }
+        int keyDataSize(short ofs) const { return sizeof(unsigned short) + ( keyHeader(ofs) & LengthMask ); }
+        int keyStorageSize(const Key& key) const { return storedSize(key, data + prefixOfs, prefixLen); }
+        bool storeKey(char *dest, const Key& key) const { return store(dest, key, data + prefixOfs, prefixLen); }
+        static unsigned long long keyCode(const Key& key) { return key.prefixCode(); }
+
+        /** the part of a code kept in the key codes array, 0 only if the code is 0 */
+        typedef unsigned int StoredCode;
+        static StoredCode storedCode(unsigned long long code) { return static_cast<StoredCode>(code >> 32); }
+        bool hasKeyCodes() const { return codesCap != 0; }
+        StoredCode storedCodeAt(int pos) const {
+            StoredCode c;
+            memcpy(&c, data + codesOfs + pos * sizeof(c), sizeof(c));
+            return c;
+        }
+        /**
+         * @return the capacity of a key codes array for n keys taking 'used' bytes with their
+         *         _KeyNodes, with room for as many more keys of their average size as fit in
+         *         'avail' free bytes, but leaving room for a key of KeyMax bytes; or 0 if that
+         *         does not leave room for n codes
+         */
+        static int keyCodesCapacity(int n, int used, int avail) {
+            if ( n == 0 )
+                return 0;
+            const int codeSize = sizeof(StoredCode);
+            int perKey = used / n + codeSize;
+            int cap = n + std::max(avail - n * codeSize, 0) / perKey;
+            int spare = avail - keyStorageBound(KeyMax) - static_cast<int>(sizeof(_KeyNode));
+            cap = std::min(cap, spare / codeSize);
+            return cap >= n ? cap : 0;
+        }
+
+        /**
+         * KeyV1::prefixCode() of the key at ofs, from its leading bytes, without reassembling
+         * the key, for buckets without a key codes array.
+         */
+        unsigned long long keyCodeAt(short ofs) const {
+            // the code never looks past the type byte and the 9 bytes after it
+            char lead[16];
+            memset(lead, 0, sizeof(lead));
+            unsigned short h = keyHeader(ofs);
+            int fromPrefix = ( h & HasPrefix ) ? std::min<int>(prefixLen, sizeof(lead)) : 0;
+            memcpy(lead, data + prefixOfs, fromPrefix);
+            memcpy(lead + fromPrefix, data + ofs + sizeof(h),
+                   std::min<int>(h & LengthMask, sizeof(lead) - fromPrefix));
+            return KeyV1(lead).prefixCode();
+        }
+        int compareKeyCode(unsigned long long code, int pos, const _KeyNode& kn, const Ordering &o) const {
+            if ( code == 0 )
+                return 0;
+            unsigned long long knCode;
+            if ( hasKeyCodes() ) {
+                code = storedCode(code);
+                knCode = storedCodeAt(pos);
+            }
+            else {
+                knCode = keyCodeAt(kn.keyDataOfs());
+            }
+            if ( knCode == 0 || code == knCode )
+                return 0;
+            int x = code < knCode ? -1 : 1;
+            return o.descending(1) ? -x : x;
+        }
+
+        static bool startsWith(const Key& key, const char *prefix, int prefixLen) {
+            return prefixLen && key.dataSize() >= prefixLen && memcmp(key.data(), prefix, prefixLen) == 0;
+        }
+        static int storedSize(const Key& key, const char *prefix, int prefixLen) {
+            return keyStorageBound(key.dataSize()) - ( startsWith(key, prefix, prefixLen) ? prefixLen : 0 );
+        }
+        /** @return true if the prefix was stripped */
+        static bool store(char *dest, const Key& key, const char *prefix, int prefixLen) {
+            bool stripped = startsWith(key, prefix, prefixLen);
+            int skip = stripped ? prefixLen : 0;
+            unsigned short h = ( key.dataSize() - skip ) | ( stripped ? HasPrefix : 0 );
+            memcpy(dest, &h, sizeof(h));
+            memcpy(dest + sizeof(h), key.data() + skip, key.dataSize() - skip);
+            return stripped;
+        }
     };
 
     typedef BtreeData_V0 V0;
     typedef BtreeData_V1 V1;
+    typedef BtreeData_V2 V2;
 
     /**
      * This class adds functionality to BtreeData for managing a single bucket.
@@ -395,7 +612,7 @@ namespace mongo {
             return (char*)&(d->data) - (char*)&(d->parent);
         }
         static int bodySize() { return Version::BucketSize - headerSize(); }
-        static int lowWaterMark() { return bodySize() / 2 - Version::KeyMax - sizeof( _KeyNode ) + 1; } // see comment in btree.cpp
+        static int lowWaterMark() { return bodySize() / 2 - Version::keyStorageBound( Version::KeyMax ) - sizeof( _KeyNode ) + 1; } // see comment in btree.cpp
 
         // for testing
         int nKeys() const { return this->n; }
@@ -609,8 +826,46 @@ namespace mongo {
          *    _KeyNode data and without shifting any other _KeyNode objects.
          */
         void setKey( int i, const DiskLoc recordLoc, const Key& key, const DiskLoc prevChildBucket );
+
+        /**
+         * Preconditions:
+         *  - n == 0
+         * Postconditions:
+         *  - Keys moved here from 'from' take no more space than they did there.
+         *    Only has an effect for versions which share a key prefix within a
+         *    bucket, which is copied.
+         */
+        void adoptPrefix( const BucketBasics& from );
+
+        /**
+         * Keep the key codes array of versions which have one (see BtreeData_V2) in step
+         * with the keys.  _insertKeyCode() is called once key was inserted at pos and n
+         * incremented, _removeKeyCode() once the key at pos was removed and n decremented.
+         * Either may drop the array.  Both declare their own write intents.
+         */
+        void _insertKeyCode( int pos, const Key& key );
+        void _removeKeyCode( int pos );
+        /** Drops the key codes array, for changes which don't keep it up to date. */
+        void _dropKeyCodes();
+        /** Adds a key codes array to a bucket without one, if there is room. */
+        void _buildKeyCodes();
+
+    public:
+        /** @return false if the bucket's key codes array does not match its keys */
+        bool keyCodesMatchKeys() const { return true; }
     };
 
+    // v:2 buckets choose their key prefix when packed and size keys by their
+    // uncompressed length, see BtreeData_V2
+    template<> int BucketBasics<V2>::packedDataSize( int refPos ) const;
+    template<> void BucketBasics<V2>::_packReadyForMod( const Ordering &order, int &refPos );
+    template<> void BucketBasics<V2>::adoptPrefix( const BucketBasics<V2>& from );
+    template<> void BucketBasics<V2>::_insertKeyCode( int pos, const KeyV2& key );
+    template<> void BucketBasics<V2>::_removeKeyCode( int pos );
+    template<> void BucketBasics<V2>::_dropKeyCodes();
+    template<> void BucketBasics<V2>::_buildKeyCodes();
+    template<> bool BucketBasics<V2>::keyCodesMatchKeys() const;
+
     class IndexDetails;
 
     /**
@@ -863,7 +1118,8 @@ namespace mongo {
          *    fewer than lowWaterMark bytes.
          * Postconditions:
          *  - If the child bucket at leftIndex can merge with the child index
-         *    at leftIndex + 1, do nothing and return false.
+         *    at leftIndex + 1, or the children cannot be balanced, do nothing
+         *    and return false.
          *  - Otherwise, balance keys between the leftIndex child and the
          *    leftIndex + 1 child, return true, and possibly change the tree head.
          */
@@ -943,6 +1199,21 @@ namespace mongo {
          */
         bool canMergeChildren( const DiskLoc &thisLoc, int leftIndex ) const;
 
+        /**
+         * @return true iff rebalancedSeparatorPos() can split the keys of the
+         *  leftIndex and leftIndex + 1 children so that each side fits in a
+         *  bucket.  This always holds for children which cannot be merged unless
+         *  their keys are prefix compressed, in which case they may together be
+         *  larger than two buckets when sized uncompressed.
+         */
+        bool canBalanceChildren( const DiskLoc &thisLoc, int leftIndex ) const;
+
+        /**
+         * @return packed body size of the leftIndex and leftIndex + 1 children
+         *  together with the thisLoc key at leftIndex.
+         */
+        int childrenDataSize( const DiskLoc &thisLoc, int leftIndex ) const;
+
         /**
          * Preconditions:
          *  - leftIndex and leftIndex + 1 children are packed
@@ -964,7 +1235,7 @@ namespace mongo {
         Key keyAt(int i) const {
             if( i >= this->n ) 
                 return Key();
-            return Key(this->data + k(i).keyDataOfs());
+            return V::keyAt(k(i).keyDataOfs());
         }
     protected:
 
@@ -1071,7 +1342,7 @@ namespace mongo {
     template< class V >
     BucketBasics<V>::KeyNode::KeyNode(const BucketBasics<V>& bb, const _KeyNode &k) :
         prevChildBucket(k.prevChildBucket),
-        recordLoc(k.recordLoc), key(bb.data+k.keyDataOfs())
+        recordLoc(k.recordLoc), key(bb.keyAt(k.keyDataOfs()))
     { }
 
     template< class V >
@@ -77,6 +77,24 @@ namespace mongo {
         b = _getModifiableBucket( cur );
     }
 
+    /**
+     * Buckets of some versions (see BtreeData_V2) only make full use of their space once
+     * packed, so a full bucket is packed and tried again before giving up on it.
+     * @return false if the key does not fit in 'bucket'.
+     */
+    template<class V>
+    bool BtreeBuilder<V>::pushBack(BtreeBucket<V> *bucket, const DiskLoc recordLoc, const Key& key, const DiskLoc prevChild) {
+        if ( bucket->_pushBack(recordLoc, key, _btreeState->ordering(), prevChild) ) {
+            return true;
+        }
+        if ( bucket->flags & BtreeBucket<V>::Packed ) {
+            return false;
+        }
+        int zeropos = 0;
+        bucket->_packReadyForMod(_btreeState->ordering(), zeropos);
+        return bucket->_pushBack(recordLoc, key, _btreeState->ordering(), prevChild);
+    }
+
     template<class V>
     void BtreeBuilder<V>::mayCommitProgressDurably() {
         if ( getDur().commitIfNeeded() ) {
@@ -110,7 +128,7 @@ namespace mongo {
             }
         }
 
-        if ( ! b->_pushBack(loc, *key, _btreeState->ordering(), DiskLoc()) ) {
+        if ( ! pushBack(b, loc, *key, DiskLoc()) ) {
             // bucket was full
             newBucket();
             b->pushBack(loc, *key, _btreeState->ordering(), DiskLoc());
@@ -151,7 +169,7 @@ namespace mongo {
                 bool keepX = ( x->n != 0 );
                 DiskLoc keepLoc = keepX ? xloc : x->nextChild;
 
-                if ( ! up->_pushBack(r, k, _btreeState->ordering(), keepLoc) ) {
+                if ( ! pushBack(up, r, k, keepLoc) ) {
                     // current bucket full
                     DiskLoc n = BtreeBucket<V>::addBucket(_btreeState);
                     up->setTempNext(n);
@@ -193,5 +211,6 @@ namespace mongo {
 
     template class BtreeBuilder<V0>;
     template class BtreeBuilder<V1>;
+    template class BtreeBuilder<V2>;
 
 }
@@ -57,6 +57,7 @@ namespace mongo {
         BtreeBucket<V> *b;
 
         void newBucket();
+        bool pushBack(BtreeBucket<V> *bucket, const DiskLoc recordLoc, const Key& key, const DiskLoc prevChild);
         void buildNextLevel(DiskLoc loc, bool mayInterrupt);
         void mayCommitProgressDurably();
 
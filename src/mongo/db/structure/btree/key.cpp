@@ -367,6 +367,40 @@ namespace mongo {
         dassert( (*_keyData & cNOTUSED) == 0 );
     }
 
+    KeyV2::KeyV2(const BSONObj& obj) {
+        KeyV1Owned k(obj);
+        _set(k.data(), k.dataSize(), 0, 0);
+    }
+
+    KeyV2::KeyV2(const KeyV2& rhs) : KeyV1() {
+        if( rhs.isValid() )
+            _set(rhs.data(), rhs.dataSize(), 0, 0);
+    }
+
+    KeyV2::KeyV2(const char *prefix, int prefixLen, const char *rest, int restLen) {
+        _set(prefix, prefixLen, rest, restLen);
+    }
+
+    void KeyV2::assign(const KeyV2& rhs) {
+        if( &rhs == this )
+            return;
+        _set(rhs.data(), rhs.dataSize(), 0, 0);
+    }
+
+    void KeyV2::_set(const char *prefix, int prefixLen, const char *rest, int restLen) {
+        _b.reset();
+        _b.appendBuf(prefix, prefixLen);
+        _b.appendBuf(rest, restLen);
+        _keyData = (const unsigned char *) _b.buf();
+        dassert( _b.len() == KeyV1::dataSize() ); // the pieces must make up exactly one key
+    }
+
+    BSONObj KeyV2::toBson() const {
+        BSONObj o = KeyV1::toBson();
+        // traditional bson keys are returned in place
+        return isCompactFormat() ? o : o.getOwned();
+    }
+
     BSONObj KeyV1::toBson() const { 
         verify( _keyData != 0 );
         if( !isCompactFormat() )
@@ -526,6 +560,55 @@ namespace mongo {
         return 0;
     }
 
+    /** the canonical type goes in the top byte, followed by the first 7 bytes of a big endian 
+        encoding of the value which orders as compare() does.  values of types not encoded this 
+        way only get the type.
+    */
+    unsigned long long KeyV1::prefixCode() const { 
+        const unsigned char *p = _keyData;
+        if( *p == IsBSON )
+            return 0;
+        unsigned long long type = *p & cCANONTYPEMASK;
+        p++;
+        unsigned long long v = 0;
+        switch( type ) { 
+        case cdouble:
+            {
+                double d = (reinterpret_cast< const PackedDouble* >(p))->d;
+                if( d != d ) // NaN is never stored in compact format, but would not order
+                    return 0;
+                if( d == 0 ) 
+                    d = 0; // -0 == 0
+                memcpy(&v, &d, sizeof(v));
+                // negatives order by magnitude reversed, and below positives
+                v = ( v & (1ULL << 63) ) ? ~v : v | (1ULL << 63);
+                break;
+            }
+        case cdate:
+            {
+                long long L;
+                memcpy(&L, p, sizeof(L));
+                v = ((unsigned long long) L) ^ (1ULL << 63);
+                break;
+            }
+        case cstring:
+            {
+                int len = *p++;
+                // shorter strings sort first when the common bytes match, so pad with zeros
+                for( int i = 0; i < 8; i++ ) 
+                    v = (v << 8) | ( i < len ? p[i] : 0 );
+                break;
+            }
+        case coid:
+            for( int i = 0; i < 8; i++ ) 
+                v = (v << 8) | p[i];
+            break;
+        default:
+            ;
+        }
+        return (type << 56) | (v >> 8);
+    }
+
     // at least one of this and right are traditional BSON format
     int NOINLINE_DECL KeyV1::compareHybrid(const KeyV1& right, const Ordering& order) const { 
         BSONObj L = toBson();
@@ -692,4 +775,33 @@ namespace mongo {
         }
     } cunittest;
 
+    struct PrefixCodeUnitTest : public StartupTest {
+        void run() {
+            BSONObj keys[] = {
+                BSON( "" << MINKEY ), BSON( "" << BSONNULL ),
+                BSON( "" << -1e300 ), BSON( "" << -2 ), BSON( "" << -1.5 ), BSON( "" << -0.0 ),
+                BSON( "" << 0 ), BSON( "" << 1e-300 ), BSON( "" << 1 ), BSON( "" << 1LL << "" << 2 ),
+                BSON( "" << 3000000000LL ), BSON( "" << 1e300 ),
+                BSON( "" << "" ), BSON( "" << "a" ), BSON( "" << "abcdefg" ),
+                BSON( "" << "abcdefgh" ), BSON( "" << "abcdefgi" ), BSON( "" << "b" ),
+                BSON( "" << OID( "000000000000000000000000" ) ), BSON( "" << OID( "ffffffffffffffffffffffff" ) ),
+                BSON( "" << false ), BSON( "" << true ),
+                BSON( "" << Date_t( -1000 ) ), BSON( "" << Date_t( 0 ) ), BSON( "" << Date_t( 1000 ) ),
+                BSON( "" << MAXKEY )
+            };
+            int n = sizeof( keys ) / sizeof( keys[ 0 ] );
+            for( int i = 0; i < n; i++ ) {
+                KeyV1Owned a( keys[ i ] );
+                for( int j = 0; j < n; j++ ) {
+                    KeyV1Owned b( keys[ j ] );
+                    unsigned long long ca = a.prefixCode(), cb = b.prefixCode();
+                    verify( ca && cb );
+                    int x = a.woCompare( b, nullOrdering );
+                    if( ca < cb ) verify( x < 0 );
+                    if( ca > cb ) verify( x > 0 );
+                }
+            }
+        }
+    } prefixcodeunittest;
+
 }
@@ -99,6 +99,13 @@ namespace mongo {
         bool isCompactFormat() const { return *_keyData != IsBSON; }
 
         bool isValid() const { return _keyData > (const unsigned char*)1; }
+
+        /** @return a code such that if the codes of two keys differ, they order the keys 
+                    as an ascending first field would, by comparing as unsigned integers.
+                    keys with equal codes may still differ.  0 if there is no code, which 
+                    is the case for keys in traditional bson format.
+        */
+        unsigned long long prefixCode() const;
     protected:
         enum { IsBSON = 0xff };
         const unsigned char *_keyData;
@@ -127,4 +134,37 @@ namespace mongo {
         void traditional(const BSONObj& obj); // store as traditional bson not as compact format
     };
 
+    /** KeyV1 format key which always owns its buffer.
+
+        corresponding to BtreeData_V2, whose buckets store a key prefix once and only the
+        remaining bytes per key, so a key read from a bucket is reassembled here rather than
+        pointed to.
+    */
+    class KeyV2 : public KeyV1 {
+        void operator=(const KeyV2&);
+    public:
+        KeyV2() { }
+
+        /** @obj a BSON object to be translated to KeyV1 format, see KeyV1Owned */
+        explicit KeyV2(const BSONObj& obj);
+
+        /** makes a copy */
+        KeyV2(const KeyV2& rhs);
+
+        /** reassembles a key from a prefix and the rest of its bytes */
+        KeyV2(const char *prefix, int prefixLen, const char *rest, int restLen);
+
+        void assign(const KeyV2& rhs);
+
+        int dataSize() const { return _b.len(); }
+
+        /** unlike KeyV1::toBson() the result never points into our buffer */
+        BSONObj toBson() const;
+        string toString() const { return toBson().toString(); }
+
+    private:
+        void _set(const char *prefix, int prefixLen, const char *rest, int restLen);
+        StackBufBuilder _b;
+    };
+
 };
@@ -63,6 +63,7 @@ namespace mongo {
         }
 
         ss << " validateDocuments: " << validateDocuments;
+        ss << " batchSize: " << batchSize;
 
         return ss.str();
     }
@@ -345,6 +346,7 @@ namespace mongo {
             Status ret = iam->update(*updateTickets.mutableMap()[descriptor], &updatedKeys);
             if ( !ret.isOK() )
                 return StatusWith<DiskLoc>( ret );
+            _indexCatalog.noteKeysWritten( descriptor, updatedKeys );
             if ( debug )
                 debug->keyUpdates += updatedKeys;
         }
@@ -69,6 +69,7 @@ namespace mongo {
             validateDocuments = true;
             paddingFactor = 1;
             paddingBytes = 0;
+            batchSize = 100;
         }
 
         // padding
@@ -88,15 +89,39 @@ namespace mongo {
         // other
         bool validateDocuments;
 
+        // only used by an online compact, records moved while holding the lock
+        int batchSize;
+
         std::string toString() const;
     };
 
     struct CompactStats {
         CompactStats() {
             corruptDocuments = 0;
+            recordsMoved = 0;
+            extentsFreed = 0;
+            bytesReclaimed = 0;
         }
 
         long long corruptDocuments;
+
+        // online compact only
+        long long recordsMoved;
+        long long extentsFreed;
+        long long bytesReclaimed;
+    };
+
+    /**
+     * Where an online compact is between two batches, see Collection::compactBatch().
+     */
+    struct OnlineCompactState {
+        OnlineCompactState() {
+            extentsLeft = -1;
+        }
+
+        DiskLoc extent; // the extent being emptied, null when the next one is to be picked
+        int extentsLeft; // how many more extents may be emptied, -1 before the first batch
+        CompactStats stats;
     };
 
     /**
@@ -124,6 +149,8 @@ namespace mongo {
         const IndexCatalog* getIndexCatalog() const { return &_indexCatalog; }
         IndexCatalog* getIndexCatalog() { return &_indexCatalog; }
 
+        const RecordStore* getRecordStore() const { return &_recordStore; }
+
         bool requiresIdIndex() const;
 
         BSONObj docFor( const DiskLoc& loc );
@@ -174,6 +201,15 @@ namespace mongo {
 
         StatusWith<CompactStats> compact( const CompactOptions* options );
 
+        /**
+         * Does one batch of an online compact, which empties the extents at the end of the
+         * collection by moving their records into the free space of the others, updating the
+         * indexes record by record, and frees them once they're empty.  The caller holds the
+         * write lock for one batch and may release it in between.
+         * @return whether there may be more to do
+         */
+        StatusWith<bool> compactBatch( const CompactOptions* options, OnlineCompactState* state );
+
         // -----------
 
 
@@ -212,6 +248,17 @@ namespace mongo {
                             vector<IndexAccessMethod*>& indexesToInsertTo,
                             const CompactOptions* compactOptions, CompactStats* stats );
 
+        // compactBatch() without releasing the extent being emptied when compact stops
+        StatusWith<bool> _compactBatch( const CompactOptions* options,
+                                        OnlineCompactState* state );
+
+        // ends an online compact, giving back the free space of an extent it was emptying
+        void _stopOnlineCompact( OnlineCompactState* state );
+
+        // takes an extent whose records have all been moved out of the collection, and whose
+        // deleted records have been orphaned, and frees it
+        void _freeEmptyExtent( const DiskLoc& extentLoc );
+
         // @return 0 for inf., otherwise a number of files
         int largestFileNumberInQuota() const;
 
@@ -74,6 +74,36 @@ namespace mongo {
         size_t _allocationSize;
     };
 
+    /**
+     * @return the length with header of a record compacted from 'recOld'
+     */
+    unsigned _compactRecordLength( const CompactOptions* compactOptions,
+                                   const NamespaceDetails* details,
+                                   const Record* recOld,
+                                   unsigned docSize ) {
+        unsigned lenWHdr = docSize + Record::HeaderSize;
+        unsigned lenWPadding = lenWHdr;
+
+        switch( compactOptions->paddingMode ) {
+        case CompactOptions::NONE:
+            if ( details->isUserFlagSet(NamespaceDetails::Flag_UsePowerOf2Sizes) )
+                lenWPadding = details->quantizePowerOf2AllocationSpace(lenWPadding);
+            break;
+        case CompactOptions::PRESERVE:
+            // if we are preserving the padding, the record should not change size
+            lenWPadding = recOld->lengthWithHeaders();
+            break;
+        case CompactOptions::MANUAL:
+            lenWPadding = compactOptions->computeRecordSize(lenWPadding);
+            if (lenWPadding < lenWHdr || lenWPadding > BSONObjMaxUserSize / 2 ) {
+                lenWPadding = lenWHdr;
+            }
+            break;
+        }
+
+        return lenWPadding;
+    }
+
     void Collection::_compactExtent(const DiskLoc diskloc, int extentNumber,
                                     vector<IndexAccessMethod*>& indexesToInsertTo,
                                     const CompactOptions* compactOptions, CompactStats* stats ) {
@@ -125,25 +155,8 @@ namespace mongo {
                         oldObjSize += docSize;
                         oldObjSizeWithPadding += recOld->netLength();
 
-                        unsigned lenWHdr = docSize + Record::HeaderSize;
-                        unsigned lenWPadding = lenWHdr;
-
-                        switch( compactOptions->paddingMode ) {
-                        case CompactOptions::NONE:
-                            if ( details()->isUserFlagSet(NamespaceDetails::Flag_UsePowerOf2Sizes) )
-                                lenWPadding = details()->quantizePowerOf2AllocationSpace(lenWPadding);
-                            break;
-                        case CompactOptions::PRESERVE:
-                            // if we are preserving the padding, the record should not change size
-                            lenWPadding = recOld->lengthWithHeaders();
-                            break;
-                        case CompactOptions::MANUAL:
-                            lenWPadding = compactOptions->computeRecordSize(lenWPadding);
-                            if (lenWPadding < lenWHdr || lenWPadding > BSONObjMaxUserSize / 2 ) {
-                                lenWPadding = lenWHdr;
-                            }
-                            break;
-                        }
+                        unsigned lenWPadding = _compactRecordLength( compactOptions, details(),
+                                                                     recOld, docSize );
 
                         CompactDocWriter writer( objOld, lenWPadding );
                         StatusWith<DiskLoc> status = _recordStore.insertRecord( &writer, 0 );
@@ -257,7 +270,7 @@ namespace mongo {
         }
 
         log() << "compact orphan deleted lists" << endl;
-        d->orphanDeletedList();
+        _recordStore.orphanDeletedList();
 
         // Start over from scratch with our extent sizing and growth
         d->setLastExtentSize( 0 );
@@ -346,5 +359,190 @@ namespace mongo {
         return StatusWith<CompactStats>( stats );
     }
 
+    StatusWith<bool> Collection::compactBatch( const CompactOptions* compactOptions,
+                                               OnlineCompactState* state ) {
+        StatusWith<bool> more( false );
+        try {
+            more = _compactBatch( compactOptions, state );
+            if ( more.isOK() && more.getValue() )
+                return more;
+        }
+        catch ( ... ) {
+            _stopOnlineCompact( state );
+            throw;
+        }
+
+        _stopOnlineCompact( state );
+        return more;
+    }
+
+    void Collection::_stopOnlineCompact( OnlineCompactState* state ) {
+        // deleted space goes on the lists again
+        _recordStore.setOrphanedExtent( DiskLoc() );
+        if ( state->extent.isNull() )
+            return;
+
+        // stopped partway through an extent: the space of the records moved out of it so far,
+        // and of its deleted records, would otherwise stay orphaned.  the extent went away if
+        // the collection was dropped while the lock was released.
+        NamespaceDetails* d = details();
+        for( DiskLoc L = d->firstExtent(); !L.isNull(); L = L.ext()->xnext ) {
+            if ( L == state->extent ) {
+                log() << "compact online stopping partway through extent " << L << " of "
+                      << _ns << ", putting its free space on the deleted lists";
+                _recordStore.restoreDeletedRecordsInExtent( L );
+                break;
+            }
+        }
+        state->extent = DiskLoc();
+    }
+
+    StatusWith<bool> Collection::_compactBatch( const CompactOptions* compactOptions,
+                                                OnlineCompactState* state ) {
+
+        killCurrentOp.checkForInterrupt( false );
+
+        if ( isCapped() )
+            return StatusWith<bool>( ErrorCodes::BadValue, "cannot compact capped collection" );
+
+        if ( _indexCatalog.numIndexesInProgress() )
+            return StatusWith<bool>( ErrorCodes::BadValue,
+                                     "cannot compact when indexes in progress" );
+
+        NamespaceDetails* d = details();
+
+        if ( state->extentsLeft < 0 ) {
+            // each extent is emptied at most once, so records moved into extents which are
+            // added while compacting aren't moved around again
+            state->extentsLeft = 0;
+            for( DiskLoc L = d->firstExtent(); !L.isNull(); L = L.ext()->xnext )
+                state->extentsLeft++;
+        }
+
+        if ( !state->extent.isNull() ) {
+            // the extent went away if the collection was dropped while the lock was released
+            bool found = false;
+            for( DiskLoc L = d->firstExtent(); !L.isNull() && !found; L = L.ext()->xnext )
+                found = L == state->extent;
+            if ( !found )
+                state->extent = DiskLoc();
+        }
+
+        if ( state->extent.isNull() ) {
+            DiskLoc last = d->lastExtent();
+            if ( state->extentsLeft == 0 || last.isNull() || last == d->firstExtent() )
+                return StatusWith<bool>( false );
+
+            long long needed = 0;
+            for ( DiskLoc L = last.ext()->firstRecord; !L.isNull();
+                  L = getExtentManager()->getNextRecordInExtent( L ) ) {
+                Record* rec = L.rec();
+                needed += _compactRecordLength( compactOptions, d, rec,
+                                                BSONObj::make( rec ).objsize() );
+            }
+
+            long long available = _recordStore.deletedRecordsLength( last );
+            if ( available < needed ) {
+                log() << "compact online stopping, " << available << " bytes free for the "
+                      << needed << " bytes of extent " << last << " in " << _ns;
+                return StatusWith<bool>( false );
+            }
+
+            log() << "compact online emptying extent " << last << " of " << _ns;
+            state->extent = last;
+            state->extentsLeft--;
+        }
+
+        if ( _recordStore.getOrphanedExtent() != state->extent ) {
+            // first batch of the extent, or the collection was reopened since the last one: the
+            // space of the extent must not be allocated while its records are moved out of it
+            _recordStore.orphanDeletedRecordsInExtent( state->extent );
+            _recordStore.setOrphanedExtent( state->extent );
+        }
+
+        Extent* e = state->extent.ext();
+        int moved = 0;
+        while ( !e->firstRecord.isNull() && moved < compactOptions->batchSize ) {
+            DiskLoc oldLoc = e->firstRecord;
+            Record* recOld = oldLoc.rec();
+            BSONObj objOld = BSONObj::make( recOld );
+
+            if ( compactOptions->validateDocuments && !objOld.valid() ) {
+                return StatusWith<bool>( ErrorCodes::BadValue,
+                                         str::stream() << "corrupt document at "
+                                         << oldLoc.toString()
+                                         << ", only an offline compact can skip it" );
+            }
+
+            unsigned lenWPadding = _compactRecordLength( compactOptions, d, recOld,
+                                                         objOld.objsize() );
+            DiskLoc lastExtent = d->lastExtent();
+
+            // move it like an update would, except that the old space isn't reused
+            ClientCursor::invalidateDocument( _ns.ns(), d, oldLoc, INVALIDATION_DELETION );
+            _indexCatalog.unindexRecord( objOld, oldLoc, true );
+
+            CompactDocWriter writer( objOld, lenWPadding );
+            StatusWith<DiskLoc> newLoc = _recordStore.insertRecord( &writer, 0 );
+            if ( !newLoc.isOK() ) {
+                _indexCatalog.indexRecord( objOld, oldLoc );
+                return StatusWith<bool>( newLoc.getStatus() );
+            }
+
+            try {
+                _indexCatalog.indexRecord( objOld, newLoc.getValue() );
+            }
+            catch ( DBException& ) {
+                _recordStore.deleteRecord( newLoc.getValue() );
+                _indexCatalog.indexRecord( objOld, oldLoc );
+                throw;
+            }
+
+            _recordStore.orphanRecord( oldLoc );
+            moved++;
+
+            if ( d->lastExtent() != lastExtent && state->extentsLeft > 0 ) {
+                log() << "compact online ran out of free space in " << _ns
+                      << ", finishing with extent " << state->extent;
+                state->extentsLeft = 0;
+            }
+        }
+
+        state->stats.recordsMoved += moved;
+        _infoCache.notifyOfWriteOp();
+
+        if ( e->firstRecord.isNull() ) {
+            int length = e->length;
+            _freeEmptyExtent( state->extent );
+            _recordStore.setOrphanedExtent( DiskLoc() );
+            state->stats.extentsFreed++;
+            state->stats.bytesReclaimed += length;
+            state->extent = DiskLoc();
+        }
+
+        getDur().commitIfNeeded();
+
+        return StatusWith<bool>( true );
+    }
+
+    void Collection::_freeEmptyExtent( const DiskLoc& extentLoc ) {
+        NamespaceDetails* d = details();
+        Extent* e = extentLoc.ext();
+        verify( e->firstRecord.isNull() );
+
+        if ( e->xprev.isNull() )
+            d->setFirstExtent( e->xnext );
+        else
+            getDur().writingDiskLoc( e->xprev.ext()->xnext ) = e->xnext;
+
+        if ( e->xnext.isNull() )
+            d->setLastExtent( e->xprev );
+        else
+            getDur().writingDiskLoc( e->xnext.ext()->xprev ) = e->xprev;
+
+        getDur().writing( e )->markEmpty();
+        getExtentManager()->freeExtents( extentLoc, extentLoc );
+    }
+
 
 }
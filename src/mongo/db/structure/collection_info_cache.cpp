@@ -30,6 +30,7 @@
 
 #include "mongo/db/structure/collection_info_cache.h"
 
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/namespace_details-inl.h"
@@ -42,6 +43,19 @@
 
 namespace mongo {
 
+    static ServerStatusMetricField<Counter64> displayPlanCacheEntries(
+            "queryExecutor.planCache.entries", &PlanCache::totalEntries );
+    static ServerStatusMetricField<Counter64> displayPlanCacheSizeBytes(
+            "queryExecutor.planCache.sizeBytes", &PlanCache::totalSizeBytes );
+    static ServerStatusMetricField<Counter64> displayPlanCacheHits(
+            "queryExecutor.planCache.hits", &PlanCache::totalHits );
+    static ServerStatusMetricField<Counter64> displayPlanCacheMisses(
+            "queryExecutor.planCache.misses", &PlanCache::totalMisses );
+    static ServerStatusMetricField<Counter64> displayPlanCacheEvictions(
+            "queryExecutor.planCache.evictions", &PlanCache::totalEvictions );
+    static ServerStatusMetricField<Counter64> displayPlanCacheReplans(
+            "queryExecutor.planCache.replans", &PlanCache::totalReplans );
+
     CollectionInfoCache::CollectionInfoCache( Collection* collection )
         : _collection( collection ),
           _keysComputed( false ),
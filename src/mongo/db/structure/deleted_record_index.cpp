@@ -0,0 +1,321 @@
+// deleted_record_index.cpp
+
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/db/structure/deleted_record_index.h"
+
+#include <algorithm>
+
+#include "mongo/db/dur.h"
+#include "mongo/db/namespace_details.h"
+#include "mongo/db/storage/record.h"
+#include "mongo/platform/bits.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/log.h"
+
+namespace mongo {
+
+    namespace {
+        // log2(DeletedRecordIndex::kMinClassSize)
+        const int kMinClassPower = 5;
+
+        // records are at most 2gb, the length of an extent
+        const int kMaxClassPower = 30;
+    }
+
+    const int DeletedRecordIndex::kNumClasses =
+        (kMaxClassPower - kMinClassPower + 1) * kClassesPerPowerOf2;
+
+    DeletedRecordIndex::DeletedRecordIndex() {
+        clear();
+    }
+
+    // static
+    int DeletedRecordIndex::sizeClass(int lengthWithHeaders) {
+        if (lengthWithHeaders < kMinClassSize) {
+            return 0;
+        }
+        int power = 0;
+        for (int x = lengthWithHeaders; x > 1; x >>= 1) {
+            ++power;
+        }
+        const int step = (1 << power) / kClassesPerPowerOf2;
+        int c = (power - kMinClassPower) * kClassesPerPowerOf2
+              + (lengthWithHeaders - (1 << power)) / step;
+        return std::min(c, kNumClasses - 1);
+    }
+
+    // static
+    int DeletedRecordIndex::sizeClassMinLength(int sizeClass) {
+        const int power = kMinClassPower + sizeClass / kClassesPerPowerOf2;
+        return (1 << power) + (sizeClass % kClassesPerPowerOf2) * ((1 << power) /
+                                                                   kClassesPerPowerOf2);
+    }
+
+    void DeletedRecordIndex::clear() {
+        _active = false;
+        _entries.clear();
+        _classes.assign(kNumClasses, std::vector<ClassMember>());
+        _classBytes.assign(kNumClasses, 0);
+        _nonEmptyClasses.assign((kNumClasses + 63) / 64, 0);
+        _heads.assign(Buckets, DiskLoc());
+        _bytes = 0;
+    }
+
+    void DeletedRecordIndex::sync(NamespaceDetails* details) {
+        _active = true;
+        for (int b = 0; b < Buckets; ++b) {
+            if (details->deletedListEntry(b) != _heads[b]) {
+                _syncBucket(details, b);
+            }
+        }
+    }
+
+    bool DeletedRecordIndex::isInSync(const NamespaceDetails* details) const {
+        if (!_active) {
+            return false;
+        }
+        for (int b = 0; b < Buckets; ++b) {
+            if (details->deletedListEntry(b) != _heads[b]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    DiskLoc DeletedRecordIndex::take(NamespaceDetails* details, int lengthWithHeaders) {
+        DEV verify(isInSync(details));
+
+        // The records in the class of the requested length may be shorter than it, look for the
+        // best fit among a few of them.
+        const int c = sizeClass(lengthWithHeaders);
+        const std::vector<ClassMember>& members = _classes[c];
+        DiskLoc best;
+        int bestLength = 0x7fffffff;
+        for (size_t i = 0; i < members.size() && i < kMaxProbes; ++i) {
+            const ClassMember& m = members[members.size() - 1 - i];
+            if (m.length >= lengthWithHeaders && m.length < bestLength) {
+                best = m.loc;
+                bestLength = m.length;
+                if (m.length == lengthWithHeaders) {
+                    break;
+                }
+            }
+        }
+
+        if (best.isNull()) {
+            // Every record in a larger class is long enough.
+            int larger = _findClass(c + 1);
+            if (larger >= 0) {
+                best = _classes[larger].back().loc;
+            }
+        }
+
+        if (best.isNull()) {
+            // Before giving up, and having a new extent allocated, look at the rest of the class.
+            for (size_t i = 0; i + kMaxProbes < members.size(); ++i) {
+                const ClassMember& m = members[i];
+                if (m.length >= lengthWithHeaders && m.length < bestLength) {
+                    best = m.loc;
+                    bestLength = m.length;
+                    if (m.length == lengthWithHeaders) {
+                        break;
+                    }
+                }
+            }
+            if (best.isNull()) {
+                return DiskLoc();
+            }
+        }
+
+        EntryMap::iterator it = _entries.find(best);
+        invariant(it != _entries.end());
+        _unlink(details, it);
+        return best;
+    }
+
+    void DeletedRecordIndex::remove(NamespaceDetails* details, const DiskLoc& loc) {
+        DEV verify(isInSync(details));
+
+        EntryMap::iterator it = _entries.find(loc);
+        invariant(it != _entries.end());
+        _unlink(details, it);
+    }
+
+    void DeletedRecordIndex::findInRange(const DiskLoc& start, int length,
+                                         std::vector<DiskLoc>* out) const {
+        const DiskLoc end(start.a(), start.getOfs() + length);
+        for (EntryMap::const_iterator it = _entries.lower_bound(start);
+             it != _entries.end() && it->first < end; ++it) {
+            out->push_back(it->first);
+        }
+    }
+
+    void DeletedRecordIndex::appendStats(BSONObjBuilder* out) const {
+        out->appendNumber("records", numRecords());
+        out->appendNumber("bytes", _bytes);
+        BSONArrayBuilder classes(out->subarrayStart("sizeClasses"));
+        for (int c = 0; c < kNumClasses; ++c) {
+            if (_classes[c].empty()) {
+                continue;
+            }
+            BSONObjBuilder classBuilder(classes.subobjStart());
+            classBuilder.append("minBytes", sizeClassMinLength(c));
+            classBuilder.appendNumber("records", static_cast<long long>(_classes[c].size()));
+            classBuilder.appendNumber("bytes", _classBytes[c]);
+            classBuilder.doneFast();
+        }
+        classes.doneFast();
+    }
+
+    bool DeletedRecordIndex::_readList(const DiskLoc& from, const DiskLoc& to,
+                                       std::vector<ClassMember>* out) const {
+        for (DiskLoc cur = from; cur != to; ) {
+            if (cur.isNull() || _entries.count(cur)) {
+                return false;
+            }
+            if (cur.a() < 0 || cur.a() >= 100000 || cur.getOfs() < 0) {
+                problem() << "Deleted record list corrupted, invalid link is " << cur.toString()
+                          << ", throwing Fatal Assertion" << endl;
+                fassertFailed(17361);
+            }
+            DeletedRecord* d = cur.drec();
+            out->push_back(ClassMember(cur, d->lengthWithHeaders()));
+            cur = d->nextDeleted();
+        }
+        return true;
+    }
+
+    void DeletedRecordIndex::_syncBucket(NamespaceDetails* details, int bucket) {
+        const DiskLoc head = details->deletedListEntry(bucket);
+
+        std::vector<ClassMember> added;
+        if (!_readList(head, _heads[bucket], &added)) {
+            // Records were taken off the list by someone else, read all of it again.
+            LOG(1) << "rebuilding the size class index of deleted list " << bucket << endl;
+            for (EntryMap::iterator it = _entries.begin(); it != _entries.end(); ) {
+                if (it->second.bucket == bucket) {
+                    _erase(it++);
+                }
+                else {
+                    ++it;
+                }
+            }
+            _heads[bucket] = DiskLoc();
+            added.clear();
+            // a record seen in another list now
+            fassert(17362, _readList(head, DiskLoc(), &added));
+        }
+
+        DiskLoc prev;
+        for (size_t i = 0; i < added.size(); ++i) {
+            _insert(added[i].loc, prev, added[i].length, bucket);
+            prev = added[i].loc;
+        }
+        if (!_heads[bucket].isNull()) {
+            _entries.find(_heads[bucket])->second.prev = prev;
+        }
+        _heads[bucket] = head;
+    }
+
+    void DeletedRecordIndex::_unlink(NamespaceDetails* details, EntryMap::iterator it) {
+        const DiskLoc loc = it->first;
+        const Entry& entry = it->second;
+
+        DeletedRecord* d = loc.drec();
+        DiskLoc next = d->nextDeleted();
+        if (entry.prev.isNull()) {
+            getDur().writingDiskLoc(details->deletedListEntry(entry.bucket)) = next;
+            _heads[entry.bucket] = next;
+        }
+        else {
+            getDur().writingDiskLoc(entry.prev.drec()->nextDeleted()) = next;
+        }
+        if (!next.isNull()) {
+            EntryMap::iterator nextIt = _entries.find(next);
+            invariant(nextIt != _entries.end());
+            nextIt->second.prev = entry.prev;
+        }
+        d->nextDeleted().writing().setInvalid(); // defensive.
+        verify(d->extentOfs() < loc.getOfs());
+
+        _erase(it);
+    }
+
+    void DeletedRecordIndex::_insert(const DiskLoc& loc, const DiskLoc& prev, int length,
+                                     int bucket) {
+        const int c = sizeClass(length);
+        Entry entry;
+        entry.prev = prev;
+        entry.length = length;
+        entry.bucket = bucket;
+        entry.classPos = _classes[c].size();
+        _entries[loc] = entry;
+
+        _classes[c].push_back(ClassMember(loc, length));
+        _classBytes[c] += length;
+        _nonEmptyClasses[c / 64] |= 1ULL << (c % 64);
+        _bytes += length;
+    }
+
+    void DeletedRecordIndex::_erase(EntryMap::iterator it) {
+        const Entry& entry = it->second;
+        const int c = sizeClass(entry.length);
+
+        std::vector<ClassMember>& members = _classes[c];
+        if (entry.classPos != members.size() - 1) {
+            members[entry.classPos] = members.back();
+            _entries.find(members[entry.classPos].loc)->second.classPos = entry.classPos;
+        }
+        members.pop_back();
+        if (members.empty()) {
+            _nonEmptyClasses[c / 64] &= ~(1ULL << (c % 64));
+        }
+        _classBytes[c] -= entry.length;
+        _bytes -= entry.length;
+
+        _entries.erase(it);
+    }
+
+    int DeletedRecordIndex::_findClass(int sizeClass) const {
+        if (sizeClass >= kNumClasses) {
+            return -1;
+        }
+        size_t word = sizeClass / 64;
+        unsigned long long bits = _nonEmptyClasses[word] & (~0ULL << (sizeClass % 64));
+        while (bits == 0) {
+            if (++word == _nonEmptyClasses.size()) {
+                return -1;
+            }
+            bits = _nonEmptyClasses[word];
+        }
+        return word * 64 + firstBitSet(bits) - 1;
+    }
+
+}  // namespace mongo
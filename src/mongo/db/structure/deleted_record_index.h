@@ -0,0 +1,163 @@
+// deleted_record_index.h
+
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/db/diskloc.h"
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    class NamespaceDetails;
+
+    /**
+     * An in-memory index of the deleted records of a collection, used instead of walking the
+     * deleted lists when the collection has Flag_UseSizeClassFreeLists set.
+     *
+     * The records are grouped in size classes much finer than the deleted list buckets: every
+     * power of two is split in kClassesPerPowerOf2 classes.  A bitmap of the classes holding
+     * records finds the smallest class with a large enough record without looking at any record,
+     * and within the class of the requested size at most kMaxProbes records are compared for a
+     * better fit.  The rest of that class is only searched when no larger class holds a record.
+     * Nothing but the record handed out is read from the data files.
+     *
+     * The deleted lists in NamespaceDetails stay the durable record of free space, the index
+     * mirrors them.  It remembers each record's predecessor in its list, so a record is unlinked
+     * without walking the list, and the list heads it saw last.  Records are always pushed at the
+     * head of a list, so sync() picks up the ones added by other code by walking from each head
+     * to the one it knows; a list which changed any other way is read again from scratch.
+     * Records must not be taken off the lists other than through take() or remove() while the
+     * index is active, except by orphaning all of them, after which clear() must be called.
+     *
+     * Concurrency: callers hold the database lock, exclusively for the non const methods.
+     */
+    class DeletedRecordIndex {
+        MONGO_DISALLOW_COPYING(DeletedRecordIndex);
+    public:
+        static const int kClassesPerPowerOf2 = 4;
+        static const int kMinClassSize = 32;
+        static const int kNumClasses;
+        static const size_t kMaxProbes = 8;
+
+        DeletedRecordIndex();
+
+        /** @return true once sync() was called, until clear() */
+        bool isActive() const { return _active; }
+
+        /** Forgets every record, the index is inactive until the next sync(). */
+        void clear();
+
+        /** Brings the index up to date with the deleted lists of 'details', activating it. */
+        void sync(NamespaceDetails* details);
+
+        /** @return true if the index is active and matches the deleted lists of 'details' */
+        bool isInSync(const NamespaceDetails* details) const;
+
+        /**
+         * Unlinks a deleted record of at least 'lengthWithHeaders' bytes from the deleted lists
+         * of 'details' and returns it, or returns a null DiskLoc if there is none.  The index must
+         * be in sync.
+         */
+        DiskLoc take(NamespaceDetails* details, int lengthWithHeaders);
+
+        /**
+         * Unlinks the deleted record at 'loc', which the index must know, from the deleted lists
+         * of 'details'.  The index must be in sync.
+         */
+        void remove(NamespaceDetails* details, const DiskLoc& loc);
+
+        /** Appends the deleted records within the 'length' bytes at 'start' to 'out', in order. */
+        void findInRange(const DiskLoc& start, int length, std::vector<DiskLoc>* out) const;
+
+        /**
+         * Appends { records, bytes, sizeClasses: [ { minBytes, records, bytes }, ... ] } to 'out',
+         * with an element for each size class which holds records.
+         */
+        void appendStats(BSONObjBuilder* out) const;
+
+        long long numRecords() const { return _entries.size(); }
+
+        long long numBytes() const { return _bytes; }
+
+        /** @return the size class of records of 'lengthWithHeaders' bytes */
+        static int sizeClass(int lengthWithHeaders);
+
+        /** @return the smallest record length in 'sizeClass' */
+        static int sizeClassMinLength(int sizeClass);
+
+    private:
+        struct Entry {
+            DiskLoc prev; // predecessor in the deleted list, null at the head
+            int length;
+            int bucket; // of the deleted list
+            size_t classPos; // in _classes[sizeClass(length)]
+        };
+        typedef std::map<DiskLoc, Entry> EntryMap;
+
+        struct ClassMember {
+            ClassMember(const DiskLoc& l, int len) : loc(l), length(len) { }
+            DiskLoc loc;
+            int length;
+        };
+
+        /** adds the records at the head of 'bucket' up to the one the index knows */
+        void _syncBucket(NamespaceDetails* details, int bucket);
+
+        /**
+         * Appends the records of a deleted list from 'from' up to 'to' to 'out'.  Returns false
+         * if the list ends, or reaches a record in the index, before 'to'.
+         */
+        bool _readList(const DiskLoc& from, const DiskLoc& to,
+                       std::vector<ClassMember>* out) const;
+
+        /** unlinks the record of 'it' from its deleted list and forgets it */
+        void _unlink(NamespaceDetails* details, EntryMap::iterator it);
+
+        void _insert(const DiskLoc& loc, const DiskLoc& prev, int length, int bucket);
+
+        void _erase(EntryMap::iterator it);
+
+        /** @return the first class from 'sizeClass' up which holds records, -1 if none */
+        int _findClass(int sizeClass) const;
+
+        bool _active;
+        EntryMap _entries;
+        std::vector<std::vector<ClassMember> > _classes;
+        std::vector<long long> _classBytes;
+        std::vector<unsigned long long> _nonEmptyClasses; // bitmap
+        std::vector<DiskLoc> _heads; // of the deleted lists, as of the last sync
+        long long _bytes;
+    };
+
+}  // namespace mongo
@@ -101,9 +101,107 @@ namespace mongo {
         return loc;
     }
 
+    bool RecordStore::_usesSizeClassFreeLists() const {
+        return !_details->isCapped() &&
+            _details->isUserFlagSet( NamespaceDetails::Flag_UseSizeClassFreeLists );
+    }
+
+    DiskLoc RecordStore::_allocFromDeletedList( int lengthWithHeaders ) {
+        if ( !_usesSizeClassFreeLists() ) {
+            if ( _deletedRecords.isActive() ) {
+                // the flag was cleared, and the index won't be kept up to date anymore
+                _deletedRecords.clear();
+            }
+            return _details->alloc( _ns, lengthWithHeaders );
+        }
+
+        int len = NamespaceDetails::alignAllocationLength( lengthWithHeaders );
+        _deletedRecords.sync( _details );
+        DiskLoc loc = _deletedRecords.take( _details, len );
+        if ( loc.isNull() )
+            return loc;
+
+        _details->claimDeletedRec( _ns, loc, len );
+        _deletedRecords.sync( _details ); // picks up what was split off
+        return loc;
+    }
+
+    void RecordStore::orphanDeletedList() {
+        _details->orphanDeletedList();
+        _deletedRecords.clear();
+    }
+
+    void RecordStore::orphanDeletedRecordsInExtent( const DiskLoc& extentLoc ) {
+        if ( !_usesSizeClassFreeLists() ) {
+            _details->orphanDeletedRecordsInExtent( extentLoc );
+            _deletedRecords.clear();
+            return;
+        }
+
+        // the index knows where the records of the extent are, no need to walk the lists
+        _deletedRecords.sync( _details );
+        vector<DiskLoc> inExtent;
+        _deletedRecords.findInRange( extentLoc, extentLoc.ext()->length, &inExtent );
+        for ( size_t i = 0; i < inExtent.size(); i++ )
+            _deletedRecords.remove( _details, inExtent[i] );
+    }
+
+    void RecordStore::restoreDeletedRecordsInExtent( const DiskLoc& extentLoc ) {
+        // whatever was deleted in the extent while it wasn't orphaned is in a gap too
+        orphanDeletedRecordsInExtent( extentLoc );
+
+        // the record list of an extent is in insertion order, the gaps are found by address
+        Extent* e = _extentManager->getExtent( extentLoc );
+        vector< pair<int, int> > records;
+        for ( DiskLoc L = e->firstRecord; !L.isNull();
+              L = _extentManager->getNextRecordInExtent( L ) ) {
+            records.push_back( make_pair( L.getOfs(), recordFor( L )->lengthWithHeaders() ) );
+        }
+        sort( records.begin(), records.end() );
+
+        int ofs = extentLoc.getOfs() + Extent::HeaderSize();
+        for ( size_t i = 0; i < records.size(); i++ ) {
+            _addDeletedRange( extentLoc, ofs, records[i].first );
+            ofs = records[i].first + records[i].second;
+        }
+        _addDeletedRange( extentLoc, ofs, extentLoc.getOfs() + e->length );
+
+        if ( _deletedRecords.isActive() )
+            _deletedRecords.sync( _details );
+    }
+
+    void RecordStore::_addDeletedRange( const DiskLoc& extentLoc, int start, int end ) {
+        if ( end - start < Record::HeaderSize )
+            return;
+
+        DiskLoc loc( extentLoc.a(), start );
+        DeletedRecord* d = getDur().writing( &recordFor( loc )->asDeleted() );
+        d->lengthWithHeaders() = end - start;
+        d->extentOfs() = extentLoc.getOfs();
+        _details->addDeletedRec( d, loc );
+    }
+
+    long long RecordStore::deletedRecordsLength( const DiskLoc& excludedExtent ) {
+        if ( !_usesSizeClassFreeLists() )
+            return _details->deletedRecordsLength( excludedExtent );
+
+        _deletedRecords.sync( _details );
+        long long total = _deletedRecords.numBytes();
+        vector<DiskLoc> inExtent;
+        _deletedRecords.findInRange( excludedExtent, excludedExtent.ext()->length, &inExtent );
+        for ( size_t i = 0; i < inExtent.size(); i++ )
+            total -= inExtent[i].drec()->lengthWithHeaders();
+        return total;
+    }
+
+    const DeletedRecordIndex* RecordStore::getDeletedRecordIndex() const {
+        if ( !_usesSizeClassFreeLists() || !_deletedRecords.isInSync( _details ) )
+            return NULL;
+        return &_deletedRecords;
+    }
 
     StatusWith<DiskLoc> RecordStore::allocRecord( int lengthWithHeaders, int quotaMax ) {
-        DiskLoc loc = _details->alloc( _ns, lengthWithHeaders );
+        DiskLoc loc = _allocFromDeletedList( lengthWithHeaders );
         if ( !loc.isNull() )
             return StatusWith<DiskLoc>( loc );
 
@@ -118,7 +216,7 @@ namespace mongo {
                                                                    _details->lastExtentSize()),
                                              quotaMax );
 
-        loc = _details->alloc( _ns, lengthWithHeaders );
+        loc = _allocFromDeletedList( lengthWithHeaders );
         if ( !loc.isNull() ) {
             // got on first try
             return StatusWith<DiskLoc>( loc );
@@ -136,7 +234,7 @@ namespace mongo {
                                                                        _details->lastExtentSize()),
                                                  quotaMax );
 
-            loc = _details->alloc( _ns, lengthWithHeaders);
+            loc = _allocFromDeletedList( lengthWithHeaders );
             if ( ! loc.isNull() )
                 return StatusWith<DiskLoc>( loc );
         }
@@ -144,10 +242,7 @@ namespace mongo {
         return StatusWith<DiskLoc>( ErrorCodes::InternalError, "cannot allocate space" );
     }
 
-    void RecordStore::deleteRecord( const DiskLoc& dl ) {
-
-        Record* todelete = recordFor( dl );
-
+    void RecordStore::_unlinkFromExtent( const DiskLoc& dl, Record* todelete ) {
         /* remove ourself from the record next/prev chain */
         {
             if ( todelete->prevOfs() != DiskLoc::NullOfs ) {
@@ -179,6 +274,19 @@ namespace mongo {
                     e->lastRecord.set(dl.a(), todelete->prevOfs() );
             }
         }
+    }
+
+    void RecordStore::orphanRecord( const DiskLoc& dl ) {
+        Record* toorphan = recordFor( dl );
+        _unlinkFromExtent( dl, toorphan );
+        _details->incrementStats( -1 * toorphan->netLength(), -1 );
+    }
+
+    void RecordStore::deleteRecord( const DiskLoc& dl ) {
+
+        Record* todelete = recordFor( dl );
+
+        _unlinkFromExtent( dl, todelete );
 
         /* add to the free list */
         {
@@ -198,7 +306,11 @@ namespace mongo {
                     unsigned long long *p = reinterpret_cast<unsigned long long *>( todelete->data() );
                     *getDur().writing(p) = 0;
                 }
+                if ( DiskLoc( dl.a(), todelete->extentOfs() ) == _orphanedExtent )
+                    return;
                 _details->addDeletedRec((DeletedRecord*)todelete, dl);
+                if ( _deletedRecords.isActive() )
+                    _deletedRecords.sync( _details );
             }
         }
 
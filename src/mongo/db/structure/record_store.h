@@ -31,6 +31,7 @@
 #pragma once
 
 #include "mongo/db/diskloc.h"
+#include "mongo/db/structure/deleted_record_index.h"
 
 namespace mongo {
 
@@ -52,18 +53,72 @@ namespace mongo {
 
         void deleteRecord( const DiskLoc& dl );
 
+        /**
+         * takes the record out of its extent without putting its space on the deleted lists,
+         * for an extent which is being emptied so it can be freed
+         */
+        void orphanRecord( const DiskLoc& dl );
+
         StatusWith<DiskLoc> insertRecord( const char* data, int len, int quotaMax );
 
         StatusWith<DiskLoc> insertRecord( const DocWriter* doc, int quotaMax );
 
+        /**
+         * drops all the deleted records of the collection
+         */
+        void orphanDeletedList();
+
+        /**
+         * drops the deleted records of one extent, so its space isn't allocated again
+         */
+        void orphanDeletedRecordsInExtent( const DiskLoc& extentLoc );
+
+        /**
+         * puts the free space of an extent whose deleted records were orphaned, and some of
+         * whose records were, on the deleted lists again: each gap between the records left in
+         * it becomes one deleted record.  for a collection's extent, whose records start right
+         * after the extent header.
+         */
+        void restoreDeletedRecordsInExtent( const DiskLoc& extentLoc );
+
+        /**
+         * while set, the space of the records deleted in the extent at 'extentLoc' isn't put on
+         * the deleted lists, as with orphanRecord(), so an extent whose deleted records were
+         * orphaned stays without any.  a null DiskLoc puts deleted space on the lists again.
+         */
+        void setOrphanedExtent( const DiskLoc& extentLoc ) { _orphanedExtent = extentLoc; }
+        const DiskLoc& getOrphanedExtent() const { return _orphanedExtent; }
+
+        /** @return the length of all the deleted records, except those in 'excludedExtent' */
+        long long deletedRecordsLength( const DiskLoc& excludedExtent );
+
+        /**
+         * @return the index of deleted records by size class, if the collection uses one and it
+         *         is up to date, otherwise NULL
+         */
+        const DeletedRecordIndex* getDeletedRecordIndex() const;
+
     protected:
         StatusWith<DiskLoc> allocRecord( int lengthWithHeaders, int quotaMax );
 
     private:
+        // unlinks the record from the record list of its extent
+        void _unlinkFromExtent( const DiskLoc& dl, Record* todelete );
+
+        // makes the bytes [start, end) of the extent one deleted record, if they hold a header
+        void _addDeletedRange( const DiskLoc& extentLoc, int start, int end );
+
+        // allocates from the deleted lists, null if there's no room
+        DiskLoc _allocFromDeletedList( int lengthWithHeaders );
+
+        bool _usesSizeClassFreeLists() const;
+
         std::string _ns;
         NamespaceDetails* _details;
         ExtentManager* _extentManager;
         bool _isSystemIndexes;
+        DeletedRecordIndex _deletedRecords;
+        DiskLoc _orphanedExtent;
     };
 
 }
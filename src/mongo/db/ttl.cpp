@@ -40,21 +40,75 @@
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/database_holder.h"
 #include "mongo/db/instance.h"
-#include "mongo/db/ops/delete.h"
+#include "mongo/db/dur.h"
+#include "mongo/db/query/internal_plans.h"
 #include "mongo/db/repl/is_master.h"
+#include "mongo/db/repl/oplog.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/util/background.h"
+#include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
 
     Counter64 ttlPasses;
+    Counter64 ttlBatches;
     Counter64 ttlDeletedDocuments;
 
     ServerStatusMetricField<Counter64> ttlPassesDisplay("ttl.passes", &ttlPasses);
+    ServerStatusMetricField<Counter64> ttlBatchesDisplay("ttl.batches", &ttlBatches);
     ServerStatusMetricField<Counter64> ttlDeletedDocumentsDisplay("ttl.deletedDocuments", &ttlDeletedDocuments);
 
     MONGO_EXPORT_SERVER_PARAMETER( ttlMonitorEnabled, bool, true );
-    
+    MONGO_EXPORT_SERVER_PARAMETER( ttlMonitorSleepSecs, int, 60 );
+
+    // most expired documents deleted under one acquisition of the write lock
+    MONGO_EXPORT_SERVER_PARAMETER( ttlDeleteBatchSize, int, 500 );
+
+    // ceiling on the rate the monitor deletes documents at across all collections, 0 for none
+    MONGO_EXPORT_SERVER_PARAMETER( ttlMaxDocsPerSecond, int, 0 );
+
+    namespace {
+
+        /** what the last pass saw of a ttl index, for serverStatus */
+        struct TTLIndexStats {
+            TTLIndexStats() : expireAfterSeconds( 0 ), lagSecs( 0 ), deletedDocuments( 0 ) {}
+
+            string ns;
+            string name;
+            long long expireAfterSeconds;
+            // how long ago the oldest document still in the collection expired, 0 if none has
+            long long lagSecs;
+            long long deletedDocuments;
+        };
+
+        SimpleMutex ttlIndexStatsMutex( "ttlIndexStats" );
+        map<string, TTLIndexStats> ttlIndexStats; // keyed by ns and index name
+
+        class TTLServerStatusSection : public ServerStatusSection {
+        public:
+            TTLServerStatusSection() : ServerStatusSection( "ttl" ) {}
+            virtual bool includeByDefault() const { return true; }
+
+            virtual BSONObj generateSection( const BSONElement& configElement ) const {
+                BSONObjBuilder b;
+                BSONArrayBuilder indexes( b.subarrayStart( "indexes" ) );
+                SimpleMutex::scoped_lock lk( ttlIndexStatsMutex );
+                for ( map<string, TTLIndexStats>::const_iterator i = ttlIndexStats.begin();
+                      i != ttlIndexStats.end(); ++i ) {
+                    const TTLIndexStats& stats = i->second;
+                    indexes.append( BSON( "ns" << stats.ns <<
+                                          "name" << stats.name <<
+                                          "expireAfterSeconds" << stats.expireAfterSeconds <<
+                                          "lagSecs" << stats.lagSecs <<
+                                          "deletedDocuments" << stats.deletedDocuments ) );
+                }
+                indexes.done();
+                return b.obj();
+            }
+        } ttlServerStatusSection;
+
+    } // namespace
+
     class TTLMonitor : public BackgroundJob {
     public:
         TTLMonitor(){}
@@ -63,10 +117,20 @@ namespace mongo {
         virtual string name() const { return "TTLMonitor"; }
         
         static string secondsExpireField;
-        
-        void doTTLForDB( const string& dbName ) {
 
-            bool isMaster = isMasterNs( dbName.c_str() );
+        /** a ttl index the current pass is working through */
+        struct TTLIndex {
+            TTLIndex() : done( false ) {}
+
+            BSONObj spec;
+            bool done;
+            // where the next batch starts scanning, past keys that aren't dates
+            BSONObj resumeKey;
+            TTLIndexStats stats;
+        };
+
+        void getTTLIndexesForDB( const string& dbName, vector<TTLIndex>* out ) {
+
             vector<BSONObj> indexes;
             {
                 auto_ptr<DBClientCursor> cursor =
@@ -99,50 +163,189 @@ namespace mongo {
                     continue;
                 }
 
-                BSONObj query;
+                TTLIndex ttl;
+                ttl.spec = idx;
+                ttl.stats.ns = idx["ns"].String();
+                ttl.stats.name = idx["name"].String();
+                ttl.stats.expireAfterSeconds = idx[secondsExpireField].numberLong();
                 {
-                    BSONObjBuilder b;
-                    b.appendDate( "$lt" , curTimeMillis64() - ( 1000 * idx[secondsExpireField].numberLong() ) );
-                    query = BSON( key.firstElement().fieldName() << b.obj() );
+                    SimpleMutex::scoped_lock lk( ttlIndexStatsMutex );
+                    map<string, TTLIndexStats>::const_iterator last =
+                        ttlIndexStats.find( ttl.stats.ns + ' ' + ttl.stats.name );
+                    if ( last != ttlIndexStats.end() )
+                        ttl.stats.deletedDocuments = last->second.deletedDocuments;
                 }
+                out->push_back( ttl );
+            }
+        }
 
-                LOG(1) << "TTL: " << key << " \t " << query << endl;
+        /**
+         * Walks the ttl index from its oldest date, deleting up to 'batchSize' expired documents
+         * under one write lock, or only measuring the lag if we aren't master.
+         * @return the number of documents deleted
+         */
+        long long doTTLBatch( TTLIndex* ttl, int batchSize ) {
+            const BSONObj& idx = ttl->spec;
+            BSONObj key = idx["key"].Obj();
+            const string& ns = ttl->stats.ns;
 
-                long long n = 0;
-                {
-                    string ns = idx["ns"].String();
-                    Client::WriteContext ctx( ns );
-                    Collection* collection = ctx.ctx().db()->getCollection( ns );
-                    if ( !collection ) {
-                        // collection was dropped
-                        continue;
-                    }
+            long long now = curTimeMillis64();
+            long long expireBefore = now - ( 1000 * ttl->stats.expireAfterSeconds );
 
-                    NamespaceDetails* nsd = collection->details();
-                    if ( nsd->setUserFlag( NamespaceDetails::Flag_UsePowerOf2Sizes ) ) {
-                        // TODO: wish there was a cleaner way to do this
-                        nsd->syncUserFlags( ns );
-                    }
+            BSONObj startKey = ttl->resumeKey;
+            if ( startKey.isEmpty() ) {
+                BSONObjBuilder b;
+                b.appendMinForType( "" , Date );
+                startKey = b.obj();
+            }
+            BSONObj endKey;
+            {
+                BSONObjBuilder b;
+                b.appendDate( "" , expireBefore );
+                endKey = b.obj();
+            }
+
+            LOG(1) << "TTL: " << key << " \t " << ns << " expiring before " << endKey << endl;
+
+            Client::WriteContext ctx( ns );
+            // checked under the lock every batch, as we may step down during a pass
+            bool isMaster = isMasterNs( ns.c_str() );
+            Collection* collection = ctx.ctx().db()->getCollection( ns );
+            if ( !collection ) {
+                // collection was dropped
+                ttl->done = true;
+                return 0;
+            }
+
+            NamespaceDetails* nsd = collection->details();
+            if ( nsd->setUserFlag( NamespaceDetails::Flag_UsePowerOf2Sizes ) ) {
+                // TODO: wish there was a cleaner way to do this
+                nsd->syncUserFlags( ns );
+            }
+
+            IndexDescriptor* desc = collection->getIndexCatalog()->findIndexByKeyPattern( key );
+            if ( desc == NULL ) {
+                // index not finished yet
+                LOG(1) << " skipping index because not finished";
+                ttl->done = true;
+                return 0;
+            }
 
-                    // only do deletes if on master
-                    if ( ! isMaster ) {
+            // the batch is bounded and deleted under this lock, so the scan doesn't yield
+            InternalPlanner::Direction direction = key.firstElement().number() < 0 ?
+                InternalPlanner::BACKWARD : InternalPlanner::FORWARD;
+            auto_ptr<Runner> runner( InternalPlanner::indexScan( collection, desc,
+                                                                 startKey, endKey,
+                                                                 false, direction ) );
+
+            // only dates expire, and a multikey index can have several for one document
+            set<DiskLoc> expired;
+            long long oldest = expireBefore;
+            BSONObj indexKey;
+            DiskLoc loc;
+            while ( Runner::RUNNER_ADVANCED == runner->getNext( &indexKey, &loc ) ) {
+                BSONElement e = indexKey.firstElement();
+                if ( e.type() != Date ) {
+                    ttl->resumeKey = indexKey.getOwned();
+                    continue;
+                }
+                if ( expired.empty() )
+                    oldest = e.date().millis;
+                if ( !isMaster )
+                    break;
+                expired.insert( loc );
+                if ( static_cast<int>( expired.size() ) >= batchSize )
+                    break;
+            }
+            runner.reset();
+
+            ttl->stats.lagSecs = ( expireBefore - oldest ) / 1000;
+
+            // only do deletes if on master
+            if ( !isMaster ) {
+                ttl->done = true;
+                return 0;
+            }
+
+            for ( set<DiskLoc>::const_iterator i = expired.begin(); i != expired.end(); ++i ) {
+                BSONObj deletedId;
+                collection->deleteDocument( *i, false, false, &deletedId );
+                if ( deletedId.isEmpty() ) {
+                    problem() << "deleted object without id, not logging" << endl;
+                }
+                else {
+                    bool replJustOne = true;
+                    logOp( "d", ns.c_str(), deletedId, 0, &replJustOne );
+                }
+                getDur().commitIfNeeded();
+            }
+
+            long long n = expired.size();
+            if ( n < batchSize ) {
+                ttl->done = true;
+                ttl->stats.lagSecs = 0;
+            }
+
+            ttlBatches.increment();
+            ttlDeletedDocuments.increment( n );
+            ttl->stats.deletedDocuments += n;
+
+            LOG(1) << "\tTTL deleted: " << n << endl;
+            return n;
+        }
+
+        /**
+         * Deletes a batch from each ttl index in turn until none have expired documents left, so
+         * one large backlog doesn't hold up the others, pacing the batches to ttlMaxDocsPerSecond.
+         */
+        void doTTLPass( vector<TTLIndex>* indexes ) {
+            Timer passTimer;
+            long long deleted = 0;
+
+            bool more = true;
+            while ( more ) {
+                more = false;
+                for ( unsigned i = 0; i < indexes->size(); i++ ) {
+                    TTLIndex& ttl = (*indexes)[i];
+                    if ( ttl.done )
                         continue;
+
+                    if ( inShutdown() || !ttlMonitorEnabled || lockedForWriting() )
+                        return;
+
+                    int maxPerSec = ttlMaxDocsPerSecond;
+                    int batchSize = std::max( 1, static_cast<int>( ttlDeleteBatchSize ) );
+                    if ( maxPerSec > 0 )
+                        batchSize = std::min( batchSize, maxPerSec );
+
+                    try {
+                        deleted += doTTLBatch( &ttl, batchSize );
+                    }
+                    catch ( DBException& e ) {
+                        error() << "error processing ttl for " << ttl.stats.ns << " "
+                                << e << endl;
+                        ttl.done = true;
                     }
+                    more = more || !ttl.done;
 
-                    if ( collection->getIndexCatalog()->findIndexByKeyPattern( key ) == NULL ) {
-                        // index not finished yet
-                        LOG(1) << " skipping index because not finished";
-                        continue;
+                    {
+                        SimpleMutex::scoped_lock lk( ttlIndexStatsMutex );
+                        ttlIndexStats[ ttl.stats.ns + ' ' + ttl.stats.name ] = ttl.stats;
                     }
 
-                    n = deleteObjects( ns , query , false , true );
-                    ttlDeletedDocuments.increment( n );
+                    // let others at the lock between batches
+                    if ( maxPerSec > 0 ) {
+                        long long ahead = deleted * 1000 / maxPerSec - passTimer.millis();
+                        if ( ahead > 0 )
+                            sleepmillis( ahead );
+                    }
+                    else {
+                        int micros = Client::recommendedYieldMicros();
+                        if ( micros > 0 )
+                            sleepmicros( micros );
+                    }
                 }
-
-                LOG(1) << "\tTTL deleted: " << n << endl;
             }
-            
-            
         }
 
         virtual void run() {
@@ -150,7 +353,7 @@ namespace mongo {
             cc().getAuthorizationSession()->grantInternalAuthorization();
 
             while ( ! inShutdown() ) {
-                sleepsecs( 60 );
+                sleepsecs( ttlMonitorSleepSecs );
                 
                 LOG(3) << "TTLMonitor thread awake" << endl;
 
@@ -178,16 +381,27 @@ namespace mongo {
                 
                 ttlPasses.increment();
 
+                vector<TTLIndex> indexes;
                 for ( set<string>::const_iterator i=dbs.begin(); i!=dbs.end(); ++i ) {
                     string db = *i;
                     try {
-                        doTTLForDB( db );
+                        getTTLIndexesForDB( db, &indexes );
                     }
                     catch ( DBException& e ) {
                         error() << "error processing ttl for db: " << db << " " << e << endl;
                     }
                 }
 
+                doTTLPass( &indexes );
+
+                // indexes which are gone drop out of serverStatus
+                map<string, TTLIndexStats> stats;
+                for ( unsigned i = 0; i < indexes.size(); i++ ) {
+                    const TTLIndexStats& s = indexes[i].stats;
+                    stats[ s.ns + ' ' + s.name ] = s;
+                }
+                SimpleMutex::scoped_lock lk( ttlIndexStatsMutex );
+                ttlIndexStats.swap( stats );
             }
         }
 
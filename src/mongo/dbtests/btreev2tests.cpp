@@ -0,0 +1,342 @@
+// btreev2tests.cpp : tests of the v:2 btree bucket format, see BtreeData_V2
+//
+
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/db/structure/btree/btree.h"
+
+#include <cstdio>
+
+#include "mongo/db/namespace_details.h"
+#include "mongo/db/pdfile.h"
+#include "mongo/db/storage/index_details.h"
+
+#include "mongo/dbtests/dbtests.h"
+
+namespace BtreeV2Tests {
+
+    static const char* const _ns = "unittests.btreev2";
+    DBDirectClient _client;
+
+    typedef BtreeBucket<V2>::_KeyNode _KeyNode;
+
+    static const BSONObj _orderObj = BSON( "a" << 1 );
+
+    // dummy, valid record loc
+    static DiskLoc recordLoc() {
+        return DiskLoc( 0, 2 );
+    }
+
+    /** @return a key of the 700 byte prefix "ppp...", then 'i' in hex, then 'tail' */
+    static BSONObj prefixedKey( int i, const string& tail = "" ) {
+        char suffix[ 9 ];
+        sprintf( suffix, "%.8x", i );
+        return BSON( "" << string( 700, 'p' ) + suffix + tail );
+    }
+
+    /**
+     * Exposes a bucket's internals, for buckets which aren't part of a real tree: the head
+     * buckets of otherwise empty indexes are rewritten in place.
+     */
+    class TestBucket : public BtreeBucket<V2> {
+    public:
+        /** declares write intent for the whole bucket */
+        static TestBucket* is( const DiskLoc& loc ) {
+            return static_cast<TestBucket*>( loc.btreemod<V2>() );
+        }
+        static const TestBucket* at( const DiskLoc& loc ) {
+            return static_cast<const TestBucket*>( loc.btree<V2>() );
+        }
+        static Ordering order() { return Ordering::make( _orderObj ); }
+
+        void reset() { init(); }
+        bool pushIfRoom( const BSONObj& key, const DiskLoc& child = DiskLoc() ) {
+            KeyV2 k( key );
+            return _pushBack( recordLoc(), k, order(), child );
+        }
+        void push( const BSONObj& key, const DiskLoc& child = DiskLoc() ) {
+            ASSERT( pushIfRoom( key, child ) );
+        }
+        bool insertAt( const DiskLoc& thisLoc, int pos, const BSONObj& key ) {
+            KeyV2 k( key );
+            return basicInsert( thisLoc, pos, recordLoc(), k, order() );
+        }
+        void delAt( int pos ) { _delKeyAtPos( pos ); }
+        void replaceAt( int pos, const BSONObj& key ) {
+            KeyV2 k( key );
+            setKey( pos, recordLoc(), k, DiskLoc() );
+        }
+        void pack() {
+            int refPos = 0;
+            setNotPacked();
+            _packReadyForMod( order(), refPos );
+        }
+        void setNext( const DiskLoc& child ) { this->nextChild = child; }
+        void fixParents( const DiskLoc& thisLoc ) { fixParentPtrs( thisLoc ); }
+        bool canMerge( const DiskLoc& thisLoc ) const { return canMergeChildren( thisLoc, 0 ); }
+        bool canBalance( const DiskLoc& thisLoc ) const { return canBalanceChildren( thisLoc, 0 ); }
+        int packedSize() const { return packedDataSize( 0 ); }
+
+        bool isPacked() const { return this->flags & Packed; }
+        int prefixLength() const { return this->prefixLen; }
+        bool stripped( int i ) const { return keyHasPrefix( k( i ).keyDataOfs() ); }
+        int used() const { return this->topSize; }
+        bool keyCodes() const { return hasKeyCodes(); }
+        int keyCodesBytes() const { return this->codesCap * sizeof( StoredCode ); }
+        BSONObj keyAt( int i ) const { return keyNode( i ).key.toBson(); }
+        int keySize( int i ) const { return keyNode( i ).key.dataSize(); }
+
+        /** @return the packedDataSize() of the keys if none were stored behind a prefix */
+        int unprefixedSize() const {
+            int size = 0;
+            for ( int i = 0; i < this->n; i++ )
+                size += keyStorageBound( keySize( i ) ) + sizeof( _KeyNode );
+            return size;
+        }
+
+        /**
+         * Pushes keys from 'first' up, packing the bucket whenever it is full, until they
+         * would not fit the bucket without their prefix.  @return the next key
+         */
+        int fillPacked( int first ) {
+            int i = first;
+            while ( packedDataSize( 0 ) < bodySize() ) {
+                if ( !pushIfRoom( prefixedKey( i ) ) ) {
+                    pack();
+                    push( prefixedKey( i ) );
+                }
+                i++;
+            }
+            return i;
+        }
+    };
+
+    /**
+     * Holds the write lock on a collection with three empty v:2 indexes, whose head buckets
+     * the tests use as scratch buckets.
+     */
+    class Base {
+    public:
+        Base() :
+            _ctx( _ns ) {
+            _client.dropCollection( _ns );
+            _client.ensureIndex( _ns, BSON( "a" << 1 ), false, "a_1", false, false, 2 );
+            _client.ensureIndex( _ns, BSON( "b" << 1 ), false, "b_1", false, false, 2 );
+            _client.ensureIndex( _ns, BSON( "c" << 1 ), false, "c_1", false, false, 2 );
+        }
+        virtual ~Base() {
+            _client.dropCollection( _ns );
+        }
+    protected:
+        /** @return the head bucket of the index on 'field', which is reset */
+        static DiskLoc scratch( const string& field ) {
+            DiskLoc head = index( field ).head;
+            TestBucket::is( head )->reset();
+            return head;
+        }
+    private:
+        static IndexDetails& index( const string& field ) {
+            NamespaceDetails* nsd = nsdetails( _ns );
+            verify( nsd );
+            IndexDetails* found = NULL;
+            for ( NamespaceDetails::IndexIterator i = nsd->ii(); i.more(); ) {
+                IndexDetails& id = i.next();
+                if ( id.indexName() == field + "_1" )
+                    found = &id;
+            }
+            verify( found && found->version() == 2 );
+            return *found;
+        }
+        Client::WriteContext _ctx;
+    };
+
+    /** Packing strips the prefix the keys share, and the keys read back whole. */
+    class KeyPacking : public Base {
+    public:
+        void run() {
+            DiskLoc loc = scratch( "a" );
+            TestBucket* b = TestBucket::is( loc );
+            for ( int i = 0; i < 8; i++ ) {
+                b->push( prefixedKey( i ) );
+            }
+            // no prefix is chosen before the first pack
+            ASSERT_EQUALS( 0, b->prefixLength() );
+            ASSERT( !b->isPacked() );
+            int unpacked = b->used();
+
+            b->pack();
+            ASSERT( b->isPacked() );
+            ASSERT_NOT_LESS_THAN( b->prefixLength(), 700 );
+            ASSERT_LESS_THAN( b->prefixLength(), b->keySize( 0 ) );
+            int stored = b->prefixLength();
+            for ( int i = 0; i < 8; i++ ) {
+                ASSERT( b->stripped( i ) );
+                ASSERT_EQUALS( 0, prefixedKey( i ).woCompare( b->keyAt( i ) ) );
+                stored += V2::keyStorageBound( b->keySize( i ) ) - b->prefixLength();
+            }
+            ASSERT_EQUALS( stored, b->used() - b->keyCodesBytes() );
+            ASSERT_LESS_THAN( stored, unpacked - 7 * 700 );
+
+            // keys which may move to another bucket are sized without the prefix
+            ASSERT_EQUALS( b->unprefixedSize(), b->packedSize() );
+
+            // a key without the prefix is stored whole, and the bucket may pack better
+            b->push( BSON( "" << "q" ) );
+            ASSERT( !b->stripped( 8 ) );
+            ASSERT( !b->isPacked() );
+            ASSERT_EQUALS( 0, BSON( "" << "q" ).woCompare( b->keyAt( 8 ) ) );
+            b->pack();
+            for ( int i = 0; i < 9; i++ ) {
+                ASSERT_EQUALS( 0, ( i < 8 ? prefixedKey( i ) : BSON( "" << "q" ) )
+                                      .woCompare( b->keyAt( i ) ) );
+            }
+            ASSERT( b->keyCodesMatchKeys() );
+        }
+    };
+
+    /** A key takes at most keyStorageBound() bytes, and keyStorageBound() less its prefix */
+    class KeyStorageBound : public Base {
+    public:
+        void run() {
+            ASSERT_EQUALS( 100, V1::keyStorageBound( 100 ) );
+            ASSERT_EQUALS( 100 + static_cast<int>( sizeof( unsigned short ) ),
+                           V2::keyStorageBound( 100 ) );
+            ASSERT_EQUALS( BtreeBucket<V2>::bodySize() / 2 - V2::keyStorageBound( V2::KeyMax ) -
+                           static_cast<int>( sizeof( _KeyNode ) ) + 1,
+                           BtreeBucket<V2>::lowWaterMark() );
+
+            DiskLoc loc = scratch( "a" );
+            TestBucket* b = TestBucket::is( loc );
+            for ( int i = 0; i < 8; i++ ) {
+                b->push( prefixedKey( i ) );
+            }
+            b->pack();
+
+            int before = b->used();
+            b->push( prefixedKey( 8 ) );
+            ASSERT( b->stripped( 8 ) );
+            ASSERT_EQUALS( V2::keyStorageBound( b->keySize( 8 ) ) - b->prefixLength(),
+                           b->used() - before );
+
+            before = b->used();
+            b->push( BSON( "" << "q" ) );
+            ASSERT_EQUALS( V2::keyStorageBound( b->keySize( 9 ) ), b->used() - before );
+        }
+    };
+
+    /**
+     * Keys are sized without the prefix they share when they may move between buckets, so
+     * two children which only fit their buckets packed behind a prefix can neither be merged
+     * nor balanced, while smaller ones can.
+     */
+    class PrefixMergeBoundary : public Base {
+    public:
+        void run() {
+            DiskLoc root = scratch( "a" );
+            DiskLoc left = scratch( "b" );
+            DiskLoc right = scratch( "c" );
+
+            int n = TestBucket::is( left )->fillPacked( 0 );
+            TestBucket* r = TestBucket::is( root );
+            r->push( prefixedKey( n ), left );
+            r->setNext( right );
+            r->fixParents( root );
+            TestBucket::is( right )->fillPacked( n + 1 );
+
+            ASSERT( TestBucket::is( left )->prefixLength() > 0 );
+            ASSERT_NOT_LESS_THAN( TestBucket::at( left )->packedSize(),
+                                  BtreeBucket<V2>::bodySize() );
+            ASSERT_NOT_LESS_THAN( TestBucket::at( right )->packedSize(),
+                                  BtreeBucket<V2>::bodySize() );
+            ASSERT( !TestBucket::at( root )->canMerge( root ) );
+            ASSERT( !TestBucket::at( root )->canBalance( root ) );
+
+            // a few keys each fit one bucket unprefixed
+            TestBucket::is( left )->reset();
+            TestBucket::is( right )->reset();
+            for ( int i = 0; i < 3; i++ ) {
+                TestBucket::is( left )->push( prefixedKey( i ) );
+                TestBucket::is( right )->push( prefixedKey( n + 1 + i ) );
+            }
+            TestBucket::is( left )->pack();
+            TestBucket::is( right )->pack();
+            ASSERT( TestBucket::at( root )->canMerge( root ) );
+            ASSERT( TestBucket::at( root )->canBalance( root ) );
+        }
+    };
+
+    /** The key codes array follows inserts and deletes, and is dropped by other changes */
+    class KeyCodes : public Base {
+    public:
+        void run() {
+            DiskLoc loc = scratch( "a" );
+            TestBucket* b = TestBucket::is( loc );
+            for ( int i = 0; i < 20; i += 2 ) {
+                b->push( prefixedKey( i, "-" + string( 1, 'a' + i ) ) );
+            }
+            b->pack();
+            ASSERT( b->keyCodes() );
+            ASSERT( b->keyCodesMatchKeys() );
+
+            // keys which differ after their first bytes share codes, keys of other types don't
+            ASSERT( b->insertAt( loc, 3, prefixedKey( 5 ) ) );
+            ASSERT( b->insertAt( loc, 0, BSON( "" << 1 ) ) );
+            ASSERT( b->insertAt( loc, b->getN(), BSON( "" << "q" ) ) );
+            ASSERT( b->keyCodes() );
+            ASSERT( b->keyCodesMatchKeys() );
+
+            b->delAt( 4 );
+            b->delAt( 0 );
+            b->delAt( b->getN() - 1 );
+            ASSERT( b->keyCodes() );
+            ASSERT( b->keyCodesMatchKeys() );
+
+            b->replaceAt( 0, prefixedKey( 0 ) );
+            ASSERT( !b->keyCodes() );
+            ASSERT( !b->isPacked() );
+            b->pack();
+            ASSERT( b->keyCodes() );
+            ASSERT( b->keyCodesMatchKeys() );
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite( "btreev2" ) {
+        }
+
+        void setupTests() {
+            add< KeyPacking >();
+            add< KeyStorageBound >();
+            add< PrefixMergeBoundary >();
+            add< KeyCodes >();
+        }
+    } myall;
+
+} // namespace BtreeV2Tests
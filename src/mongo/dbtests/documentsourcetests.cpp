@@ -422,17 +422,24 @@ namespace DocumentSourceTests {
 
         class Base : public DocumentSourceCursor::Base {
         protected:
-            void createGroup( const BSONObj &spec, bool inShard = false ) {
+            /** A nonzero maxMemoryUsageBytes allows the group to spill to disk past that size. */
+            void createGroup( const BSONObj &spec, bool inShard = false,
+                              size_t maxMemoryUsageBytes = 0 ) {
                 BSONObj namedSpec = BSON( "$group" << spec );
                 BSONElement specElement = namedSpec.firstElement();
 
                 intrusive_ptr<ExpressionContext> expressionContext =
                         new ExpressionContext(InterruptStatusMongod::status, NamespaceString(ns));
                 expressionContext->inShard = inShard;
+                expressionContext->extSortAllowed = maxMemoryUsageBytes != 0;
                 expressionContext->tempDir = storageGlobalParams.dbpath + "/_tmp";
 
                 _group = DocumentSourceGroup::createFromBson( specElement, expressionContext );
                 assertRoundTrips( _group );
+                if ( maxMemoryUsageBytes ) {
+                    static_cast<DocumentSourceGroup*>( _group.get() )
+                            ->setMaxMemoryUsageBytes( maxMemoryUsageBytes );
+                }
                 _group->setSource( source() );
             }
             DocumentSource* group() { return _group.get(); }
@@ -898,6 +905,78 @@ namespace DocumentSourceTests {
             string expectedResultSetString() { return "[{_id:[1,2,3],a:[[4,5,6]]}]"; }
         };
 
+        /**
+         * Groups past the memory limit are spilled to hash partitions, which are partitioned
+         * again when they don't fit in memory either, and every group is output once.
+         */
+        class SpillToPartitions : public Base {
+        public:
+            void run() {
+                for( int i = 0; i < 3000; ++i ) {
+                    client.insert( ns, BSON( "_id" << i << "a" << i % 500 << "b" << i ) );
+                }
+                createSource();
+                createGroup( fromjson( "{_id:'$a',n:{$sum:1},min:{$min:'$b'},all:{$push:'$b'}}" ),
+                             false,
+                             4 * 1024 );
+
+                IdMap results;
+                while ( boost::optional<Document> next = group()->getNext() ) {
+                    Value id = next->getField( "_id" );
+                    ASSERT( results.find( id ) == results.end() );
+                    results[ id ] = *next;
+                }
+                assertExhausted( group() );
+
+                ASSERT_EQUALS( 500U, results.size() );
+                for( int i = 0; i < 500; ++i ) {
+                    const Document& result = results[ Value( i ) ];
+                    ASSERT_EQUALS( Value( 6 ), result[ "n" ] );
+                    ASSERT_EQUALS( Value( i ), result[ "min" ] );
+                    ASSERT_EQUALS( 6U, result[ "all" ].getArray().size() );
+                }
+            }
+        };
+
+        /** Times a high cardinality group in memory and spilled to hash partitions. */
+        class SpillBenchmark : public Base {
+        public:
+            void run() {
+                const int n = 100000;
+                for( int i = 0; i < n; ++i ) {
+                    client.insert( ns, BSON( "_id" << i << "a" << i / 2 << "b" << i % 7 ) );
+                }
+
+                IdMap inMemory;
+                IdMap spilled;
+                long long inMemoryMillis = aggregate( 0, &inMemory );
+                long long spilledMillis = aggregate( 1024 * 1024, &spilled );
+
+                ASSERT_EQUALS( size_t( n / 2 ), inMemory.size() );
+                ASSERT_EQUALS( inMemory.size(), spilled.size() );
+                for( IdMap::const_iterator i = inMemory.begin(), j = spilled.begin();
+                     i != inMemory.end(); ++i, ++j ) {
+                    ASSERT_EQUALS( i->second.toBson(), j->second.toBson() );
+                }
+
+                unittest::log() << "$group of " << n << " documents into " << n / 2 << " groups: "
+                                << inMemoryMillis << "ms in memory, "
+                                << spilledMillis << "ms spilled to hash partitions" << endl;
+            }
+        private:
+            long long aggregate( size_t maxMemoryUsageBytes, IdMap* results ) {
+                createSource();
+                createGroup( fromjson( "{_id:'$a',sum:{$sum:'$b'},avg:{$avg:'$b'}}" ),
+                             false,
+                             maxMemoryUsageBytes );
+                Timer t;
+                while ( boost::optional<Document> next = group()->getNext() ) {
+                    ( *results )[ next->getField( "_id" ) ] = *next;
+                }
+                return t.millis();
+            }
+        };
+
     } // namespace DocumentSourceGroup
 
     namespace DocumentSourceProject {
@@ -1023,6 +1102,39 @@ namespace DocumentSourceTests {
             }
         };
 
+        /** Batches of documents are projected, interleaved with single documents. */
+        class Batches : public Base {
+        public:
+            void run() {
+                const int n = DocumentSource::BatchSize * 2 + 10;
+                for ( int i = 0; i < n; ++i ) {
+                    client.insert( ns, BSON( "_id" << i << "a" << i << "b" << 2 ) );
+                }
+                createSource();
+                createProject();
+
+                vector<Document> batch;
+                project()->getNextBatch( &batch );
+                ASSERT( !batch.empty() );
+                int count = 0;
+                while ( !batch.empty() ) {
+                    for ( size_t i = 0; i < batch.size(); ++i ) {
+                        ASSERT_EQUALS( count, batch[ i ].getField( "a" ).getInt() );
+                        ASSERT( batch[ i ].getField( "b" ).missing() );
+                        ++count;
+                    }
+                    // A single document may be pulled between batches.
+                    if ( boost::optional<Document> next = project()->getNext() ) {
+                        ASSERT_EQUALS( count, next->getField( "a" ).getInt() );
+                        ++count;
+                    }
+                    project()->getNextBatch( &batch );
+                }
+                ASSERT_EQUALS( n, count );
+                assertExhausted();
+            }
+        };
+
         /** List of dependent field paths. */
         class Dependencies : public Base {
         public:
@@ -1871,6 +1983,93 @@ namespace DocumentSourceTests {
                                                                      "{c:1}]}"));
             }
         };
+
+        /** Hands out the batches it was given, and their documents one by one from getNext(). */
+        class BatchSource : public mongo::DocumentSource {
+        public:
+            BatchSource( const intrusive_ptr<ExpressionContext>& ctx,
+                         const vector<vector<Document> >& batches )
+                : DocumentSource( ctx ), _batches( batches.begin(), batches.end() ) {}
+            virtual boost::optional<Document> getNext() {
+                while ( !_batches.empty() && _batches.front().empty() ) {
+                    _batches.pop_front();
+                }
+                if ( _batches.empty() ) {
+                    return boost::none;
+                }
+                Document next = _batches.front().front();
+                _batches.front().erase( _batches.front().begin() );
+                return next;
+            }
+            virtual void getNextBatch( vector<Document>* batch ) {
+                batch->clear();
+                if ( _batches.empty() ) {
+                    return;
+                }
+                batch->swap( _batches.front() );
+                _batches.pop_front();
+            }
+            size_t batchesLeft() const { return _batches.size(); }
+        private:
+            virtual Value serialize( bool explain ) const { return Value(); }
+            deque<vector<Document> > _batches;
+        };
+
+        /**
+         * Batches are filtered in place, a batch in which nothing matches is skipped rather than
+         * returned empty, which would end the stream.
+         */
+        class Batches {
+        public:
+            void run() {
+                intrusive_ptr<ExpressionContext> ctx =
+                    new ExpressionContext( InterruptStatusMongod::status, NamespaceString( ns ) );
+                vector<vector<Document> > batches( 4 );
+                int id = 0;
+                // some documents match
+                for ( int i = 0; i < 4; ++i, ++id ) {
+                    bool keep = i % 2 == 0;
+                    batches[ 0 ].push_back( Document( BSON( "_id" << id << "keep" << keep ) ) );
+                }
+                // none match
+                for ( int i = 0; i < 5; ++i, ++id )
+                    batches[ 1 ].push_back( Document( BSON( "_id" << id << "keep" << false ) ) );
+                // the last one matches
+                for ( int i = 0; i < 3; ++i, ++id ) {
+                    bool keep = i == 2;
+                    batches[ 2 ].push_back( Document( BSON( "_id" << id << "keep" << keep ) ) );
+                }
+                // none match, at the end
+                for ( int i = 0; i < 2; ++i, ++id )
+                    batches[ 3 ].push_back( Document( BSON( "_id" << id << "keep" << false ) ) );
+
+                intrusive_ptr<BatchSource> source = new BatchSource( ctx, batches );
+                intrusive_ptr<DocumentSource> match =
+                    DocumentSourceMatch::createFromBson( BSON( "$match" << BSON( "keep" << true ) )
+                                                         .firstElement(),
+                                                         ctx );
+                match->setSource( source.get() );
+
+                vector<Document> batch;
+                match->getNextBatch( &batch );
+                ASSERT_EQUALS( 2U, batch.size() );
+                ASSERT_EQUALS( 0, batch[ 0 ].getField( "_id" ).getInt() );
+                ASSERT_EQUALS( 2, batch[ 1 ].getField( "_id" ).getInt() );
+                ASSERT_EQUALS( 3U, source->batchesLeft() );
+
+                // the second batch is filtered out entirely, the third one is returned
+                match->getNextBatch( &batch );
+                ASSERT_EQUALS( 1U, batch.size() );
+                ASSERT_EQUALS( 11, batch[ 0 ].getField( "_id" ).getInt() );
+                ASSERT_EQUALS( 1U, source->batchesLeft() );
+
+                // nothing matches in the rest
+                match->getNextBatch( &batch );
+                ASSERT( batch.empty() );
+                ASSERT_EQUALS( 0U, source->batchesLeft() );
+                ASSERT( !match->getNext() );
+            }
+        };
     } // namespace DocumentSourceMatch
 
     class All : public Suite {
@@ -1926,6 +2125,8 @@ namespace DocumentSourceTests {
             add<DocumentSourceGroup::Dependencies>();
             add<DocumentSourceGroup::StringConstantIdAndAccumulatorExpressions>();
             add<DocumentSourceGroup::ArrayConstantAccumulatorExpression>();
+            add<DocumentSourceGroup::SpillToPartitions>();
+            add<DocumentSourceGroup::SpillBenchmark>();
 
             add<DocumentSourceProject::Inclusion>();
             add<DocumentSourceProject::Optimize>();
@@ -1934,6 +2135,7 @@ namespace DocumentSourceTests {
             add<DocumentSourceProject::TopLevelDollar>();
             add<DocumentSourceProject::InvalidSpec>();
             add<DocumentSourceProject::TwoDocuments>();
+            add<DocumentSourceProject::Batches>();
             add<DocumentSourceProject::Dependencies>();
 
             add<DocumentSourceSort::Empty>();
@@ -1979,6 +2181,7 @@ namespace DocumentSourceTests {
 
             add<DocumentSourceMatch::RedactSafePortion>();
             add<DocumentSourceMatch::Coalesce>();
+            add<DocumentSourceMatch::Batches>();
         }
     } myall;
 
@@ -1570,6 +1570,125 @@ namespace NamespaceTests {
             virtual string spec() const { return ""; }
         };
 
+        /** Size classes split every power of two evenly. */
+        class SizeClasses : public Base {
+        public:
+            void run() {
+                ASSERT_EQUALS( 0, DeletedRecordIndex::sizeClass( 24 ) );
+                ASSERT_EQUALS( 0, DeletedRecordIndex::sizeClass( 32 ) );
+                ASSERT_EQUALS( 1, DeletedRecordIndex::sizeClass( 40 ) );
+                for ( int c = 0; c < DeletedRecordIndex::kNumClasses; c++ ) {
+                    int minLength = DeletedRecordIndex::sizeClassMinLength( c );
+                    ASSERT_EQUALS( c, DeletedRecordIndex::sizeClass( minLength ) );
+                    if ( c > 0 )
+                        ASSERT_EQUALS( c - 1, DeletedRecordIndex::sizeClass( minLength - 1 ) );
+                }
+                ASSERT_EQUALS( DeletedRecordIndex::kNumClasses - 1,
+                               DeletedRecordIndex::sizeClass( 0x7fffffff ) );
+            }
+        };
+
+        /**
+         * With Flag_UseSizeClassFreeLists set, records are allocated through a DeletedRecordIndex
+         * which mirrors the deleted lists.
+         */
+        class SizeClassFreeListsReuseDeletedRecords : public Base {
+        public:
+            void run() {
+                create();
+                ASSERT( nsd()->setUserFlag( NamespaceDetails::Flag_UseSizeClassFreeLists ) );
+
+                vector<DiskLoc> locs;
+                for ( int i = 0; i < 20; i++ ) {
+                    BSONObj doc = BSON( "_id" << i << "x" << string( 100 + 50 * i, 'x' ) );
+                    StatusWith<DiskLoc> loc = collection()->insertDocument( doc, false );
+                    ASSERT( loc.isOK() );
+                    locs.push_back( loc.getValue() );
+                }
+                assertMirrorsDeletedLists();
+
+                // a document of the same size goes where a deleted one was
+                DiskLoc deleted = locs[10];
+                collection()->deleteDocument( deleted );
+                assertMirrorsDeletedLists();
+                BSONObj doc = BSON( "_id" << 100 << "x" << string( 100 + 50 * 10, 'x' ) );
+                StatusWith<DiskLoc> loc = collection()->insertDocument( doc, false );
+                ASSERT( loc.isOK() );
+                ASSERT_EQUALS( deleted, loc.getValue() );
+                assertMirrorsDeletedLists();
+
+                for ( int i = 0; i < 20; i += 2 )
+                    collection()->deleteDocument( locs[i] );
+                assertMirrorsDeletedLists();
+
+                // clearing the flag drops the index
+                ASSERT( nsd()->clearUserFlag( NamespaceDetails::Flag_UseSizeClassFreeLists ) );
+                ASSERT( collection()->getRecordStore()->getDeletedRecordIndex() == NULL );
+            }
+            virtual string spec() const { return ""; }
+
+        private:
+            void assertMirrorsDeletedLists() {
+                const DeletedRecordIndex* index =
+                    collection()->getRecordStore()->getDeletedRecordIndex();
+                ASSERT( index );
+
+                long long records = 0;
+                long long bytes = 0;
+                for ( int i = 0; i < Buckets; i++ ) {
+                    for ( DiskLoc dl = nsd()->deletedListEntry( i ); !dl.isNull();
+                          dl = dl.drec()->nextDeleted() ) {
+                        records++;
+                        bytes += dl.drec()->lengthWithHeaders();
+                    }
+                }
+                ASSERT_EQUALS( records, index->numRecords() );
+                ASSERT_EQUALS( bytes, index->numBytes() );
+            }
+        };
+
+        /**
+         * A DeletedRecordIndex finds a long enough record of the requested size class beyond the
+         * ones it probes when no larger class holds a record.
+         */
+        class SizeClassTakeSearchesWholeClass : public Base {
+        public:
+            void run() {
+                create();
+
+                // carve the extent's deleted record into records of one size class, the one long
+                // enough for 310 bytes last, so it is at the head of its list and not probed
+                DiskLoc extentSpace = smallestDeletedRecord();
+                ASSERT( !extentSpace.isNull() );
+                ASSERT_GREATER_THAN_OR_EQUALS( extentSpace.drec()->lengthWithHeaders(),
+                                               9 * 300 + 316 );
+                int extentOfs = extentSpace.drec()->extentOfs();
+                nsd()->orphanDeletedList();
+                int lengths[ 10 ] = { 300, 300, 300, 300, 300, 300, 300, 300, 300, 316 };
+                DiskLoc loc = extentSpace;
+                DiskLoc fits;
+                for ( int i = 0; i < 10; i++ ) {
+                    DeletedRecord* d = getDur().writing( loc.drec() );
+                    d->lengthWithHeaders() = lengths[ i ];
+                    d->extentOfs() = extentOfs;
+                    nsd()->addDeletedRec( d, loc );
+                    fits = loc;
+                    loc.inc( lengths[ i ] );
+                }
+                ASSERT_EQUALS( DeletedRecordIndex::sizeClass( 300 ),
+                               DeletedRecordIndex::sizeClass( 316 ) );
+                ASSERT( DeletedRecordIndex::kMaxProbes < 9 );
+
+                DeletedRecordIndex index;
+                index.sync( nsd() );
+                ASSERT_EQUALS( fits, index.take( nsd(), 310 ) );
+                ASSERT( index.take( nsd(), 310 ).isNull() );
+                ASSERT( index.isInSync( nsd() ) );
+                ASSERT_EQUALS( 9, index.numRecords() );
+            }
+            virtual string spec() const { return ""; }
+        };
+
         /* test  NamespaceDetails::cappedTruncateAfter(const char *ns, DiskLoc loc)
         */
         class TruncateCapped : public Base {
@@ -1809,6 +1928,9 @@ namespace NamespaceTests {
             add< NamespaceDetailsTests::AllocQuantizedWithoutExtra >();
             add< NamespaceDetailsTests::AllocNotQuantizedNearDeletedSize >();
             add< NamespaceDetailsTests::AllocFailsWithTooSmallDeletedRecord >();
+            add< NamespaceDetailsTests::SizeClasses >();
+            add< NamespaceDetailsTests::SizeClassFreeListsReuseDeletedRecords >();
+            add< NamespaceDetailsTests::SizeClassTakeSearchesWholeClass >();
             add< NamespaceDetailsTests::TwoExtent >();
             add< NamespaceDetailsTests::TruncateCapped >();
             add< NamespaceDetailsTests::Migrate >();
@@ -398,12 +398,88 @@ private:
     char _buf[ 1024 ];
 };
 
+/**
+ * Compares a v:1 and a v:2 (prefix compressed) index on a compound key whose leading fields
+ * repeat across many documents, reporting the size of each index and the throughput of an
+ * index scan.  The perf dbtests (btree-lookup-*) time point lookups in process.
+ */
+class IndexVersionComparison {
+public:
+    IndexVersionComparison( DBClientConnection &conn, int tenants, int usersPerTenant, int eventsPerUser ) :
+        _conn( conn ),
+        _tenants( tenants ),
+        _usersPerTenant( usersPerTenant ),
+        _eventsPerUser( eventsPerUser ) {
+    }
+    void run() {
+        cout << "version,indexBytes,scanned,scanMillis" << endl;
+        for( int v = 1; v <= 2; ++v ) {
+            _conn.dropCollection( ns );
+            _conn.ensureIndex( ns, BSON( "tenantId" << 1 << "userId" << 1 << "ts" << 1 ),
+                               false, "", false, false, v );
+            load();
+            report( v );
+        }
+    }
+private:
+    string tenantId( int t ) const {
+        return str::stream() << "tenant-" << ( 1000000 + t );
+    }
+    string userId( int u ) const {
+        return str::stream() << "user-account-" << ( 10000000 + u );
+    }
+    void load() {
+        for( int t = 0; t < _tenants; ++t ) {
+            for( int u = 0; u < _usersPerTenant; ++u ) {
+                for( int e = 0; e < _eventsPerUser; ++e ) {
+                    _conn.insert( ns, BSON( "tenantId" << tenantId( t ) <<
+                                            "userId" << userId( u ) <<
+                                            "ts" << Date_t( 1380000000000LL + e * 1000LL ) ) );
+                }
+            }
+        }
+        _conn.getLastError();
+    }
+    void report( int v ) {
+        BSONObj stats;
+        _conn.runCommand( db, BSON( "collstats" << "btreeperf" ), stats );
+        long long indexBytes = stats[ "indexSizes" ][ "tenantId_1_userId_1_ts_1" ].numberLong();
+
+        Timer scanTimer;
+        long long scanned = 0;
+        auto_ptr<DBClientCursor> c =
+            _conn.query( ns, Query().hint( BSON( "tenantId" << 1 << "userId" << 1 << "ts" << 1 ) ),
+                         0, 0, &_scanFields );
+        while( c->more() ) {
+            c->next();
+            ++scanned;
+        }
+        cout << v << ',' << indexBytes << ',' << scanned << ',' << scanTimer.millis() << endl;
+    }
+
+    DBClientConnection &_conn;
+    int _tenants;
+    int _usersPerTenant;
+    int _eventsPerUser;
+    static BSONObj _scanFields;
+};
+
+// covered by the index, so the scan does not fetch documents
+BSONObj IndexVersionComparison::_scanFields = BSON( "_id" << 0 << "tenantId" << 1 << "userId" << 1 << "ts" << 1 );
+
 int main( int argc, const char **argv ) {
 
     DBClientConnection conn;
     conn.connect( "127.0.0.1:27017" );
     conn.dropCollection( ns );
 
+    // btreeperf compare: compare index versions rather than run the insert / remove workload.
+    if ( argc > 1 && string( argv[ 1 ] ) == "compare" ) {
+        IndexVersionComparison comparison( conn, 20, 500, 20 );
+        comparison.run();
+        return 0;
+    }
+
 //    UniformInsertRangedUniformRemoveInteger strategy;
 //    UniformInsertUniformRemoveInteger strategy;
 //    UniformInsertRangedUniformRemoveString strategy;
@@ -0,0 +1,170 @@
+// gatherperf.cpp
+
+/*    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ * How long shard responses wait before mongos handles them in a scatter-gather.
+ *
+ * Mock shards (socket pairs) answer after random delays of up to --maxDelay millis, and each
+ * response costs --handleMicros to handle, e.g. parsing a batch.  The responses are gathered
+ * in shard order, as with a blocking recv() on each shard in turn, and in arrival order
+ * through a ResponsePoller, for 4, 16 and 64 shards.  Prints p50 and p99 of the delay between
+ * a shard responding and its response being handled.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#include "mongo/base/initializer.h"
+#include "mongo/client/response_poller.h"
+#include "mongo/platform/random.h"
+#include "mongo/util/assert_util.h"
+#include "mongo/util/time_support.h"
+
+using namespace std;
+using namespace mongo;
+
+#ifndef _WIN32
+
+int rounds = 20;
+int maxDelay = 20;
+int handleMicros = 200;
+
+/** A connected pair of sockets: the "shard" writes its response to [1], mongos reads [0]. */
+struct MockShard {
+    MockShard() {
+        int fds[2];
+        verify( ::socketpair( PF_LOCAL, SOCK_STREAM, 0, fds ) == 0 );
+        mongosFD = fds[0];
+        shardFD = fds[1];
+    }
+    ~MockShard() {
+        ::close( mongosFD );
+        ::close( shardFD );
+    }
+
+    void respondAfter( int millis, unsigned long long* respondedAtMicros ) {
+        sleepmillis( millis );
+        *respondedAtMicros = curTimeMicros64();
+        char c = 'r';
+        verify( ::write( shardFD, &c, 1 ) == 1 );
+    }
+
+    /** The blocking recv() of the response */
+    void recv() {
+        char c;
+        verify( ::read( mongosFD, &c, 1 ) == 1 );
+    }
+
+    int mongosFD;
+    int shardFD;
+};
+
+/**
+ * @return the delays in micros between the shards responding and their responses being
+ *         handled, over all rounds, sorted
+ */
+vector<unsigned long long> gather( size_t numShards, bool poll, PseudoRandom& random ) {
+    vector<unsigned long long> delays;
+    for ( int r = 0; r < rounds; r++ ) {
+        vector<boost::shared_ptr<MockShard> > shards;
+        vector<unsigned long long> respondedAt( numShards );
+        boost::thread_group responders;
+        for ( size_t i = 0; i < numShards; i++ ) {
+            shards.push_back( boost::shared_ptr<MockShard>( new MockShard() ) );
+            responders.create_thread( boost::bind( &MockShard::respondAfter,
+                                                   shards[i].get(),
+                                                   random.nextInt32( maxDelay ),
+                                                   &respondedAt[i] ) );
+        }
+
+        // without polling every fd is handed back at once, in shard order
+        ResponsePoller poller;
+        for ( size_t i = 0; i < numShards; i++ )
+            poller.addFD( poll ? shards[i]->mongosFD : -1, i );
+
+        while ( poller.numPending() > 0 ) {
+            size_t i = poller.waitForAny();
+            shards[i]->recv();
+            delays.push_back( curTimeMicros64() - respondedAt[i] );
+            sleepmicros( handleMicros );
+        }
+        responders.join_all();
+    }
+    sort( delays.begin(), delays.end() );
+    return delays;
+}
+
+unsigned long long percentile( const vector<unsigned long long>& sorted, double p ) {
+    return sorted[ min( sorted.size() - 1, static_cast<size_t>( sorted.size() * p ) ) ];
+}
+
+int main( int argc, char** argv, char** envp ) {
+    for ( int i = 1; i + 1 < argc; i += 2 ) {
+        string arg = argv[i];
+        int val = atoi( argv[i + 1] );
+        if ( arg == "--rounds" ) rounds = val;
+        else if ( arg == "--maxDelay" ) maxDelay = val;
+        else if ( arg == "--handleMicros" ) handleMicros = val;
+        else {
+            cout << "usage: " << argv[0] << " [--rounds n] [--maxDelay millis]"
+                 << " [--handleMicros n]" << endl;
+            return 1;
+        }
+    }
+
+    runGlobalInitializersOrDie( argc, argv, envp );
+
+    if ( ! isPollSupported() ) {
+        cout << "poll() is not supported on this platform" << endl;
+        return 1;
+    }
+
+    PseudoRandom random( static_cast<int32_t>( curTimeMicros64() ) );
+    const size_t shardCounts[] = { 4, 16, 64 };
+    for ( size_t i = 0; i < sizeof(shardCounts) / sizeof(shardCounts[0]); i++ ) {
+        vector<unsigned long long> inOrder = gather( shardCounts[i], false, random );
+        vector<unsigned long long> polled = gather( shardCounts[i], true, random );
+
+        cout << "{ shards: " << shardCounts[i]
+             << ", shardOrder: { p50: " << percentile( inOrder, 0.5 )
+             << ", p99: " << percentile( inOrder, 0.99 ) << " }"
+             << ", arrivalOrder: { p50: " << percentile( polled, 0.5 )
+             << ", p99: " << percentile( polled, 0.99 ) << " } }" << endl;
+    }
+    return 0;
+}
+
+#else
+
+int main( int argc, char** argv ) {
+    cout << "gatherperf needs socketpair(), which this platform doesn't have" << endl;
+    return 1;
+}
+
+#endif // ndef _WIN32
@@ -0,0 +1,210 @@
+// messageserverperf.cpp
+
+/*    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ * Throughput and footprint of the message server with many mostly idle connections.
+ *
+ * Starts an in process echo server, either thread per connection (the default) or
+ * multiplexed over epoll (--reactor N), then opens 1k, 10k and 50k connections of which
+ * --active are driven by client threads issuing round trips for --seconds each.  Prints
+ * round trips per second and the thread count and virtual size of the process.
+ *
+ * 50k connections need a matching ulimit -n and enough ephemeral ports on localhost.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+#include "mongo/base/initializer.h"
+#include "mongo/client/dbclientinterface.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/net/listen.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/message_server.h"
+#include "mongo/util/net/sock.h"
+#include "mongo/util/timer.h"
+
+using namespace std;
+using namespace mongo;
+
+namespace {
+    mongo::mutex shutDownMutex("shutDownMutex");
+    bool shuttingDown = false;
+}
+
+namespace mongo {
+    // Symbols defined to build the binary correctly.
+
+    bool inShutdown() {
+        scoped_lock sl(shutDownMutex);
+        return shuttingDown;
+    }
+
+    DBClientBase *createDirectClient() { return NULL; }
+
+    void dbexit(ExitCode rc, const char *why){
+        {
+            scoped_lock sl(shutDownMutex);
+            shuttingDown = true;
+        }
+
+        ::_exit(rc);
+    }
+
+    bool haveLocalShardingInfo(const string& ns) {
+        return false;
+    }
+}
+
+/**
+ * Replies to every message with its own payload.
+ */
+class EchoMessageHandler : public MessageHandler {
+public:
+    virtual void connected( AbstractMessagingPort* p ) {}
+
+    virtual void process( Message& m, AbstractMessagingPort* p, LastError* le ) {
+        Message response;
+        response.setData( opReply, m.singleData()->_data, m.dataSize() );
+        p->reply( m, response );
+    }
+
+    virtual void disconnected( AbstractMessagingPort* p ) {}
+
+    virtual bool isThreadAgnostic() const { return true; }
+};
+
+const int port = 27599;
+
+int reactorThreads = 0;
+int workerThreads = 16;
+int activeConnections = 100;
+int seconds = 10;
+
+AtomicUInt64 roundTrips;
+AtomicUInt32 stopClients;
+
+MessagingPort* connect() {
+    boost::shared_ptr<Socket> s( new Socket() );
+    SockAddr addr( "127.0.0.1", port );
+    if ( ! s->connect( addr ) )
+        return NULL;
+    return new MessagingPort( s );
+}
+
+void runServer( MessageServer* server ) {
+    server->setupSockets();
+    server->run();
+}
+
+void runClient( MessagingPort* p ) {
+    const char payload[] = "ping";
+    while ( ! stopClients.load() ) {
+        Message toSend;
+        toSend.setData( dbMsg, payload );
+        Message response;
+        if ( ! p->call( toSend, response ) ) {
+            cout << "call failed" << endl;
+            return;
+        }
+        roundTrips.fetchAndAdd( 1 );
+    }
+}
+
+/** @return a field such as "Threads" or "VmSize" of /proc/self/status, or "?" */
+string procStatus( const string& field ) {
+    ifstream status( "/proc/self/status" );
+    string line;
+    while ( getline( status, line ) ) {
+        if ( line.compare( 0, field.size() + 1, field + ":" ) == 0 )
+            return str::ltrim( line.substr( field.size() + 1 ) );
+    }
+    return "?";
+}
+
+int main( int argc, char** argv, char** envp ) {
+    for ( int i = 1; i + 1 < argc; i += 2 ) {
+        string arg = argv[i];
+        int val = atoi( argv[i + 1] );
+        if ( arg == "--reactor" ) reactorThreads = val;
+        else if ( arg == "--workers" ) workerThreads = val;
+        else if ( arg == "--active" ) activeConnections = val;
+        else if ( arg == "--seconds" ) seconds = val;
+        else {
+            cout << "usage: " << argv[0] << " [--reactor n] [--workers n] [--active n] [--seconds n]"
+                 << endl;
+            return 1;
+        }
+    }
+
+    runGlobalInitializersOrDie( argc, argv, envp );
+    Listener::globalTicketHolder.resize( 60000 );
+
+    MessageServer::Options options;
+    options.port = port;
+    options.reactorThreads = reactorThreads;
+    options.workerThreads = workerThreads;
+    EchoMessageHandler handler;
+    MessageServer* server = createServer( options, &handler );
+    boost::thread serverThread( runServer, server );
+    sleepsecs( 1 );
+
+    vector<MessagingPort*> active;
+    for ( int i = 0; i < activeConnections; i++ ) {
+        MessagingPort* p = connect();
+        verify( p );
+        active.push_back( p );
+    }
+
+    vector<MessagingPort*> idle;
+    const int levels[] = { 1000, 10000, 50000 };
+    for ( size_t level = 0; level < sizeof(levels) / sizeof(levels[0]); level++ ) {
+        while ( static_cast<int>( idle.size() + active.size() ) < levels[level] ) {
+            MessagingPort* p = connect();
+            if ( ! p ) {
+                cout << "could not open connection " << idle.size() + active.size() << endl;
+                break;
+            }
+            idle.push_back( p );
+        }
+        sleepsecs( 1 );
+
+        stopClients.store( 0 );
+        roundTrips.store( 0 );
+        boost::thread_group clients;
+        for ( size_t i = 0; i < active.size(); i++ )
+            clients.create_thread( boost::bind( runClient, active[i] ) );
+
+        Timer t;
+        sleepsecs( seconds );
+        stopClients.store( 1 );
+        clients.join_all();
+
+        cout << "{ mode: '" << ( reactorThreads ? "reactor" : "thread per connection" ) << "'"
+             << ", connections: " << idle.size() + active.size()
+             << ", active: " << active.size()
+             << ", roundTripsPerSec: " << roundTrips.load() * 1000000 / t.micros()
+             << ", threads: " << procStatus( "Threads" )
+             << ", vsize: '" << procStatus( "VmSize" ) << "' }" << endl;
+    }
+
+    ::_exit( 0 );
+}
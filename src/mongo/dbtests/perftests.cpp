@@ -40,11 +40,14 @@
 #include <boost/thread/thread.hpp>
 #include <fstream>
 
+#include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/db.h"
 #include "mongo/db/dur_stats.h"
+#include "mongo/db/index/btree_based_access_method.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/json.h"
 #include "mongo/db/structure/btree/key.h"
+#include "mongo/db/structure/collection.h"
 #include "mongo/db/lasterror.h"
 #include "mongo/db/taskqueue.h"
 #include "mongo/dbtests/dbtests.h"
@@ -1137,6 +1140,54 @@ namespace PerfTests {
         }
     };
 
+    /**
+     * Random point lookups through a single field index of version 'v', on integer or string
+     * keys.  Each timed() runs a batch of them through the index access method under one read
+     * lock, so what's measured is mostly the search of the buckets.
+     */
+    template <int v, bool strings>
+    class BtreeLookup : public B {
+    public:
+        enum { Keys = 100000, LookupsPerLock = 100 };
+        string name() {
+            return str::stream() << "btree-lookup-v" << v << ( strings ? "-string" : "-int" )
+                                 << "-x" << LookupsPerLock;
+        }
+        virtual bool showDurStats() { return false; }
+        void prep() {
+            client().ensureIndex( ns(), BSON( "k" << 1 ), false, "", false, false, v );
+            _keys.clear();
+            for ( int i = 0; i < Keys; i++ ) {
+                BSONObj o = doc( i );
+                client().insert( ns(), o );
+                _keys.push_back( BSON( "" << o["k"] ) );
+            }
+        }
+        void timed() {
+            Client::ReadContext ctx( ns() );
+            Collection* collection = ctx.ctx().db()->getCollection( ns() );
+            IndexCatalog* catalog = collection->getIndexCatalog();
+            BtreeBasedAccessMethod* iam =
+                catalog->getBtreeBasedIndex( catalog->findIndexByKeyPattern( BSON( "k" << 1 ) ) );
+            for ( int i = 0; i < LookupsPerLock; i++ ) {
+                verify( !iam->findSingle( _keys[ std::rand() % Keys ] ).isNull() );
+            }
+        }
+    private:
+        static BSONObj doc( int i ) {
+            long long x = i * 7919LL % Keys;
+            if ( strings ) {
+                // keys differ in their first 8 bytes, which is what the v:2 key codes look at:
+                // an odd multiplier permutes 32 bit values, so distinct x give distinct heads
+                char head[16];
+                sprintf( head, "%08x", static_cast<unsigned>( x * 2654435761LL ) );
+                return BSON( "k" << string( str::stream() << head << "-key" ) );
+            }
+            return BSON( "k" << x );
+        }
+        vector<BSONObj> _keys;
+    };
+
     template <typename T>
     class MoreIndexes : public T {
     public:
@@ -1431,6 +1482,12 @@ namespace PerfTests {
                 add< Update1 >();
                 add< MoreIndexes<Update1> >();
                 add< InsertBig >();
+                add< BtreeLookup<0, false> >();
+                add< BtreeLookup<1, false> >();
+                add< BtreeLookup<2, false> >();
+                add< BtreeLookup<0, true> >();
+                add< BtreeLookup<1, true> >();
+                add< BtreeLookup<2, true> >();
                 add< FailPointTest<false, false> >();
                 add< FailPointTest<true, false> >();
                 add< FailPointTest<true, true> >();
@@ -280,6 +280,82 @@ namespace ShardingTests {
 
     };
 
+    //
+    // Tests that reloading after a split changes only the split chunk: the new chunk manager
+    // shares the other chunks with the old one, and the old one is left as it was.
+    //
+    class ChunkManagerLoadSplitTest : public ChunkManagerCreateFullTest {
+    public:
+
+        void run(){
+
+            createChunks( "_id" );
+            int numChunks = static_cast<int>(client().count(ChunkType::ConfigNS,
+                                                            BSON(ChunkType::ns(collName()))));
+
+            ChunkManagerPtr manager( new ChunkManager( collName(), ShardKeyPattern( BSON( "_id" << 1 ) ), false ) );
+            ((ChunkManager*) manager.get())->loadExistingRanges( shard().getConnString() );
+            ChunkVersion version = manager->getVersion();
+
+            // Find a chunk with room for a split point
+            ChunkMap oldChunks = manager->getChunkMap();
+            ChunkPtr toSplit;
+            for ( ChunkMap::const_iterator it = oldChunks.begin(); it != oldChunks.end(); ++it ) {
+                BSONElement min = it->second->getMin()[ "_id" ];
+                BSONElement max = it->second->getMax()[ "_id" ];
+                if ( min.isNumber() && max.isNumber() && max.numberInt() - min.numberInt() > 1 ) {
+                    toSplit = it->second;
+                    break;
+                }
+            }
+            ASSERT( toSplit );
+
+            int midPoint = ( toSplit->getMin()[ "_id" ].numberInt() +
+                             toSplit->getMax()[ "_id" ].numberInt() ) / 2;
+            BSONObj mid = BSON( "_id" << midPoint );
+
+            // Split it on the config server as splitChunk does, with a new major version
+            ChunkVersion splitVersion( version.majorVersion() + 1, 0, version.epoch() );
+            Chunk low( manager.get(), toSplit->getMin(), mid, shard(), splitVersion );
+            splitVersion.incMinor();
+            Chunk high( manager.get(), mid, toSplit->getMax(), shard(), splitVersion );
+
+            BSONObjBuilder lowB;
+            low.serialize( lowB );
+            BSONObjBuilder highB;
+            high.serialize( highB );
+            client().update( ChunkType::ConfigNS, BSON( ChunkType::name( toSplit->genID() ) ),
+                             lowB.obj() );
+            client().insert( ChunkType::ConfigNS, highB.obj() );
+
+            ChunkManager newManager( manager );
+            newManager.loadExistingRanges( shard().getConnString() );
+
+            ASSERT( newManager.getVersion().toLong() == splitVersion.toLong() );
+            ASSERT_EQUALS( numChunks + 1, newManager.numChunks() );
+            ASSERT_EQUALS( numChunks, manager->numChunks() );
+            ASSERT( manager->findIntersectingChunk( mid ) == toSplit );
+
+            ChunkPtr newHigh = newManager.findIntersectingChunk( mid );
+            ASSERT_EQUALS( mid, newHigh->getMin() );
+            ASSERT_EQUALS( toSplit->getMax(), newHigh->getMax() );
+
+            // Everything else is shared rather than copied
+            ChunkMap newChunks = newManager.getChunkMap();
+            for ( ChunkMap::const_iterator it = oldChunks.begin(); it != oldChunks.end(); ++it ) {
+                if ( it->second == toSplit )
+                    continue;
+                ASSERT( newChunks.find( it->first )->second == it->second );
+            }
+
+            set<Shard> shards;
+            newManager.getShardsForRange( shards, toSplit->getMin(), toSplit->getMax() );
+            ASSERT_EQUALS( 1U, shards.size() );
+            ASSERT( shards.count( shard() ) );
+        }
+
+    };
+
     class ChunkDiffUnitTest {
     public:
 
@@ -652,6 +728,7 @@ namespace ShardingTests {
             add< ChunkManagerCreateBasicTest >();
             add< ChunkManagerCreateFullTest >();
             add< ChunkManagerLoadBasicTest >();
+            add< ChunkManagerLoadSplitTest >();
             add< ChunkDiffUnitTestNormal >();
             add< ChunkDiffUnitTestInverse >();
         }
@@ -36,6 +36,7 @@
 
 #include "mongo/bson/util/atomic_int.h"
 #include "mongo/db/d_concurrency.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/dbtests/dbtests.h"
 #include "mongo/platform/atomic_word.h"
 #include "mongo/util/concurrency/mvar.h"
@@ -907,6 +908,93 @@ namespace ThreadedTests {
         }
     };
 
+    // Collection writers on different collections of one database run together; collection
+    // writers on the same collection, and database level lockers, exclude each other.
+    class CollectionWriteTest : public ThreadedTest<9> {
+        enum { N = 2000, NColls = 3 };
+        AtomicUInt32 _writers[NColls];  // current holders per collection
+        AtomicUInt32 _allWriters;       // current holders of any collection lock
+        AtomicUInt32 _maxAllWriters;
+        bool _wasEnabled;
+    public:
+        CollectionWriteTest() : _wasEnabled(false) {}
+        void run() {
+            // collectionLevelLocking is a startup parameter, so set it directly for the test
+            ExportedServerParameter<bool>* param = collectionLevelLockingParam();
+            _wasEnabled = param->get();
+            ASSERT_OK( param->set( true ) );
+            try {
+                ThreadedTest<9>::run();
+            }
+            catch ( ... ) {
+                param->set( _wasEnabled );
+                throw;
+            }
+            ASSERT_OK( param->set( _wasEnabled ) );
+        }
+    private:
+        static ExportedServerParameter<bool>* collectionLevelLockingParam() {
+            const ServerParameter::Map& m = ServerParameterSet::getGlobal()->getMap();
+            ServerParameter::Map::const_iterator i = m.find( "collectionLevelLocking" );
+            verify( i != m.end() );
+            return static_cast<ExportedServerParameter<bool>*>( i->second );
+        }
+        static string ns( int coll ) {
+            return str::stream() << "collwritetest.c" << coll;
+        }
+        virtual void subthread(int x) {
+            ASSERT( Lock::CollectionWrite::supported( ns( x % NColls ) ) );
+            string threadName = ( str::stream() << "collwritetest" << x );
+            Client::initThread( threadName.c_str() );
+            for( int i = 0; i < N; i++ ) {
+                if( x == 1 ) {
+                    // database level lockers
+                    if( i % 2 ) {
+                        Lock::DBRead r( "collwritetest" );
+                        ASSERT_EQUALS( 0U, _allWriters.load() );
+                    }
+                    else {
+                        Lock::DBWrite w( "collwritetest" );
+                        ASSERT_EQUALS( 0U, _allWriters.load() );
+                    }
+                    continue;
+                }
+
+                int coll = ( x + i ) % NColls;
+                Lock::CollectionWrite lk( ns( coll ) );
+                ASSERT( Lock::isWriteLocked( ns( coll ) ) );
+                ASSERT( !Lock::isWriteLocked( ns( ( coll + 1 ) % NColls ) ) );
+                ASSERT( !Lock::isWriteLocked( "collwritetest" ) );
+                ASSERT( Lock::isIntentWriteLocked( "collwritetest" ) );
+
+                ASSERT_EQUALS( 1U, _writers[coll].addAndFetch( 1 ) );
+                unsigned all = _allWriters.addAndFetch( 1 );
+                unsigned max = _maxAllWriters.load();
+                while( all > max && _maxAllWriters.compareAndSwap( max, all ) != max )
+                    max = _maxAllWriters.load();
+
+                if( i % 10 == 0 ) {
+                    sleepmillis(1);
+                }
+                _allWriters.subtractAndFetch( 1 );
+                _writers[coll].subtractAndFetch( 1 );
+
+                if( i % 15 == 0 ) {
+                    Lock::TempRelease t;
+                    ASSERT( !Lock::isLocked() );
+                }
+            }
+            cc().shutdown();
+        }
+        virtual void validate() {
+            mongo::unittest::log() << "CollectionWriteTest max concurrent collection writers: "
+                                   << _maxAllWriters.load() << endl;
+            ASSERT( _maxAllWriters.load() <= NColls );
+            // writers on different collections must actually have run at the same time
+            ASSERT( _maxAllWriters.load() > 1 );
+        }
+    };
+
     // Tests waiting on the TicketHolder by running many more threads than can fit into the "hotel", but only
     // max _nRooms threads should ever get in at once
     class TicketHolderWaits : public ThreadedTest<10> {
@@ -989,6 +1077,7 @@ namespace ThreadedTests {
             add< WriteLocksAreGreedy >();
             add< QLockTest >();
             add< QLockTest >();
+            add< CollectionWriteTest >();
 
             // Slack is a test to see how long it takes for another thread to pick up
             // and begin work after another relinquishes the lock.  e.g. a spin lock 
@@ -30,6 +30,8 @@
 
 #include "mongo/s/balance.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/write_concern.h"
@@ -46,6 +48,7 @@
 #include "mongo/s/type_mongos.h"
 #include "mongo/s/type_settings.h"
 #include "mongo/s/type_tags.h"
+#include "mongo/util/timer.h"
 #include "mongo/util/version.h"
 
 namespace mongo {
@@ -57,81 +60,128 @@ namespace mongo {
     Balancer::~Balancer() {
     }
 
-    int Balancer::_moveChunks(const vector<CandidateChunkPtr>* candidateChunks,
+    void Balancer::_moveChunk(const CandidateChunk* candidate,
                               bool secondaryThrottle,
-                              bool waitForDelete)
+                              bool waitForDelete,
+                              int* movedCount)
     {
-        int movedCount = 0;
+        const CandidateChunk& chunkInfo = *candidate;
 
-        for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
-            const CandidateChunk& chunkInfo = *it->get();
+        // Changes to metadata, borked metadata, and connectivity problems should cause us to
+        // abort this chunk move, but shouldn't cause us to abort the entire round of chunks.
+        // TODO: Handle all these things more cleanly, since they're expected problems
+        try {
 
-            // Changes to metadata, borked metadata, and connectivity problems should cause us to
-            // abort this chunk move, but shouldn't cause us to abort the entire round of chunks.
-            // TODO: Handle all these things more cleanly, since they're expected problems
-            try {
+            DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
+            verify( cfg );
 
-                DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
-                verify( cfg );
+            // NOTE: We purposely do not reload metadata here, since _doBalanceRound already
+            // tried to do so once.
+            ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+            verify( cm );
 
-                // NOTE: We purposely do not reload metadata here, since _doBalanceRound already
-                // tried to do so once.
-                ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+            ChunkPtr c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+            if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
+                // likely a split happened somewhere
+                cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
                 verify( cm );
 
-                ChunkPtr c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+                c = cm->findIntersectingChunk( chunkInfo.chunk.min );
                 if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
-                    // likely a split happened somewhere
-                    cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
-                    verify( cm );
-
-                    c = cm->findIntersectingChunk( chunkInfo.chunk.min );
-                    if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
-                        log() << "chunk mismatch after reload, ignoring will retry issue " << chunkInfo.chunk.toString() << endl;
-                        continue;
-                    }
-                }
-
-                BSONObj res;
-                if (c->moveAndCommit(Shard::make(chunkInfo.to),
-                                     Chunk::MaxChunkSize,
-                                     secondaryThrottle,
-                                     waitForDelete,
-                                     0, /* maxTimeMS */
-                                     res)) {
-                    movedCount++;
-                    continue;
+                    log() << "chunk mismatch after reload, ignoring will retry issue " << chunkInfo.chunk.toString() << endl;
+                    return;
                 }
+            }
 
-                // the move requires acquiring the collection metadata's lock, which can fail
-                log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
-                      << " chunk: " << chunkInfo.chunk << endl;
+            BSONObj res;
+            if (c->moveAndCommit(Shard::make(chunkInfo.to),
+                                 Chunk::MaxChunkSize,
+                                 secondaryThrottle,
+                                 waitForDelete,
+                                 0, /* maxTimeMS */
+                                 res)) {
+                (*movedCount)++;
+                return;
+            }
 
-                if ( res["chunkTooBig"].trueValue() ) {
-                    // reload just to be safe
-                    cm = cfg->getChunkManager( chunkInfo.ns );
-                    verify( cm );
-                    c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+            // the move requires acquiring the collection metadata's lock, which can fail
+            log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
+                  << " chunk: " << chunkInfo.chunk << endl;
 
-                    log() << "forcing a split because migrate failed for size reasons" << endl;
+            if ( res["chunkTooBig"].trueValue() ) {
+                // reload just to be safe
+                cm = cfg->getChunkManager( chunkInfo.ns );
+                verify( cm );
+                c = cm->findIntersectingChunk( chunkInfo.chunk.min );
 
-                    res = BSONObj();
-                    c->singleSplit( true , res );
-                    log() << "forced split results: " << res << endl;
+                log() << "forcing a split because migrate failed for size reasons" << endl;
 
-                    if ( ! res["ok"].trueValue() ) {
-                        log() << "marking chunk as jumbo: " << c->toString() << endl;
-                        c->markAsJumbo();
-                        // we increment moveCount so we do another round right away
-                        movedCount++;
-                    }
+                res = BSONObj();
+                c->singleSplit( true , res );
+                log() << "forced split results: " << res << endl;
 
+                if ( ! res["ok"].trueValue() ) {
+                    log() << "marking chunk as jumbo: " << c->toString() << endl;
+                    c->markAsJumbo();
+                    // we increment moveCount so we do another round right away
+                    (*movedCount)++;
                 }
+
             }
-            catch( const DBException& ex ) {
-                warning() << "could not move chunk " << chunkInfo.chunk.toString()
-                          << ", continuing balancing round" << causedBy( ex ) << endl;
+        }
+        catch( const DBException& ex ) {
+            warning() << "could not move chunk " << chunkInfo.chunk.toString()
+                      << ", continuing balancing round" << causedBy( ex ) << endl;
+        }
+        catch( const std::exception& ex ) {
+            // may be running on its own thread, nothing above would catch this
+            warning() << "could not move chunk " << chunkInfo.chunk.toString()
+                      << ", continuing balancing round" << causedBy( ex ) << endl;
+        }
+    }
+
+    int Balancer::_moveChunks(const vector<CandidateChunkPtr>* candidateChunks,
+                              bool secondaryThrottle,
+                              bool waitForDelete,
+                              int maxConcurrentMigrations)
+    {
+        // Migrations between disjoint pairs of shards don't contend for anything but the config
+        // servers, so each batch runs at the same time.  Chunks of one collection never share a
+        // batch, since there is a single candidate per collection.
+        vector< vector<size_t> > batches;
+        BalancerPolicy::scheduleConcurrentMigrations(*candidateChunks,
+                                                     std::max(maxConcurrentMigrations, 0),
+                                                     &batches);
+
+        int movedCount = 0;
+
+        for ( size_t i = 0; i < batches.size(); i++ ) {
+            const vector<size_t>& batch = batches[i];
+            vector<int> moved( batch.size(), 0 );
+
+            if ( batch.size() == 1 ) {
+                _moveChunk( (*candidateChunks)[batch[0]].get(),
+                            secondaryThrottle,
+                            waitForDelete,
+                            &moved[0] );
+            }
+            else {
+                LOG(1) << "moving " << batch.size() << " chunks concurrently" << endl;
+
+                boost::thread_group migrations;
+                for ( size_t j = 0; j < batch.size(); j++ ) {
+                    migrations.create_thread( boost::bind( &Balancer::_moveChunk,
+                                                           this,
+                                                           (*candidateChunks)[batch[j]].get(),
+                                                           secondaryThrottle,
+                                                           waitForDelete,
+                                                           &moved[j] ) );
+                }
+                migrations.join_all();
             }
+
+            for ( size_t j = 0; j < moved.size(); j++ )
+                movedCount += moved[j];
         }
 
         return movedCount;
@@ -499,8 +549,16 @@ namespace mongo {
                         secondaryThrottle = balancerConfig[SettingsType::secondaryThrottle()].trueValue();
                     }
 
+                    // 0 lets every migration between distinct shards run at the same time
+                    int maxConcurrentMigrations = 0;
+                    if ( balancerConfig["maxConcurrentMigrations"].isNumber() ) {
+                        maxConcurrentMigrations =
+                            balancerConfig["maxConcurrentMigrations"].numberInt();
+                    }
+
                     LOG(1) << "waitForDelete: " << waitForDelete << endl;
                     LOG(1) << "secondaryThrottle: " << secondaryThrottle << endl;
+                    LOG(1) << "maxConcurrentMigrations: " << maxConcurrentMigrations << endl;
 
                     vector<CandidateChunkPtr> candidateChunks;
                     _doBalanceRound( conn.conn() , &candidateChunks );
@@ -509,9 +567,14 @@ namespace mongo {
                         _balancedLastTime = 0;
                     }
                     else {
+                        Timer t;
                         _balancedLastTime = _moveChunks(&candidateChunks,
                                                         secondaryThrottle,
-                                                        waitForDelete );
+                                                        waitForDelete,
+                                                        maxConcurrentMigrations);
+                        log() << "balancing round moved " << _balancedLastTime << " of "
+                              << candidateChunks.size() << " candidate chunks in "
+                              << t.millis() << "ms" << endl;
                     }
 
                     LOG(1) << "*** end of balancing round" << endl;
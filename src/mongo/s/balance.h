@@ -45,7 +45,7 @@ namespace mongo {
      *
      * The balancer does act continuously but in "rounds". At a given round, it would decide if there is an imbalance by
      * checking the difference in chunks between the most and least loaded shards. It would issue a request for a chunk
-     * migration per round, if it found so.
+     * migration per collection per round, if it found so. Migrations between distinct shards run concurrently.
      */
     class Balancer : public BackgroundJob {
     public:
@@ -93,16 +93,28 @@ namespace mongo {
         void _doBalanceRound( DBClientBase& conn, vector<CandidateChunkPtr>* candidateChunks );
 
         /**
-         * Issues chunk migration request, one at a time.
+         * Issues chunk migration requests, running those between disjoint pairs of shards
+         * concurrently.
          *
          * @param candidateChunks possible chunks to move
          * @param secondaryThrottle wait for secondaries to catch up before pushing more deletes
          * @param waitForDelete wait for deletes to complete after each chunk move
+         * @param maxConcurrentMigrations most migrations to run at once, 0 for no limit
          * @return number of chunks effectively moved
          */
         int _moveChunks(const vector<CandidateChunkPtr>* candidateChunks,
                         bool secondaryThrottle,
-                        bool waitForDelete);
+                        bool waitForDelete,
+                        int maxConcurrentMigrations);
+
+        /**
+         * Issues a single chunk migration request, incrementing 'movedCount' if the chunk moved
+         * or had to be split or marked jumbo instead.  Doesn't throw.
+         */
+        void _moveChunk(const CandidateChunk* candidate,
+                        bool secondaryThrottle,
+                        bool waitForDelete,
+                        int* movedCount);
 
         /**
          * Marks this balancer as being live on the config server(s).
@@ -414,6 +414,41 @@ namespace mongo {
         return NULL;
     }
 
+    void BalancerPolicy::scheduleConcurrentMigrations(
+            const vector<shared_ptr<MigrateInfo> >& migrations,
+            size_t maxPerBatch,
+            vector< vector<size_t> >* batches ) {
+
+        batches->clear();
+
+        vector<size_t> pending;
+        for ( size_t i = 0; i < migrations.size(); i++ )
+            pending.push_back( i );
+
+        while ( ! pending.empty() ) {
+            set<string> busyShards;
+            vector<size_t> batch;
+            vector<size_t> deferred;
+
+            for ( size_t i = 0; i < pending.size(); i++ ) {
+                const MigrateInfo& migration = *migrations[ pending[i] ];
+                if ( ( maxPerBatch && batch.size() == maxPerBatch ) ||
+                     busyShards.count( migration.from ) ||
+                     busyShards.count( migration.to ) ) {
+                    deferred.push_back( pending[i] );
+                    continue;
+                }
+
+                busyShards.insert( migration.from );
+                busyShards.insert( migration.to );
+                batch.push_back( pending[i] );
+            }
+
+            batches->push_back( batch );
+            pending.swap( deferred );
+        }
+    }
+
 
     ShardInfo::ShardInfo( long long maxSize, long long currSize,
                           bool draining, bool opsQueued,
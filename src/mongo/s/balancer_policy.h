@@ -209,6 +209,20 @@ namespace mongo {
                                      const DistributionStatus& distribution,
                                      int balancedLastTime );
 
+        /**
+         * Groups migrations into batches whose migrations can run at the same time: a shard
+         * takes part in a single migration at a time, so within a batch no shard is the donor or
+         * the recipient of more than one chunk.  Migrations which conflict with an earlier one are
+         * deferred to a later batch, keeping their relative order.
+         *
+         * @param maxPerBatch caps the number of migrations in a batch, 0 for no limit
+         * @param batches (OUT) filled with the indexes into 'migrations' of each batch, in order
+         */
+        static void scheduleConcurrentMigrations(
+                const vector<shared_ptr<MigrateInfo> >& migrations,
+                size_t maxPerBatch,
+                vector< vector<size_t> >* batches );
+
     private:
         static bool _isJumbo( const BSONObj& chunk );
     };
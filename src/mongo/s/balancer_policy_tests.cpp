@@ -368,6 +368,70 @@ namespace mongo {
             ASSERT( !m );
         }
 
+        void addMigration( vector<shared_ptr<MigrateInfo> >* migrations,
+                           const string& from,
+                           const string& to ) {
+            int x = static_cast<int>( migrations->size() );
+            BSONObj chunk = BSON(ChunkType::min(BSON("x" << x)) <<
+                                 ChunkType::max(BSON("x" << BSON("$maxKey" << 1))));
+            migrations->push_back( shared_ptr<MigrateInfo>( new MigrateInfo( "ns", to, from,
+                                                                             chunk ) ) );
+        }
+
+        TEST( BalancerPolicyTests, ScheduleDisjointMigrations ) {
+            vector<shared_ptr<MigrateInfo> > migrations;
+            addMigration( &migrations, "shard0", "shard1" );
+            addMigration( &migrations, "shard2", "shard3" );
+            addMigration( &migrations, "shard4", "shard5" );
+
+            vector< vector<size_t> > batches;
+            BalancerPolicy::scheduleConcurrentMigrations( migrations, 0, &batches );
+            ASSERT_EQUALS( 1U, batches.size() );
+            ASSERT_EQUALS( 3U, batches[0].size() );
+
+            // at most two at a time
+            BalancerPolicy::scheduleConcurrentMigrations( migrations, 2, &batches );
+            ASSERT_EQUALS( 2U, batches.size() );
+            ASSERT_EQUALS( 2U, batches[0].size() );
+            ASSERT_EQUALS( 1U, batches[1].size() );
+            ASSERT_EQUALS( 2U, batches[1][0] );
+        }
+
+        TEST( BalancerPolicyTests, ScheduleConflictingMigrations ) {
+            vector<shared_ptr<MigrateInfo> > migrations;
+            addMigration( &migrations, "shard0", "shard9" );    // everything drains to shard9
+            addMigration( &migrations, "shard1", "shard9" );
+            addMigration( &migrations, "shard2", "shard3" );
+            addMigration( &migrations, "shard3", "shard4" );    // shard3 receives above
+            addMigration( &migrations, "shard5", "shard6" );
+
+            vector< vector<size_t> > batches;
+            BalancerPolicy::scheduleConcurrentMigrations( migrations, 0, &batches );
+            ASSERT_EQUALS( 2U, batches.size() );
+
+            ASSERT_EQUALS( 3U, batches[0].size() );
+            ASSERT_EQUALS( 0U, batches[0][0] );
+            ASSERT_EQUALS( 2U, batches[0][1] );
+            ASSERT_EQUALS( 4U, batches[0][2] );
+
+            ASSERT_EQUALS( 2U, batches[1].size() );
+            ASSERT_EQUALS( 1U, batches[1][0] );
+            ASSERT_EQUALS( 3U, batches[1][1] );
+
+            // every migration is scheduled once and no shard is busy twice in a batch
+            set<size_t> scheduled;
+            for ( size_t i = 0; i < batches.size(); i++ ) {
+                set<string> busy;
+                for ( size_t j = 0; j < batches[i].size(); j++ ) {
+                    const MigrateInfo& m = *migrations[ batches[i][j] ];
+                    ASSERT( busy.insert( m.from ).second );
+                    ASSERT( busy.insert( m.to ).second );
+                    ASSERT( scheduled.insert( batches[i][j] ).second );
+                }
+            }
+            ASSERT_EQUALS( migrations.size(), scheduled.size() );
+        }
+
         /**
          * Idea behind this test is that we set up several shards, the first two of which are
          * draining and the second two of which have a data size limit.  We also simulate a random
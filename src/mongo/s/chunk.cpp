@@ -37,6 +37,7 @@
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/queryutil.h"
 #include "mongo/db/write_concern.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/platform/random.h"
 #include "mongo/s/chunk_diff.h"
 #include "mongo/s/chunk_version.h"
@@ -49,6 +50,7 @@
 #include "mongo/s/strategy.h"
 #include "mongo/s/type_collection.h"
 #include "mongo/s/type_settings.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/startup_test.h"
 #include "mongo/util/timer.h"
@@ -64,6 +66,29 @@ namespace mongo {
         return true;
     }
 
+    /** The size to split chunks at for a collection with 'nc' chunks */
+    static int desiredChunkSize( int nc ) {
+        // split faster in early chunks helps spread out an initial load better
+        const int minChunkSize = 1 << 20;  // 1 MBytes
+
+        int splitThreshold = Chunk::MaxChunkSize;
+
+        if ( nc <= 1 ) {
+            return 1024;
+        }
+        else if ( nc < 3 ) {
+            return minChunkSize / 2;
+        }
+        else if ( nc < 10 ) {
+            splitThreshold = max( splitThreshold / 4 , minChunkSize );
+        }
+        else if ( nc < 20 ) {
+            splitThreshold = max( splitThreshold / 2 , minChunkSize );
+        }
+
+        return splitThreshold;
+    }
+
     // -------  Shard --------
 
     int Chunk::MaxChunkSize = 1024 * 1024 * 64;
@@ -73,7 +98,7 @@ namespace mongo {
     bool Chunk::ShouldAutoSplit = true;
 
     Chunk::Chunk(const ChunkManager * manager, BSONObj from)
-        : _manager(manager), _lastmod(0, OID()), _dataWritten(mkDataWritten())
+        : _lineage(manager->_lineage), _lastmod(0, OID()), _dataWritten(mkDataWritten())
     {
         string ns = from.getStringField(ChunkType::ns().c_str());
         _shard.reset(from.getStringField(ChunkType::shard().c_str()));
@@ -87,7 +112,7 @@ namespace mongo {
         _jumbo = from[ChunkType::jumbo()].trueValue();
 
         uassert( 10170 ,  "Chunk needs a ns" , ! ns.empty() );
-        uassert( 13327 ,  "Chunk ns must match server ns" , ns == _manager->getns() );
+        uassert( 13327 ,  "Chunk ns must match server ns" , ns == _lineage->getns() );
 
         uassert( 10171 ,  "Chunk needs a server" , _shard.ok() );
 
@@ -96,17 +121,17 @@ namespace mongo {
     }
 
     Chunk::Chunk(const ChunkManager * info , const BSONObj& min, const BSONObj& max, const Shard& shard, ChunkVersion lastmod)
-        : _manager(info), _min(min), _max(max), _shard(shard), _lastmod(lastmod), _jumbo(false), _dataWritten(mkDataWritten())
+        : _lineage(info->_lineage), _min(min), _max(max), _shard(shard), _lastmod(lastmod), _jumbo(false), _dataWritten(mkDataWritten())
     {}
 
     int Chunk::mkDataWritten() {
         PseudoRandom r(static_cast<int64_t>(time(0)));
-        return r.nextInt32( MaxChunkSize / ChunkManager::SplitHeuristics::splitTestFactor );
+        return r.nextInt32( MaxChunkSize / ChunkManagerLineage::SplitHeuristics::splitTestFactor );
     }
 
     string Chunk::getns() const {
-        verify( _manager );
-        return _manager->getns();
+        verify( _lineage );
+        return _lineage->getns();
     }
 
     bool Chunk::containsPoint( const BSONObj& point ) const {
@@ -119,23 +144,23 @@ namespace mongo {
     }
 
     bool Chunk::minIsInf() const {
-        return _manager->getShardKey().globalMin().woCompare( getMin() ) == 0;
+        return _lineage->getShardKey().globalMin().woCompare( getMin() ) == 0;
     }
 
     bool Chunk::maxIsInf() const {
-        return _manager->getShardKey().globalMax().woCompare( getMax() ) == 0;
+        return _lineage->getShardKey().globalMax().woCompare( getMax() ) == 0;
     }
 
     BSONObj Chunk::_getExtremeKey( int sort ) const {
         Query q;
         if ( sort == 1 ) {
-            q.sort( _manager->getShardKey().key() );
+            q.sort( _lineage->getShardKey().key() );
         }
         else {
             // need to invert shard key pattern to sort backwards
             // TODO: make a helper in ShardKeyPattern?
 
-            BSONObj k = _manager->getShardKey().key();
+            BSONObj k = _lineage->getShardKey().key();
             BSONObjBuilder r;
 
             BSONObjIterator i(k);
@@ -149,11 +174,11 @@ namespace mongo {
         }
         // find the extreme key
         ScopedDbConnection conn(getShard().getConnString());
-        BSONObj end = conn->findOne(_manager->getns(), q);
+        BSONObj end = conn->findOne(_lineage->getns(), q);
         conn.done();
         if ( end.isEmpty() )
             return BSONObj();
-        return _manager->getShardKey().extractKey( end );
+        return _lineage->getShardKey().extractKey( end );
     }
 
     void Chunk::pickMedianKey( BSONObj& medianKey ) const {
@@ -161,8 +186,8 @@ namespace mongo {
         ScopedDbConnection conn(getShard().getConnString());
         BSONObj result;
         BSONObjBuilder cmd;
-        cmd.append( "splitVector" , _manager->getns() );
-        cmd.append( "keyPattern" , _manager->getShardKey().key() );
+        cmd.append( "splitVector" , _lineage->getns() );
+        cmd.append( "keyPattern" , _lineage->getShardKey().key() );
         cmd.append( "min" , getMin() );
         cmd.append( "max" , getMax() );
         cmd.appendBool( "force" , true );
@@ -188,8 +213,8 @@ namespace mongo {
         ScopedDbConnection conn(getShard().getConnString());
         BSONObj result;
         BSONObjBuilder cmd;
-        cmd.append( "splitVector" , _manager->getns() );
-        cmd.append( "keyPattern" , _manager->getShardKey().key() );
+        cmd.append( "splitVector" , _lineage->getns() );
+        cmd.append( "keyPattern" , _lineage->getShardKey().key() );
         cmd.append( "min" , getMin() );
         cmd.append( "max" , getMax() );
         cmd.append( "maxChunkSizeBytes" , chunkSize );
@@ -220,7 +245,7 @@ namespace mongo {
         if ( ! force ) {
             vector<BSONObj> candidates;
             const int maxPoints = 2;
-            pickSplitVector( candidates , getManager()->getCurrentDesiredChunkSize() , maxPoints , MaxObjectPerChunk );
+            pickSplitVector( candidates , _lineage->getCurrentDesiredChunkSize() , maxPoints , MaxObjectPerChunk );
             if ( candidates.size() <= 1 ) {
                 // no split points means there isn't enough data to split on
                 // 1 split point means we have between half the chunk size to full chunk size
@@ -281,7 +306,7 @@ namespace mongo {
     bool Chunk::multiSplit( const vector<BSONObj>& m , BSONObj& res ) const {
         const size_t maxSplitPoints = 8192;
 
-        uassert( 10165 , "can't split as shard doesn't have a manager" , _manager );
+        uassert( 10165 , "can't split as shard doesn't have a manager" , _lineage );
         uassert( 13332 , "need a split key to split chunk" , !m.empty() );
         uassert( 13333 , "can't split a chunk in that many parts", m.size() < maxSplitPoints );
         uassert( 13003 , "can't split a chunk with only one distinct value" , _min.woCompare(_max) );
@@ -289,8 +314,8 @@ namespace mongo {
         ScopedDbConnection conn(getShard().getConnString());
 
         BSONObjBuilder cmd;
-        cmd.append( "splitChunk" , _manager->getns() );
-        cmd.append( "keyPattern" , _manager->getShardKey().key() );
+        cmd.append( "splitChunk" , _lineage->getns() );
+        cmd.append( "keyPattern" , _lineage->getShardKey().key() );
         cmd.append( "min" , getMin() );
         cmd.append( "max" , getMax() );
         cmd.append( "from" , getShard().getName() );
@@ -304,7 +329,7 @@ namespace mongo {
             conn.done();
 
             // Mark the minor version for *eventual* reload
-            _manager->markMinorForReload( this->_lastmod );
+            _lineage->markMinorForReload( this->_lastmod );
 
             return false;
         }
@@ -312,7 +337,7 @@ namespace mongo {
         conn.done();
         
         // force reload of config
-        _manager->reload();
+        _lineage->reload();
 
         return true;
     }
@@ -326,14 +351,14 @@ namespace mongo {
     {
         uassert( 10167 ,  "can't move shard to its current location!" , getShard() != to );
 
-        log() << "moving chunk ns: " << _manager->getns() << " moving ( " << toString() << ") " << _shard.toString() << " -> " << to.toString() << endl;
+        log() << "moving chunk ns: " << _lineage->getns() << " moving ( " << toString() << ") " << _shard.toString() << " -> " << to.toString() << endl;
 
         Shard from = _shard;
 
         ScopedDbConnection fromconn(from.getConnString());
 
         bool worked = fromconn->runCommand( "admin" ,
-                                            BSON( "moveChunk" << _manager->getns() <<
+                                            BSON( "moveChunk" << _lineage->getns() <<
                                                   "from" << from.getAddress().toString() <<
                                                   "to" << to.getAddress().toString() <<
                                                   // NEEDED FOR 2.0 COMPATIBILITY
@@ -357,7 +382,7 @@ namespace mongo {
         // if succeeded, needs to reload to pick up the new location
         // if failed, mongos may be stale
         // reload is excessive here as the failure could be simply because collection metadata is taken
-        _manager->reload();
+        _lineage->reload();
 
         return worked;
     }
@@ -368,19 +393,19 @@ namespace mongo {
 
         try {
             _dataWritten += dataWritten;
-            int splitThreshold = getManager()->getCurrentDesiredChunkSize();
+            int splitThreshold = _lineage->getCurrentDesiredChunkSize();
             if ( minIsInf() || maxIsInf() ) {
                 splitThreshold = (int) ((double)splitThreshold * .9);
             }
 
-            if ( _dataWritten < splitThreshold / ChunkManager::SplitHeuristics::splitTestFactor )
+            if ( _dataWritten < splitThreshold / ChunkManagerLineage::SplitHeuristics::splitTestFactor )
                 return false;
             
-            if ( ! getManager()->_splitHeuristics._splitTickets.tryAcquire() ) {
-                LOG(1) << "won't auto split because not enough tickets: " << getManager()->getns() << endl;
+            if ( ! _lineage->splitTickets().tryAcquire() ) {
+                LOG(1) << "won't auto split because not enough tickets: " << _lineage->getns() << endl;
                 return false;
             }
-            TicketHolderReleaser releaser( &(getManager()->_splitHeuristics._splitTickets) );
+            TicketHolderReleaser releaser( &(_lineage->splitTickets()) );
 
             // this is a bit ugly
             // we need it so that mongos blocks for the writes to actually be committed
@@ -412,9 +437,9 @@ namespace mongo {
                 _dataWritten = 0; // we're splitting, so should wait a bit
             }
 
-            bool shouldBalance = grid.shouldBalance( _manager->getns() );
+            bool shouldBalance = grid.shouldBalance( _lineage->getns() );
 
-            log() << "autosplitted " << _manager->getns() << " shard: " << toString()
+            log() << "autosplitted " << _lineage->getns() << " shard: " << toString()
                   << " on: " << splitPoint << " (splitThreshold " << splitThreshold << ")"
 #ifdef _DEBUG
                   << " size: " << getPhysicalSize() // slow - but can be useful when debugging
@@ -438,7 +463,7 @@ namespace mongo {
                     return true; // we did split even if we didn't migrate
                 }
 
-                ChunkManagerPtr cm = _manager->reload(false/*just reloaded in mulitsplit*/);
+                ChunkManagerPtr cm = _lineage->reload(false/*just reloaded in mulitsplit*/);
                 ChunkPtr toMove = cm->findIntersectingChunk(min);
 
                 if ( ! (toMove->getMin() == min && toMove->getMax() == max) ){
@@ -459,7 +484,7 @@ namespace mongo {
                                                 res ) );
                 
                 // update our config
-                _manager->reload();
+                _lineage->reload();
             }
 
             return true;
@@ -472,7 +497,7 @@ namespace mongo {
             _dataWritten = mkDataWritten();
 
             // if the collection lock is taken (e.g. we're migrating), it is fine for the split to fail.
-            warning() << "could not autosplit collection " << _manager->getns() << causedBy( e ) << endl;
+            warning() << "could not autosplit collection " << _lineage->getns() << causedBy( e ) << endl;
             return false;
         }
     }
@@ -482,8 +507,8 @@ namespace mongo {
 
         BSONObj result;
         uassert( 10169 ,  "datasize failed!" , conn->runCommand( "admin" ,
-                 BSON( "datasize" << _manager->getns()
-                       << "keyPattern" << _manager->getShardKey().key()
+                 BSON( "datasize" << _lineage->getns()
+                       << "keyPattern" << _lineage->getShardKey().key()
                        << "min" << getMin()
                        << "max" << getMax()
                        << "maxSize" << ( MaxChunkSize + 1 )
@@ -507,7 +532,7 @@ namespace mongo {
 
     void Chunk::serialize(BSONObjBuilder& to,ChunkVersion myLastMod) {
 
-        to.append( "_id" , genID( _manager->getns() , _min ) );
+        to.append( "_id" , genID( _lineage->getns() , _min ) );
 
         if ( myLastMod.isSet() ) {
             myLastMod.addToBSON(to, ChunkType::DEPRECATED_lastmod());
@@ -519,7 +544,7 @@ namespace mongo {
             verify(0);
         }
 
-        to << ChunkType::ns(_manager->getns());
+        to << ChunkType::ns(_lineage->getns());
         to << ChunkType::min(_min);
         to << ChunkType::max(_max);
         to << ChunkType::shard(_shard.getName());
@@ -540,7 +565,7 @@ namespace mongo {
 
     string Chunk::toString() const {
         stringstream ss;
-        ss << ChunkType::ns()                 << ": " << _manager->getns()   << ", "
+        ss << ChunkType::ns()                 << ": " << _lineage->getns()   << ", "
            << ChunkType::shard()              << ": " << _shard.toString()   << ", "
            << ChunkType::DEPRECATED_lastmod() << ": " << _lastmod.toString() << ", "
            << ChunkType::min()                << ": " << _min                << ", "
@@ -549,7 +574,7 @@ namespace mongo {
     }
 
     ShardKeyPattern Chunk::skey() const {
-        return _manager->getShardKey();
+        return _lineage->getShardKey();
     }
 
     void Chunk::markAsJumbo() const {
@@ -609,17 +634,63 @@ namespace mongo {
         return true;
     }
 
+    // -------  ChunkManagerLineage --------
+
+    ChunkManagerLineage::ChunkManagerLineage( const string& ns, const ShardKeyPattern& key ) :
+        _ns( ns ),
+        _key( key )
+    {}
+
+    int ChunkManagerLineage::getCurrentDesiredChunkSize() const {
+        return desiredChunkSize( _numChunks.get() );
+    }
+
+    ChunkManagerPtr ChunkManagerLineage::reload( bool force ) const {
+        return grid.getDBConfig( _ns )->getChunkManager( _ns, force );
+    }
+
     // -------  ChunkManager --------
 
     AtomicUInt ChunkManager::NextSequenceNumber = 1;
 
+    /**
+     * The flat routing table over a manager's chunk map, and its chunks in the same order.
+     * Only read once 'built' is set, and never changed after that.
+     */
+    struct ChunkManager::ChunkTable {
+        AtomicUInt32 built;
+        ChunkRoutingTable maxes;
+        vector<ChunkPtr> chunks;
+
+        /** the table of a namespace's newest manager waiting for the builder, and its chunks */
+        struct Queued {
+            boost::weak_ptr<ChunkTable> table;
+            ChunkMap chunks;
+        };
+        typedef map<string, Queued> QueuedMap;
+
+        // at most one per namespace, so a burst of reloads builds the last table only
+        static mongo::mutex queuedMutex;
+        static QueuedMap queued;
+    };
+
+    mongo::mutex ChunkManager::ChunkTable::queuedMutex( "ChunkTable::queued" );
+    ChunkManager::ChunkTable::QueuedMap ChunkManager::ChunkTable::queued;
+
+    /** builds the routing tables of reloaded managers, off the request threads */
+    static ThreadPool& chunkTableBuilder() {
+        static ThreadPool* pool = new ThreadPool(1);
+        return *pool;
+    }
+
     ChunkManager::ChunkManager( const string& ns, const ShardKeyPattern& pattern , bool unique ) :
         _ns( ns ),
         _key( pattern ),
         _unique( unique ),
         _chunkRanges(),
         _mutex("ChunkManager"),
-        _sequenceNumber(++NextSequenceNumber)
+        _sequenceNumber(++NextSequenceNumber),
+        _lineage(new ChunkManagerLineage(_ns, _key))
     {
         //
         // Sets up a chunk manager from new data
@@ -641,7 +712,8 @@ namespace mongo {
         // The shard versioning mechanism hinges on keeping track of the number of times we reloaded ChunkManager's.
         // Increasing this number here will prompt checkShardVersion() to refresh the connection-level versions to
         // the most up to date value.
-        _sequenceNumber(++NextSequenceNumber)
+        _sequenceNumber(++NextSequenceNumber),
+        _lineage(new ChunkManagerLineage(_ns, _key))
     {
 
         //
@@ -660,7 +732,8 @@ namespace mongo {
         _unique( oldManager->isUnique() ),
         _chunkRanges(),
         _mutex("ChunkManager"),
-        _sequenceNumber(++NextSequenceNumber)
+        _sequenceNumber(++NextSequenceNumber),
+        _lineage( oldManager->_lineage )
     {
         //
         // Sets up a chunk manager based on an older manager
@@ -676,9 +749,12 @@ namespace mongo {
             ChunkMap chunkMap;
             set<Shard> shards;
             ShardVersionMap shardVersions;
+            vector<ChunkPtr> newChunks;
+            bool fromOldManager = false;
             Timer t;
 
-            bool success = _load( config, chunkMap, shards, shardVersions, _oldManager );
+            bool success = _load( config, chunkMap, shards, shardVersions, _oldManager,
+                                  &newChunks, &fromOldManager );
 
             if( success ){
                 {
@@ -688,18 +764,35 @@ namespace mongo {
                           << " version: " << _version.toString()
                           << " based on: " <<
                            ( _oldManager.get() ? _oldManager->getVersion().toString() : "(empty)" )
+                          << " chunks loaded: " << newChunks.size() << " of " << chunkMap.size()
                           << endl;
                 }
 
                 // TODO: Merge into diff code above, so we validate in one place
-                if (_isValid(chunkMap)) {
+                bool valid = fromOldManager ? _isValidAround(chunkMap, newChunks)
+                                            : _isValid(chunkMap);
+                if (valid) {
                     // These variables are const for thread-safety. Since the
                     // constructor can only be called from one thread, we don't have
                     // to worry about that here.
                     const_cast<ChunkMap&>(_chunkMap).swap(chunkMap);
                     const_cast<set<Shard>&>(_shards).swap(shards);
                     const_cast<ShardVersionMap&>(_shardVersions).swap(shardVersions);
-                    const_cast<ChunkRangeManager&>(_chunkRanges).reloadAll(_chunkMap);
+
+                    ChunkRangeManager& chunkRanges = const_cast<ChunkRangeManager&>(_chunkRanges);
+                    if (fromOldManager) {
+                        // the old manager's marked minor versions were loaded with the diffs
+                        _lineage->clearMarkedMinorVersions();
+                        chunkRanges = _oldManager->_chunkRanges;
+                        chunkRanges.reloadChanged(_chunkMap, newChunks);
+                    }
+                    else {
+                        chunkRanges.reloadAll(_chunkMap);
+                    }
+
+                    _lineage->setNumChunks(numChunks());
+
+                    _scheduleChunkTableBuild();
 
                     // Once we load data, clear reference to old manager
                     _oldManager.reset();
@@ -729,9 +822,10 @@ namespace mongo {
      *
      * The mongos adapter here tracks all shards, and stores ranges by (max, Chunk) in the map.
      */
-    class CMConfigDiffTracker : public ConfigDiffTracker<ChunkPtr,Shard> {
+    class CMConfigDiffTracker : public ConfigDiffTracker<ChunkPtr,Shard,ChunkMap> {
     public:
-        CMConfigDiffTracker( ChunkManager* manager ) : _manager( manager ) {}
+        CMConfigDiffTracker( ChunkManager* manager, vector<ChunkPtr>* newChunks )
+            : _manager( manager ), _newChunks( newChunks ) {}
 
         virtual bool isTracked( const BSONObj& chunkDoc ) const {
             // Mongos tracks all shards
@@ -746,6 +840,8 @@ namespace mongo {
 
         virtual pair<BSONObj,ChunkPtr> rangeFor( const BSONObj& chunkDoc, const BSONObj& min, const BSONObj& max ) const {
             ChunkPtr c( new Chunk( _manager, chunkDoc ) );
+            // Only called for the chunks which are added to the map
+            _newChunks->push_back( c );
             return make_pair( max, c );
         }
 
@@ -758,6 +854,7 @@ namespace mongo {
         }
 
         ChunkManager* _manager;
+        vector<ChunkPtr>* _newChunks;
 
     };
 
@@ -765,7 +862,9 @@ namespace mongo {
                               ChunkMap& chunkMap,
                               set<Shard>& shards,
                               ShardVersionMap& shardVersions,
-                              ChunkManagerPtr oldManager)
+                              ChunkManagerPtr oldManager,
+                              vector<ChunkPtr>* newChunks,
+                              bool* fromOldManager )
     {
 
         // Reset the max version, but not the epoch, when we aren't loading from the oldManager
@@ -781,35 +880,22 @@ namespace mongo {
             // Load a copy of the old versions
             shardVersions = oldManager->_shardVersions;
 
-            // Load a copy of the chunk map, replacing the chunk manager with our own
-            const ChunkMap& oldChunkMap = oldManager->getChunkMap();
-
-            // Could be v.expensive
-            // TODO: If chunks were immutable and didn't reference the manager, we could do more
-            // interesting things here
-            for( ChunkMap::const_iterator it = oldChunkMap.begin(); it != oldChunkMap.end(); it++ ){
-
-                ChunkPtr oldC = it->second;
-                ChunkPtr c( new Chunk( this, oldC->getMin(),
-                                             oldC->getMax(),
-                                             oldC->getShard(),
-                                             oldC->getLastmod() ) );
-
-                c->setBytesWritten( oldC->getBytesWritten() );
-
-                chunkMap.insert( make_pair( oldC->getMax(), c ) );
-            }
+            // Start from the old chunk map.  The copy shares everything with the old map, and the
+            // diffs only copy the paths to the chunks they change, so old chunks (which belong
+            // to our lineage, not to the old manager) and their bytes written carry over as is.
+            chunkMap = oldManager->_chunkMap;
+            *fromOldManager = true;
 
             // Also get any minor versions stored for reload
             oldManager->getMarkedMinorVersions( minorVersions );
 
             LOG(2) << "loading chunk manager for collection " << _ns
                    << " using old chunk manager w/ version " << _version.toString()
-                   << " and " << oldChunkMap.size() << " chunks" << endl;
+                   << " and " << chunkMap.size() << " chunks" << endl;
         }
 
         // Attach a diff tracker for the versioned chunk data
-        CMConfigDiffTracker differ( this );
+        CMConfigDiffTracker differ( this, newChunks );
         differ.attach( _ns, chunkMap, _version, shardVersions );
 
         // Diff tracker should *always* find at least one chunk if collection exists
@@ -835,6 +921,8 @@ namespace mongo {
             // Set all our data to empty
             chunkMap.clear();
             shardVersions.clear();
+            newChunks->clear();
+            *fromOldManager = false;
             _version = ChunkVersion( 0, OID() );
 
             return true;
@@ -859,6 +947,8 @@ namespace mongo {
             // Set all our data to empty to be extra safe
             chunkMap.clear();
             shardVersions.clear();
+            newChunks->clear();
+            *fromOldManager = false;
             _version = ChunkVersion( 0, OID() );
 
             return allInconsistent;
@@ -867,18 +957,18 @@ namespace mongo {
     }
 
     ChunkManagerPtr ChunkManager::reload(bool force) const {
-        return grid.getDBConfig(getns())->getChunkManager(getns(), force);
+        return _lineage->reload(force);
     }
 
     void ChunkManager::markMinorForReload( ChunkVersion majorVersion ) const {
-        _splitHeuristics.markMinorForReload( getns(), majorVersion );
+        _lineage->markMinorForReload( majorVersion );
     }
 
     void ChunkManager::getMarkedMinorVersions( set<ChunkVersion>& minorVersions ) const {
-        _splitHeuristics.getMarkedMinorVersions( minorVersions );
+        _lineage->getMarkedMinorVersions( minorVersions );
     }
 
-    void ChunkManager::SplitHeuristics::markMinorForReload( const string& ns, ChunkVersion majorVersion ) {
+    void ChunkManagerLineage::SplitHeuristics::markMinorForReload( const string& ns, ChunkVersion majorVersion ) {
 
         // When we get a stale minor version, it means that some *other* mongos has just split a
         // chunk into a number of smaller parts, so we shouldn't need reload the data needed to
@@ -916,13 +1006,19 @@ namespace mongo {
             grid.getDBConfig( ns )->getChunkManagerIfExists( ns, true, true );
     }
 
-    void ChunkManager::SplitHeuristics::getMarkedMinorVersions( set<ChunkVersion>& minorVersions ) {
+    void ChunkManagerLineage::SplitHeuristics::getMarkedMinorVersions( set<ChunkVersion>& minorVersions ) {
         scoped_lock lk( _staleMinorSetMutex );
         for( set<ChunkVersion>::iterator it = _staleMinorSet.begin(); it != _staleMinorSet.end(); it++ ){
             minorVersions.insert( *it );
         }
     }
 
+    void ChunkManagerLineage::SplitHeuristics::clearMarkedMinorVersions() {
+        scoped_lock lk( _staleMinorSetMutex );
+        _staleMinorSet.clear();
+        _staleMinorCount = 0;
+    }
+
     bool ChunkManager::_isValid(const ChunkMap& chunkMap) {
 #define ENSURE(x) do { if(!(x)) { log() << "ChunkManager::_isValid failed: " #x << endl; return false; } } while(0)
 
@@ -947,6 +1043,39 @@ namespace mongo {
 
         return true;
 
+#undef ENSURE
+    }
+
+    bool ChunkManager::_isValidAround(const ChunkMap& chunkMap, const vector<ChunkPtr>& newChunks) {
+#define ENSURE(x) do { if(!(x)) { log() << "ChunkManager::_isValidAround failed: " #x << endl; return false; } } while(0)
+
+        if (chunkMap.empty())
+            return true;
+
+        ENSURE(allOfType(MinKey, chunkMap.begin()->second->getMin()));
+        ENSURE(allOfType(MaxKey, boost::prior(chunkMap.end())->second->getMax()));
+
+        // Every chunk the diffs removed overlapped a new chunk, which was added where the
+        // removed chunks were.  So two neighbors which are both old chunks were neighbors before,
+        // and checking the bounds of the new chunks against their neighbors finds all gaps and
+        // overlaps.
+        for (vector<ChunkPtr>::const_iterator i = newChunks.begin(); i != newChunks.end(); ++i) {
+            const ChunkPtr& chunk = *i;
+            ChunkMap::const_iterator it = chunkMap.find(chunk->getMax());
+            ENSURE(it != chunkMap.end() && it->second == chunk);
+
+            if (it != chunkMap.begin()) {
+                ENSURE(boost::prior(it)->second->getMax() == chunk->getMin());
+            }
+
+            ChunkMap::const_iterator next = boost::next(it);
+            if (next != chunkMap.end()) {
+                ENSURE(next->second->getMin() == chunk->getMax());
+            }
+        }
+
+        return true;
+
 #undef ENSURE
     }
 
@@ -1071,15 +1200,78 @@ namespace mongo {
         _version = ChunkVersion( 0, version.epoch() );
     }
 
+    void ChunkManager::_scheduleChunkTableBuild() {
+        _chunkTable.reset( new ChunkTable() );
+
+        scoped_lock lk( ChunkTable::queuedMutex );
+        bool scheduled = ChunkTable::queued.count( _ns ) > 0;
+        // an older manager's table is dropped from the queue, its lookups search its chunk map
+        ChunkTable::Queued& q = ChunkTable::queued[ _ns ];
+        q.table = _chunkTable;
+        // copying _chunkMap is O(1), it shares its structure
+        q.chunks = _chunkMap;
+        if ( !scheduled )
+            chunkTableBuilder().schedule( &ChunkManager::_buildQueuedChunkTable, _ns );
+    }
+
+    void ChunkManager::_buildChunkTableNow() {
+        shared_ptr<ChunkTable> table( new ChunkTable() );
+        _buildChunkTable( _chunkMap, table.get() );
+        _chunkTable = table;
+    }
+
+    void ChunkManager::_buildQueuedChunkTable( const string& ns ) {
+        shared_ptr<ChunkTable> table;
+        ChunkMap chunks;
+        {
+            scoped_lock lk( ChunkTable::queuedMutex );
+            ChunkTable::QueuedMap::iterator it = ChunkTable::queued.find( ns );
+            verify( it != ChunkTable::queued.end() );
+            table = it->second.table.lock();
+            chunks.swap( it->second.chunks );
+            ChunkTable::queued.erase( it );
+        }
+
+        if ( table )
+            _buildChunkTable( chunks, table.get() );
+    }
+
+    void ChunkManager::_buildChunkTable( const ChunkMap& chunkMap, ChunkTable* table ) {
+        vector<BSONObj> maxes;
+        vector<ChunkPtr> chunks;
+        maxes.reserve( chunkMap.size() );
+        chunks.reserve( chunkMap.size() );
+        for ( ChunkMap::const_iterator it = chunkMap.begin(); it != chunkMap.end(); ++it ) {
+            maxes.push_back( it->first );
+            chunks.push_back( it->second );
+        }
+
+        ChunkRoutingTable routingTable( maxes );
+        table->maxes.swap( routingTable );
+        table->chunks.swap( chunks );
+        table->built.store( 1 );
+    }
+
     ChunkPtr ChunkManager::findIntersectingChunk( const BSONObj& point ) const {
         {
             BSONObj foo;
             ChunkPtr c;
             {
-                ChunkMap::const_iterator it = _chunkMap.upper_bound( point );
-                if (it != _chunkMap.end()) {
-                    foo = it->first;
-                    c = it->second;
+                const ChunkTable* table = _chunkTable.get();
+                if ( table && table->built.load() ) {
+                    size_t i = table->maxes.upperBound( point );
+                    if (i != table->chunks.size()) {
+                        foo = table->maxes.getMax( i );
+                        c = table->chunks[i];
+                    }
+                }
+                else {
+                    // O(log chunks) BSON comparisons until the table is built
+                    ChunkMap::const_iterator it = _chunkMap.upper_bound( point );
+                    if (it != _chunkMap.end()) {
+                        foo = it->first;
+                        c = it->second;
+                    }
                 }
             }
 
@@ -1352,7 +1544,7 @@ namespace mongo {
         return ss.str();
     }
 
-    void ChunkRangeManager::assertValid() const {
+    void ChunkRangeManager::assertValid(const ChunkMap& chunks) const {
         if (_ranges.empty())
             return;
 
@@ -1378,7 +1570,6 @@ namespace mongo {
             }
 
             // Make sure we match the original chunks
-            const ChunkMap chunks = _ranges.begin()->second->getManager()->_chunkMap;
             for ( ChunkMap::const_iterator i=chunks.begin(); i!=chunks.end(); ++i ) {
                 const ChunkPtr chunk = i->second;
 
@@ -1408,7 +1599,80 @@ namespace mongo {
         _ranges.clear();
         _insertRange(chunks.begin(), chunks.end());
 
-        DEV assertValid();
+        DEV assertValid(chunks);
+    }
+
+    void ChunkRangeManager::reloadChanged(const ChunkMap& chunks,
+                                          const vector<ChunkPtr>& newChunks) {
+        // The new chunks replace the parts of the old ranges they cover.  What is left of a
+        // range outside of a new chunk still consists of unchanged chunks on the range's shard.
+        for (vector<ChunkPtr>::const_iterator i = newChunks.begin(); i != newChunks.end(); ++i) {
+            const ChunkPtr& chunk = *i;
+
+            vector<shared_ptr<ChunkRange> > overlapping;
+            for (ChunkRangeMap::const_iterator it = _ranges.upper_bound(chunk->getMin());
+                 it != _ranges.end() && it->second->getMin().woCompare(chunk->getMax()) < 0;
+                 ++it) {
+                overlapping.push_back(it->second);
+            }
+
+            for (size_t j = 0; j < overlapping.size(); j++) {
+                const ChunkRange& range = *overlapping[j];
+                _ranges.erase(range.getMax());
+
+                if (range.getMin().woCompare(chunk->getMin()) < 0) {
+                    shared_ptr<ChunkRange> before(new ChunkRange(range.getShard(),
+                                                                 range.getMin(),
+                                                                 chunk->getMin()));
+                    _ranges.insert(make_pair(before->getMax(), before));
+                }
+                if (chunk->getMax().woCompare(range.getMax()) < 0) {
+                    shared_ptr<ChunkRange> after(new ChunkRange(range.getShard(),
+                                                                chunk->getMax(),
+                                                                range.getMax()));
+                    _ranges.insert(make_pair(after->getMax(), after));
+                }
+            }
+
+            shared_ptr<ChunkRange> cr(new ChunkRange(chunk->getShard(),
+                                                     chunk->getMin(),
+                                                     chunk->getMax()));
+            _ranges.insert(make_pair(cr->getMax(), cr));
+        }
+
+        // Ranges on the same shard can only meet where a range was cut above
+        for (vector<ChunkPtr>::const_iterator i = newChunks.begin(); i != newChunks.end(); ++i) {
+            _mergeAround((*i)->getMin());
+            _mergeAround((*i)->getMax());
+        }
+
+        DEV assertValid(chunks);
+    }
+
+    void ChunkRangeManager::_mergeAround(const BSONObj& point) {
+        ChunkRangeMap::const_iterator it = _ranges.upper_bound(point);
+        if (it == _ranges.end())
+            return;
+
+        const Shard shard = it->second->getShard();
+
+        ChunkRangeMap::const_iterator first = it;
+        while (first != _ranges.begin() && boost::prior(first)->second->getShard() == shard)
+            --first;
+
+        ChunkRangeMap::const_iterator last = it;
+        ++last;
+        while (last != _ranges.end() && last->second->getShard() == shard)
+            ++last;
+
+        if (first == it && last == boost::next(it))
+            return;
+
+        shared_ptr<ChunkRange> merged(new ChunkRange(shard,
+                                                     first->second->getMin(),
+                                                     boost::prior(last)->second->getMax()));
+        _ranges.erase(first, last);
+        _ranges.insert(make_pair(merged->getMax(), merged));
     }
 
     void ChunkRangeManager::_insertRange(ChunkMap::const_iterator begin, const ChunkMap::const_iterator end) {
@@ -1419,32 +1683,12 @@ namespace mongo {
                 ++begin;
 
             shared_ptr<ChunkRange> cr (new ChunkRange(first, begin));
-            _ranges[cr->getMax()] = cr;
+            _ranges.insert(make_pair(cr->getMax(), cr));
         }
     }
 
     int ChunkManager::getCurrentDesiredChunkSize() const {
-        // split faster in early chunks helps spread out an initial load better
-        const int minChunkSize = 1 << 20;  // 1 MBytes
-
-        int splitThreshold = Chunk::MaxChunkSize;
-
-        int nc = numChunks();
-
-        if ( nc <= 1 ) {
-            return 1024;
-        }
-        else if ( nc < 3 ) {
-            return minChunkSize / 2;
-        }
-        else if ( nc < 10 ) {
-            splitThreshold = max( splitThreshold / 4 , minChunkSize );
-        }
-        else if ( nc < 20 ) {
-            splitThreshold = max( splitThreshold / 2 , minChunkSize );
-        }
-
-        return splitThreshold;
+        return desiredChunkSize( numChunks() );
     }
     
     /** This is for testing only, just setting up minimal basic defaults. */
@@ -1452,7 +1696,8 @@ namespace mongo {
     _unique(),
     _chunkRanges(),
     _mutex( "ChunkManager" ),
-    _sequenceNumber()
+    _sequenceNumber(),
+    _lineage( new ChunkManagerLineage( _ns, _key ) )
     {}
 
     class ChunkObjUnitTest : public StartupTest {
@@ -32,11 +32,13 @@
 
 #include "mongo/base/string_data.h"
 #include "mongo/bson/util/atomic_int.h"
+#include "mongo/s/chunk_routing_table.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/distlock.h"
 #include "mongo/s/shard.h"
 #include "mongo/s/shardkey.h"
 #include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/persistent_map.h"
 
 namespace mongo {
 
@@ -49,11 +51,91 @@ namespace mongo {
     typedef shared_ptr<const Chunk> ChunkPtr;
 
     // key is max for each Chunk or ChunkRange
-    typedef map<BSONObj,ChunkPtr,BSONObjCmp> ChunkMap;
-    typedef map<BSONObj,shared_ptr<ChunkRange>,BSONObjCmp> ChunkRangeMap;
+    // A reloaded ChunkManager shares both maps with the manager it was reloaded from, except for
+    // the paths to the chunks which changed.
+    typedef PersistentMap<BSONObj,ChunkPtr,BSONObjCmp> ChunkMap;
+    typedef PersistentMap<BSONObj,shared_ptr<ChunkRange>,BSONObjCmp> ChunkRangeMap;
 
     typedef shared_ptr<const ChunkManager> ChunkManagerPtr;
 
+    /**
+     * The state of a sharded collection which its chunks use, shared by a ChunkManager and all
+     * the managers reloaded from it.  Chunks reference this rather than the manager which loaded
+     * them, so the chunks which didn't change can be passed on from one manager to the next
+     * instead of being copied on every reload.
+     */
+    class ChunkManagerLineage : boost::noncopyable {
+    public:
+        ChunkManagerLineage( const string& ns, const ShardKeyPattern& key );
+
+        const string& getns() const { return _ns; }
+        const ShardKeyPattern& getShardKey() const { return _key; }
+
+        /** The chunk size to split at, given the number of chunks of the latest manager */
+        int getCurrentDesiredChunkSize() const;
+        void setNumChunks( int numChunks ) { _numChunks.set( numChunks ); }
+
+        ChunkManagerPtr reload( bool force = true ) const;
+
+        //
+        // Split Heuristic info
+        //
+
+        TicketHolder& splitTickets() { return _splitHeuristics._splitTickets; }
+
+        void markMinorForReload( ChunkVersion majorVersion ) {
+            _splitHeuristics.markMinorForReload( _ns, majorVersion );
+        }
+        void getMarkedMinorVersions( set<ChunkVersion>& minorVersions ) {
+            _splitHeuristics.getMarkedMinorVersions( minorVersions );
+        }
+        /** Called once a reload has picked up the marked minor versions */
+        void clearMarkedMinorVersions() { _splitHeuristics.clearMarkedMinorVersions(); }
+
+        class SplitHeuristics {
+        public:
+
+            SplitHeuristics() :
+                _splitTickets( maxParallelSplits ),
+                _staleMinorSetMutex( "SplitHeuristics::staleMinorSet" ),
+                _staleMinorCount( 0 ) {}
+
+            void markMinorForReload( const string& ns, ChunkVersion majorVersion );
+            void getMarkedMinorVersions( set<ChunkVersion>& minorVersions );
+            void clearMarkedMinorVersions();
+
+            TicketHolder _splitTickets;
+
+            mutex _staleMinorSetMutex;
+
+            // mutex protects below
+            int _staleMinorCount;
+            set<ChunkVersion> _staleMinorSet;
+
+            // Test whether we should split once data * splitTestFactor > chunkSize (approximately)
+            static const int splitTestFactor = 5;
+            // Maximum number of parallel threads requesting a split
+            static const int maxParallelSplits = 5;
+
+            // The idea here is that we're over-aggressive on split testing by a factor of
+            // splitTestFactor, so we can safely wait until we get to splitTestFactor invalid splits
+            // before changing.  Unfortunately, we also potentially over-request the splits by a
+            // factor of maxParallelSplits, but since the factors are identical it works out
+            // (for now) for parallel or sequential oversplitting.
+            // TODO: Make splitting a separate thread with notifications?
+            static const int staleMinorReloadThreshold = maxParallelSplits;
+
+        };
+
+    private:
+        const string _ns;
+        const ShardKeyPattern _key;
+
+        AtomicUInt _numChunks;
+
+        SplitHeuristics _splitHeuristics;
+    };
+
     /**
        config.chunks
        { ns : "alleyinsider.fs.chunks" , min : {} , max : {} , server : "localhost:30001" }
@@ -226,14 +308,12 @@ namespace mongo {
 
         string getns() const;
         Shard getShard() const { return _shard; }
-        const ChunkManager* getManager() const { return _manager; }
-        
 
     private:
 
         // main shard info
         
-        const ChunkManager * _manager;
+        const shared_ptr<ChunkManagerLineage> _lineage;
 
         BSONObj _min;
         BSONObj _max;
@@ -266,7 +346,6 @@ namespace mongo {
 
     class ChunkRange {
     public:
-        const ChunkManager* getManager() const { return _manager; }
         Shard getShard() const { return _shard; }
 
         const BSONObj& getMin() const { return _min; }
@@ -281,27 +360,29 @@ namespace mongo {
         bool containsPoint( const BSONObj& point ) const;
 
         ChunkRange(ChunkMap::const_iterator begin, const ChunkMap::const_iterator end)
-            : _manager(begin->second->getManager())
-            , _shard(begin->second->getShard())
+            : _shard(begin->second->getShard())
             , _min(begin->second->getMin())
             , _max(boost::prior(end)->second->getMax()) {
             verify( begin != end );
 
             DEV while (begin != end) {
-                verify(begin->second->getManager() == _manager);
                 verify(begin->second->getShard() == _shard);
                 ++begin;
             }
         }
 
+        ChunkRange(const Shard& shard, const BSONObj& min, const BSONObj& max)
+            : _shard(shard)
+            , _min(min)
+            , _max(max) {
+        }
+
         // Merge min and max (must be adjacent ranges)
         ChunkRange(const ChunkRange& min, const ChunkRange& max)
-            : _manager(min.getManager())
-            , _shard(min.getShard())
+            : _shard(min.getShard())
             , _min(min.getMin())
             , _max(max.getMax()) {
             verify(min.getShard() == max.getShard());
-            verify(min.getManager() == max.getManager());
             verify(min.getMax() == max.getMin());
         }
 
@@ -310,7 +391,6 @@ namespace mongo {
         }
 
     private:
-        const ChunkManager* _manager;
         const Shard _shard;
         const BSONObj _min;
         const BSONObj _max;
@@ -325,8 +405,15 @@ namespace mongo {
 
         void reloadAll(const ChunkMap& chunks);
 
+        /**
+         * Updates the ranges of the chunks these ranges were loaded from to those of 'chunks',
+         * which differ from them only by 'newChunks' (and the chunks these replaced), in
+         * O(newChunks * log(ranges)).
+         */
+        void reloadChanged(const ChunkMap& chunks, const vector<ChunkPtr>& newChunks);
+
         // Slow operation -- wrap with DEV
-        void assertValid() const;
+        void assertValid(const ChunkMap& chunks) const;
 
         ChunkRangeMap::const_iterator upper_bound(const BSONObj& o) const { return _ranges.upper_bound(o); }
         ChunkRangeMap::const_iterator lower_bound(const BSONObj& o) const { return _ranges.lower_bound(o); }
@@ -335,6 +422,9 @@ namespace mongo {
         // assumes nothing in this range exists in _ranges
         void _insertRange(ChunkMap::const_iterator begin, const ChunkMap::const_iterator end);
 
+        // merges the range containing 'point' with its neighbors on the same shard
+        void _mergeAround(const BSONObj& point);
+
         ChunkRangeMap _ranges;
     };
 
@@ -462,9 +552,25 @@ namespace mongo {
         // helpers for loading
 
         // returns true if load was consistent
+        // if the chunks were loaded as diffs to those of oldManager, sets *fromOldManager and
+        // returns the chunks of the diffs in newChunks
         bool _load( const string& config, ChunkMap& chunks, set<Shard>& shards,
-                                    ShardVersionMap& shardVersions, ChunkManagerPtr oldManager);
+                                    ShardVersionMap& shardVersions, ChunkManagerPtr oldManager,
+                                    vector<ChunkPtr>* newChunks, bool* fromOldManager );
         static bool _isValid(const ChunkMap& chunks);
+        // like _isValid() for chunks which were valid before newChunks were added
+        static bool _isValidAround(const ChunkMap& chunks, const vector<ChunkPtr>& newChunks);
+
+        struct ChunkTable;
+
+        // queues building _chunkTable on the chunk table builder thread, in place of a build
+        // still queued for an older manager of the namespace
+        void _scheduleChunkTableBuild();
+        // builds _chunkTable on this thread
+        void _buildChunkTableNow();
+        // builds the table queued for 'ns', unless its manager is gone
+        static void _buildQueuedChunkTable( const string& ns );
+        static void _buildChunkTable( const ChunkMap& chunks, ChunkTable* table );
 
         // end helpers
 
@@ -476,6 +582,11 @@ namespace mongo {
         const ChunkMap _chunkMap;
         const ChunkRangeManager _chunkRanges;
 
+        // The flat routing table over _chunkMap for findIntersectingChunk().  Building it is
+        // O(chunks), so reloads leave it to a background thread and lookups search _chunkMap
+        // itself until it's built.  The builder only holds on to it weakly.
+        shared_ptr<ChunkTable> _chunkTable;
+
         const set<Shard> _shards;
 
         const ShardVersionMap _shardVersions; // max version per shard
@@ -491,53 +602,10 @@ namespace mongo {
 
         const unsigned long long _sequenceNumber;
 
-        //
-        // Split Heuristic info
-        //
-
-
-        class SplitHeuristics {
-        public:
-
-            SplitHeuristics() :
-                _splitTickets( maxParallelSplits ),
-                _staleMinorSetMutex( "SplitHeuristics::staleMinorSet" ),
-                _staleMinorCount( 0 ) {}
-
-            void markMinorForReload( const string& ns, ChunkVersion majorVersion );
-            void getMarkedMinorVersions( set<ChunkVersion>& minorVersions );
-
-            TicketHolder _splitTickets;
-
-            mutex _staleMinorSetMutex;
-
-            // mutex protects below
-            int _staleMinorCount;
-            set<ChunkVersion> _staleMinorSet;
-
-            // Test whether we should split once data * splitTestFactor > chunkSize (approximately)
-            static const int splitTestFactor = 5;
-            // Maximum number of parallel threads requesting a split
-            static const int maxParallelSplits = 5;
-
-            // The idea here is that we're over-aggressive on split testing by a factor of
-            // splitTestFactor, so we can safely wait until we get to splitTestFactor invalid splits
-            // before changing.  Unfortunately, we also potentially over-request the splits by a
-            // factor of maxParallelSplits, but since the factors are identical it works out
-            // (for now) for parallel or sequential oversplitting.
-            // TODO: Make splitting a separate thread with notifications?
-            static const int staleMinorReloadThreshold = maxParallelSplits;
-
-        };
-
-        mutable SplitHeuristics _splitHeuristics;
-
-        //
-        // End split heuristics
-        //
+        // shared with the managers reloaded from this one, and their chunks
+        const shared_ptr<ChunkManagerLineage> _lineage;
 
         friend class Chunk;
-        friend class ChunkRangeManager; // only needed for CRM::assertValid()
         static AtomicUInt NextSequenceNumber;
         
         /** Just for testing */
@@ -577,7 +645,7 @@ namespace mongo {
         Chunk _c;
     };
     */
-    inline string Chunk::genID() const { return genID(_manager->getns(), _min); }
+    inline string Chunk::genID() const { return genID(_lineage->getns(), _min); }
 
     bool setShardVersion( DBClientBase & conn,
                           const string& ns,
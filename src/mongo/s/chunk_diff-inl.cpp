@@ -36,8 +36,8 @@
 
 namespace mongo {
 
-    template < class ValType, class ShardType >
-    bool ConfigDiffTracker<ValType,ShardType>::
+    template < class ValType, class ShardType, class RangeMapType >
+    bool ConfigDiffTracker<ValType,ShardType,RangeMapType>::
         isOverlapping( const BSONObj& min, const BSONObj& max )
     {
         RangeOverlap overlap = overlappingRange( min, max );
@@ -45,8 +45,8 @@ namespace mongo {
         return overlap.first != overlap.second;
     }
 
-    template < class ValType, class ShardType >
-    void ConfigDiffTracker<ValType,ShardType>::
+    template < class ValType, class ShardType, class RangeMapType >
+    void ConfigDiffTracker<ValType,ShardType,RangeMapType>::
         removeOverlapping( const BSONObj& min, const BSONObj& max )
     {
         verifyAttached();
@@ -56,8 +56,9 @@ namespace mongo {
         _currMap->erase( overlap.first, overlap.second );
     }
 
-    template < class ValType, class ShardType >
-    typename ConfigDiffTracker<ValType,ShardType>::RangeOverlap ConfigDiffTracker<ValType,ShardType>::
+    template < class ValType, class ShardType, class RangeMapType >
+    typename ConfigDiffTracker<ValType,ShardType,RangeMapType>::RangeOverlap
+        ConfigDiffTracker<ValType,ShardType,RangeMapType>::
         overlappingRange( const BSONObj& min, const BSONObj& max )
     {
         verifyAttached();
@@ -85,8 +86,8 @@ namespace mongo {
         return RangeOverlap( low, high );
     }
 
-    template < class ValType, class ShardType >
-    int ConfigDiffTracker<ValType,ShardType>::
+    template < class ValType, class ShardType, class RangeMapType >
+    int ConfigDiffTracker<ValType,ShardType,RangeMapType>::
         calculateConfigDiff( string config,
                              const set<ChunkVersion>& extraMinorVersions )
     {
@@ -117,8 +118,8 @@ namespace mongo {
         }
     }
 
-    template < class ValType, class ShardType >
-    int ConfigDiffTracker<ValType,ShardType>::
+    template < class ValType, class ShardType, class RangeMapType >
+    int ConfigDiffTracker<ValType,ShardType,RangeMapType>::
         calculateConfigDiff( DBClientCursorInterface& diffCursor )
     {
         verifyAttached();
@@ -211,8 +212,8 @@ namespace mongo {
         return _validDiffs;
     }
 
-    template < class ValType, class ShardType >
-    Query ConfigDiffTracker<ValType,ShardType>::
+    template < class ValType, class ShardType, class RangeMapType >
+    Query ConfigDiffTracker<ValType,ShardType,RangeMapType>::
         configDiffQuery( const set<ChunkVersion>& extraMinorVersions ) const
     {
         verifyAttached();
@@ -0,0 +1,184 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/s/chunk_routing_table.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "mongo/platform/float_utils.h"
+
+namespace mongo {
+
+    namespace {
+
+        const unsigned long long SignBit = 1ULL << 63;
+
+        /** @return a value ordering doubles as compareElementValues() does, NaN first */
+        unsigned long long sortableDouble( double d ) {
+            if ( isNaN( d ) )
+                return 0;
+            if ( d == 0 )
+                d = 0; // -0 == 0
+            unsigned long long bits;
+            memcpy( &bits, &d, sizeof( bits ) );
+            return ( bits & SignBit ) ? ~bits : ( bits | SignBit );
+        }
+
+        /** @return the first 7 bytes at 'data', zero padded, as a big endian number */
+        unsigned long long leadingBytes( const char* data, size_t len ) {
+            unsigned long long code = 0;
+            for ( size_t i = 0; i < 7; i++ ) {
+                code <<= 8;
+                if ( i < len )
+                    code |= static_cast<unsigned char>( data[i] );
+            }
+            return code;
+        }
+    }
+
+    ChunkRoutingTable::ChunkRoutingTable( const vector<BSONObj>& maxes ) :
+        _codes( NoCodes ), _maxes( maxes ) {
+
+        if ( _maxes.empty() || _maxes[0].isEmpty() )
+            return;
+
+        _firstField = _maxes[0].firstElement().fieldName();
+        _maxCodes.resize( _maxes.size() );
+
+        // Prefer exact codes, then type and value codes
+        const CodeType candidates[] = { Hashed, TypeAndValue };
+        for ( size_t c = 0; c < sizeof( candidates ) / sizeof( candidates[0] ); c++ ) {
+            _codes = candidates[c];
+            size_t i = 0;
+            while ( i < _maxes.size() && keyCode( _maxes[i], &_maxCodes[i] ) )
+                i++;
+            if ( i == _maxes.size() )
+                return;
+        }
+
+        _codes = NoCodes;
+        _maxCodes.clear();
+    }
+
+    void ChunkRoutingTable::swap( ChunkRoutingTable& other ) {
+        std::swap( _codes, other._codes );
+        _firstField.swap( other._firstField );
+        _maxCodes.swap( other._maxCodes );
+        _maxes.swap( other._maxes );
+    }
+
+    size_t ChunkRoutingTable::upperBound( const BSONObj& point ) const {
+        unsigned long long pointCode;
+        if ( !keyCode( point, &pointCode ) ) {
+            return std::upper_bound( _maxes.begin(), _maxes.end(), point, BSONObjCmp() )
+                   - _maxes.begin();
+        }
+
+        size_t low = 0;
+        size_t high = _maxCodes.size();
+        while ( low < high ) {
+            size_t mid = low + ( high - low ) / 2;
+            bool below = pointCode == _maxCodes[mid] ? point.woCompare( _maxes[mid] ) < 0
+                                                     : pointCode < _maxCodes[mid];
+            if ( below )
+                high = mid;
+            else
+                low = mid + 1;
+        }
+        return low;
+    }
+
+    bool ChunkRoutingTable::keyCode( const BSONObj& key, unsigned long long* code ) const {
+        if ( _codes == NoCodes || key.isEmpty() )
+            return false;
+
+        // woCompare() orders by field name before value
+        BSONElement first = key.firstElement();
+        if ( _firstField != first.fieldName() )
+            return false;
+
+        if ( _codes == Hashed )
+            return hashedCode( first, code );
+        return typeAndValueCode( first, code );
+    }
+
+    bool ChunkRoutingTable::typeAndValueCode( const BSONElement& e, unsigned long long* code ) {
+        unsigned long long value = 0;
+        switch ( e.type() ) {
+        case NumberDouble:
+        case NumberInt:
+        case NumberLong:
+            // longs only order exactly against longs, so all numbers are coded as doubles
+            value = sortableDouble( e.number() ) >> 8;
+            break;
+        case String:
+        case Symbol:
+            value = leadingBytes( e.valuestr(), e.valuestrsize() - 1 );
+            break;
+        case jstOID:
+            value = leadingBytes( e.value(), OID::kOIDSize );
+            break;
+        case Date:
+            value = ( static_cast<unsigned long long>( e.date().millis ) ^ SignBit ) >> 8;
+            break;
+        case Bool:
+            if ( *e.value() != 0 && *e.value() != 1 )
+                return false;
+            value = *e.value();
+            break;
+        case Timestamp:
+            // compares with Dates in the same canonical type as unsigned
+            return false;
+        default:
+            // other types are only ordered by their canonical type
+            break;
+        }
+
+        *code = ( static_cast<unsigned long long>( e.canonicalType() + 1 ) << 56 ) | value;
+        return true;
+    }
+
+    bool ChunkRoutingTable::hashedCode( const BSONElement& e, unsigned long long* code ) {
+        switch ( e.type() ) {
+        case MinKey:
+            *code = 0;
+            return true;
+        case MaxKey:
+            *code = ~0ULL;
+            return true;
+        case NumberLong:
+            // the extremes share MinKey's and MaxKey's codes and are compared as BSON
+            *code = static_cast<unsigned long long>( e._numberLong() ) ^ SignBit;
+            return true;
+        default:
+            return false;
+        }
+    }
+
+}
@@ -0,0 +1,96 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * An immutable, flat index over the upper bounds of a collection's chunks, which locates the
+     * chunk containing a shard key without walking a tree of BSONObjs.
+     *
+     * Next to the bounds, in a contiguous array, each bound has a 64 bit code of its first field
+     * such that bounds with different codes order as their codes do.  Lookups binary search the
+     * codes and only compare BSON where a code is equal to the point's.  The codes are the
+     * canonical type of the field and the leading bits of an order preserving encoding of its
+     * value; when all bounds are NumberLongs and MinKey/MaxKey, as for hashed shard keys, the
+     * codes are the full 64 bit values instead.
+     *
+     * Bounds must be in increasing BSONObjCmp order, as the keys of a ChunkMap.
+     */
+    class ChunkRoutingTable {
+    public:
+
+        ChunkRoutingTable() : _codes( NoCodes ) {}
+
+        explicit ChunkRoutingTable( const std::vector<BSONObj>& maxes );
+
+        void swap( ChunkRoutingTable& other );
+
+        size_t size() const { return _maxes.size(); }
+
+        const BSONObj& getMax( size_t i ) const { return _maxes[i]; }
+
+        /**
+         * @return the index of the first bound greater than 'point', as
+         *         ChunkMap::upper_bound( point ), or size() if there is none
+         */
+        size_t upperBound( const BSONObj& point ) const;
+
+    private:
+
+        enum CodeType {
+            NoCodes,        // the bounds can't all be coded, lookups compare BSON
+            TypeAndValue,   // see typeAndValueCode()
+            Hashed          // see hashedCode()
+        };
+
+        /** @return false if 'key' has no code comparable with the codes of the bounds */
+        bool keyCode( const BSONObj& key, unsigned long long* code ) const;
+
+        /** the canonical type in the top byte and the top 56 bits of the value below it */
+        static bool typeAndValueCode( const BSONElement& e, unsigned long long* code );
+
+        /** exact codes for NumberLong, MinKey and MaxKey */
+        static bool hashedCode( const BSONElement& e, unsigned long long* code );
+
+        CodeType _codes;
+
+        // the field name all coded bounds start with
+        std::string _firstField;
+
+        std::vector<unsigned long long> _maxCodes;
+        std::vector<BSONObj> _maxes;
+    };
+
+}
@@ -0,0 +1,240 @@
+/**
+ *    Copyright (C) 2013 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/s/chunk_routing_table.h"
+
+#include <limits>
+#include <map>
+
+#include "mongo/platform/random.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/log.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
+
+namespace {
+
+    using namespace mongo;
+
+    typedef std::map<BSONObj, size_t, BSONObjCmp> BoundMap;
+
+    /** Builds a table and a map of the same bounds, which must be in increasing order. */
+    class Bounds {
+    public:
+        explicit Bounds( const std::vector<BSONObj>& maxes ) : _table( maxes ) {
+            for ( size_t i = 0; i < maxes.size(); i++ ) {
+                _map[maxes[i]] = i;
+            }
+            ASSERT_EQUALS( maxes.size(), _map.size() );
+        }
+
+        /** Checks that the table finds the same bound for 'point' as the map. */
+        void check( const BSONObj& point ) const {
+            BoundMap::const_iterator it = _map.upper_bound( point );
+            size_t expected = it == _map.end() ? _map.size() : it->second;
+            ASSERT_EQUALS( expected, _table.upperBound( point ) );
+        }
+
+        const ChunkRoutingTable& table() const { return _table; }
+        const BoundMap& map() const { return _map; }
+
+    private:
+        ChunkRoutingTable _table;
+        BoundMap _map;
+    };
+
+    /** @return sorted bounds for the keys, ending with MaxKey */
+    std::vector<BSONObj> boundsFor( const std::vector<BSONObj>& keys ) {
+        BoundMap sorted;
+        for ( size_t i = 0; i < keys.size(); i++ ) {
+            sorted[keys[i]] = 0;
+        }
+        std::vector<BSONObj> maxes;
+        for ( BoundMap::const_iterator it = sorted.begin(); it != sorted.end(); ++it ) {
+            maxes.push_back( it->first );
+        }
+        maxes.push_back( BSON( "a" << MAXKEY ) );
+        return maxes;
+    }
+
+    std::vector<BSONObj> mixedValues() {
+        std::vector<BSONObj> values;
+        values.push_back( BSON( "a" << MINKEY ) );
+        values.push_back( BSON( "a" << BSONNULL ) );
+        values.push_back( BSON( "a" << std::numeric_limits<double>::quiet_NaN() ) );
+        values.push_back( BSON( "a" << -std::numeric_limits<double>::infinity() ) );
+        values.push_back( BSON( "a" << -1e300 ) );
+        values.push_back( BSON( "a" << -2 ) );
+        values.push_back( BSON( "a" << -0.0 ) );
+        values.push_back( BSON( "a" << 0 ) );
+        values.push_back( BSON( "a" << 1e-300 ) );
+        values.push_back( BSON( "a" << 1 ) );
+        values.push_back( BSON( "a" << 1.5 ) );
+        values.push_back( BSON( "a" << 9007199254740993LL ) );
+        values.push_back( BSON( "a" << 9007199254740992.0 ) );
+        values.push_back( BSON( "a" << std::numeric_limits<long long>::max() ) );
+        values.push_back( BSON( "a" << std::numeric_limits<double>::infinity() ) );
+        values.push_back( BSON( "a" << "" ) );
+        values.push_back( BSON( "a" << "a" ) );
+        values.push_back( BSON( "a" << "abcdefg" ) );
+        values.push_back( BSON( "a" << "abcdefgh" ) );
+        values.push_back( BSON( "a" << "abcdefgi" ) );
+        values.push_back( BSON( "a" << "\xff\xff" ) );
+        values.push_back( BSON( "a" << BSON( "b" << 1 ) ) );
+        values.push_back( BSON( "a" << BSON_ARRAY( 1 << 2 ) ) );
+        values.push_back( BSON( "a" << OID( "000000000000000000000000" ) ) );
+        values.push_back( BSON( "a" << OID( "000000000000000000000001" ) ) );
+        values.push_back( BSON( "a" << OID( "ffffffffffffffffffffffff" ) ) );
+        values.push_back( BSON( "a" << false ) );
+        values.push_back( BSON( "a" << true ) );
+        values.push_back( BSON( "a" << Date_t( -1000 ) ) );
+        values.push_back( BSON( "a" << Date_t( 0 ) ) );
+        values.push_back( BSON( "a" << Date_t( 1000 ) ) );
+        return values;
+    }
+
+    TEST(ChunkRoutingTable, Empty) {
+        ChunkRoutingTable table;
+        ASSERT_EQUALS( 0U, table.size() );
+        ASSERT_EQUALS( 0U, table.upperBound( BSON( "a" << 1 ) ) );
+    }
+
+    TEST(ChunkRoutingTable, MixedTypes) {
+        std::vector<BSONObj> values = mixedValues();
+        Bounds bounds( boundsFor( values ) );
+        for ( size_t i = 0; i < values.size(); i++ ) {
+            bounds.check( values[i] );
+        }
+        bounds.check( BSON( "a" << MAXKEY ) );
+        bounds.check( BSON( "a" << "abcdefgh" << "b" << 1 ) );
+        bounds.check( BSON( "a" << 0.5 ) );
+        bounds.check( BSON( "a" << OpTime( 3, 0 ) ) );
+        bounds.check( BSON( "b" << 1 ) );
+        bounds.check( BSONObj() );
+    }
+
+    TEST(ChunkRoutingTable, CompoundKeys) {
+        std::vector<BSONObj> keys;
+        for ( int i = 0; i < 20; i++ ) {
+            keys.push_back( BSON( "a" << i / 5 << "b" << i ) );
+        }
+        Bounds bounds( boundsFor( keys ) );
+        for ( int i = -1; i < 21; i++ ) {
+            bounds.check( BSON( "a" << i / 5 << "b" << i ) );
+            bounds.check( BSON( "a" << i / 5 << "b" << i << "c" << 1 ) );
+            bounds.check( BSON( "a" << i / 5 << "b" << MINKEY ) );
+            bounds.check( BSON( "a" << i / 5 ) );
+        }
+    }
+
+    TEST(ChunkRoutingTable, HashedKeys) {
+        PseudoRandom random( 1234 );
+        std::vector<BSONObj> keys;
+        keys.push_back( BSON( "a" << MINKEY ) );
+        keys.push_back( BSON( "a" << std::numeric_limits<long long>::min() ) );
+        keys.push_back( BSON( "a" << std::numeric_limits<long long>::max() ) );
+        for ( int i = 0; i < 1000; i++ ) {
+            keys.push_back( BSON( "a" << static_cast<long long>( random.nextInt64() ) ) );
+        }
+        Bounds bounds( boundsFor( keys ) );
+        for ( size_t i = 0; i < keys.size(); i++ ) {
+            bounds.check( keys[i] );
+            long long value = keys[i].firstElement().numberLong();
+            if ( value < std::numeric_limits<long long>::max() )
+                bounds.check( BSON( "a" << value + 1 ) );
+        }
+        bounds.check( BSON( "a" << MAXKEY ) );
+        bounds.check( BSON( "a" << 1.5 ) );
+        bounds.check( BSON( "a" << 3 ) );
+    }
+
+    TEST(ChunkRoutingTable, TimestampsCompareBson) {
+        std::vector<BSONObj> keys;
+        keys.push_back( BSON( "a" << Date_t( 5 ) ) );
+        keys.push_back( BSON( "a" << OpTime( 1, 1 ) ) );
+        keys.push_back( BSON( "a" << OpTime( 2, 1 ) ) );
+        Bounds bounds( boundsFor( keys ) );
+        for ( size_t i = 0; i < keys.size(); i++ ) {
+            bounds.check( keys[i] );
+        }
+        bounds.check( BSON( "a" << Date_t( 0 ) ) );
+    }
+
+    /**
+     * Compares lookups of random shard keys in a table and in a map of the bounds of many chunks.
+     */
+    void benchmark( const std::string& name, const std::vector<BSONObj>& keys,
+                    const std::vector<BSONObj>& points ) {
+        Bounds bounds( boundsFor( keys ) );
+
+        size_t found = 0;
+        Timer mapTimer;
+        for ( size_t i = 0; i < points.size(); i++ ) {
+            found += bounds.map().upper_bound( points[i] )->second;
+        }
+        long long mapMicros = mapTimer.micros();
+
+        Timer tableTimer;
+        for ( size_t i = 0; i < points.size(); i++ ) {
+            found -= bounds.table().upperBound( points[i] );
+        }
+        long long tableMicros = tableTimer.micros();
+        ASSERT_EQUALS( 0U, found );
+
+        log() << name << ": " << keys.size() << " chunks, " << points.size() << " lookups,"
+              << " map " << mapMicros << "us, table " << tableMicros << "us" << std::endl;
+    }
+
+    BSONObj userKey( PseudoRandom& random ) {
+        return BSON( "a" << std::string( mongoutils::str::stream() << "user"
+                                                                 << random.nextInt32() ) );
+    }
+
+    TEST(ChunkRoutingTable, Benchmark) {
+        const int numChunks = 500 * 1000;
+        const int numLookups = 1000 * 1000;
+        PseudoRandom random( 4321 );
+
+        std::vector<BSONObj> hashed;
+        std::vector<BSONObj> hashedPoints;
+        std::vector<BSONObj> strings;
+        std::vector<BSONObj> stringPoints;
+        for ( int i = 0; i < numChunks; i++ ) {
+            hashed.push_back( BSON( "a" << static_cast<long long>( random.nextInt64() ) ) );
+            strings.push_back( userKey( random ) );
+        }
+        for ( int i = 0; i < numLookups; i++ ) {
+            hashedPoints.push_back( BSON( "a" << static_cast<long long>( random.nextInt64() ) ) );
+            stringPoints.push_back( userKey( random ) );
+        }
+
+        benchmark( "hashed shard key", hashed, hashedPoints );
+        benchmark( "string shard key", strings, stringPoints );
+    }
+
+} // namespace
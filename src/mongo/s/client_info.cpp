@@ -123,6 +123,15 @@ namespace mongo {
         return info;
     }
 
+    ClientInfo* ClientInfo::release() {
+        return _tlInfo.release();
+    }
+
+    void ClientInfo::attach(ClientInfo* info) {
+        massert(17395, "A ClientInfo already exists for this thread", !_tlInfo.get());
+        _tlInfo.reset(info);
+    }
+
     bool ClientInfo::exists() {
         return _tlInfo.get();
     }
@@ -141,6 +141,9 @@ namespace mongo {
         static ClientInfo * get(AbstractMessagingPort* messagingPort = NULL);
         // Creates a ClientInfo and stores it in _tlInfo
         static ClientInfo* create(AbstractMessagingPort* messagingPort);
+        // Move the ClientInfo of a connection processed on several threads between them
+        static ClientInfo* release();
+        static void attach(ClientInfo* info);
 
     private:
 
@@ -165,6 +165,12 @@ namespace mongo {
                 "Drops all cached queries in a collection.",
                 ActionType::planCacheWrite );
 
+            new ClusterPlanCacheCmd(
+                "planCacheStats",
+                "Displays the size and hit, miss, eviction and replan counts of a collection's "
+                "plan cache.",
+                ActionType::planCacheRead );
+
             new ClusterPlanCacheCmd(
                 "planCacheGenerateKey",
                 "Returns a key into the cache for a query. "
@@ -291,6 +291,10 @@ namespace mongo {
 
         static ShardedConnectionInfo* get( bool create );
         static void reset();
+
+        // move the info of a connection processed on several threads between them
+        static ShardedConnectionInfo* release();
+        static void attach( ShardedConnectionInfo* info );
         static void addHook();
 
         bool inForceVersionOkMode() const {
@@ -37,6 +37,7 @@
 #include "mongo/pch.h"
 
 #include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/thread/thread.hpp>
 #include <map>
 #include <string>
@@ -66,6 +67,7 @@
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rs_config.h"
 #include "mongo/db/repl/write_concern.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/logger/ramlog.h"
 #include "mongo/s/chunk.h"
 #include "mongo/s/chunk_version.h"
@@ -145,6 +147,11 @@ namespace mongo {
         }
 
 
+        /** Records a figure about the migration, such as its throughput, in the changelog. */
+        void append( const string& field , long long n ) {
+            _b.appendNumber( field , n );
+        }
+
         void note( const string& s ) {
             string field = "note";
             if ( _nextNote > 0 ) {
@@ -466,6 +473,9 @@ namespace mongo {
         }
 
         bool clone( string& errmsg , BSONObjBuilder& result ) {
+            // locs taken from _cloneLocs at a time
+            const size_t cloneSliceSize = 64;
+
             if ( ! _getActive() ) {
                 errmsg = "not active";
                 return false;
@@ -487,46 +497,73 @@ namespace mongo {
             
             while ( 1 ) {
                 bool filledBuffer = false;
-                
+                bool done = false;
+
                 auto_ptr<LockMongoFilesShared> fileLock;
                 Record* recordToTouch = 0;
 
                 {
                     Client::ReadContext ctx( _ns );
-                    scoped_spinlock lk( _trackerLocks );
-                    set<DiskLoc>::iterator i = _cloneLocs.begin();
-                    for ( ; i!=_cloneLocs.end(); ++i ) {
-                        if (tracker.intervalHasElapsed()) // should I yield?
-                            break;
-                        
-                        DiskLoc dl = *i;
-                        
-                        Record* r = dl.rec();
-                        if ( ! r->likelyInPhysicalMemory() ) {
-                            fileLock.reset( new LockMongoFilesShared() );
-                            recordToTouch = r;
+                    while ( 1 ) {
+                        // only take a slice of the locs under the spinlock, the batch is built
+                        // outside of it so concurrent _migrateClone's build theirs in parallel
+                        vector<DiskLoc> slice;
+                        {
+                            scoped_spinlock lk( _trackerLocks );
+                            set<DiskLoc>::iterator i = _cloneLocs.begin();
+                            for ( ; i != _cloneLocs.end() && slice.size() < cloneSliceSize; ++i )
+                                slice.push_back( *i );
+                            _cloneLocs.erase( _cloneLocs.begin() , i );
+                        }
+                        if ( slice.empty() ) {
+                            done = true;
                             break;
                         }
-                        
-                        BSONObj o = dl.obj();
 
-                        // use the builder size instead of accumulating 'o's size so that we take into consideration
-                        // the overhead of BSONArray indices, and *always* append one doc
-                        if ( a.arrSize() != 0 &&
-                             a.len() + o.objsize() + 1024 > BSONObjMaxUserSize ) {
-                            filledBuffer = true; // break out of outer while loop
-                            break;
+                        bool yield = false;
+                        size_t n = 0;
+                        for ( ; n < slice.size(); n++ ) {
+                            if (tracker.intervalHasElapsed()) { // should I yield?
+                                yield = true;
+                                break;
+                            }
+
+                            DiskLoc dl = slice[n];
+
+                            Record* r = dl.rec();
+                            if ( ! r->likelyInPhysicalMemory() ) {
+                                fileLock.reset( new LockMongoFilesShared() );
+                                recordToTouch = r;
+                                break;
+                            }
+
+                            BSONObj o = dl.obj();
+
+                            // use the builder size instead of accumulating 'o's size so that we take into consideration
+                            // the overhead of BSONArray indices, and *always* append one doc
+                            if ( a.arrSize() != 0 &&
+                                 a.len() + o.objsize() + 1024 > BSONObjMaxUserSize ) {
+                                filledBuffer = true; // break out of outer while loop
+                                break;
+                            }
+
+                            a.append( o );
                         }
-                        
-                        a.append( o );
+
+                        if ( n < slice.size() ) {
+                            // the read lock kept these from being deleted since they were taken
+                            scoped_spinlock lk( _trackerLocks );
+                            _cloneLocs.insert( slice.begin() + n , slice.end() );
+                        }
+
+                        if ( yield || recordToTouch || filledBuffer )
+                            break;
                     }
-                    
-                    _cloneLocs.erase( _cloneLocs.begin() , i );
-                    
-                    if ( _cloneLocs.empty() || filledBuffer )
-                        break;
                 }
-                
+
+                if ( done || filledBuffer )
+                    break;
+
                 if ( recordToTouch ) {
                     // its safe to touch here because we have a LockMongoFilesShared
                     // we can't do where we get the lock because we would have to unlock the main readlock and tne _trackerLocks
@@ -543,7 +580,8 @@ namespace mongo {
 
         void aboutToDelete( const Database* db , const DiskLoc& dl ) {
             verify(db);
-            Lock::assertWriteLocked(db->name());
+            // an update moving a document under a Lock::CollectionWrite only intent locks db
+            verify( Lock::isIntentWriteLocked( db->name() ) );
 
             if ( ! _getActive() )
                 return;
@@ -615,8 +653,9 @@ namespace mongo {
         SpinLock _trackerLocks;
 
         // disk locs yet to be transferred from here to the other side
-        // no locking needed because built initially by 1 thread in a read lock
-        // emptied by 1 thread in a read lock
+        // built initially by 1 thread in a read lock
+        // emptied in a read lock by the concurrent _migrateClone's of the recipient's fetchers,
+        // each taking slices of locs under _trackerLocks and reading their documents outside it
         // updates applied by 1 thread in a write lock
         set<DiskLoc> _cloneLocs;
 
@@ -1128,6 +1167,11 @@ namespace mongo {
 
                 killCurrentOp.checkForInterrupt();
             }
+            if ( res["counts"].isABSONObj() ) {
+                BSONObj counts = res["counts"].Obj();
+                timing.append( "clonedDocs" , counts["cloned"].numberLong() );
+                timing.append( "clonedBytes" , counts["clonedBytes"].numberLong() );
+            }
             timing.done(4);
             MONGO_FP_PAUSE_WHILE(moveChunkHangAtStep4);
 
@@ -1510,6 +1554,18 @@ namespace mongo {
     MONGO_FP_DECLARE(migrateThreadHangAtStep4);
     MONGO_FP_DECLARE(migrateThreadHangAtStep5);
 
+    // Connections the receiving end of a migration clones the chunk's documents over.
+    MONGO_EXPORT_SERVER_PARAMETER(migrateCloneThreads, int, 4);
+
+    /** Sets up a thread of the receiving end of a migration, which talks to the donor. */
+    static void initMigrateThread( const char* name ) {
+        Client::initThread( name );
+        if (getGlobalAuthorizationManager()->isAuthEnabled()) {
+            ShardedConnectionInfo::addHook();
+            cc().getAuthorizationSession()->grantInternalAuthorization();
+        }
+    }
+
     class MigrateStatus {
     public:
         
@@ -1687,77 +1743,84 @@ namespace mongo {
                 }
             }
 
+            // if running on a replicated system, we'll need to flush the docs we cloned to the secondaries
+            ReplTime lastOpApplied = 0;
+
             {
                 // 3. initial bulk clone
                 state = CLONE;
 
+                // Several fetchers each pull a batch from the donor, which hands every fetcher
+                // different documents, and insert it.  In between rounds of batches the mods made
+                // on the donor meanwhile are applied, so they don't pile up there until the clone
+                // is over.  Every batch fetched before a _transferMods is inserted by the time
+                // its mods are applied, so an older cloned copy never overwrites a newer one.
+                const int numFetchers = std::max( 1, migrateCloneThreads );
+                Timer cloneTimer;
+                OpTime lastClonedOp;
+
                 while ( true ) {
-                    BSONObj res;
-                    if ( ! conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , res ) ) {  // gets array of objects to copy, in disk order
-                        state = FAIL;
-                        errmsg = "_migrateClone failed: ";
-                        errmsg += res.toString();
-                        error() << errmsg << migrateLog;
-                        conn.done();
-                        return;
+                    vector<CloneBatchResult> batches( numFetchers );
+                    {
+                        boost::thread_group fetchers;
+                        for ( int i = 0; i < numFetchers; i++ ) {
+                            fetchers.create_thread( boost::bind( &MigrateStatus::_cloneBatch,
+                                                                 this, i, &batches[i] ) );
+                        }
+                        fetchers.join_all();
                     }
 
-                    BSONObj arr = res["objects"].Obj();
-                    int thisTime = 0;
-
-                    BSONObjIterator i( arr );
-                    while( i.more() ) {
-                        BSONObj o = i.next().Obj();
-                        {
-                            PageFaultRetryableSection pgrs;
-                            while ( 1 ) {
-                                try {
-                                    Client::WriteContext cx( ns );
-
-                                    BSONObj localDoc;
-                                    if ( willOverrideLocalId( o, &localDoc ) ) {
-                                        string errMsg =
-                                            str::stream() << "cannot migrate chunk, local document "
-                                                          << localDoc
-                                                          << " has same _id as cloned "
-                                                          << "remote document " << o;
-
-                                        warning() << errMsg << endl;
-
-                                        // Exception will abort migration cleanly
-                                        uasserted( 16976, errMsg );
-                                    }
-
-                                    Helpers::upsert( ns, o, true );
-                                    break;
-                                }
-                                catch ( PageFaultException& e ) {
-                                    e.touch();
-                                }
-                            }
+                    long long thisTime = 0;
+                    for ( int i = 0; i < numFetchers; i++ ) {
+                        const CloneBatchResult& batch = batches[i];
+                        if ( ! batch.errmsg.empty() ) {
+                            state = FAIL;
+                            errmsg = batch.errmsg;
+                            error() << errmsg << migrateLog;
+                            conn.done();
+                            return;
                         }
-                        thisTime++;
-                        numCloned++;
-                        clonedBytes += o.objsize();
 
-                        if ( secondaryThrottle && thisTime > 0 ) {
-                            if ( ! waitForReplication( cc().getLastOp(), 2, 60 /* seconds to wait */ ) ) {
-                                warning() << "secondaryThrottle on, but doc insert timed out after 60 seconds, continuing" << endl;
-                            }
-                        }
+                        thisTime += batch.docs;
+                        numCloned += batch.docs;
+                        clonedBytes += batch.bytes;
+                        if ( lastClonedOp < batch.lastOp )
+                            lastClonedOp = batch.lastOp;
                     }
 
                     if ( thisTime == 0 )
                         break;
+
+                    BSONObj res;
+                    if ( ! conn->runCommand( "admin" , BSON( "_transferMods" << 1 ) , res ) ) {
+                        state = FAIL;
+                        errmsg = "_transferMods failed: ";
+                        errmsg += res.toString();
+                        error() << "_transferMods failed: " << res << migrateLog;
+                        conn.done();
+                        return;
+                    }
+                    if ( res["size"].number() > 0 )
+                        apply( res , &lastOpApplied );
+
+                    if ( state == ABORT ) {
+                        timing.note( "aborted" );
+                        return;
+                    }
                 }
 
+                const long long cloneMillis = std::max( 1, cloneTimer.millis() );
+                timing.append( "cloneThreads" , numFetchers );
+                timing.append( "clonedDocs" , numCloned );
+                timing.append( "clonedBytes" , clonedBytes );
+                timing.append( "clonedBytesPerSec" , clonedBytes * 1000 / cloneMillis );
+
+                // the secondaries must catch up with the fetchers' writes as well as ours
+                lastOpApplied = std::max( cc().getLastOp(), lastClonedOp ).asDate();
                 timing.done(3);
                 MONGO_FP_PAUSE_WHILE(migrateThreadHangAtStep3);
             }
 
-            // if running on a replicated system, we'll need to flush the docs we cloned to the secondaries
-            ReplTime lastOpApplied = cc().getLastOp().asDate();
-
             {
                 // 4. do bulk of mods
                 state = CATCHUP;
@@ -1803,6 +1866,7 @@ namespace mongo {
                     } 
                 }
 
+                timing.append( "catchupMods" , numCatchup );
                 timing.done(4);
                 MONGO_FP_PAUSE_WHILE(migrateThreadHangAtStep4);
             }
@@ -1867,6 +1931,7 @@ namespace mongo {
                     return;
                 }
 
+                timing.append( "steadyMods" , numSteady );
                 timing.done(5);
                 MONGO_FP_PAUSE_WHILE(migrateThreadHangAtStep5);
             }
@@ -1899,6 +1964,109 @@ namespace mongo {
 
         }
 
+        /** What one clone fetcher copied in a round, or why it failed. */
+        struct CloneBatchResult {
+            CloneBatchResult() : docs( 0 ), bytes( 0 ) {}
+
+            string errmsg; // empty unless the fetcher failed
+            long long docs;
+            long long bytes;
+            OpTime lastOp;
+        };
+
+        /**
+         * Runs on a fetcher thread: pulls one batch of documents from the donor over a
+         * connection of its own and inserts it.  A batch with no documents means the donor has
+         * nothing left to clone.
+         */
+        void _cloneBatch( int id , CloneBatchResult* result ) {
+            string name = str::stream() << "migrateCloneWorker" << id;
+            initMigrateThread( name.c_str() );
+
+            try {
+                ScopedDbConnection conn( from );
+
+                BSONObj res;
+                // gets array of objects to copy, in disk order
+                if ( ! conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , res ) ) {
+                    result->errmsg = "_migrateClone failed: " + res.toString();
+                }
+                conn.done();
+
+                if ( result->errmsg.empty() ) {
+                    vector<BSONObj> docs;
+                    BSONObjIterator i( res["objects"].Obj() );
+                    while ( i.more() ) {
+                        docs.push_back( i.next().Obj() );
+                    }
+                    _insertCloned( docs , result );
+                }
+            }
+            catch ( const std::exception& e ) {
+                result->errmsg = str::stream() << "cloning from " << from << " failed: "
+                                               << e.what();
+            }
+
+            result->lastOp = cc().getLastOp();
+            cc().shutdown();
+        }
+
+        /**
+         * Upserts cloned documents, a group at a time under one write lock instead of locking
+         * for each of them.  With secondaryThrottle on, waits for the secondaries after each
+         * group.
+         */
+        void _insertCloned( const vector<BSONObj>& docs , CloneBatchResult* result ) {
+            const size_t maxGroupSize = 128;
+
+            size_t next = 0;
+            while ( next < docs.size() ) {
+                const size_t groupEnd = std::min( docs.size() , next + maxGroupSize );
+                {
+                    PageFaultRetryableSection pgrs;
+                    while ( 1 ) {
+                        try {
+                            Client::WriteContext cx( ns );
+
+                            // a fault retries the group from the first document not yet done
+                            for ( ; next < groupEnd; next++ ) {
+                                const BSONObj& o = docs[next];
+
+                                BSONObj localDoc;
+                                if ( willOverrideLocalId( o, &localDoc ) ) {
+                                    string errMsg =
+                                        str::stream() << "cannot migrate chunk, local document "
+                                                      << localDoc
+                                                      << " has same _id as cloned "
+                                                      << "remote document " << o;
+
+                                    warning() << errMsg << endl;
+
+                                    // Exception will abort migration cleanly
+                                    uasserted( 16976, errMsg );
+                                }
+
+                                Helpers::upsert( ns, o, true );
+                                result->docs++;
+                                result->bytes += o.objsize();
+                            }
+                            break;
+                        }
+                        catch ( PageFaultException& e ) {
+                            e.touch();
+                        }
+                    }
+                }
+
+                if ( secondaryThrottle ) {
+                    if ( ! waitForReplication( cc().getLastOp(), 2, 60 /* seconds to wait */ ) ) {
+                        warning() << "secondaryThrottle on, but doc insert timed out after 60 "
+                                  << "seconds, continuing" << endl;
+                    }
+                }
+            }
+        }
+
         bool apply( const BSONObj& xfer , ReplTime* lastOpApplied ) {
             ReplTime dummy;
             if ( lastOpApplied == NULL ) {
@@ -1939,6 +2107,7 @@ namespace mongo {
                                           true ); /*fromMigrate*/
 
                     *lastOpApplied = cx.ctx().getClient()->getLastOp().asDate();
+                    _countMod();
                     didAnything = true;
                 }
             }
@@ -1968,6 +2137,7 @@ namespace mongo {
                     Helpers::upsert( ns , it , true );
 
                     *lastOpApplied = cx.ctx().getClient()->getLastOp().asDate();
+                    _countMod();
                     didAnything = true;
                 }
             }
@@ -1975,6 +2145,13 @@ namespace mongo {
             return didAnything;
         }
 
+        void _countMod() {
+            if ( state == STEADY || state == COMMIT_START )
+                numSteady++;
+            else
+                numCatchup++;
+        }
+
         /**
          * Checks if an upsert of a remote document will override a local document with the same _id
          * but in a different range on this shard.
@@ -2103,11 +2280,7 @@ namespace mongo {
     } migrateStatus;
 
     void migrateThread() {
-        Client::initThread( "migrateThread" );
-        if (getGlobalAuthorizationManager()->isAuthEnabled()) {
-            ShardedConnectionInfo::addHook();
-            cc().getAuthorizationSession()->grantInternalAuthorization();
-        }
+        initMigrateThread( "migrateThread" );
         migrateStatus.go();
         cc().shutdown();
     }
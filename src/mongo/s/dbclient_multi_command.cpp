@@ -55,6 +55,7 @@ namespace mongo {
                                            const BSONSerializable& request ) {
         PendingCommand* command = new PendingCommand( endpoint, dbName, request.toBSON() );
         _pendingCommands.push_back( command );
+        _numPending++;
     }
 
     namespace {
@@ -147,10 +148,10 @@ namespace mongo {
 
     void DBClientMultiCommand::sendAll() {
 
-        for ( deque<PendingCommand*>::iterator it = _pendingCommands.begin();
-            it != _pendingCommands.end(); ++it ) {
+        for ( size_t i = 0; i < _pendingCommands.size(); ++i ) {
 
-            PendingCommand* command = *it;
+            PendingCommand* command = _pendingCommands[i];
+            if ( NULL == command ) continue;
             dassert( NULL == command->conn );
 
             try {
@@ -165,6 +166,10 @@ namespace mongo {
                      || !isBatchWriteCommand( command->cmdObj ) ) {
                     // Do normal command dispatch
                     sayAsCmd( command->conn, command->dbName, command->cmdObj );
+
+                    // Wait for the response along with the others
+                    _poller.add( command->conn, i );
+                    continue;
                 }
                 else {
                     // Sending a batch as safe writes necessarily blocks, so we can't do anything
@@ -189,17 +194,26 @@ namespace mongo {
                     command->conn = NULL;
                 }
             }
+
+            // Errors and legacy writes are handed back by recvAny() without waiting
+            _poller.addFD( -1, i );
         }
     }
 
     int DBClientMultiCommand::numPending() const {
-        return static_cast<int>( _pendingCommands.size() );
+        return _numPending;
     }
 
     Status DBClientMultiCommand::recvAny( ConnectionString* endpoint, BSONSerializable* response ) {
 
-        scoped_ptr<PendingCommand> command( _pendingCommands.front() );
-        _pendingCommands.pop_front();
+        size_t next = _poller.waitForAny();
+        dassert( next < _pendingCommands.size() );
+        scoped_ptr<PendingCommand> command( _pendingCommands[next] );
+        _pendingCommands[next] = NULL;
+        if ( --_numPending == 0 ) {
+            // Batches may be dispatched again in later rounds
+            _pendingCommands.clear();
+        }
 
         *endpoint = command->endpoint;
         if ( !command->status.isOK() ) return command->status;
@@ -253,10 +267,11 @@ namespace mongo {
     DBClientMultiCommand::~DBClientMultiCommand() {
 
         // Cleanup anything outstanding, do *not* return stuff to the pool, that might error
-        for ( deque<PendingCommand*>::iterator it = _pendingCommands.begin();
+        for ( PendingQueue::iterator it = _pendingCommands.begin();
             it != _pendingCommands.end(); ++it ) {
 
             PendingCommand* command = *it;
+            if ( NULL == command ) continue;
 
             if ( NULL != command->conn ) delete command->conn;
             delete command;
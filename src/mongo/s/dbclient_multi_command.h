@@ -28,23 +28,25 @@
 
 #pragma once
 
-#include <deque>
+#include <vector>
 
 #include "mongo/bson/bsonobj.h"
+#include "mongo/client/response_poller.h"
 #include "mongo/s/multi_command_dispatch.h"
 
 namespace mongo {
 
     /**
      * A DBClientMultiCommand uses the client driver (DBClientConnections) to send and recv
-     * commands to different hosts in parallel.
+     * commands to different hosts in parallel.  recvAny() returns responses in the order they
+     * arrive, so one slow host doesn't hold up handling the others.
      *
      * See MultiCommandDispatch for more details.
      */
     class DBClientMultiCommand : public MultiCommandDispatch {
     public:
 
-        DBClientMultiCommand() : _timeoutMillis( 0 ) {}
+        DBClientMultiCommand() : _numPending( 0 ), _timeoutMillis( 0 ) {}
 
         ~DBClientMultiCommand();
 
@@ -81,8 +83,14 @@ namespace mongo {
             Status status;
         };
 
-        typedef std::deque<PendingCommand*> PendingQueue;
+        // Commands are NULLed out once their response has been received
+        typedef std::vector<PendingCommand*> PendingQueue;
         PendingQueue _pendingCommands;
+        int _numPending;
+
+        // Hands back the indexes of sent commands in _pendingCommands as responses arrive
+        ResponsePoller _poller;
+
         int _timeoutMillis;
     };
 
@@ -122,10 +122,44 @@ namespace mongo {
         return errB.obj();
     }
 
+    /**
+     * What a client connection keeps in thread local storage: its ClientInfo and its
+     * connections to the shards.  Moved between threads by a reactor message server.
+     */
+    class MongosConnectionState : public MessageHandler::ConnectionState {
+    public:
+        MongosConnectionState() : _info( NULL ), _connections( NULL ) {}
+
+        virtual ~MongosConnectionState() {
+            ShardConnection::deleteConnections( _connections );
+            delete _info;
+        }
+
+        virtual void attach() {
+            if ( _info )
+                ClientInfo::attach( _info );
+            if ( _connections )
+                ShardConnection::attachThreadConnections( _connections );
+        }
+
+        virtual void detach() {
+            _info = ClientInfo::release();
+            _connections = ShardConnection::releaseMyThreadConnections();
+        }
+
+    private:
+        ClientInfo* _info;
+        ClientConnections* _connections;
+    };
+
     class ShardedMessageHandler : public MessageHandler {
     public:
         virtual ~ShardedMessageHandler() {}
 
+        virtual bool isThreadAgnostic() const { return true; }
+
+        virtual ConnectionState* newConnectionState() { return new MongosConnectionState(); }
+
         virtual void connected( AbstractMessagingPort* p ) {
             ClientInfo::create(p);
         }
@@ -394,6 +428,8 @@ static bool runMongosServer( bool doUpgrade ) {
     MessageServer::Options opts;
     opts.port = serverGlobalParams.port;
     opts.ipList = serverGlobalParams.bind_ip;
+    opts.reactorThreads = netReactorThreads;
+    opts.workerThreads = netReactorWorkerThreads;
     start(opts);
 
     // listen() will return when exit code closes its socket.
@@ -36,6 +36,7 @@
 
 namespace mongo {
 
+    class ClientConnections;
     class ShardConnection;
     class ShardStatus;
 
@@ -326,6 +327,15 @@ namespace mongo {
          */
         static void forgetNS( const string& ns );
 
+        /**
+         * Move the thread local connections of an incoming connection processed on several
+         * threads between them.  Connections released from all threads are deleted with
+         * deleteConnections().
+         */
+        static ClientConnections* releaseMyThreadConnections();
+        static void attachThreadConnections( ClientConnections* connections );
+        static void deleteConnections( ClientConnections* connections );
+
     private:
         void _init();
         void _finishInit();
@@ -540,6 +540,19 @@ namespace mongo {
         ClientConnections::threadInstance()->releaseAll();
     }
 
+    ClientConnections* ShardConnection::releaseMyThreadConnections() {
+        return ClientConnections::_perThread.release();
+    }
+
+    void ShardConnection::attachThreadConnections( ClientConnections* connections ) {
+        verify( ! ClientConnections::_perThread.get() );
+        ClientConnections::_perThread.reset( connections );
+    }
+
+    void ShardConnection::deleteConnections( ClientConnections* connections ) {
+        delete connections;
+    }
+
     void ShardConnection::clearPool() {
         shardConnectionPool.clear();
         ClientConnections::threadInstance()->clearPool();
@@ -378,8 +378,14 @@ public:
 
         if (mongoRestoreGlobalParams.restoreIndexes && metadataObject.hasField("indexes")) {
             vector<BSONElement> indexes = metadataObject["indexes"].Array();
+            vector<BSONObj> specs;
             for (vector<BSONElement>::iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                createIndex((*it).Obj(), false);
+                specs.push_back(fixIndexSpec((*it).Obj(), false));
+            }
+            if (!createIndexes(specs)) {
+                for (vector<BSONObj>::iterator it = specs.begin(); it != specs.end(); ++it) {
+                    insertIndex(*it);
+                }
             }
         }
     }
@@ -412,7 +418,7 @@ public:
             }
         }
         else if (nsToCollectionSubstring(_curns) == "system.indexes") {
-            createIndex(obj, true);
+            insertIndex(fixIndexSpec(obj, true));
         }
         else if (mongoRestoreGlobalParams.drop &&
                  nsToCollectionSubstring(_curns) == ".system.users" &&
@@ -528,7 +534,7 @@ private:
     /* We must handle if the dbname or collection name is different at restore time than what was dumped.
        If keepCollName is true, however, we keep the same collection name that's in the index object.
      */
-    void createIndex(BSONObj indexObj, bool keepCollName) {
+    BSONObj fixIndexSpec(const BSONObj& indexObj, bool keepCollName) {
         BSONObjBuilder bo;
         BSONObjIterator i(indexObj);
         while ( i.more() ) {
@@ -543,12 +549,49 @@ private:
                 bo.append(e);
             }
         }
-        BSONObj o = bo.obj();
+        return bo.obj();
+    }
+
+    /* Builds several indexes of the current collection with a single scan of it.  Returns false
+       if the server doesn't have the createIndexes command, so the indexes have to be inserted
+       into system.indexes one at a time.
+     */
+    bool createIndexes(const vector<BSONObj>& specs) {
+        if (specs.size() < 2) {
+            return false;
+        }
+        if (logger::globalLogDomain()->shouldLog(logger::LogSeverity::Debug(0))) {
+            for (vector<BSONObj>::const_iterator it = specs.begin(); it != specs.end(); ++it) {
+                toolInfoLog() << "\tCreating index: " << *it << std::endl;
+            }
+        }
+
+        BSONObjBuilder cmd;
+        cmd.append("createIndexes", _curcoll);
+        cmd.append("indexes", specs);
+        BSONObj info;
+        if (!conn().runCommand(_curdb, cmd.obj(), info)) {
+            if (info["code"].numberInt() == ErrorCodes::CommandNotFound) {
+                return false;
+            }
+            toolError() << "Error creating indexes " << _curns << ": "
+                        << info["code"].numberInt() << " " << info["errmsg"] << std::endl;
+            ::abort();
+        }
+
+        checkIndexCreated(_curns);
+        return true;
+    }
+
+    void insertIndex(const BSONObj& o) {
         if (logger::globalLogDomain()->shouldLog(logger::LogSeverity::Debug(0))) {
             toolInfoLog() << "\tCreating index: " << o << std::endl;
         }
         conn().insert( _curdb + ".system.indexes" ,  o );
+        checkIndexCreated(o["ns"].String());
+    }
 
+    void checkIndexCreated(const string& ns) {
         // We're stricter about errors for indexes than for regular data
         BSONObj err = conn().getLastErrorDetailed(_curdb, false, false, mongoRestoreGlobalParams.w);
 
@@ -563,7 +606,7 @@ private:
                     errCode = str::stream() << err["code"].numberInt();
                 }
 
-                toolError() << "Error creating index " << o["ns"].String() << ": "
+                toolError() << "Error creating index " << ns << ": "
                           << errCode << " " << err["err"] << std::endl;
             }
 
@@ -38,7 +38,8 @@ namespace mongo {
             unsigned long long words[2];
         };
 
-        // if you change this you must bump dur::CurrentVersion
+        // if you change this you must bump the journal versions, dur::JHeader::UncompressedVersion
+        // and CompressedVersion in dur_journalformat.h
         void gen(const void *buf, unsigned len) {
             wassert( ((size_t)buf) % 8 == 0 ); // performance warning
             unsigned n = len / 8 / 2;
@@ -94,6 +94,8 @@ namespace mongo {
     public:
         T* get() const;
         void reset(T* v);
+        /** @return the thread's value, which is no longer deleted with the thread */
+        T* release();
         T* getMake() { 
             T *t = get();
             if( t == 0 )
@@ -112,7 +114,13 @@ namespace mongo {
     void TSP<T>::reset(T* v) { \
         tsp.reset(v); \
         _ ## p = v; \
-    } 
+    } \
+    template<> T* TSP<T>::release() { \
+        tsp.release(); \
+        T* v = _ ## p; \
+        _ ## p = 0; \
+        return v; \
+    }
 # else
 
 #  define TSP_DECLARE(T,p) \
@@ -126,6 +134,12 @@ namespace mongo {
         tsp.reset(v); \
         _ ## p = v; \
     } \
+    template<> T* TSP<T>::release() { \
+        tsp.release(); \
+        T* v = _ ## p; \
+        _ ## p = 0; \
+        return v; \
+    } \
     TSP<T> p;
 # endif
 
@@ -157,6 +171,12 @@ namespace mongo {
             verify( pthread_setspecific( _key, v ) == 0 ); 
         }
 
+        T* release() {
+            T* v = get();
+            verify( pthread_setspecific( _key, 0 ) == 0 );
+            return v;
+        }
+
         T* getMake() { 
             T *t = get();
             if( t == 0 ) {
@@ -179,6 +199,7 @@ namespace mongo {
     public:
         T* get() const { return tsp.get(); }
         void reset(T* v) { tsp.reset(v); }
+        T* release() { return tsp.release(); }
         T* getMake() { 
             T *t = get();
             if( t == 0 )
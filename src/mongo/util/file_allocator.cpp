@@ -37,6 +37,7 @@
 #   include <io.h>
 #endif
 
+#include "mongo/bson/bsonobjbuilder.h"
 #include "mongo/platform/posix_fadvise.h"
 #include "mongo/util/concurrency/thread_name.h"
 #include "mongo/util/mongoutils/str.h"
@@ -80,7 +81,10 @@ namespace mongo {
     }
 
     FileAllocator::FileAllocator()
-        : _pendingMutex("FileAllocator"), _failed() {
+        : _pendingMutex("FileAllocator"), _failed(), _maxZeroFillMBPerSec(0),
+          _filesAllocated(0), _bytesAllocated(0), _filesZeroFilled(0),
+          _totalAllocationMillis(0), _maxAllocationMillis(0), _lastAllocationMillis(0),
+          _waits(0), _totalWaitMillis(0), _maxWaitMillis(0) {
     }
 
 
@@ -121,11 +125,25 @@ namespace mongo {
             _pending.insert( i, name );
         }
         _pendingUpdated.notify_all();
-        while( inProgress( name ) ) {
-            checkFailure();
-            _pendingUpdated.wait( lk.boost() );
+
+        Timer t;
+        _waitingFor.insert( name );
+        try {
+            while( inProgress( name ) ) {
+                checkFailure();
+                _pendingUpdated.wait( lk.boost() );
+            }
         }
+        catch ( ... ) {
+            _waitingFor.erase( _waitingFor.find( name ) );
+            throw;
+        }
+        _waitingFor.erase( _waitingFor.find( name ) );
 
+        long long waited = t.millis();
+        _waits++;
+        _totalWaitMillis += waited;
+        _maxWaitMillis = std::max( _maxWaitMillis, waited );
     }
 
     void FileAllocator::waitUntilFinished() const {
@@ -166,22 +184,75 @@ namespace mongo {
 #endif
     }
 
-    void FileAllocator::ensureLength(int fd , long size) {
+    void FileAllocator::setMaxZeroFillMBPerSec( int mbPerSec ) {
+        scoped_lock lk( _pendingMutex );
+        _maxZeroFillMBPerSec = mbPerSec;
+    }
+
+    int FileAllocator::getMaxZeroFillMBPerSec() const {
+        scoped_lock lk( _pendingMutex );
+        return _maxZeroFillMBPerSec;
+    }
+
+    long long FileAllocator::lastAllocationMillis() const {
+        scoped_lock lk( _pendingMutex );
+        return _lastAllocationMillis;
+    }
+
+    void FileAllocator::appendStats( BSONObjBuilder* b ) const {
+        scoped_lock lk( _pendingMutex );
+        b->append( "pending", static_cast<int>( _pending.size() ) );
+        b->append( "failed", _failed );
+        b->append( "filesAllocated", _filesAllocated );
+        b->append( "filesZeroFilled", _filesZeroFilled );
+        b->append( "bytesAllocated", _bytesAllocated );
+        b->append( "maxZeroFillMBPerSec", _maxZeroFillMBPerSec );
+        {
+            BSONObjBuilder sub( b->subobjStart( "allocationMillis" ) );
+            sub.append( "total", _totalAllocationMillis );
+            sub.append( "max", _maxAllocationMillis );
+            sub.append( "last", _lastAllocationMillis );
+            sub.done();
+        }
+        {
+            BSONObjBuilder sub( b->subobjStart( "waits" ) );
+            sub.append( "count", _waits );
+            sub.append( "totalMillis", _totalWaitMillis );
+            sub.append( "maxMillis", _maxWaitMillis );
+            sub.done();
+        }
+    }
+
+    bool FileAllocator::shouldThrottle( const string& name ) const {
+        scoped_lock lk( _pendingMutex );
+        return _maxZeroFillMBPerSec > 0 && _waitingFor.count( name ) == 0;
+    }
+
+    bool FileAllocator::ensureLength( int fd, long size, const string& name ) const {
 #if !defined(_WIN32)
         if (useSparseFiles(fd)) {
             LOG(1) << "using ftruncate to create a sparse file" << endl;
             int ret = ftruncate(fd, size);
             uassert(16063, "ftruncate failed: " + errnoWithDescription(), ret == 0);
-            return;
+            return true;
         }
 #endif
 
 #if defined(__linux__)
-        int ret = posix_fallocate(fd,0,size);
-        if ( ret == 0 )
-            return;
-
-        log() << "FileAllocator: posix_fallocate failed: " << errnoWithDescription( ret ) << " falling back" << endl;
+        // unlike posix_fallocate, which glibc emulates by writing to every block when the
+        // filesystem can't allocate directly, fallocate fails quickly and we throttle the writes
+        if ( fallocate( fd, 0, 0, size ) == 0 )
+            return true;
+
+        int err = errno;
+        if ( err == EOPNOTSUPP || err == ENOSYS ) {
+            LOG(1) << "FileAllocator: filesystem doesn't support fallocate, filling with zeroes"
+                   << endl;
+        }
+        else {
+            log() << "FileAllocator: fallocate failed: " << errnoWithDescription( err )
+                  << " falling back" << endl;
+        }
 #endif
 
         off_t filelen = lseek( fd, 0, SEEK_END );
@@ -204,6 +275,7 @@ namespace mongo {
             char* buf = buf_holder.get();
             memset(buf, 0, z);
             long left = size;
+            Timer chunkTimer;
             while ( left > 0 ) {
                 long towrite = left;
                 if ( towrite > z )
@@ -212,8 +284,21 @@ namespace mongo {
                 int written = write( fd , buf , towrite );
                 uassert( 10443 , errnoWithPrefix("FileAllocator: file write failed" ), written > 0 );
                 left -= written;
+
+                // pace each chunk so the fill stays under the configured rate, rechecking the
+                // limit as we go since it may change or someone may start waiting on this file
+                if ( shouldThrottle( name ) ) {
+                    long long mbPerSec = getMaxZeroFillMBPerSec();
+                    long long minMicros = mbPerSec > 0 ?
+                        written * 1000000LL / ( mbPerSec * 1024 * 1024 ) : 0;
+                    long long spent = chunkTimer.micros();
+                    if ( spent < minMicros )
+                        sleepmicros( minMicros - spent );
+                }
+                chunkTimer.reset();
             }
         }
+        return false;
     }
 
     bool FileAllocator::hasFailed() const {
@@ -317,7 +402,7 @@ namespace mongo {
                     Timer t;
 
                     /* make sure the file is the full desired length */
-                    ensureLength( fd , size );
+                    bool fallocated = fa->ensureLength( fd , size , name );
 
                     close( fd );
                     fd = 0;
@@ -331,11 +416,22 @@ namespace mongo {
                     }
                     flushMyDirectory(name);
 
+                    // rounded up, so the stats never count an allocation as taking no time
+                    long long millis = ( t.micros() + 999 ) / 1000;
                     log() << "done allocating datafile " << name << ", "
                           << "size: " << size/1024/1024 << "MB, "
-                          << " took " << ((double)t.millis())/1000.0 << " secs"
+                          << " took " << ((double)millis)/1000.0 << " secs"
                           << endl;
 
+                    scoped_lock lk( fa->_pendingMutex );
+                    fa->_filesAllocated++;
+                    fa->_bytesAllocated += size;
+                    if ( !fallocated )
+                        fa->_filesZeroFilled++;
+                    fa->_totalAllocationMillis += millis;
+                    fa->_maxAllocationMillis = std::max( fa->_maxAllocationMillis, millis );
+                    fa->_lastAllocationMillis = millis;
+
                     // no longer in a failed state. allow new writers.
                     fa->_failed = false;
                 }
@@ -18,6 +18,7 @@
 #include "mongo/pch.h"
 
 #include <list>
+#include <set>
 #include <boost/filesystem/path.hpp>
 #include <boost/thread/condition.hpp>
 
@@ -56,7 +57,20 @@ namespace mongo {
         
         bool hasFailed() const;
 
-        static void ensureLength(int fd, long size);
+        /**
+         * Limits the rate at which new files are filled with zeroes when the filesystem can't
+         * allocate their space directly, so that preallocation doesn't starve foreground i/o.
+         * A file someone is waiting on in allocateAsap is never throttled.
+         * @param mbPerSec 0 for no limit
+         */
+        void setMaxZeroFillMBPerSec( int mbPerSec );
+        int getMaxZeroFillMBPerSec() const;
+
+        /** @return how long the most recent allocation took, 0 if there hasn't been one */
+        long long lastAllocationMillis() const;
+
+        /** appends allocation counts and latencies, and the time callers spent waiting */
+        void appendStats( BSONObjBuilder* b ) const;
 
         /** @return the singleton */
         static FileAllocator * get();
@@ -65,6 +79,15 @@ namespace mongo {
 
         FileAllocator();
 
+        /**
+         * makes sure the file is the full desired length
+         * @return true if the filesystem allocated the space, false if it was zero filled
+         */
+        bool ensureLength( int fd, long size, const string& name ) const;
+
+        // true if the file is being zero filled without anyone waiting on it
+        bool shouldThrottle( const string& name ) const;
+
         void checkFailure();
 
         // caller must hold pendingMutex_ lock.  Returns size if allocated or
@@ -91,6 +114,22 @@ namespace mongo {
 
         bool _failed;
 
+        int _maxZeroFillMBPerSec;
+
+        // files callers are blocked on in allocateAsap, guarded by _pendingMutex
+        std::multiset< string > _waitingFor;
+
+        // statistics, guarded by _pendingMutex
+        long long _filesAllocated;
+        long long _bytesAllocated;
+        long long _filesZeroFilled;
+        long long _totalAllocationMillis;
+        long long _maxAllocationMillis;
+        long long _lastAllocationMillis;
+        long long _waits;
+        long long _totalWaitMillis;
+        long long _maxWaitMillis;
+
         static FileAllocator* _instance;
 
     };
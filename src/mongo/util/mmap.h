@@ -42,6 +42,12 @@ namespace mongo {
         enum Advice { Sequential=1 , Random=2 };
         MAdvise(void *p, unsigned len, Advice a);
         ~MAdvise(); // destructor resets the range to MADV_NORMAL
+
+        /**
+         * Asks the OS to start reading [p, p+len) in without waiting for it (MADV_WILLNEED).
+         * @return false where there is no such advice, or it failed
+         */
+        static bool willNeed(const void *p, size_t len);
     };
 
     // lock order: lock dbMutex before this if you lock both
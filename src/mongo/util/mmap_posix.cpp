@@ -70,6 +70,7 @@ namespace mongo {
 #if defined(__sunos__)
     MAdvise::MAdvise(void *,unsigned, Advice) { }
     MAdvise::~MAdvise() { }
+    bool MAdvise::willNeed(const void *, size_t) { return false; }
 #else
     MAdvise::MAdvise(void *p, unsigned len, Advice a) {
         
@@ -92,6 +93,16 @@ namespace mongo {
     MAdvise::~MAdvise() { 
         madvise(_p,_len,MADV_NORMAL);
     }
+
+    bool MAdvise::willNeed(const void *p, size_t len) {
+        char *start = (char*)((unsigned long long)p & ~(g_minOSPageSizeBytes-1));
+        len += (const char*)p - start;
+        if ( madvise(start, len, MADV_WILLNEED) ) {
+            LOG(1) << "madvise(MADV_WILLNEED) failed: " << errnoWithDescription() << endl;
+            return false;
+        }
+        return true;
+    }
 #endif
 
     void* MemoryMappedFile::map(const char *filename, unsigned long long &length, int options) {
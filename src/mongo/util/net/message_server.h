@@ -30,6 +30,19 @@ namespace mongo {
 
     class MessageHandler {
     public:
+        /**
+         * What a thread agnostic handler keeps in thread local storage for one connection.
+         * A server which processes a connection's messages on different threads attaches it to
+         * the thread before each call of connected(), process() or disconnected() for the
+         * connection, and detaches it after.  Deleted detached, with what it holds.
+         */
+        class ConnectionState {
+        public:
+            virtual ~ConnectionState() {}
+            virtual void attach() = 0;
+            virtual void detach() = 0;
+        };
+
         virtual ~MessageHandler() {}
         
         /**
@@ -47,6 +60,21 @@ namespace mongo {
          * called once when a socket is disconnected
          */
         virtual void disconnected( AbstractMessagingPort* p ) = 0;
+
+        /**
+         * @return true if successive messages from one connection may be processed on
+         * different threads: the handler keeps no per connection state in thread local storage
+         * but what newConnectionState() moves between threads.  The LastError passed to
+         * process() is always the one belonging to the connection.  Handlers that return false
+         * are always given a dedicated thread per connection.
+         */
+        virtual bool isThreadAgnostic() const { return false; }
+
+        /**
+         * @return a new, detached state for a connection of a thread agnostic handler, or
+         * NULL if it keeps nothing in thread local storage
+         */
+        virtual ConnectionState* newConnectionState() { return NULL; }
     };
 
     class MessageServer {
@@ -55,7 +83,13 @@ namespace mongo {
             int port;                   // port to bind to
             string ipList;             // addresses to bind to
 
-            Options() : port(0), ipList("") {}
+            // If reactorThreads > 0 and the handler is thread agnostic, client sockets are
+            // multiplexed over that many epoll loops and ready connections are serviced by a
+            // pool of workerThreads threads (16 if 0), instead of a thread per connection.
+            int reactorThreads;
+            int workerThreads;
+
+            Options() : port(0), ipList(""), reactorThreads(0), workerThreads(0) {}
         };
 
         virtual ~MessageServer() {}
@@ -64,6 +98,10 @@ namespace mongo {
         virtual void setupSockets() = 0;
     };
 
+    // startup parameters for MessageServer::Options::reactorThreads and workerThreads
+    extern int netReactorThreads;
+    extern int netReactorWorkerThreads;
+
     // TODO use a factory here to decide between port and asio variations
     MessageServer * createServer( const MessageServer::Options& opts , MessageHandler * handler );
 }
@@ -23,6 +23,7 @@
 
 
 #include "mongo/db/lasterror.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/concurrency/thread_name.h"
@@ -30,6 +31,8 @@
 #include "mongo/util/net/message.h"
 #include "mongo/util/net/message_port.h"
 #include "mongo/util/net/message_server.h"
+#include "mongo/util/net/message_server_reactor.h"
+#include "mongo/util/net/ssl_options.h"
 #include "mongo/util/net/ssl_manager.h"
 
 #ifdef __linux__  // TODO: consider making this ifndef _WIN32
@@ -38,6 +41,15 @@
 
 namespace mongo {
 
+    // Number of epoll loops mongod and mongos multiplex client connections over.  0 keeps the
+    // classic thread per connection server.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(netReactorThreads, int, 0);
+
+    // Number of threads processing messages when netReactorThreads > 0.  A message which
+    // waits, such as a tailable cursor's awaitData getMore or a write behind fsyncLock, holds
+    // its worker meanwhile, so this bounds how many of them can wait at once.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(netReactorWorkerThreads, int, 16);
+
     class PortMessageServer : public MessageServer , public Listener {
     public:
         /**
@@ -245,7 +257,36 @@ namespace mongo {
 
 
     MessageServer * createServer( const MessageServer::Options& opts , MessageHandler * handler ) {
-        return new PortMessageServer( opts , handler );
+        int reactorThreads = opts.reactorThreads;
+        int workerThreads = opts.workerThreads ? opts.workerThreads : 16;
+
+        if ( reactorThreads <= 0 )
+            return new PortMessageServer( opts , handler );
+
+        if ( ! reactorMessageServerSupported() ) {
+            warning() << "a reactor message server is not supported on this platform, "
+                      << "using a thread per connection" << endl;
+            return new PortMessageServer( opts , handler );
+        }
+
+        if ( ! handler->isThreadAgnostic() ) {
+            warning() << "this server keeps per connection state in thread local storage, "
+                      << "ignoring netReactorThreads and using a thread per connection" << endl;
+            return new PortMessageServer( opts , handler );
+        }
+
+#ifdef MONGO_SSL
+        // SSL may buffer decrypted bytes the epoll loop cannot see
+        if ( sslGlobalParams.sslMode.load() != SSLGlobalParams::SSLMode_disabled ) {
+            warning() << "a reactor message server is not supported with SSL, "
+                      << "using a thread per connection" << endl;
+            return new PortMessageServer( opts , handler );
+        }
+#endif
+
+        log() << "multiplexing connections over " << reactorThreads << " reactor threads and "
+              << workerThreads << " worker threads" << endl;
+        return createReactorServer( opts , handler , reactorThreads , std::max( workerThreads , 1 ) );
     }
 
 }
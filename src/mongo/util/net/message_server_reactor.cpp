@@ -0,0 +1,464 @@
+// message_server_reactor.cpp
+
+/*    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/net/message_server_reactor.h"
+
+#ifdef __linux__
+
+#include <boost/thread/thread.hpp>
+#include <sys/epoll.h>
+
+#include "mongo/base/owned_pointer_vector.h"
+#include "mongo/db/lasterror.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/net/listen.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/ssl_manager.h"
+
+namespace mongo {
+
+    namespace {
+
+        class ReactorLoop;
+
+        /**
+         * Everything the server keeps for a client connection between messages.
+         * At most one thread owns a connection at a time: either it is armed in its loop's
+         * epoll set (EPOLLONESHOT), its loop is reading from it, or exactly one worker is
+         * servicing it.
+         */
+        struct ReactorConnection {
+            enum ReadResult { Incomplete, Complete, Closed };
+
+            ReactorConnection( MessagingPort* p,
+                               ReactorLoop* l,
+                               MessageHandler::ConnectionState* s )
+                : port( p ), le( new LastError() ), state( s ), loop( l ), bytesIn( 0 ),
+                  _md( NULL ), _read( 0 ) {
+            }
+
+            ~ReactorConnection() {
+                free( _md );
+            }
+
+            /**
+             * Reads what the socket has of the next message, without blocking.  Once it
+             * returns Complete the message is in 'message', and 'bytesIn' counts the bytes
+             * read for it.
+             */
+            ReadResult readSome();
+
+            scoped_ptr<MessagingPort> port;
+            scoped_ptr<LastError> le;
+            scoped_ptr<MessageHandler::ConnectionState> state;
+            ReactorLoop* loop;
+            string threadName; // of a worker servicing it
+            string otherSide;
+            Message message;
+            long long bytesIn;
+
+        private:
+            /** checks the header just read, @return false if the connection is to be closed */
+            bool _startMessage();
+
+            MSGHEADER _header;
+            MsgData* _md;   // the message being read, once its header was
+            int _read;      // bytes of the message read so far
+        };
+
+        ReactorConnection::ReadResult ReactorConnection::readSome() {
+            const int headerLen = sizeof( MSGHEADER );
+            while ( true ) {
+                char* buf;
+                int want;
+                if ( ! _md ) {
+                    buf = reinterpret_cast<char*>( &_header ) + _read;
+                    want = headerLen - _read;
+                }
+                else {
+                    buf = reinterpret_cast<char*>( _md ) + _read;
+                    want = _header.messageLength - _read;
+                }
+
+                int ret = ::recv( port->psock->rawFD(), buf, want, MSG_DONTWAIT );
+                if ( ret == 0 )
+                    return Closed;
+                if ( ret < 0 ) {
+                    if ( errno == EINTR )
+                        continue;
+                    if ( errno == EAGAIN || errno == EWOULDBLOCK )
+                        return Incomplete;
+                    LOG(1) << "recv failed for " << otherSide << ": " << errnoWithDescription()
+                           << endl;
+                    return Closed;
+                }
+                _read += ret;
+                bytesIn += ret;
+
+                if ( ! _md && _read == headerLen && ! _startMessage() )
+                    return Closed;
+                if ( _md && _read == _header.messageLength ) {
+                    message.setData( _md, true );
+                    _md = NULL;
+                    _read = 0;
+                    return Complete;
+                }
+            }
+        }
+
+        bool ReactorConnection::_startMessage() {
+            int len = _header.messageLength;
+            if ( len == 542393671 ) {
+                // an http GET, answered like MessagingPort::recv() does
+                string msg = "It looks like you are trying to access MongoDB over HTTP on the native driver port.\n";
+                LOG( port->psock->getLogLevel() ) << msg << endl;
+                stringstream ss;
+                ss << "HTTP/1.0 200 OK\r\nConnection: close\r\nContent-Type: text/plain\r\nContent-Length: " << msg.size() << "\r\n\r\n" << msg;
+                string s = ss.str();
+                port->send( s.c_str(), s.size(), "http" );
+                return false;
+            }
+            if ( len == -1 ) {
+                // Endian check from the client, after connecting, to see what mode server is running in.
+                unsigned foo = 0x10203040;
+                port->send( (char *) &foo, 4, "endian" );
+                port->psock->setHandshakeReceived();
+                _read = 0;
+                return true;
+            }
+            if ( port->psock->isAwaitingHandshake() &&
+                 _header.responseTo != 0 && _header.responseTo != -1 ) {
+                // createServer() only uses a reactor without SSL
+                log() << "SSL handshake received from " << otherSide
+                      << " but server is started without SSL support" << endl;
+                return false;
+            }
+            if ( len < static_cast<int>(sizeof(MSGHEADER)) || len > MaxMessageSizeBytes ) {
+                LOG(0) << "recv(): message len " << len << " is invalid. "
+                       << "Min " << sizeof(MSGHEADER) << " Max: " << MaxMessageSizeBytes << endl;
+                return false;
+            }
+
+            port->psock->setHandshakeReceived();
+            int z = (len+1023)&0xfffffc00;
+            verify(z>=len);
+            _md = (MsgData *) malloc(z);
+            verify(_md);
+            memcpy(_md, &_header, sizeof(MSGHEADER));
+            return true;
+        }
+
+        /**
+         * One epoll set and the thread waiting on it.  Readable connections are removed from
+         * the set (by EPOLLONESHOT) and given to the callback, which reads from them without
+         * blocking and hands complete messages to the worker pool.
+         */
+        class ReactorLoop : boost::noncopyable {
+        public:
+            typedef boost::function<void(ReactorConnection*)> ReadyCallback;
+
+            ReactorLoop( int id, const ReadyCallback& onReady ) : _id( id ), _onReady( onReady ) {
+                _epfd = epoll_create1( EPOLL_CLOEXEC );
+                massert( 17349,
+                         str::stream() << "epoll_create1 failed: " << errnoWithDescription(),
+                         _epfd >= 0 );
+            }
+
+            ~ReactorLoop() {
+                close( _epfd );
+            }
+
+            void go() {
+                boost::thread thr( boost::bind( &ReactorLoop::run, this ) );
+            }
+
+            /** starts watching a connection that is not yet in the set */
+            bool add( ReactorConnection* c ) {
+                return _ctl( EPOLL_CTL_ADD, c );
+            }
+
+            /** re-arms a connection after a worker is done with it */
+            bool rearm( ReactorConnection* c ) {
+                return _ctl( EPOLL_CTL_MOD, c );
+            }
+
+        private:
+            bool _ctl( int op, ReactorConnection* c ) {
+                struct epoll_event ev;
+                memset( &ev, 0, sizeof(ev) );
+                ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+                ev.data.ptr = c;
+                if ( epoll_ctl( _epfd, op, c->port->psock->rawFD(), &ev ) != 0 ) {
+                    log() << "epoll_ctl failed for " << c->otherSide << ": "
+                          << errnoWithDescription() << endl;
+                    return false;
+                }
+                return true;
+            }
+
+            void run() {
+                string name = str::stream() << "reactor" << _id;
+                setThreadName( name.c_str() );
+
+                const int maxEvents = 256;
+                struct epoll_event events[maxEvents];
+
+                while ( ! inShutdown() ) {
+                    int n = epoll_wait( _epfd, events, maxEvents, 500 );
+                    if ( n < 0 ) {
+                        if ( errno == EINTR )
+                            continue;
+                        error() << "epoll_wait failed: " << errnoWithDescription() << endl;
+                        sleepmillis( 10 );
+                        continue;
+                    }
+                    for ( int i = 0; i < n; i++ ) {
+                        _onReady( static_cast<ReactorConnection*>( events[i].data.ptr ) );
+                    }
+                }
+            }
+
+            int _id;
+            int _epfd;
+            ReadyCallback _onReady;
+        };
+
+        class ReactorMessageServer : public MessageServer , public Listener {
+        public:
+            /**
+             * @param handler the handler to use. Caller is responsible for managing this object
+             *     and should make sure that it lives longer than this server.
+             */
+            ReactorMessageServer( const MessageServer::Options& opts,
+                                  MessageHandler* handler,
+                                  int reactorThreads,
+                                  int workerThreads ) :
+                Listener( "", opts.ipList, opts.port ),
+                _handler( handler ),
+                _workers( workerThreads ),
+                _nextLoop( 0 ) {
+
+                verify( _handler->isThreadAgnostic() );
+                verify( reactorThreads > 0 );
+                for ( int i = 0; i < reactorThreads; i++ ) {
+                    _loops.mutableVector().push_back( new ReactorLoop( i, boost::bind( &ReactorMessageServer::_ready,
+                                                                       this, _1 ) ) );
+                }
+            }
+
+            virtual void acceptedMP( MessagingPort* p ) {
+                if ( ! Listener::globalTicketHolder.tryAcquire() ) {
+                    log() << "connection refused because too many open connections: "
+                          << Listener::globalTicketHolder.used() << endl;
+
+                    p->shutdown();
+                    delete p;
+
+                    sleepmillis(2); // otherwise we'll hard loop
+                    return;
+                }
+
+                ReactorLoop* loop = _loops.vector()[ _nextLoop++ % _loops.size() ];
+                _workers.schedule( &ReactorMessageServer::_connect, this,
+                                   new ReactorConnection( p, loop,
+                                                          _handler->newConnectionState() ) );
+            }
+
+            virtual void setAsTimeTracker() {
+                Listener::setAsTimeTracker();
+            }
+
+            virtual void setupSockets() {
+                Listener::setupSockets();
+            }
+
+            void run() {
+                for ( size_t i = 0; i < _loops.size(); i++ )
+                    _loops.vector()[i]->go();
+                initAndListen();
+            }
+
+            virtual bool useUnixSockets() const { return true; }
+
+        private:
+            /** runs on a worker: introduces the connection to the handler and starts watching it */
+            void _connect( ReactorConnection* c ) {
+                c->threadName = "conn";
+                if ( c->port->connectionId() > 0 )
+                    c->threadName = str::stream() << c->threadName << c->port->connectionId();
+
+                lastError.reset( c->le.get() );
+                _attach( c );
+                bool ok = false;
+                try {
+                    c->port->psock->setLogLevel( logger::LogSeverity::Debug(1) );
+                    c->otherSide = c->port->psock->remoteString();
+                    _handler->connected( c->port.get() );
+                    ok = true;
+                }
+                catch ( const DBException& e ) {
+                    log() << "DBException accepting connection " << c->otherSide << ": " << e << endl;
+                }
+                _detach( c );
+                lastError.release();
+
+                // from here on the connection's loop may hand it to another worker
+                if ( ! ok || ! c->loop->add( c ) )
+                    _close( c );
+            }
+
+            /**
+             * called by a loop thread when a connection is readable or has hung up: reads
+             * what has arrived and has a worker process the message once it's whole
+             */
+            void _ready( ReactorConnection* c ) {
+                switch ( c->readSome() ) {
+                case ReactorConnection::Complete:
+                    _workers.schedule( &ReactorMessageServer::_service, this, c );
+                    return;
+                case ReactorConnection::Incomplete:
+                    if ( c->loop->rearm( c ) )
+                        return;
+                    break;
+                case ReactorConnection::Closed:
+                    break;
+                }
+                _workers.schedule( &ReactorMessageServer::_close, this, c );
+            }
+
+            /** runs on a worker: processes the message the connection's loop read */
+            void _service( ReactorConnection* c ) {
+                MessagingPort* p = c->port.get();
+                lastError.reset( c->le.get() );
+                _attach( c );
+
+                bool keep = false;
+                try {
+                    p->psock->clearCounters();
+                    _handler->process( c->message, p, c->le.get() );
+                    networkCounter.hit( c->bytesIn, p->psock->getBytesOut() );
+                    keep = ! inShutdown();
+                }
+                catch ( AssertionException& e ) {
+                    log() << "AssertionException handling request, closing client connection: " << e << endl;
+                }
+                catch ( SocketException& e ) {
+                    log() << "SocketException handling request, closing client connection: " << e << endl;
+                }
+                catch ( const DBException& e ) { // must be right above std::exception to avoid catching subclasses
+                    log() << "DBException handling request, closing client connection: " << e << endl;
+                }
+                catch ( std::exception &e ) {
+                    error() << "Uncaught std::exception: " << e.what() << ", terminating" << endl;
+                    dbexit( EXIT_UNCAUGHT );
+                }
+                catch ( ... ) {
+                    error() << "Uncaught exception, terminating" << endl;
+                    dbexit( EXIT_UNCAUGHT );
+                }
+                c->message.reset();
+                c->bytesIn = 0;
+
+                _detach( c );
+                lastError.release();
+
+                if ( keep && c->loop->rearm( c ) )
+                    return;
+
+                _close( c );
+            }
+
+            /** runs on a worker */
+            void _close( ReactorConnection* c ) {
+                TicketHolderReleaser connTicketReleaser( &Listener::globalTicketHolder );
+                if (!serverGlobalParams.quiet) {
+                    int conns = Listener::globalTicketHolder.used()-1;
+                    const char* word = (conns == 1 ? " connection" : " connections");
+                    log() << "end connection " << c->otherSide
+                          << " (" << conns << word << " now open)" << endl;
+                }
+                c->port->shutdown();
+
+                lastError.reset( c->le.get() );
+                _attach( c );
+                _handler->disconnected( c->port.get() );
+                _detach( c );
+                lastError.release();
+
+                // closing the socket also removes it from the epoll set
+                delete c;
+            }
+
+            /** moves the handler's state for the connection onto the calling worker */
+            static void _attach( ReactorConnection* c ) {
+                setThreadName( c->threadName.c_str() );
+                if ( c->state )
+                    c->state->attach();
+            }
+
+            static void _detach( ReactorConnection* c ) {
+                if ( c->state )
+                    c->state->detach();
+                setThreadName( "reactorWorker" );
+            }
+
+            MessageHandler* _handler;
+            ThreadPool _workers;
+            OwnedPointerVector<ReactorLoop> _loops;
+            unsigned _nextLoop; // only used by the listener thread
+        };
+
+    } // namespace
+
+    bool reactorMessageServerSupported() {
+        return true;
+    }
+
+    MessageServer* createReactorServer( const MessageServer::Options& opts,
+                                        MessageHandler* handler,
+                                        int reactorThreads,
+                                        int workerThreads ) {
+        return new ReactorMessageServer( opts, handler, reactorThreads, workerThreads );
+    }
+
+} // namespace mongo
+
+#else
+
+namespace mongo {
+
+    bool reactorMessageServerSupported() {
+        return false;
+    }
+
+    MessageServer* createReactorServer( const MessageServer::Options& opts,
+                                        MessageHandler* handler,
+                                        int reactorThreads,
+                                        int workerThreads ) {
+        msgasserted( 17350, "the reactor message server is only supported on linux" );
+        return NULL;
+    }
+
+} // namespace mongo
+
+#endif
@@ -0,0 +1,47 @@
+// message_server_reactor.h
+
+/*    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/message_server.h"
+
+namespace mongo {
+
+    /**
+     * @return true if this platform can multiplex client connections over a reactor.
+     */
+    bool reactorMessageServerSupported();
+
+    /**
+     * Creates a message server which waits for client sockets to become readable on
+     * 'reactorThreads' epoll loops, which read messages without blocking.  Each complete
+     * message is handed to one of 'workerThreads' worker threads, which processes it and
+     * re-arms the socket.  Idle connections, and clients sending slowly, therefore cost a
+     * file descriptor and a small amount of heap instead of a thread with its own stack.
+     *
+     * The handler must be thread agnostic (see MessageHandler::isThreadAgnostic()), and its
+     * connection state is attached to the worker for each call.  Connections can't use SSL.
+     * Only available if reactorMessageServerSupported().
+     */
+    MessageServer* createReactorServer( const MessageServer::Options& opts,
+                                        MessageHandler* handler,
+                                        int reactorThreads,
+                                        int workerThreads );
+
+}
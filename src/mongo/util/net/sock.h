@@ -228,6 +228,15 @@ namespace mongo {
         void setTimeout( double secs );
         bool isStillConnected();
 
+        /** @return true if traffic goes through SSL, which may buffer data poll() can't see */
+        bool isSecure() const {
+#ifdef MONGO_SSL
+            return _sslConnection.get() != NULL;
+#else
+            return false;
+#endif
+        }
+
         void setHandshakeReceived() {
             _awaitingHandshake = false;
         }
@@ -0,0 +1,445 @@
+/*    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <boost/intrusive_ptr.hpp>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    /**
+     * An ordered map with most of the interface of std::map, whose copies share their structure.
+     *
+     * Copying a PersistentMap is O(1): both copies point to the same balanced tree.  A change to
+     * one of them copies only the O(log n) nodes on the path to the changed entry, every other
+     * node stays shared with the copy, which is unaffected.  Nodes only reachable from the map
+     * being changed are updated in place, so building up a map which isn't shared costs about
+     * what it costs with std::map.
+     *
+     * This makes it cheap to derive a new version of a large map from an old one which readers
+     * may still be using, e.g. a new chunk map from the previous one and a few chunk diffs.
+     *
+     * Entries can't be changed through iterators, and iterators are only valid as long as the
+     * version of the map they came from isn't changed or destroyed.  Different versions can be
+     * used concurrently, but as with std::map a single version must not be changed while it's
+     * read.
+     */
+    template <typename K, typename V, typename Compare = std::less<K> >
+    class PersistentMap {
+    public:
+        typedef K key_type;
+        typedef V mapped_type;
+        typedef std::pair<const K, V> value_type;
+        typedef Compare key_compare;
+        typedef size_t size_type;
+
+        class const_iterator;
+        // entries are never changed in place, so there's only one kind of iterator
+        typedef const_iterator iterator;
+
+    private:
+        class Node {
+        public:
+            explicit Node( const value_type& v ) : value( v ), height( 1 ) {}
+            Node( const Node& other )
+                : value( other.value )
+                , left( other.left )
+                , right( other.right )
+                , height( other.height ) {
+            }
+
+            const K& key() const { return value.first; }
+
+            /**
+             * If false, the one reference to this node is the one it was reached through, and no
+             * other thread can get another one.
+             */
+            bool isShared() const { return _refCount.loadRelaxed() > 1; }
+
+            friend void intrusive_ptr_add_ref( Node* n ) { n->_refCount.addAndFetch( 1 ); }
+            friend void intrusive_ptr_release( Node* n ) {
+                if ( n->_refCount.subtractAndFetch( 1 ) == 0 )
+                    delete n;
+            }
+
+            const value_type value;
+            boost::intrusive_ptr<Node> left;
+            boost::intrusive_ptr<Node> right;
+            int height;
+
+        private:
+            Node& operator=( const Node& );
+
+            AtomicUInt32 _refCount; // starts at 0
+        };
+
+        typedef boost::intrusive_ptr<Node> NodePtr;
+
+        // An AVL tree of n nodes is less than 1.45 * log2(n + 2) high
+        static const int MaxHeight = 64;
+
+    public:
+
+        /**
+         * A bidirectional iterator, which remembers the path from the root to its entry since
+         * nodes have no parent pointers (they may have several).
+         */
+        class const_iterator {
+        public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef typename PersistentMap::value_type value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const value_type* pointer;
+            typedef const value_type& reference;
+
+            const_iterator() : _root( NULL ), _depth( 0 ) {}
+
+            const_iterator( const const_iterator& other )
+                : _root( other._root )
+                , _depth( other._depth ) {
+                std::copy( other._path, other._path + _depth, _path );
+            }
+
+            const_iterator& operator=( const const_iterator& other ) {
+                _root = other._root;
+                _depth = other._depth;
+                std::copy( other._path, other._path + _depth, _path );
+                return *this;
+            }
+
+            reference operator*() const { return _node()->value; }
+            pointer operator->() const { return &_node()->value; }
+
+            const_iterator& operator++() {
+                const Node* n = _node();
+                if ( n->right ) {
+                    _push( n->right.get() );
+                    _pushLeftmost();
+                    return *this;
+                }
+                // up to the first ancestor whose left subtree we've finished, or to end()
+                while ( true ) {
+                    const Node* child = _path[--_depth];
+                    if ( _depth == 0 || _path[_depth - 1]->left.get() == child )
+                        return *this;
+                }
+            }
+
+            const_iterator& operator--() {
+                if ( _depth == 0 ) {
+                    // from end() to the last entry
+                    _push( _root );
+                    _pushRightmost();
+                    return *this;
+                }
+                const Node* n = _node();
+                if ( n->left ) {
+                    _push( n->left.get() );
+                    _pushRightmost();
+                    return *this;
+                }
+                while ( true ) {
+                    const Node* child = _path[--_depth];
+                    // decrementing begin() is undefined, as with std::map
+                    dassert( _depth > 0 );
+                    if ( _path[_depth - 1]->right.get() == child )
+                        return *this;
+                }
+            }
+
+            const_iterator operator++( int ) {
+                const_iterator old( *this );
+                ++*this;
+                return old;
+            }
+
+            const_iterator operator--( int ) {
+                const_iterator old( *this );
+                --*this;
+                return old;
+            }
+
+            bool operator==( const const_iterator& other ) const {
+                return _current() == other._current();
+            }
+            bool operator!=( const const_iterator& other ) const { return !( *this == other ); }
+
+        private:
+            friend class PersistentMap;
+
+            explicit const_iterator( const Node* root ) : _root( root ), _depth( 0 ) {}
+
+            const Node* _node() const {
+                dassert( _depth > 0 );
+                return _path[_depth - 1];
+            }
+            const Node* _current() const { return _depth == 0 ? NULL : _path[_depth - 1]; }
+
+            void _push( const Node* n ) {
+                dassert( _depth < MaxHeight );
+                _path[_depth++] = n;
+            }
+            void _pushLeftmost() {
+                while ( _node()->left )
+                    _push( _node()->left.get() );
+            }
+            void _pushRightmost() {
+                while ( _node()->right )
+                    _push( _node()->right.get() );
+            }
+
+            const Node* _root;
+            int _depth;
+            const Node* _path[MaxHeight];
+        };
+
+        explicit PersistentMap( const Compare& cmp = Compare() ) : _cmp( cmp ), _size( 0 ) {}
+
+        const_iterator begin() const {
+            const_iterator it( _root.get() );
+            if ( _root ) {
+                it._push( _root.get() );
+                it._pushLeftmost();
+            }
+            return it;
+        }
+
+        const_iterator end() const { return const_iterator( _root.get() ); }
+
+        size_type size() const { return _size; }
+        bool empty() const { return _size == 0; }
+
+        const_iterator find( const K& key ) const {
+            const_iterator it = lower_bound( key );
+            if ( it != end() && _cmp( key, it->first ) )
+                return end();
+            return it;
+        }
+
+        size_type count( const K& key ) const { return find( key ) == end() ? 0 : 1; }
+
+        /** @return the first entry whose key is not less than 'key' */
+        const_iterator lower_bound( const K& key ) const { return _bound( key, false ); }
+
+        /** @return the first entry whose key is greater than 'key' */
+        const_iterator upper_bound( const K& key ) const { return _bound( key, true ); }
+
+        /**
+         * Adds 'v' unless its key is already present, like std::map::insert().
+         * @return whether 'v' was added
+         */
+        bool insert( const value_type& v ) {
+            if ( !_insert( _root, v ) )
+                return false;
+            _size++;
+            return true;
+        }
+
+        /** @return the number of entries removed, 0 or 1 */
+        size_type erase( const K& key ) {
+            if ( !_erase( _root, key ) )
+                return 0;
+            _size--;
+            return 1;
+        }
+
+        /** Removes the entries in [first, last), in O(k log n) for k entries. */
+        void erase( const_iterator first, const const_iterator& last ) {
+            // the iterators are invalidated by the first change
+            std::vector<K> keys;
+            for ( ; first != last; ++first )
+                keys.push_back( first->first );
+
+            for ( size_t i = 0; i < keys.size(); i++ )
+                erase( keys[i] );
+        }
+
+        void clear() {
+            _root.reset();
+            _size = 0;
+        }
+
+        void swap( PersistentMap& other ) {
+            std::swap( _cmp, other._cmp );
+            _root.swap( other._root );
+            std::swap( _size, other._size );
+        }
+
+    private:
+
+        const_iterator _bound( const K& key, bool upper ) const {
+            const_iterator it( _root.get() );
+            int found = 0;
+            for ( const Node* n = _root.get(); n; ) {
+                it._push( n );
+                if ( upper ? _cmp( key, n->key() ) : !_cmp( n->key(), key ) ) {
+                    // n is a candidate, look for a smaller one on its left
+                    found = it._depth;
+                    n = n->left.get();
+                }
+                else {
+                    n = n->right.get();
+                }
+            }
+            // the path to the last candidate is a prefix of the path searched
+            it._depth = found;
+            return it;
+        }
+
+        static int _height( const NodePtr& n ) { return n ? n->height : 0; }
+
+        static void _fixHeight( Node* n ) {
+            n->height = 1 + std::max( _height( n->left ), _height( n->right ) );
+        }
+
+        /** Makes 'n' a node which only this map references, copying it if it is shared. */
+        static Node* _writable( NodePtr& n ) {
+            if ( n->isShared() )
+                n = NodePtr( new Node( *n ) );
+            return n.get();
+        }
+
+        // The rotations expect n and the child moving up to be writable
+
+        static void _rotateRight( NodePtr& n ) {
+            NodePtr l;
+            l.swap( n->left );
+            n->left.swap( l->right );
+            _fixHeight( n.get() );
+            l->right.swap( n );
+            _fixHeight( l.get() );
+            n.swap( l );
+        }
+
+        static void _rotateLeft( NodePtr& n ) {
+            NodePtr r;
+            r.swap( n->right );
+            n->right.swap( r->left );
+            _fixHeight( n.get() );
+            r->left.swap( n );
+            _fixHeight( r.get() );
+            n.swap( r );
+        }
+
+        /** Restores the AVL balance of a writable 'n' whose subtrees are balanced. */
+        static void _rebalance( NodePtr& n ) {
+            int balance = _height( n->left ) - _height( n->right );
+            if ( balance > 1 ) {
+                Node* l = _writable( n->left );
+                if ( _height( l->left ) < _height( l->right ) ) {
+                    _writable( l->right );
+                    _rotateLeft( n->left );
+                }
+                _rotateRight( n );
+            }
+            else if ( balance < -1 ) {
+                Node* r = _writable( n->right );
+                if ( _height( r->right ) < _height( r->left ) ) {
+                    _writable( r->left );
+                    _rotateRight( n->right );
+                }
+                _rotateLeft( n );
+            }
+            else {
+                _fixHeight( n.get() );
+            }
+        }
+
+        /** @return whether 'v' was added below 'n' */
+        bool _insert( NodePtr& n, const value_type& v ) {
+            if ( !n ) {
+                n = NodePtr( new Node( v ) );
+                return true;
+            }
+
+            // if the key is present the path to it is copied for nothing, which is rare enough
+            Node* w = _writable( n );
+            bool inserted;
+            if ( _cmp( v.first, w->key() ) )
+                inserted = _insert( w->left, v );
+            else if ( _cmp( w->key(), v.first ) )
+                inserted = _insert( w->right, v );
+            else
+                return false;
+
+            if ( inserted )
+                _rebalance( n );
+            return inserted;
+        }
+
+        /** Detaches the smallest node below 'n' into 'min', writable and without children. */
+        static void _removeMin( NodePtr& n, NodePtr* min ) {
+            Node* w = _writable( n );
+            if ( !w->left ) {
+                min->swap( n );
+                n.swap( ( *min )->right );
+                return;
+            }
+            _removeMin( w->left, min );
+            _rebalance( n );
+        }
+
+        /** @return whether 'key' was removed from below 'n' */
+        bool _erase( NodePtr& n, const K& key ) {
+            if ( !n )
+                return false;
+
+            Node* w = _writable( n );
+            if ( _cmp( key, w->key() ) ) {
+                if ( !_erase( w->left, key ) )
+                    return false;
+            }
+            else if ( _cmp( w->key(), key ) ) {
+                if ( !_erase( w->right, key ) )
+                    return false;
+            }
+            else {
+                // the removed node is released when 'old' goes out of scope
+                NodePtr old;
+                if ( !w->left || !w->right ) {
+                    NodePtr child;
+                    child.swap( w->left ? w->left : w->right );
+                    old.swap( n );
+                    n.swap( child );
+                    return true;
+                }
+
+                // replace n with the smallest node of its right subtree
+                NodePtr min;
+                _removeMin( w->right, &min );
+                min->left.swap( w->left );
+                min->right.swap( w->right );
+                old.swap( n );
+                n.swap( min );
+            }
+            _rebalance( n );
+            return true;
+        }
+
+        Compare _cmp;
+        NodePtr _root;
+        size_type _size;
+    };
+
+}
@@ -0,0 +1,173 @@
+/*    Copyright 2013 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/unittest/unittest.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "mongo/platform/random.h"
+#include "mongo/util/persistent_map.h"
+
+namespace {
+
+    using namespace mongo;
+
+    typedef PersistentMap<int, std::string> IntMap;
+    typedef std::map<int, std::string> StdIntMap;
+
+    /** Checks iteration in both directions, and the lookups of every key around the entries. */
+    void assertSame( const StdIntMap& expected, const IntMap& map ) {
+        ASSERT_EQUALS( expected.size(), map.size() );
+        ASSERT_EQUALS( expected.empty(), map.empty() );
+
+        IntMap::const_iterator it = map.begin();
+        for ( StdIntMap::const_iterator i = expected.begin(); i != expected.end(); ++i, ++it ) {
+            ASSERT( it != map.end() );
+            ASSERT_EQUALS( i->first, it->first );
+            ASSERT_EQUALS( i->second, it->second );
+        }
+        ASSERT( it == map.end() );
+
+        for ( StdIntMap::const_reverse_iterator i = expected.rbegin(); i != expected.rend(); ++i ) {
+            --it;
+            ASSERT_EQUALS( i->first, it->first );
+        }
+        ASSERT( it == map.begin() );
+
+        int lo = expected.empty() ? 0 : expected.begin()->first - 1;
+        int hi = expected.empty() ? 0 : expected.rbegin()->first + 1;
+        for ( int k = lo; k <= hi; k++ ) {
+            StdIntMap::const_iterator e = expected.lower_bound( k );
+            IntMap::const_iterator m = map.lower_bound( k );
+            ASSERT_EQUALS( e == expected.end(), m == map.end() );
+            if ( e != expected.end() )
+                ASSERT_EQUALS( e->first, m->first );
+
+            e = expected.upper_bound( k );
+            m = map.upper_bound( k );
+            ASSERT_EQUALS( e == expected.end(), m == map.end() );
+            if ( e != expected.end() )
+                ASSERT_EQUALS( e->first, m->first );
+
+            ASSERT_EQUALS( expected.count( k ), map.count( k ) );
+            ASSERT_EQUALS( expected.find( k ) == expected.end(), map.find( k ) == map.end() );
+        }
+    }
+
+    TEST(PersistentMapTest, Empty) {
+        IntMap map;
+        ASSERT( map.begin() == map.end() );
+        ASSERT( map.find( 1 ) == map.end() );
+        ASSERT( map.lower_bound( 1 ) == map.end() );
+        ASSERT_EQUALS( 0U, map.erase( 1 ) );
+        assertSame( StdIntMap(), map );
+    }
+
+    TEST(PersistentMapTest, InsertKeepsExisting) {
+        IntMap map;
+        ASSERT( map.insert( std::make_pair( 1, std::string( "a" ) ) ) );
+        ASSERT( !map.insert( std::make_pair( 1, std::string( "b" ) ) ) );
+        ASSERT_EQUALS( "a", map.find( 1 )->second );
+        ASSERT_EQUALS( 1U, map.size() );
+    }
+
+    TEST(PersistentMapTest, EraseRange) {
+        IntMap map;
+        StdIntMap expected;
+        for ( int i = 0; i < 100; i += 2 ) {
+            map.insert( std::make_pair( i, std::string( "x" ) ) );
+            expected.insert( std::make_pair( i, std::string( "x" ) ) );
+        }
+
+        map.erase( map.lower_bound( 11 ), map.upper_bound( 51 ) );
+        expected.erase( expected.lower_bound( 11 ), expected.upper_bound( 51 ) );
+        assertSame( expected, map );
+
+        map.erase( map.begin(), map.end() );
+        assertSame( StdIntMap(), map );
+    }
+
+    TEST(PersistentMapTest, RandomAgainstStdMap) {
+        PseudoRandom random( 12345 );
+        IntMap map;
+        StdIntMap expected;
+        for ( int i = 0; i < 20000; i++ ) {
+            int key = random.nextInt32( 1000 );
+            if ( random.nextInt32( 3 ) == 0 ) {
+                ASSERT_EQUALS( expected.erase( key ), map.erase( key ) );
+            }
+            else {
+                std::pair<int, std::string> v( key, std::string( 1, 'a' + i % 26 ) );
+                ASSERT_EQUALS( expected.insert( v ).second, map.insert( v ) );
+            }
+            if ( i % 1000 == 0 )
+                assertSame( expected, map );
+        }
+        assertSame( expected, map );
+    }
+
+    TEST(PersistentMapTest, CopiesAreUnaffected) {
+        PseudoRandom random( 54321 );
+        IntMap map;
+        StdIntMap expected;
+        for ( int i = 0; i < 1000; i++ ) {
+            map.insert( std::make_pair( i * 10, std::string( "v" ) ) );
+            expected.insert( std::make_pair( i * 10, std::string( "v" ) ) );
+        }
+
+        // every version derived from the last one by a few changes, as chunk maps are
+        std::vector<IntMap> versions;
+        std::vector<StdIntMap> expectedVersions;
+        for ( int v = 0; v < 20; v++ ) {
+            versions.push_back( map );
+            expectedVersions.push_back( expected );
+
+            for ( int j = 0; j < 10; j++ ) {
+                int key = random.nextInt32( 10000 );
+                map.erase( key );
+                expected.erase( key );
+                std::pair<int, std::string> entry( random.nextInt32( 10000 ), std::string( "w" ) );
+                map.insert( entry );
+                expected.insert( entry );
+            }
+        }
+
+        assertSame( expected, map );
+        for ( size_t v = 0; v < versions.size(); v++ ) {
+            assertSame( expectedVersions[v], versions[v] );
+        }
+
+        // releasing old versions leaves the newer ones intact
+        versions.erase( versions.begin(), versions.begin() + 10 );
+        expectedVersions.erase( expectedVersions.begin(), expectedVersions.begin() + 10 );
+        map.clear();
+        for ( size_t v = 0; v < versions.size(); v++ ) {
+            assertSame( expectedVersions[v], versions[v] );
+        }
+    }
+
+    TEST(PersistentMapTest, Swap) {
+        IntMap a;
+        IntMap b;
+        a.insert( std::make_pair( 1, std::string( "a" ) ) );
+        a.swap( b );
+        ASSERT( a.empty() );
+        ASSERT_EQUALS( 1U, b.size() );
+        ASSERT_EQUALS( "a", b.begin()->second );
+    }
+
+} // namespace
@@ -21,6 +21,7 @@
 
 #include <limits>
 #include <queue>
+#include <vector>
 
 #include <boost/thread/condition.hpp>
 
@@ -69,6 +70,28 @@ namespace mongo {
             _cvNoLongerEmpty.notify_one();
         }
 
+        /**
+         * Pushes all of 'ts' at once, in order, waiting until there is room for all of them.  A
+         * batch larger than the max size is let in once the queue is empty, so it can't block
+         * forever.
+         */
+        void pushAll(const std::vector<T>& ts) {
+            size_t tsSize = 0;
+            for (size_t i = 0; i < ts.size(); i++) {
+                tsSize += _getSize(ts[i]);
+            }
+
+            scoped_lock l( _lock );
+            while (!_queue.empty() && _currentSize + tsSize >= _maxSize) {
+                _cvNoLongerFull.wait( l.boost() );
+            }
+            for (size_t i = 0; i < ts.size(); i++) {
+                _queue.push( ts[i] );
+            }
+            _currentSize += tsSize;
+            _cvNoLongerEmpty.notify_one();
+        }
+
         bool empty() const {
             scoped_lock l( _lock );
             return _queue.empty();